@@ -3,24 +3,544 @@
 */
 #include "stdafx.h"     // This must be present if you use precompiled headers which you will use.
 #include "Assembler.h"
+#include "BatchRunner.h"
+#include "ForkServer.h"
+#include "MappedFile.h"
+#include "Evaluator.h"
+#include "TraceReplay.h"
+#include "ReverseDebugger.h"
+#include "FileWatcher.h"
 
-int main(int argc, char *argv[])
+// The options of a single assembly, read from the command line.
+struct CommandLine {
+	const char *fileName;   // The source file.
+	bool useJit;            // Run the emulator with the JIT (--jit).
+	bool showStats;         // Display emulator statistics (--stats).
+	bool profile;           // Profile the run of the emulator (--profile).
+	string inputName;       // Input file for READ (--input=FILE), empty for cin.
+	bool evaluate;          // Evaluate programs that never READ (--evaluate[=STEPS]).
+	long long budget;       // Most steps an evaluated program may take.
+	bool detectLoops;       // Stop a program that repeats a state (--detect-loops).
+	string traceName;       // Trace file to record the run in (--trace=FILE), empty for none.
+	bool debug;             // Take the run back afterwards (--debug[=MB]).
+	size_t undoBytes;       // Memory for the undo log.
+	bool singlePass;        // Read the source only once (--single-pass).
+	bool listing;           // Display the symbol table and translation (not --no-listing).
+	string objectName;      // Object file to write the translation to (--object=FILE), empty for none.
+	bool strip;             // Leave the symbols and lines out of the object file (--strip).
+	bool runObject;         // The file is an object file to run, not source (--run).
+	bool watch;             // Assemble and run again each time the source is saved (--watch).
+	int threads;            // Most threads the passes run on (--threads=N), 0 for one for each core.
+};
+
+// Bytes of emulator output collected before it is written (--input).
+const static int OUTPUT_BUFFER_SIZE = 1 << 16;
+
+/*
+NAME
+
+ReadCommandLine - Reads the options and source file from the command line.
+
+SYNOPSIS
+
+static bool ReadCommandLine(int argc, char *argv[], CommandLine &a_options);
+
+argc - the number of command line arguments.
+
+argv - the commmand line arguments in an array.
+
+a_options - passed by reference, set to the options given.
+
+DESCRIPTION
+
+There must be exactly one argument besides the options, the source file,
+or with --run the object file.  --debug reads its commands from cin, so
+it needs the program's input given with --input.
+Errors in the command line are displayed here.
+
+RETURNS
+
+True if the command line was valid, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+static bool ReadCommandLine(int argc, char *argv[], CommandLine &a_options)
 {
-	Assembler assem(argc, argv);
+	a_options.fileName = NULL;
+	a_options.useJit = false;
+	a_options.showStats = false;
+	a_options.profile = false;
+	a_options.evaluate = false;
+	a_options.budget = Evaluator::DEFAULT_BUDGET;
+	a_options.detectLoops = false;
+	a_options.debug = false;
+	a_options.undoBytes = UndoLog::DEFAULT_BYTES;
+	a_options.singlePass = false;
+	a_options.listing = true;
+	a_options.strip = false;
+	a_options.runObject = false;
+	a_options.watch = false;
+	a_options.threads = 0;
 
-	// Establish the location of the labels:
-	assem.PassI();
+	int fileCount = 0;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--jit") {
+			a_options.useJit = true;
+		}
+		else if (arg == "--stats") {
+			a_options.showStats = true;
+		}
+		else if (arg == "--single-pass") {
+			a_options.singlePass = true;
+		}
+		else if (arg == "--no-listing") {
+			a_options.listing = false;
+		}
+		else if (arg.compare(0, 9, "--object=") == 0) {
+			a_options.objectName = arg.substr(9);
+		}
+		else if (arg == "--strip") {
+			a_options.strip = true;
+		}
+		else if (arg == "--run") {
+			a_options.runObject = true;
+		}
+		else if (arg == "--watch") {
+			a_options.watch = true;
+		}
+		else if (arg.compare(0, 10, "--threads=") == 0) {
+			a_options.threads = atoi(arg.c_str() + 10);
+			if (a_options.threads <= 0) {
+				cerr << "Invalid thread count " << arg << endl;
+				return false;
+			}
+		}
+		else if (arg == "--profile") {
+			a_options.profile = true;
+		}
+		else if (arg.compare(0, 8, "--input=") == 0) {
+			a_options.inputName = arg.substr(8);
+		}
+		else if (arg.compare(0, 8, "--trace=") == 0) {
+			a_options.traceName = arg.substr(8);
+		}
+		else if (arg == "--detect-loops") {
+			a_options.detectLoops = true;
+		}
+		else if (arg == "--debug") {
+			a_options.debug = true;
+		}
+		else if (arg.compare(0, 8, "--debug=") == 0) {
+			a_options.debug = true;
+			long long megabytes = atoll(arg.c_str() + 8);
+			if (megabytes <= 0 || megabytes > 4096) {
+				cerr << "Invalid undo log size " << arg << endl;
+				return false;
+			}
+			a_options.undoBytes = (size_t)megabytes << 20;
+		}
+		else if (arg == "--evaluate") {
+			a_options.evaluate = true;
+		}
+		else if (arg.compare(0, 11, "--evaluate=") == 0) {
+			a_options.evaluate = true;
+			a_options.budget = atoll(arg.c_str() + 11);
+			if (a_options.budget <= 0) {
+				cerr << "Invalid step budget " << arg << endl;
+				return false;
+			}
+		}
+		else if (arg.compare(0, 2, "--") == 0) {
+			cerr << "Unknown option " << arg << endl;
+			return false;
+		}
+		else {
+			a_options.fileName = argv[i];
+			fileCount++;
+		}
+	}
+	if (a_options.runObject && a_options.profile) {
+		cerr << "--profile needs the source, not an object file" << endl;
+		return false;
+	}
+	if (a_options.watch && (a_options.runObject || a_options.singlePass || a_options.profile)) {
+		cerr << "--watch cannot be used with --run, --single-pass or --profile" << endl;
+		return false;
+	}
+	if (a_options.debug && a_options.inputName.empty()) {
+		// The debugger's commands are read from cin, so READ cannot be too.
+		cerr << "--debug needs the program's input given with --input=<File>" << endl;
+		return false;
+	}
+	if (fileCount != 1) {
+		cerr << "Usage: Assem [--single-pass | --watch] [--threads=<N>] [--no-listing] [--object=<File> [--strip]] [--jit] [--stats] [--input=<File>] [--profile] [--evaluate[=<Steps>]] [--detect-loops] [--trace=<File>] [--debug[=<MB>]] <FileName>, or Assem --batch <Manifest> [options], or Assem --fork-server <FileName> [options], or Assem --replay <Trace> [options], or Assem --run <Object> [options]" << endl;
+		return false;
+	}
+	return true;
+}
 
-	// Display the symbol table.
-	assem.DisplaySymbolTable();
+/*
+NAME
 
-	//// Output the symbol table and the translation.
-	assem.PassII(); 
+EvaluateProgram - Evaluates the translation of a program that never reads.
 
-	//// Run the emulator on the VC3600 program that came from the translation.
-	assem.RunEmulator(); 
+SYNOPSIS
+
+static Evaluator *EvaluateProgram(Assembler &a_assem, const CommandLine &a_options);
+
+a_assem - the translated program.
+
+a_options - the options from the command line.
+
+DESCRIPTION
+
+This is the stage after Pass II, or after the program is loaded from an
+object file, when --evaluate was given and the program is to be
+interpreted or compiled rather than profiled, traced or debugged.  A
+program that never reads is run once, up to the step budget, and its
+result, output and final memory are kept in a cache file next to the
+source, "<FileName>.eval", which later runs of the same translation take
+them from without emulating.
+
+RETURNS
+
+The evaluator holding the result, to be deleted by the caller, or NULL
+if the program reads, does not finish within the budget or is not to be
+evaluated.
+
+AUTHOR
+
+Charles Snyder
+*/
+static Evaluator *EvaluateProgram(Assembler &a_assem, const CommandLine &a_options)
+{
+	if (!a_options.evaluate || a_options.profile || !a_options.traceName.empty() || a_options.debug) {
+		return NULL;
+	}
+	Evaluator *evaluator = new Evaluator(a_assem.GetEmulator(), a_assem.GetStartLocation());
+	if (!evaluator->Evaluate(string(a_options.fileName) + ".eval", a_options.budget)) {
+		delete evaluator;
+		return NULL;
+	}
+	return evaluator;
+}
+
+/*
+NAME
+
+RunEmulator - Runs the emulator and displays the results.
+
+SYNOPSIS
+
+static int RunEmulator(Assembler &a_assem, const CommandLine &a_options, const ObjectFile *a_object, const Evaluator *a_evaluator);
+
+a_assem - the assembled program.
+
+a_options - the options from the command line.
+
+a_object - the object file the program was loaded from, NULL if it was assembled.
+
+a_evaluator - the result of EvaluateProgram, NULL if the program was not evaluated.
+
+DESCRIPTION
+
+Runs the emulator and displays the results to the screen.  If --jit was
+given the program is compiled to native code instead of interpreted.
+If --stats was given the number of instructions executed and fused by
+the interpreter are displayed afterwards.  If --input=FILE was given the
+READ values are taken from the file, without prompting, and the output
+is buffered until the program ends.  If --profile was given the program
+is interpreted while counting each instruction, and an annotated listing
+of the counts is displayed afterwards; this takes precedence over --jit.
+
+If the program was evaluated by EvaluateProgram, its output is displayed
+and its final memory and accumulator are loaded into the emulator
+instead of running it.
 
-	// Terminate indicating all is well.  If there is an unrecoverable error, the 
-	// program will terminate at the point that it occurred.
+If --trace=FILE was given, and not --profile, the program is interpreted
+while each instruction is recorded in the trace file, which Assem
+--replay reads.
+
+If --debug was given, and neither --profile nor --trace, the program is
+interpreted while what each instruction changes is kept in an undo log
+of 64 MB, or of the size given.  When the run stops, commands are read
+from cin that take it back a step at a time or to a location, and that
+find the instruction that last wrote a location.  The program's READs
+then come from the --input file, which --debug requires.
+
+If --detect-loops was given, a run that comes back to a state it was in
+before is stopped and the locations of the loop are displayed; the
+program is then interpreted even if --jit was given.
+
+A program loaded from an object file that stops with a runtime error has
+the line of the source the instruction came from displayed, if the object
+file was not stripped.
+
+RETURNS
+
+The exit status for the program: 1 if the input or trace file could not
+be opened or written or the program stopped with a runtime error or in a loop, 0 otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+static int RunEmulator(Assembler &a_assem, const CommandLine &a_options, const ObjectFile *a_object, const Evaluator *a_evaluator)
+{
+	cout << endl;
+	cout << "Results from emulating program:" << endl << endl;
+
+	emulator &emul = a_assem.GetEmulator();
+	MappedFile input;
+	if (a_options.inputName.empty()) {
+		emul.SetIO(cin, cout, true);
+	}
+	else {
+		if (!input.Open(a_options.inputName)) {
+			cerr << "Input file could not be opened: " << a_options.inputName << endl;
+			return 1;
+		}
+		emul.SetIO(cin, cout, false);
+		emul.SetInputBuffer(input.GetData(), input.GetData() + input.GetSize());
+		emul.SetOutputBuffer(OUTPUT_BUFFER_SIZE);
+	}
+	emul.SetLoopDetection(a_options.detectLoops);
+
+	Assembler::RunMode mode = Assembler::RM_Interpret;
+	TraceWriter trace;
+	if (a_options.profile) {
+		mode = Assembler::RM_Profile;
+	}
+	else if (!a_options.traceName.empty()) {
+		if (!trace.Open(a_options.traceName)) {
+			cerr << "Trace file could not be opened: " << a_options.traceName << endl;
+			return 1;
+		}
+		a_assem.SetTrace(&trace);
+		mode = Assembler::RM_Trace;
+	}
+	else if (a_options.debug) {
+		mode = Assembler::RM_Undo;
+	}
+	else if (a_options.useJit) {
+		mode = Assembler::RM_Jit;
+	}
+	UndoLog *undo = NULL;
+	if (mode == Assembler::RM_Undo) {
+		undo = new UndoLog(a_options.undoBytes);
+		a_assem.SetUndoLog(undo);
+	}
+	emulator::RunResult result;
+	if (a_evaluator != NULL) {
+		cout << a_evaluator->GetOutput();
+		result = a_evaluator->GetResult();
+		emul.LoadWords(&a_evaluator->GetMemory()[0], 1, a_evaluator->GetAccumulator());
+	}
+	else {
+		result = a_assem.Run(mode);
+	}
+	if (undo != NULL) {
+		ReverseDebugger debugger(emul, *undo);
+		debugger.Run(cin, cout);
+		a_assem.SetUndoLog(NULL);
+		delete undo;
+	}
+	if (mode == Assembler::RM_Trace && !trace.Close()) {
+		cerr << "Trace file could not be written: " << a_options.traceName << endl;
+		return 1;
+	}
+	if (result.status == emulator::RS_RuntimeError) {
+		int line = a_object == NULL ? -1 : a_object->FindLine(result.location);
+		if (line != -1) {
+			cout << "The instruction at location " << result.location << " is from line " << line << endl;
+		}
+		// The profile up to the error is still worth seeing.
+		if (a_options.profile) {
+			a_assem.GetProfiler().DisplayReport(emul, a_assem.GetStartLocation(), cout);
+		}
+		return 1;
+	}
+	if (result.status == emulator::RS_NonTerminating) {
+		cout << "Program does not terminate, it loops through locations "
+			<< result.loopFirst << " to " << result.loopLast << endl;
+		return 1;
+	}
+	cout << endl << "End of emulation" << endl;
+
+	if (a_options.showStats && a_evaluator != NULL) {
+		cout << "Instructions executed: " << result.steps << endl;
+		cout << (a_evaluator->isCached() ? "Result taken from the evaluation cache" : "Result evaluated at assembly time") << endl;
+	}
+	else if (a_options.showStats && mode != Assembler::RM_Jit) {
+		cout << "Instructions executed: " << result.steps << endl;
+		cout << "Instructions fused: " << emul.GetFusedCount() << endl;
+	}
+	if (a_options.profile) {
+		a_assem.GetProfiler().DisplayReport(emul, a_assem.GetStartLocation(), cout);
+	}
 	return 0;
-}
\ No newline at end of file
+}
+
+/*
+NAME
+
+WatchSource - Assembles and runs the source each time it is saved.
+
+SYNOPSIS
+
+static int WatchSource(Assembler &a_assem, const CommandLine &a_options);
+
+a_assem - the assembler of the source file.
+
+a_options - the options from the command line.
+
+DESCRIPTION
+
+Reassembles the source, displays it as an ordinary run would, writes the
+object file if --object was given and runs the emulator, then waits for
+the file to be written again and does the same, until it is interrupted.
+Only the lines that changed are parsed again, and only those whose
+translation could have changed translated again; how many, and how long
+reassembling took, is displayed on standard error after each run.  This
+needs inotify, so it is not available on Windows.
+
+RETURNS
+
+1 if the file could not be watched, otherwise the result of the last run
+once the file can no longer be watched.
+
+AUTHOR
+
+Charles Snyder
+*/
+static int WatchSource(Assembler &a_assem, const CommandLine &a_options)
+{
+#ifdef _WIN32
+	cerr << "Watching the source is not available on this system" << endl;
+	return 1;
+#else
+	FileWatcher watcher;
+	if (!watcher.Open(a_options.fileName)) {
+		cerr << "Source file could not be watched: " << a_options.fileName << endl;
+		return 1;
+	}
+	int status = 0;
+	do {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (!a_assem.Reassemble()) {
+			cerr << "Source file could not be read: " << a_options.fileName << endl;
+			continue;
+		}
+		long long milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+		if (!a_options.objectName.empty()) {
+			ObjectWriter object;
+			a_assem.WriteObject(object);
+			if (!object.Save(a_options.objectName, a_options.strip)) {
+				cerr << "Object file could not be written: " << a_options.objectName << endl;
+			}
+		}
+		Evaluator *evaluator = EvaluateProgram(a_assem, a_options);
+		status = RunEmulator(a_assem, a_options, NULL, evaluator);
+		delete evaluator;
+		cerr << "Reassembled in " << milliseconds << " ms, " << a_assem.GetReparsedCount() << " lines parsed and "
+			<< a_assem.GetRetranslatedCount() << " translated; waiting for " << a_options.fileName
+			<< " to change" << endl;
+	} while (watcher.WaitForChange());
+	return status;
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+	// A batch run assembles and runs the programs listed in a manifest instead,
+	// a fork server runs one program over the inputs it is sent, and a replay
+	// reads the trace of an earlier run.
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--batch") == 0) {
+			BatchRunner batch(argc, argv);
+			return batch.Run();
+		}
+		if (strcmp(argv[i], "--fork-server") == 0) {
+			ForkServer server(argc, argv);
+			return server.Run();
+		}
+		if (strcmp(argv[i], "--replay") == 0) {
+			TraceReplay replay(argc, argv);
+			return replay.Run();
+		}
+	}
+
+	CommandLine options;
+	if (!ReadCommandLine(argc, argv, options)) {
+		return 1;
+	}
+
+	if (options.runObject) {
+		// Load the translation straight from the object file; there is no source.
+		ObjectFile object;
+		if (!object.Open(options.fileName)) {
+			cerr << "Object file could not be opened: " << options.fileName << endl;
+			return 1;
+		}
+		Assembler assem("", 0);
+		assem.LoadObject(object);
+		Evaluator *evaluator = EvaluateProgram(assem, options);
+		int status = RunEmulator(assem, options, &object, evaluator);
+		delete evaluator;
+		return status;
+	}
+
+	Assembler assem(options.fileName);
+	if (!assem.isOpen()) {
+		cerr << "Source file could not be opened, assembler terminated." << endl;
+		return 1;
+	}
+	assem.SetConsoleListing(options.listing);
+	assem.SetWorkerCount(options.threads);
+	if (options.profile) {
+		assem.EnableProfiling();
+	}
+
+	if (options.watch) {
+		return WatchSource(assem, options);
+	}
+
+	if (options.singlePass) {
+		// Translate as the source is read, which also works from a pipe.
+		assem.SinglePass();
+		assem.DisplaySymbolTable();
+		assem.DisplayTranslation();
+	}
+	else {
+		// Establish the location of the labels:
+		assem.PassI();
+
+		// Display the symbol table.
+		assem.DisplaySymbolTable();
+
+		//// Output the symbol table and the translation.
+		assem.PassII();
+	}
+
+	// Evaluate a program that never reads now that it is translated.
+	Evaluator *evaluator = EvaluateProgram(assem, options);
+
+	if (!options.objectName.empty()) {
+		ObjectWriter object;
+		assem.WriteObject(object);
+		if (!object.Save(options.objectName, options.strip)) {
+			cerr << "Object file could not be written: " << options.objectName << endl;
+			delete evaluator;
+			return 1;
+		}
+	}
+
+	//// Run the emulator on the VC3600 program that came from the translation.
+	int status = RunEmulator(assem, options, NULL, evaluator);
+	delete evaluator;
+	return status;
+}
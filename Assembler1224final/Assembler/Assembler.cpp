@@ -4,12 +4,20 @@
 #include "stdafx.h"
 #include "Assembler.h"
 #include "Errors.h"
+#include "ThreadPool.h"
 
-// Constructor for the assembler.
-Assembler::Assembler(int argc, char *argv[])
-: m_facc(argc, argv)
+// Constructor for assembling a named file.  The file access object opens
+// the file; isOpen reports whether it could.
+Assembler::Assembler(const string &a_fileName)
+: m_fileName(a_fileName), m_facc(a_fileName), m_discard(NULL)
 {
-	// Nothing else to do here.
+	Initialize();
+}
+// Constructor for assembling source text held in memory.
+Assembler::Assembler(const char *a_source, size_t a_length)
+: m_facc(a_source, a_length), m_discard(NULL)
+{
+	Initialize();
 }
 // Destructor currently does nothing.
 Assembler::~Assembler()
@@ -17,23 +25,1236 @@ Assembler::~Assembler()
 }
 
 
+
+/*
+NAME
+
+Initialize - Sets up the parts shared by the constructors.
+
+SYNOPSIS
+
+void Assembler::Initialize();
+
+DESCRIPTION
+
+Connects the instruction to this assembler's error list and sends the
+listing and errors nowhere until SetListing is called.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::Initialize()
+{
+	m_profile = false;
+	m_workers = 0;
+	m_trace = NULL;
+	m_undo = NULL;
+	m_reparsed = 0;
+	m_retranslated = 0;
+	m_listing = &m_discard;
+	m_errors = &m_discard;
+	m_inst.SetErrors(&m_errorList);
+	m_errorList.InitErrorReporting();
+}
+
+
+
+/*
+NAME
+
+SetListing - Sets where the listing and errors are displayed.
+
+SYNOPSIS
+
+void Assembler::SetListing(ostream &a_listing, ostream &a_errors);
+
+a_listing - the stream for the symbol table and the translation.
+
+a_errors - the stream for the assembly error messages.
+
+DESCRIPTION
+
+An assembler displays nothing unless this is called, so it can be used
+inside another program without writing to its screen.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::SetListing(ostream &a_listing, ostream &a_errors)
+{
+	m_listing = &a_listing;
+	m_errors = &a_errors;
+	m_writer.SetStreams(&a_listing, &a_errors);
+	m_writer.SetListing(true);
+}
+
+
+
+/*
+NAME
+
+SetConsoleListing - Displays the listing and errors on the console.
+
+SYNOPSIS
+
+void Assembler::SetConsoleListing(bool a_listing);
+
+a_listing - false to display only the errors (--no-listing).
+
+DESCRIPTION
+
+The translation and its errors are buffered by the listing writer and
+written to file descriptors 1 and 2, where the system has writev, instead
+of going through cout and cerr a line at a time.  The symbol table still
+goes through cout.  Without a_listing neither the symbol table nor the
+translation is displayed, but the errors are, each line's on a line of
+their own.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::SetConsoleListing(bool a_listing)
+{
+	m_listing = a_listing ? &cout : &m_discard;
+	m_errors = &cerr;
+	m_writer.SetStreams(&cout, &cerr);
+	m_writer.SetDescriptors(1, 2);
+	m_writer.SetListing(a_listing);
+}
+
+
+
+/*
+NAME
+
+Assemble - Assembles the program.
+
+SYNOPSIS
+
+bool Assembler::Assemble();
+
+DESCRIPTION
+
+Runs SinglePass, leaving the translation in the emulator, and displays
+the translation.  The errors found are kept for GetErrors.
+
+RETURNS
+
+True if no errors were found, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool Assembler::Assemble()
+{
+	SinglePass();
+	DisplayTranslation();
+	return m_errorList.GetErrors().empty();
+}
+
+
+/*
+NAME
+
+PassI - establishes the location of the labels.
+
+SYNOPSIS
+
+void Assembler::PassI( );
+
+DESCRIPTION
+
+The function parses every line of the source, determines the type of
+instruction, and adds what it found to the parsed program, which Pass II
+translates from without reading the source again.  Up to the end command,
+if the line contained a label that label is added to the symbol table
+with its location, so that the lines after the end command are parsed too.
+
+The lines are split into chunks of CHUNK_LINES that are parsed by
+ParseChunk, on a thread pool when there is more than one core and on this
+thread otherwise, each with an Instruction, errors and names of its own.
+A line only depends on the lines before it through its location, and
+through the operand value and numeric opcode an instruction that does not
+set them is left with.  These are carried from chunk to chunk in order: each chunk is
+summarized by SizeChunk as setting or adding to the location, those
+summaries are combined from the first chunk on to find where each chunk
+starts, and LocateChunk gives its lines their locations.  The chunks are
+then joined in order, and the labels added to the symbol table in the
+order of the source, so a label defined twice is reported on the same
+line as ever.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::PassI()
+{
+	int count = m_facc.GetLineCount();
+
+	m_program.Clear();
+
+	vector<ParsedChunk> chunks((count + CHUNK_LINES - 1) / CHUNK_LINES);
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		chunks[i].begin = i * CHUNK_LINES;
+		chunks[i].end = (i + 1) * CHUNK_LINES < count ? (i + 1) * CHUNK_LINES : count;
+	}
+
+	// With one chunk or one core the stages run on this thread, without a pool.
+	int workers = GetWorkerCount((int)chunks.size());
+	ThreadPool *pool = workers > 1 ? new ThreadPool(workers) : NULL;
+
+	// Parse the chunks.
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		if (pool == NULL) {
+			ParseChunk(&chunks[i]);
+		}
+		else {
+			pool->Submit(bind(&Assembler::ParseChunk, this, &chunks[i]));
+		}
+	}
+	if (pool != NULL) {
+		pool->Run();
+	}
+
+	// Each chunk starts with the operand value and numeric opcode the one
+	// before it left, and can then tell how it moves the location.
+	int value = 0;
+	int code = 0;
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		if (pool == NULL) {
+			SizeChunk(&chunks[i], value, code);
+		}
+		else {
+			pool->Submit(bind(&Assembler::SizeChunk, this, &chunks[i], value, code));
+		}
+		if (chunks[i].firstValue != -1) {
+			value = chunks[i].lastValue;
+		}
+		if (chunks[i].firstCode != -1) {
+			code = chunks[i].lastCode;
+		}
+	}
+	if (pool != NULL) {
+		pool->Run();
+	}
+
+	// Find where each chunk starts and locate its lines.
+	int loc = 0;        // Tracks the location of the instructions to be generated.
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		chunks[i].location = loc;
+		loc = chunks[i].setsLocation ? chunks[i].locationChange : loc + chunks[i].locationChange;
+		if (pool == NULL) {
+			LocateChunk(&chunks[i]);
+		}
+		else {
+			pool->Submit(bind(&Assembler::LocateChunk, this, &chunks[i]));
+		}
+	}
+	if (pool != NULL) {
+		pool->Run();
+		delete pool;
+	}
+
+	// Join the chunks in order.
+	bool endFound = false; // Labels after the end statement are not recorded.
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		ParsedChunk &chunk = chunks[i];
+		vector<int> ids(chunk.names.GetNameCount());
+		for (int id = 0; id < (int)ids.size(); id++) {
+			ids[id] = m_symtab.Intern(chunk.names.GetName(id));
+		}
+		int first = m_program.GetCount();
+		m_program.Append(chunk.program, ids);
+		m_errorList.MergeErrors(chunk.errors);
+		if (chunk.startLocation != -1) {
+			m_inst.SetStartLocation(chunk.startLocation);
+		}
+
+		for (int index = first; index < m_program.GetCount(); index++) {
+			Instruction::InstructionType st = m_program.GetType(index);
+
+			// Pass II will determine if the end is the last statement.
+			if (st == Instruction::ST_End) {
+				endFound = true;
+			}
+
+			// Labels can only be on machine language and assembler language
+			// instructions.  If the instruction has a label, record it and its
+			// location in the symbol table.
+			else if (st != Instruction::ST_Comment && endFound == false && m_program.GetLabel(index) != ParsedProgram::NO_NAME) {
+
+				if (m_symtab.AddSymbol(m_program.GetLabel(index), m_program.GetLocation(index)) == false) {
+					string error = "Symbol already in table";
+					m_errorList.RecordError(m_program.GetLine(index), error);
+					m_program.AddFlag(index, ParsedProgram::PF_Errors);
+				}
+			}
+		}
+	}
+}
+
+
+
+/*
+NAME
+
+GetWorkerCount - Decides how many threads a pass runs on.
+
+SYNOPSIS
+
+int Assembler::GetWorkerCount(int a_chunks);
+
+a_chunks - the number of chunks the pass has.
+
+DESCRIPTION
+
+One worker for each core, or the number SetWorkerCount gave, but no
+more than there are chunks.
+
+RETURNS
+
+The number of workers, at least one.
+
+AUTHOR
+
+Charles Snyder
+*/
+int Assembler::GetWorkerCount(int a_chunks)
+{
+	int workers = m_workers > 0 ? m_workers : (int)thread::hardware_concurrency();
+	if (workers > a_chunks) {
+		workers = a_chunks;
+	}
+	return workers < 1 ? 1 : workers;
+}
+
+
+
+/*
+NAME
+
+ParseChunk - Parses the lines of one chunk for Pass I.
+
+SYNOPSIS
+
+void Assembler::ParseChunk(ParsedChunk *a_chunk);
+
+a_chunk - the lines to parse, where the results are kept.
+
+DESCRIPTION
+
+Each line is parsed by an Instruction of the chunk's own, which records
+its errors in the chunk, and added to the chunk's program with its names
+in the chunk's table.  The locations are left for LocateChunk.  The chunk
+notes the first line that sets the operand value, since the lines before
+it are left with the value of an earlier chunk, and the value it leaves;
+and the same for the numeric opcode, which machine instructions set.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::ParseChunk(ParsedChunk *a_chunk)
+{
+	Instruction inst;
+	inst.SetErrors(&a_chunk->errors);
+	a_chunk->firstValue = -1;
+	a_chunk->lastValue = 0;
+	a_chunk->firstCode = -1;
+	a_chunk->lastCode = 0;
+
+	// Successively process each line of source code.
+	for (int line = a_chunk->begin; line < a_chunk->end; line++) {
+		string buff = m_facc.GetLine(line).str();
+		int lineCount = line + 1;
+
+		// Parse the line and get the instruction type.
+		inst.setLineCount(lineCount);
+		size_t errorCount = a_chunk->errors.GetErrors().size();
+		Instruction::InstructionType st = inst.RecordInstruction(buff);
+		int index = a_chunk->program.Add(inst, st, 0, lineCount, a_chunk->errors.GetErrors().size() != errorCount,
+			a_chunk->names);
+
+		// A numeric operand sets the value, except on the end statement.
+		if (st != Instruction::ST_Comment && st != Instruction::ST_End && inst.GetIsNumericOperand()) {
+			if (a_chunk->firstValue == -1) {
+				a_chunk->firstValue = index;
+			}
+			a_chunk->lastValue = inst.GetOperandValue();
+		}
+		if (st == Instruction::ST_MachineLanguage) {
+			if (a_chunk->firstCode == -1) {
+				a_chunk->firstCode = index;
+			}
+			a_chunk->lastCode = inst.GetNumericOpCode();
+		}
+	}
+	a_chunk->startLocation = inst.GetStartLocation();
+}
+
+
+
+/*
+NAME
+
+SizeChunk - Works out how a chunk moves the location.
+
+SYNOPSIS
+
+void Assembler::SizeChunk(ParsedChunk *a_chunk, int a_carriedValue, int a_carriedCode);
+
+a_chunk - the parsed chunk.
+
+a_carriedValue - the operand value the chunks before it left.
+
+a_carriedCode - the numeric opcode the chunks before it left.
+
+DESCRIPTION
+
+The entries before the first to set the operand value are given
+a_carriedValue, and those before the first to set the numeric opcode
+a_carriedCode, as they would have been parsing the whole source in one
+go.  Then the chunk is summarized: from its last ORG on, it sets the
+location; without one, it adds to it.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::SizeChunk(ParsedChunk *a_chunk, int a_carriedValue, int a_carriedCode)
+{
+	ParsedProgram &program = a_chunk->program;
+	int carried = a_chunk->firstValue == -1 ? program.GetCount() : a_chunk->firstValue;
+	for (int index = 0; index < carried; index++) {
+		program.SetOperandValue(index, a_carriedValue);
+	}
+	carried = a_chunk->firstCode == -1 ? program.GetCount() : a_chunk->firstCode;
+	for (int index = 0; index < carried; index++) {
+		program.SetNumericOpCode(index, a_carriedCode);
+	}
+
+	a_chunk->setsLocation = false;
+	a_chunk->locationChange = 0;
+	for (int index = 0; index < program.GetCount(); index++) {
+		Instruction::InstructionType st = program.GetType(index);
+		if (st != Instruction::ST_Comment && st != Instruction::ST_End
+			&& OpCodeTable::Get(program.GetOpCode(index)).size == OpCodeTable::SE_Origin) {
+			a_chunk->setsLocation = true;
+		}
+		a_chunk->locationChange = program.NextLocation(index, a_chunk->locationChange);
+	}
+}
+
+
+
+/*
+NAME
+
+LocateChunk - Gives the lines of a chunk their locations.
+
+SYNOPSIS
+
+void Assembler::LocateChunk(ParsedChunk *a_chunk);
+
+a_chunk - the parsed chunk, whose location is known.
+
+DESCRIPTION
+
+Starting from the location of the chunk, each entry is given the location
+it is at, and the location of the next instruction is computed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::LocateChunk(ParsedChunk *a_chunk)
+{
+	ParsedProgram &program = a_chunk->program;
+	int loc = a_chunk->location;
+	for (int index = 0; index < program.GetCount(); index++) {
+		program.SetLocation(index, loc);
+		loc = program.NextLocation(index, loc);
+	}
+}
+
+
+
+/*
+NAME
+
+PassII - translates the assembly instructions into machine code, displays original
+	     and translated contents, and also displays any errors.
+
+SYNOPSIS
+
+void Assembler::PassII( );
+
+DESCRIPTION
+
+The function goes through the lines Pass I parsed without reading or
+parsing the source again.  The symbol table is final by now and each line
+is translated from its own entry alone, so the lines are split into chunks
+of CHUNK_LINES that are translated by TranslateChunk on a thread pool, one
+worker for each core.  Each chunk keeps its listing and errors to itself;
+once all are done they are displayed and the errors recorded in the order
+of the source, so the listing is the same as translating line by line.
+The words the lines make are then loaded into the emulator by
+LoadTranslation.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::PassII() {
+	int count = m_program.GetCount();
+	
+	DisplayTranslationHeader();
+
+	// Any line after the first end command is an error.
+	int endIndex = -1;
+	for (int index = 0; index < count; index++) {
+		if (m_program.GetType(index) == Instruction::ST_End) {
+			endIndex = index;
+			break;
+		}
+	}
+
+	// Split the lines into chunks and translate them, on one thread if
+	// there is only one chunk or one core.
+	vector<TranslatedChunk> chunks((count + CHUNK_LINES - 1) / CHUNK_LINES);
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		chunks[i].begin = i * CHUNK_LINES;
+		chunks[i].end = (i + 1) * CHUNK_LINES < count ? (i + 1) * CHUNK_LINES : count;
+		chunks[i].listing.CopyTargets(m_writer);
+	}
+	int workers = GetWorkerCount((int)chunks.size());
+	if (workers <= 1) {
+		for (int i = 0; i < (int)chunks.size(); i++) {
+			TranslateChunk(&chunks[i], endIndex);
+		}
+	}
+	else {
+		ThreadPool pool(workers);
+		for (int i = 0; i < (int)chunks.size(); i++) {
+			pool.Submit(bind(&Assembler::TranslateChunk, this, &chunks[i], endIndex));
+		}
+		pool.Run();
+	}
+
+	// Display the chunks in order, each line's errors after it.
+	m_writer.Flush();
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		chunks[i].listing.Flush();
+		m_errorList.MergeErrors(chunks[i].errors);
+	}
+
+	// If there are no more lines, we are missing an end statement.
+	if (endIndex == -1) {
+		string error = "No end statement";
+		m_errorList.RecordError(count + 1, error);
+		m_errorList.DisplayErrors(count + 1, m_writer);
+	}
+	m_writer.Flush();
+
+	LoadTranslation();
+}
+
+
+
+/*
+NAME
+
+TranslateChunk - Translates the lines of one chunk for Pass II.
+
+SYNOPSIS
+
+void Assembler::TranslateChunk(TranslatedChunk *a_chunk, int a_endIndex);
+
+a_chunk - the lines to translate, where the results are kept.
+
+a_endIndex - the index of the first end statement, -1 if there is none.
+
+DESCRIPTION
+
+Each assembly or machine instruction is translated by TranslateLine, and
+every line is added to the chunk's listing by ListLine, with its errors
+after it.
+
+Only the chunk and the words of its own lines are written, so chunks
+can be translated at the same time.  The symbol table, the parsed program
+and the errors of Pass I are only read.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::TranslateChunk(TranslatedChunk *a_chunk, int a_endIndex)
+{
+	// Successively process each line of source code.
+	for (int index = a_chunk->begin; index < a_chunk->end; index++) {
+		Instruction::InstructionType st = m_program.GetType(index);
+		string contents;
+		int translationErrors = 0;
+		if (st != Instruction::ST_Comment && st != Instruction::ST_End) {
+			translationErrors = TranslateLine(index, contents);
+		}
+		ListLine(index, a_endIndex, contents, translationErrors, a_chunk->errors, a_chunk->listing);
+	}
+}
+
+
+
+/*
+NAME
+
+TranslateLine - Translates an assembly or machine instruction.
+
+SYNOPSIS
+
+int Assembler::TranslateLine(int a_index, string &a_contents);
+
+a_index - the line, in the parsed program.
+
+a_contents - passed by reference, set to the machine code.
+
+DESCRIPTION
+
+A symbol is looked up from the table if necessary and the machine code
+is calculated.  The word the contents make is kept with the line.
+
+RETURNS
+
+The TranslationError bits of the errors found, 0 if there were none.
+
+AUTHOR
+
+Charles Snyder
+*/
+int Assembler::TranslateLine(int a_index, string &a_contents)
+{
+	int errors = 0;
+	int loc = m_program.GetLocation(a_index);
+	int symbolLocation; // Holds the location for a potential symbol operand.
+	string invalidSymbol; // Will hold ???? if an error occurs.
+
+	// Determines whether operand is symbol and if so looks it up from the symbol table.
+	if (FindSymbol(a_index, symbolLocation, invalidSymbol) == false) {
+		errors |= TE_UndefinedLabel;
+	}
+
+	// Calculates the machine code translation.
+	a_contents = CalculateContents(a_index, symbolLocation, invalidSymbol);
+
+	// Keep the machine code to load into the emulator.
+	if (OpCodeTable::Get(m_program.GetOpCode(a_index)).size == OpCodeTable::SE_Word) {
+		if (loc < 0 || loc >= emulator::MEMSZ) {
+			errors |= TE_InvalidWrite;
+		}
+		m_program.SetContents(a_index, a_contents);
+	}
+
+	if (loc > 9999 || loc < 0) {
+		errors |= TE_InvalidLocation;
+	}
+	return errors;
+}
+
+
+
+/*
+NAME
+
+ListLine - Adds a line of the translation to a listing.
+
+SYNOPSIS
+
+void Assembler::ListLine(int a_index, int a_endIndex, const string &a_contents, int a_translationErrors,
+	Errors &a_errors, ListingWriter &a_listing);
+
+a_index - the line, in the parsed program.
+
+a_endIndex - the index of the first end statement, -1 if there is none.
+
+a_contents - the machine code TranslateLine made of the line.
+
+a_translationErrors - the TranslationError bits TranslateLine returned.
+
+a_errors - where the errors of the line are recorded.
+
+a_listing - the listing.
+
+DESCRIPTION
+
+Comments and end statements are listed as they are.  Other lines are
+listed with their location and contents, and any errors that were
+encountered for a line are displayed after it, those recorded by Pass I
+first.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::ListLine(int a_index, int a_endIndex, const string &a_contents, int a_translationErrors,
+	Errors &a_errors, ListingWriter &a_listing)
+{
+	int lineCount = m_program.GetLine(a_index);
+	LineView text = m_facc.GetLine(lineCount - 1);
+	Instruction::InstructionType st = m_program.GetType(a_index);
+
+	if (st == Instruction::ST_Comment) {
+		a_listing.Write("                      ", 22);
+		a_listing.WriteSource(text.data, text.length);
+		a_listing.Write('\n');
+		return;
+	}
+
+	// Lines after the end command are checked below.
+	else if (st == Instruction::ST_End) {
+		a_listing.Write("                    ", 20);
+		a_listing.WriteSource(text.data, text.length);
+		a_listing.Write('\n');
+		return;
+	}
+
+	//  Instruction type was assembly or machine type.
+	bool errors = m_program.HasFlag(a_index, ParsedProgram::PF_Errors) || a_translationErrors != 0;
+
+	// Start with the errors Pass I found, so they are displayed first.
+	if (m_program.HasFlag(a_index, ParsedProgram::PF_Errors)) {
+		typedef multimap<int, string>::const_iterator ErrorIterator;
+		pair<ErrorIterator, ErrorIterator> found = m_errorList.GetErrors().equal_range(lineCount);
+		for (ErrorIterator error = found.first; error != found.second; error++) {
+			string message = error->second;
+			a_errors.RecordError(lineCount, message);
+		}
+	}
+
+	// If end command was encountered any following lines are errors.
+	if (a_endIndex != -1 && a_index > a_endIndex) {
+		string error = "Line after end statement";
+		a_errors.RecordError(lineCount, error);
+		errors = true;
+	}
+	if ((a_translationErrors & TE_UndefinedLabel) != 0) {
+		string error = "Undefined label";
+		a_errors.RecordError(lineCount, error);
+	}
+	if ((a_translationErrors & TE_InvalidWrite) != 0) {
+		string error = "Attempted to write to invalid memory location";
+		a_errors.RecordError(lineCount, error);
+	}
+	if ((a_translationErrors & TE_InvalidLocation) != 0) {
+		string error = "Invalid Memory Location";
+		a_errors.RecordError(lineCount, error);
+	}
+
+	// Prints the location, the machine code contents and original instruction.
+	a_listing.Write("  ", 2);
+	a_listing.WriteNumber(m_program.GetLocation(a_index));
+	a_listing.Write("      ", 6);
+	Instruction::PrintTranslation(m_program.GetOpCode(a_index), a_contents, text.data, text.length, a_listing);
+
+	// Display any errors for the current line.
+	if (errors) {
+		a_errors.DisplayErrors(lineCount, a_listing);
+	}
+}
+
+
+
+/*
+NAME
+
+Reassemble - Assembles the source file again after it has been edited.
+
+SYNOPSIS
+
+bool Assembler::Reassemble();
+
+DESCRIPTION
+
+Reads the file again and brings Pass I up to date with UpdatePassI,
+displays the symbol table, and brings Pass II up to date with
+UpdatePassII, which displays the listing and reloads the emulator.  The
+listing and errors are the same as assembling the file afresh.
+
+RETURNS
+
+True if the file was read, false if it could not be, when nothing is
+done.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool Assembler::Reassemble()
+{
+	if (!m_facc.Reread(m_fileName)) {
+		return false;
+	}
+	m_reparsed = 0;
+	m_retranslated = 0;
+	UpdatePassI();
+	DisplaySymbolTable();
+	UpdatePassII();
+	return true;
+}
+
+
+
+/*
+NAME
+
+UpdatePassI - Brings the parsed program up to date with the source.
+
+SYNOPSIS
+
+void Assembler::UpdatePassI();
+
+DESCRIPTION
+
+The lines of the source are hashed and compared with the lines assembled
+before, from the start and from the end, to find the lines that changed;
+the old lines are kept in the parse cache, and a line whose hash is equal
+is compared by its text too, so two lines whose hashes collide are not
+taken as the same.  Those are copied from the parse cache, where a line
+with the same text is parsed only the first time it is seen, and put in
+place of the entries of the old lines; the entries after them are only
+renumbered.
+
+From the first changed line on, each entry is given the operand value
+and numeric opcode carried from the line before it and its location, as
+PassI does, until an entry after the changed lines comes out as it was,
+after which nothing can have moved.  The changed entries and those that
+moved are marked stale.  The labels are taken back from the symbol table
+from the first changed line on and defined again, and the entries whose
+operand names a symbol that changed are marked stale too.  Lastly the
+errors of Pass I are recorded again from the cache.
+
+When the cache has grown to hold many more lines than the source, from
+lines edited away, everything is started over and the whole source parsed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::UpdatePassI()
+{
+	int count = m_facc.GetLineCount();
+	vector<unsigned long long> hashes(count);
+	for (int line = 0; line < count; line++) {
+		LineView text = m_facc.GetLine(line);
+		hashes[line] = ParseCache::Hash(text.data, text.length);
+	}
+
+	if (m_cache.GetCount() > 2 * count + CACHE_SLACK) {
+		m_cache.Clear();
+		m_symtab.Clear();
+		m_program.Clear();
+		m_parsedAs.clear();
+		m_contents.clear();
+		m_translationErrors.clear();
+		m_definedBy.clear();
+	}
+
+	// The lines from first up to last replace the old entries from first up to oldLast.
+	int oldCount = m_program.GetCount();
+	int first = 0;
+	while (first < count && first < oldCount) {
+		LineView text = m_facc.GetLine(first);
+		if (!m_cache.IsLine(m_parsedAs[first], text.data, text.length, hashes[first])) {
+			break;
+		}
+		first++;
+	}
+	int last = count;
+	int oldLast = oldCount;
+	while (last > first && oldLast > first) {
+		LineView text = m_facc.GetLine(last - 1);
+		if (!m_cache.IsLine(m_parsedAs[oldLast - 1], text.data, text.length, hashes[last - 1])) {
+			break;
+		}
+		last--;
+		oldLast--;
+	}
+
+	ParsedProgram changed;
+	vector<int> parsedAs;
+	for (int line = first; line < last; line++) {
+		LineView text = m_facc.GetLine(line);
+		int cached = m_cache.Find(text.data, text.length, hashes[line]);
+		if (cached == ParseCache::NOT_CACHED) {
+			cached = m_cache.Parse(text.data, text.length, hashes[line], m_parser, m_symtab);
+			m_reparsed++;
+		}
+		changed.AddCopy(m_cache.GetLines(), cached, line + 1);
+		parsedAs.push_back(cached);
+	}
+	m_program.Replace(first, oldLast, changed);
+	m_parsedAs.erase(m_parsedAs.begin() + first, m_parsedAs.begin() + oldLast);
+	m_parsedAs.insert(m_parsedAs.begin() + first, parsedAs.begin(), parsedAs.end());
+	m_contents.erase(m_contents.begin() + first, m_contents.begin() + oldLast);
+	m_contents.insert(m_contents.begin() + first, last - first, string());
+	m_translationErrors.erase(m_translationErrors.begin() + first, m_translationErrors.begin() + oldLast);
+	m_translationErrors.insert(m_translationErrors.begin() + first, last - first, (unsigned char)0);
+	if (last != oldLast) {
+		for (int index = last; index < count; index++) {
+			m_program.SetLine(index, index + 1);
+		}
+	}
+
+	// Carry the operand value, numeric opcode and location on from the
+	// line before the first that changed.
+	m_stale.assign(count, 0);
+	int value = 0;
+	int code = 0;
+	int loc = 0;
+	if (first > 0) {
+		value = m_program.GetOperandValue(first - 1);
+		code = m_program.GetNumericOpCode(first - 1);
+		loc = m_program.NextLocation(first - 1, m_program.GetLocation(first - 1));
+	}
+	for (int index = first; index < count; index++) {
+		Instruction::InstructionType st = m_program.GetType(index);
+		int oldValue = m_program.GetOperandValue(index);
+		int oldCode = m_program.GetNumericOpCode(index);
+		int oldLoc = m_program.GetLocation(index);
+		if (st == Instruction::ST_Comment || st == Instruction::ST_End
+			|| !m_program.HasFlag(index, ParsedProgram::PF_NumericOperand)) {
+			m_program.SetOperandValue(index, value);
+		}
+		if (st != Instruction::ST_MachineLanguage) {
+			m_program.SetNumericOpCode(index, code);
+		}
+		m_program.SetLocation(index, loc);
+
+		bool moved = m_program.GetOperandValue(index) != oldValue || m_program.GetNumericOpCode(index) != oldCode
+			|| loc != oldLoc;
+		if (index >= last && !moved) {
+			break;
+		}
+		m_stale[index] = 1;
+		value = m_program.GetOperandValue(index);
+		code = m_program.GetNumericOpCode(index);
+		loc = m_program.NextLocation(index, loc);
+	}
+
+	// The start location is set by the last line that sets one.
+	int start = count - 1;
+	while (start >= 0 && !m_program.HasFlag(start, ParsedProgram::PF_SetsStart)) {
+		start--;
+	}
+	m_inst.SetStartLocation(start == -1 ? -1 : m_program.GetOperandValue(start));
+
+	// Note what each name looks up as, then define the labels again from
+	// the first changed line up to the end statement.
+	int nameCount = m_symtab.GetNameCount();
+	vector<unsigned char> wasDefined(nameCount);
+	vector<int> wasAt(nameCount, 0);
+	for (int id = 0; id < nameCount; id++) {
+		wasDefined[id] = m_symtab.LookupSymbol(id, wasAt[id]);
+	}
+	int kept = (int)(lower_bound(m_definedBy.begin(), m_definedBy.end(), first) - m_definedBy.begin());
+	m_symtab.UndoAdded(kept);
+	m_definedBy.resize(kept);
+
+	int endIndex = 0;
+	while (endIndex < count && m_program.GetType(endIndex) != Instruction::ST_End) {
+		endIndex++;
+	}
+	for (int index = first; index < count; index++) {
+		bool duplicate = false;
+		if (index < endIndex && m_program.GetType(index) != Instruction::ST_Comment
+			&& m_program.GetLabel(index) != ParsedProgram::NO_NAME) {
+			duplicate = !m_symtab.AddSymbol(m_program.GetLabel(index), m_program.GetLocation(index));
+			m_definedBy.push_back(index);
+		}
+		if (duplicate) {
+			m_program.AddFlag(index, ParsedProgram::PF_DuplicateLabel);
+			m_program.AddFlag(index, ParsedProgram::PF_Errors);
+		}
+		else {
+			m_program.ClearFlag(index, ParsedProgram::PF_DuplicateLabel);
+			if (m_cache.GetErrors(m_parsedAs[index]).empty()) {
+				m_program.ClearFlag(index, ParsedProgram::PF_Errors);
+			}
+		}
+	}
+
+	// Lines looking up a symbol that changed are translated again.
+	vector<unsigned char> changedNames(nameCount, 0);
+	bool anyChanged = false;
+	for (int id = 0; id < nameCount; id++) {
+		int at = 0;
+		bool defined = m_symtab.LookupSymbol(id, at);
+		if (defined != (wasDefined[id] != 0) || (defined && at != wasAt[id])) {
+			changedNames[id] = 1;
+			anyChanged = true;
+		}
+	}
+	for (int index = 0; anyChanged && index < count; index++) {
+		Instruction::InstructionType st = m_program.GetType(index);
+		if (m_stale[index] == 0 && st != Instruction::ST_Comment && st != Instruction::ST_End
+			&& changedNames[m_program.GetOperand(index)] != 0 && HasSymbolOperand(index)) {
+			m_stale[index] = 1;
+		}
+	}
+
+	// Record the errors of Pass I, as PassI would have.
+	m_errorList.InitErrorReporting();
+	for (int index = 0; index < count; index++) {
+		if (!m_program.HasFlag(index, ParsedProgram::PF_Errors)) {
+			continue;
+		}
+		const vector<string> &errors = m_cache.GetErrors(m_parsedAs[index]);
+		for (int i = 0; i < (int)errors.size(); i++) {
+			string message = errors[i];
+			m_errorList.RecordError(index + 1, message);
+		}
+		if (m_program.HasFlag(index, ParsedProgram::PF_DuplicateLabel)) {
+			string error = "Symbol already in table";
+			m_errorList.RecordError(index + 1, error);
+		}
+	}
+}
+
+
+
+/*
+NAME
+
+UpdatePassII - Brings the translation up to date with the parsed program.
+
+SYNOPSIS
+
+void Assembler::UpdatePassII();
+
+DESCRIPTION
+
+Translates the entries UpdatePassI marked stale with TranslateLine and
+keeps their contents and errors; the others are as they were.  Every
+line is then listed with ListLine, as PassII lists it, and the emulator
+is emptied and loaded with the words of the translation.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::UpdatePassII()
+{
+	int count = m_program.GetCount();
+
+	DisplayTranslationHeader();
+
+	// Any line after the first end command is an error.
+	int endIndex = -1;
+	for (int index = 0; index < count; index++) {
+		if (m_program.GetType(index) == Instruction::ST_End) {
+			endIndex = index;
+			break;
+		}
+	}
+
+	for (int index = 0; index < count; index++) {
+		Instruction::InstructionType st = m_program.GetType(index);
+		if (m_stale[index] != 0 && st != Instruction::ST_Comment && st != Instruction::ST_End) {
+			m_translationErrors[index] = (unsigned char)TranslateLine(index, m_contents[index]);
+			m_retranslated++;
+		}
+	}
+
+	Errors errors;
+	for (int index = 0; index < count; index++) {
+		ListLine(index, endIndex, m_contents[index], m_translationErrors[index], errors, m_writer);
+		m_writer.FlushIfFull();
+	}
+	m_errorList.MergeErrors(errors);
+
+	// If there are no more lines, we are missing an end statement.
+	if (endIndex == -1) {
+		string error = "No end statement";
+		m_errorList.RecordError(count + 1, error);
+		m_errorList.DisplayErrors(count + 1, m_writer);
+	}
+	m_writer.Flush();
+
+	// The last run changed memory, and lines may have moved.
+	emulator *empty = new emulator;
+	m_emul.LoadFrom(*empty);
+	delete empty;
+	LoadTranslation();
+}
+
+
+
+/*
+NAME
+
+LoadTranslation - Loads the translation made by Pass II into the emulator.
+
+SYNOPSIS
+
+void Assembler::LoadTranslation();
+
+DESCRIPTION
+
+Stores the word of every line that takes up memory at its location, in
+the order of the source, so a later line at the same location wins as
+it always has.  Lines at locations outside of memory are not loaded.
+When profiling, the statement at each location is recorded as well.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::LoadTranslation()
+{
+	int count = m_program.GetCount();
+	for (int index = 0; index < count; index++) {
+		Instruction::InstructionType st = m_program.GetType(index);
+		if (st == Instruction::ST_Comment || st == Instruction::ST_End) {
+			continue;
+		}
+		OpCodeId opCode = m_program.GetOpCode(index);
+
+		// Remember the statement so the profile can be shown next to it.
+		if (m_profile && opCode != OC_Org) {
+			int lineCount = m_program.GetLine(index);
+			m_profiler.RecordStatement(m_program.GetLocation(index), lineCount, m_facc.GetLine(lineCount - 1).str());
+		}
+		if (OpCodeTable::Get(opCode).size == OpCodeTable::SE_Word) {
+			m_emul.insertMemory(m_program.GetLocation(index), m_program.GetContents(index));
+		}
+	}
+}
+
+
+/*
+NAME
+
+Run - Runs the translation on the emulator.
+
+SYNOPSIS
+
+emulator::RunResult Assembler::Run(RunMode a_mode);
+
+a_mode - whether to interpret, compile, profile or trace the program, or
+		 record it to be taken back.
+
+DESCRIPTION
+
+Runs the program from the location given by the END statement, with the
+input, output and limits set on the emulator.  A profiled run starts the
+profile over and names its locations from the symbol table.  Nothing is
+displayed here, and a runtime error is reported in the result rather
+than ending the process.  A traced run without a trace, or a run to be
+undone without an undo log, is interpreted.
+
+RETURNS
+
+How the run ended and, for a runtime error, what the error was and where.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunResult Assembler::Run(RunMode a_mode) {
+	emulator::RunStatus status;
+	if (a_mode == RM_Profile) {
+		m_profiler.Reset();
+		m_profiler.RecordSymbols(m_symtab);
+		status = m_emul.runProgramProfiled(m_inst.GetStartLocation(), m_profiler);
+	}
+	else if (a_mode == RM_Trace && m_trace != NULL) {
+		status = m_emul.runProgramTraced(m_inst.GetStartLocation(), *m_trace);
+	}
+	else if (a_mode == RM_Undo && m_undo != NULL) {
+		status = m_emul.runProgramUndoable(m_inst.GetStartLocation(), *m_undo);
+	}
+	else if (a_mode == RM_Jit) {
+		status = m_emul.runProgramJit(m_inst.GetStartLocation());
+	}
+	else {
+		status = m_emul.runProgram(m_inst.GetStartLocation());
+	}
+	return m_emul.GetResult(status);
+}
+
+
+
 /*
 NAME
 
-PassI - establishes the location of the labels.
+WriteObject - Records the translation for an object file.
 
 SYNOPSIS
 
-void Assembler::PassI( );
+void Assembler::WriteObject(ObjectWriter &a_object);
+
+a_object - the object file being made.
 
 DESCRIPTION
 
-The function will read in a line from the file access object.  It will then
-parse the line and determine the type of instruction.  If it is a comment,
-the next line will be read.  If it is the end command the function returns.
-Otherwise it checks to see if the line contained a label and if so adds that
-label to the symbol table.  The next location is then calculated and the
-process continues until the end command is encountered.
+Records the start location, the word and line of every location loaded
+into the emulator, and the symbols in the order they are displayed.  The
+words are those LoadTranslation or SinglePass loaded, taken in the same
+order so that a later line at the same location wins here too.
 
 RETURNS
 
@@ -43,49 +1264,70 @@ AUTHOR
 
 Charles Snyder
 */
-void Assembler::PassI()
+void Assembler::WriteObject(ObjectWriter &a_object)
 {
-	int loc = 0;        // Tracks the location of the instructions to be generated.
-	int lineCount = 0;  // Keeps track of the current line from the file for error processing.
-
-	// Successively process each line of source code.
-	for (;;) {
-		
-		// Read the next line from the source file.
-		string buff;
-		if (!m_facc.GetNextLine(buff)) {
-			
-			// If there are no more lines, we are missing an end statement.
-			return;
+	a_object.SetStartLocation(m_inst.GetStartLocation());
+	if (m_statements.empty()) {
+		int count = m_program.GetCount();
+		for (int index = 0; index < count; index++) {
+			Instruction::InstructionType st = m_program.GetType(index);
+			if (st == Instruction::ST_Comment || st == Instruction::ST_End
+				|| OpCodeTable::Get(m_program.GetOpCode(index)).size != OpCodeTable::SE_Word) {
+				continue;
+			}
+			a_object.SetContents(m_program.GetLocation(index), m_program.GetContents(index), m_program.GetLine(index));
+		}
+	}
+	else {
+		for (int loc = 0; loc < emulator::MEMSZ; loc++) {
+			if (m_loadedBy[loc] != -1) {
+				const Statement &statement = m_statements[m_loadedBy[loc]];
+				a_object.SetContents(loc, statement.contents, statement.line);
+			}
 		}
+	}
 
-		// Increase the line count for error checking.
-		lineCount++;
+	vector<int> ids;
+	m_symtab.GetSortedSymbols(ids);
+	for (int i = 0; i < (int)ids.size(); i++) {
+		int location;
+		m_symtab.LookupSymbol(ids[i], location);
+		a_object.AddSymbol(m_symtab.GetName(ids[i]), location);
+	}
+}
 
-		// Parse the line and get the instruction type.
-		m_inst.setLineCount(lineCount);
-		Instruction::InstructionType st = m_inst.RecordInstruction(buff);
 
-		// If this is an end statement, there is nothing left to do in pass I.
-		// Pass II will determine if the end is the last statement.
-		if (st == Instruction::ST_End) return;
 
-		// Labels can only be on machine language and assembler language
-		// instructions.
-		if (st == Instruction::ST_Comment) continue;
+/*
+NAME
 
-		// If the instruction has a label, record it and its location in the
-		// symbol table.
-		if (m_inst.isLabel()) {
+LoadObject - Loads a program from an object file instead of assembling it.
 
-			if (m_symtab.AddSymbol(m_inst.GetLabel(), loc) == false) {
-				string error = "Symbol already in table";
-				Errors::RecordError(lineCount, error);
-			}
-		}
-		// Compute the location of the next instruction.
-		loc = m_inst.LocationNextInstruction(loc);
-	}
+SYNOPSIS
+
+void Assembler::LoadObject(const ObjectFile &a_object);
+
+a_object - the open object file.
+
+DESCRIPTION
+
+Copies the words of the object file into the emulator and takes its
+start location, so the program runs as it did when it was assembled.
+Nothing is assembled and there is no listing; the assembler should have
+no source.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::LoadObject(const ObjectFile &a_object)
+{
+	a_object.LoadInto(m_emul);
+	m_inst.SetStartLocation(a_object.GetStartLocation());
 }
 
 
@@ -93,22 +1335,25 @@ void Assembler::PassI()
 /*
 NAME
 
-PassII - translates the assembly instructions into machine code, displays original
-	     and translated contents, and also displays any errors.
+SinglePass - Assembles the program reading each line only once.
 
 SYNOPSIS
 
-void Assembler::PassII( );
+void Assembler::SinglePass();
 
 DESCRIPTION
 
-The function will read in a line from the file access object.  It will be similar
-to Pass I except now if the instruction is determined to be assembly or machine type
-a symbol is looked up from the table if necessary, the machine code is calculated, and
-the translation is printed to the screen.  Following this the contents (or machine code)
-are inserted into the emulator along with the current location value.  The next location is
-calculated and any errors that were encountered for the current line are printed to
-the screen.
+Does the work of Pass I and Pass II together, so the source is read and
+each line parsed once, and the source can come from a pipe.  Labels are
+added to the symbol table as they are reached, up to the end statement,
+as Pass I adds them.  An instruction whose label is already defined is
+translated and loaded into the emulator at once.  Otherwise its contents
+are left for the label to fill in when it is defined, and if it is not
+defined by the end statement, or the end of the source, the instruction
+gets the same "Undefined label" error as in Pass II.  A label defined
+twice becomes multiply defined for the instructions already translated
+too.  The listing is kept and displayed by DisplayTranslation, after the
+symbol table, the same as PassII displays it.
 
 RETURNS
 
@@ -118,124 +1363,360 @@ AUTHOR
 
 Charles Snyder
 */
-void Assembler::PassII() {
-	m_facc.rewind();  // Go back to beginning of file to read through again.
+void Assembler::SinglePass()
+{
 	int loc = 0;        // Tracks the location of the instructions to be generated.
 	int lineCount = 0;  // Keeps track of the current line from the file for error processing.
-	
-	// Display column headers.
-	cout << endl;
-	cout << "Translation of Program:" << endl << endl;
-	cout << "Location" << "   " << "Contents" << "   " << "Original Statement" << endl;
-
 	bool endFound = false; // Flag to signal whether an end command has been encountered.
 
+	m_program.Clear();
+	m_statements.clear();
+	m_references.clear();
+	m_loadedBy.assign(emulator::MEMSZ, -1);
+	m_finalLine = -1;
+
 	// Successively process each line of source code.
 	for (;;) {
 
 		// Read the next line from the source file.
 		string buff;
-		string contents = "";
-		
 		if (!m_facc.GetNextLine(buff)) {
-			// Increase the line count for error checking.
 			lineCount++;
 			// If there are no more lines, we are missing an end statement.
 			if (endFound == false) {
+				FinishReferences();
 				string error = "No end statement";
-				Errors::RecordError(lineCount, error);
+				m_errorList.RecordError(lineCount, error);
 			}
-			Errors::DisplayErrors(lineCount);
+			m_finalLine = lineCount;
 			return;
 		}
-
-		// Increase the line count for error checking.
 		lineCount++;
 
 		// Parse the line and get the instruction type.
 		m_inst.setLineCount(lineCount);
+		size_t errorCount = m_errorList.GetErrors().size();
 		Instruction::InstructionType st = m_inst.RecordInstruction(buff);
-
-		
+		int index = m_program.Add(m_inst, st, loc, lineCount, m_errorList.GetErrors().size() != errorCount, m_symtab);
+
+		Statement statement;
+		statement.line = lineCount;
+		statement.text = m_inst.GetOriginalInstruction();
+		statement.location = loc;
+		statement.opCode = OC_Invalid;
+		statement.loads = false;
+		statement.finished = true;
 		if (st == Instruction::ST_Comment) {
-			cout << "                      " << m_inst.GetOriginalInstruction() << endl;
+			statement.kind = SK_Comment;
+			m_statements.push_back(statement);
 			continue;
 		}
+		if (st == Instruction::ST_End) {
+			statement.kind = SK_End;
+			m_statements.push_back(statement);
 
-		// Check to see if end command is last line.
-		else if (st == Instruction::ST_End) {
-			endFound = true;
-			if (m_facc.isEndLine() == false) {
-				cout << "                    " << m_inst.GetOriginalInstruction() << endl;
-				continue;
+			// No more labels are defined after the first end statement.
+			if (endFound == false) {
+				endFound = true;
+				FinishReferences();
 			}
-			else {
-				cout << "                    " << m_inst.GetOriginalInstruction() << endl;
+			if (m_facc.isEndLine()) {
 				return;
 			}
+			continue;
 		}
 
-		//  Instruction type was assembly or machine type.
-		else {
-
-			// If end command was encountered any following lines are errors.
-			if (endFound == true) {
-				string error = "Line after end statement";
-				Errors::RecordError(lineCount, error);
+		// Labels are recorded up to the end statement, as in Pass I.
+		if (endFound == false && m_inst.isLabel()) {
+			if (m_symtab.AddSymbol(m_inst.GetLabel(), loc) == false) {
+				string error = "Symbol already in table";
+				m_errorList.RecordError(lineCount, error);
 			}
+			ResolveReferences(m_inst.GetLabel());
+		}
+		if (endFound == true) {
+			string error = "Line after end statement";
+			m_errorList.RecordError(lineCount, error);
+		}
 
-			// Display location value.
-			cout << "  " << loc << "      ";
-			int symbolLocation; // Holds the location for a potential symbol operand.
-			string invalidSymbol; // Will hold ???? if an error occurs.
-			
-			// Determines whether operand is symbol and if so looks it up from the symbol table.
-			if (FindSymbol(symbolLocation, invalidSymbol) == false) {
-				string error = "Undefined label";
-				Errors::RecordError(lineCount, error);
-			}
-			
-			// Calculates the machine code translation.
-			contents = CalculateContents(symbolLocation, invalidSymbol);
+		statement.kind = SK_Translated;
+		statement.opCode = m_inst.GetOpCode();
+		statement.loads = OpCodeTable::Get(statement.opCode).size == OpCodeTable::SE_Word;
+		statement.finished = false;
+		if (HasSymbolOperand(index)) {
+			// The address goes after the opcode, in the last four digits.
+			statement.symbol = m_inst.GetOperand();
+			string contents = CalculateContents(index, 0, "");
+			statement.prefix = contents.substr(0, contents.length() - 4);
+		}
+		else {
+			int symbolLocation;
+			string invalidSymbol;
+			FindSymbol(index, symbolLocation, invalidSymbol);
+			statement.contents = CalculateContents(index, symbolLocation, invalidSymbol);
+		}
+		m_statements.push_back(statement);
 
-			// Prints the machine code contents and original instruction to screen.
-			m_inst.PrintTranslation(contents);
+		// Remember the statement so the profile can be shown next to it.
+		if (m_profile && statement.opCode != OC_Org) {
+			m_profiler.RecordStatement(loc, lineCount, statement.text);
 		}
 
-		// Load the machine code into the emulator.
-		if (m_inst.GetOpCode() != "DS" && m_inst.GetOpCode() != "ORG") {
-			if (LoadIntoEmulator(loc, contents) == false) {
-				string error = "Attempted to write to invalid memory location";
-				Errors::RecordError(lineCount, error);
-			}
+		bool resolved = statement.symbol.empty() || ResolveStatement(index);
+		if (!statement.symbol.empty() && endFound == false) {
+			m_references[statement.symbol].push_back(index);
 		}
-		
-		if (loc > 9999 || loc < 0) {
-			string error = "Invalid Memory Location";
-			Errors::RecordError(lineCount, error);
+		if (resolved || endFound) {
+			FinishStatement(index);
 		}
+
 		// Determine next memory location.
 		loc = m_inst.LocationNextInstruction(loc);
+	}
+}
+
+
+
+/*
+NAME
+
+DisplayTranslation - Displays the translation made by SinglePass.
+
+SYNOPSIS
+
+void Assembler::DisplayTranslation();
+
+DESCRIPTION
+
+Displays the column headers and each line with its location, contents
+and errors, exactly as PassII displays them while it translates.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::DisplayTranslation()
+{
+	DisplayTranslationHeader();
+
+	for (int i = 0; i < (int)m_statements.size(); i++) {
+		const Statement &statement = m_statements[i];
+		if (statement.kind == SK_Comment) {
+			m_writer.Write("                      ", 22);
+			m_writer.WriteSource(statement.text.data(), statement.text.size());
+			m_writer.Write('\n');
+		}
+		else if (statement.kind == SK_End) {
+			m_writer.Write("                    ", 20);
+			m_writer.WriteSource(statement.text.data(), statement.text.size());
+			m_writer.Write('\n');
+		}
+		else {
+			m_writer.Write("  ", 2);
+			m_writer.WriteNumber(statement.location);
+			m_writer.Write("      ", 6);
+			Instruction::PrintTranslation(statement.opCode, statement.contents, statement.text.data(), statement.text.size(), m_writer);
+			m_errorList.DisplayErrors(statement.line, m_writer);
+		}
+		m_writer.FlushIfFull();
+	}
+	if (m_finalLine != -1) {
+		m_errorList.DisplayErrors(m_finalLine, m_writer);
+	}
+	m_writer.Flush();
+}
+
+
+
+/*
+NAME
+
+DisplayTranslationHeader - Displays the column headers of the translation.
+
+SYNOPSIS
+
+void Assembler::DisplayTranslationHeader();
+
+DESCRIPTION
+
+Writes the title and column headers through the listing writer, which
+PassII and DisplayTranslation then write the lines through.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::DisplayTranslationHeader()
+{
+	static const char HEADER[] = "\nTranslation of Program:\n\nLocation   Contents   Original Statement\n";
+	m_writer.Write(HEADER, sizeof(HEADER) - 1);
+}
+
+
+
+/*
+NAME
+
+ResolveStatement - Sets the address of a statement from its label.
+
+SYNOPSIS
+
+bool Assembler::ResolveStatement(int a_index);
+
+a_index - the statement, in m_statements.
+
+DESCRIPTION
+
+Looks the label up and makes the contents the part before the address
+followed by the location, as CalculateContents does.
+
+RETURNS
+
+True if the label is defined, false if it is not yet.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool Assembler::ResolveStatement(int a_index)
+{
+	Statement &statement = m_statements[a_index];
+	int location;
+	if (!m_symtab.LookupSymbol(statement.symbol, location)) {
+		return false;
+	}
+	statement.contents = statement.prefix;
+	ListingWriter::FormatNumber(location, 4, statement.contents);
+	return true;
+}
+
+
+
+/*
+NAME
+
+FinishStatement - Loads a statement once its address is settled.
+
+SYNOPSIS
+
+void Assembler::FinishStatement(int a_index);
+
+a_index - the statement, in m_statements.
+
+DESCRIPTION
+
+A statement whose label is still not defined gets the "Undefined label"
+error and "????" for its address.  The contents are then loaded into the
+emulator, unless a later statement has already loaded the same location,
+and the errors Pass II finds after looking up the label are recorded in
+the same order.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::FinishStatement(int a_index)
+{
+	Statement &statement = m_statements[a_index];
+	if (!statement.symbol.empty() && statement.contents.empty()) {
+		string error = "Undefined label";
+		m_errorList.RecordError(statement.line, error);
+		statement.contents = statement.prefix + "????";
+	}
+
+	int loc = statement.location;
+	bool inMemory = loc >= 0 && loc < emulator::MEMSZ;
+	if (statement.loads && !(inMemory && m_loadedBy[loc] > a_index)) {
+		if (LoadIntoEmulator(loc, statement.contents) == false) {
+			string error = "Attempted to write to invalid memory location";
+			m_errorList.RecordError(statement.line, error);
+		}
+		else {
+			m_loadedBy[loc] = a_index;
+		}
+	}
+	if (loc > 9999 || loc < 0) {
+		string error = "Invalid Memory Location";
+		m_errorList.RecordError(statement.line, error);
+	}
+	statement.finished = true;
+}
+
+
+
+/*
+NAME
 
-		// Display any errors for the current line.
-		Errors::DisplayErrors(lineCount);
-		
+ResolveReferences - Patches the statements referring to a label just defined.
+
+SYNOPSIS
+
+void Assembler::ResolveReferences(const string &a_symbol);
+
+a_symbol - the label.
+
+DESCRIPTION
+
+Statements waiting for the label are resolved and finished.  If the
+label has just become multiply defined, the statements already finished
+get its new location, and any of them still in memory is loaded again.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Assembler::ResolveReferences(const string &a_symbol)
+{
+	map<string, vector<int> >::iterator references = m_references.find(a_symbol);
+	if (references == m_references.end()) {
+		return;
+	}
+	const vector<int> &indexes = references->second;
+	for (int i = 0; i < (int)indexes.size(); i++) {
+		int index = indexes[i];
+		ResolveStatement(index);
+		Statement &statement = m_statements[index];
+		if (!statement.finished) {
+			FinishStatement(index);
+		}
+		else if (statement.location >= 0 && statement.location < emulator::MEMSZ
+			&& m_loadedBy[statement.location] == index) {
+			LoadIntoEmulator(statement.location, statement.contents);
+		}
 	}
 }
 
 
+
 /*
 NAME
 
-RunEmulator - Runs the emulator.
+FinishReferences - Finishes the statements whose labels were never defined.
 
 SYNOPSIS
 
-void Assembler::RunEmulator( );
+void Assembler::FinishReferences();
 
 DESCRIPTION
 
-Runs the emulator and displays the results to the screen.
+Called at the end statement, or the end of the source without one,
+after which no more labels are defined.
 
 RETURNS
 
@@ -245,11 +1726,18 @@ AUTHOR
 
 Charles Snyder
 */
-void Assembler::RunEmulator() {
-	cout << endl;
-	cout << "Results from emulating program:" << endl << endl;
-	m_emul.runProgram(m_inst.GetStartLocation());
-	cout << endl << "End of emulation" << endl;
+void Assembler::FinishReferences()
+{
+	map<string, vector<int> >::iterator references;
+	for (references = m_references.begin(); references != m_references.end(); references++) {
+		const vector<int> &indexes = references->second;
+		for (int i = 0; i < (int)indexes.size(); i++) {
+			if (!m_statements[indexes[i]].finished) {
+				FinishStatement(indexes[i]);
+			}
+		}
+	}
+	m_references.clear();
 }
 
 
@@ -295,16 +1783,16 @@ CalculateContents - Determines the machine code from the opcode and operand valu
 
 SYNOPSIS
 
-string Assembler::CalculateContents(int symbolLocation, string invalidSymbol);
+string Assembler::CalculateContents(int a_index, int symbolLocation, string invalidSymbol);
 
+int a_index - the line, in the parsed program.
 int symbolLocation - holds the location where the symbol is located in memory.
 string invalidSymbol - tells the function whether an error occured in symbol lookup.
 
 DESCRIPTION
 
 Based on particular opcode and operand combinations particular values will
-get placed into the contents stringstream.  The stream will be converted
-to a string and returned.
+get placed into the contents, padded with zeros to their widths.
 
 RETURNS
 
@@ -314,49 +1802,52 @@ AUTHOR
 
 Charles Snyder
 */
-string Assembler::CalculateContents(int symbolLocation, string invalidSymbol) {
-	stringstream contents; // Stream to hold the machine code contents.
+string Assembler::CalculateContents(int a_index, int symbolLocation, string invalidSymbol) {
+	string contents; // Holds the machine code contents.
+	OpCodeId opCode = m_program.GetOpCode(a_index);
+	int numericOpCode = m_program.GetNumericOpCode(a_index);
 
 	// If the opcode is DC then the contents are just the operand, no opcode is needed in the calculation.
-	if (m_inst.GetOpCode() == "DC") {
-		contents << setw(6) << setfill('0') << m_inst.GetOperand();
-		return contents.str();
+	const OpCodeTable::Descriptor &info = OpCodeTable::Get(opCode);
+	if (opCode == OC_Dc) {
+		ListingWriter::FormatText(m_symtab.GetName(m_program.GetOperand(a_index)), 6, contents);
+		return contents;
 	}
 
 	// If the opcode is DS or ORG then there are no contents.
-	else if (m_inst.GetOpCode() == "DS" || m_inst.GetOpCode() == "ORG") {
+	else if (info.size != OpCodeTable::SE_Word) {
 		return "";
 	}
 
 	// If the opcode is a machine instruction first set the 2 lefthand digits of the machine code.
-	else if (m_inst.GetNumericOpCode() > 0) {
-		contents << setw(2) << setfill('0') << m_inst.GetNumericOpCode() << setw(4) << setfill('0');
+	else if (numericOpCode > 0) {
+		ListingWriter::FormatNumber(numericOpCode, 2, contents);
 	}
 
 	// This is if an error was encountered and the current opcode value is "??".
 	else {
-		contents << setw(2) << setfill('0') << m_inst.GetOpCode() << setw(4) << setfill('0');
+		ListingWriter::FormatText(info.mnemonic, 2, contents);
 	}
 
 	// This section is for a machine instructions address section of the contents.
 	// If a symbol was looked up and valid, store that location.
 	if (symbolLocation != -1 && invalidSymbol == "") {
-		contents << symbolLocation;
+		ListingWriter::FormatNumber(symbolLocation, 4, contents);
 	}
 	// If invalid symbol was set to "????", set that as address portion of the contents.
 	else if (invalidSymbol != "") {
-		contents << invalidSymbol;
+		ListingWriter::FormatText(invalidSymbol, 4, contents);
 	}
 	// This is if the operand was not a symbol.
-	else if (m_inst.GetOpCode() != "HALT" && m_inst.GetOpCode() != "END") {
-		contents << m_inst.GetOperandValue();
+	else if (info.operand != OpCodeTable::OR_None) {
+		ListingWriter::FormatNumber(m_program.GetOperandValue(a_index), 4, contents);
 	}
 	// Default case load in zero for address.
 	else {
-		contents << 0;
+		ListingWriter::FormatNumber(0, 4, contents);
 	}
 
-	return contents.str();
+	return contents;
 }
 
 
@@ -368,8 +1859,9 @@ FindSymbol - Determines whether operand is a symbol and if so looks up its locat
 
 SYNOPSIS
 
-bool Assembler::FindSymbol(int &symbolLocation, string &invalidSymbol);
+bool Assembler::FindSymbol(int a_index, int &symbolLocation, string &invalidSymbol);
 
+int a_index - the line, in the parsed program.
 int symbolLocation - holds the location where the symbol is located in memory, passed by reference.
 string invalidSymbol - tells the function whether an error occured in symbol lookup, passed by reference.
 
@@ -387,11 +1879,13 @@ AUTHOR
 
 Charles Snyder
 */
-bool Assembler::FindSymbol(int &symbolLocation, string &invalidSymbol) {
+bool Assembler::FindSymbol(int a_index, int &symbolLocation, string &invalidSymbol) {
+	int operand = m_program.GetOperand(a_index);
+
 	// Determine whether the operand is a symbol or numeric.
-	if (m_inst.GetIsNumericOperand() == false && m_inst.GetOpCode() != "HALT" && m_inst.GetOperand() != "????") {
+	if (HasSymbolOperand(a_index)) {
 		// Determined to be a symbol, perform the lookup.
-		if (m_symtab.LookupSymbol(m_inst.GetOperand(), symbolLocation) == false) {
+		if (m_symtab.LookupSymbol(operand, symbolLocation) == false) {
 			symbolLocation = 10000;
 			invalidSymbol = "????";
 			return false;
@@ -399,7 +1893,7 @@ bool Assembler::FindSymbol(int &symbolLocation, string &invalidSymbol) {
 		return true;
 	}
 	// Error occured in earlier function, set invalid symbol.
-	else if (m_inst.GetOperand() == "????" && m_inst.GetOpCode() != "HALT" && m_inst.GetOpCode() != "END") {
+	else if (m_symtab.GetName(operand) == "????" && OpCodeTable::Get(m_program.GetOpCode(a_index)).operand != OpCodeTable::OR_None) {
 		invalidSymbol = "????";
 		symbolLocation = -1;
 		return true;
@@ -413,3 +1907,34 @@ bool Assembler::FindSymbol(int &symbolLocation, string &invalidSymbol) {
 
 
 
+/*
+NAME
+
+HasSymbolOperand - Checks whether the operand is looked up in the symbol table.
+
+SYNOPSIS
+
+bool Assembler::HasSymbolOperand(int a_index);
+
+a_index - the line, in the parsed program.
+
+DESCRIPTION
+
+The operand is a symbol unless it is numeric, belongs to a HALT, or was
+replaced by "????" for an error found when the line was parsed.
+
+RETURNS
+
+True if the operand is a symbol, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool Assembler::HasSymbolOperand(int a_index) {
+	return m_program.HasFlag(a_index, ParsedProgram::PF_NumericOperand) == false && m_program.GetOpCode(a_index) != OC_Halt
+		&& m_symtab.GetName(m_program.GetOperand(a_index)) != "????";
+}
+
+
+
@@ -8,40 +8,270 @@
 #include "Instruction.h"
 #include "FileAccess.h"
 #include "Emulator.h"
+#include "Profiler.h"
+#include "TraceWriter.h"
+#include "UndoLog.h"
+#include "ParsedProgram.h"
+#include "ListingWriter.h"
+#include "ObjectWriter.h"
+#include "ObjectFile.h"
+#include "ParseCache.h"
 
 
 class Assembler {
 
 public:
-	Assembler(int argc, char *argv[]);
+
+	// Assembles the named source file; isOpen reports whether it could be opened.
+	Assembler(const string &a_fileName);
+
+	// Assembles source text held in memory.  The text is copied.
+	Assembler(const char *a_source, size_t a_length);
 	~Assembler();
 
-	// Pass I - establish the locations of the symbols
+	// Sets where the listing and the assembly errors are displayed.  Until
+	// this is called nothing is displayed.
+	void SetListing(ostream &a_listing, ostream &a_errors);
+
+	// Displays the listing on standard output and the errors on standard
+	// error, written straight to them where that is possible; without
+	// a_listing only the errors are displayed.
+	void SetConsoleListing(bool a_listing);
+
+	// Checks whether the source file could be opened.
+	bool isOpen() { return m_facc.isOpen(); }
+
+	// Assembles the program with SinglePass; false if there were errors.
+	bool Assemble();
+
+	// Pass I - establish the locations of the symbols and parse every line
 	void PassI();
 
-	// Pass II - generate a translation
+	// Pass II - generate a translation from the lines Pass I parsed
 	//at the end of pass 2 feed in location and content to emulator.
 	void PassII();
 
+	// Assembles the source file again after it has been edited, as PassI,
+	// DisplaySymbolTable and PassII would, but parsing only lines it has
+	// not seen and translating only lines that could have changed.  The
+	// first call assembles all of it.  False if the file could not be read.
+	bool Reassemble();
+
+	// The lines the last Reassemble parsed and translated.
+	int GetReparsedCount() const { return m_reparsed; }
+	int GetRetranslatedCount() const { return m_retranslated; }
+
+	// Assembles the program reading each line only once, so the source
+	// need not be a file that can be read again.  References to labels
+	// defined further on are patched when the label is.
+	void SinglePass();
+
+	// Displays the translation made by SinglePass, as PassII displays it.
+	void DisplayTranslation();
+
 	// Display the symbols in the symbol table.
-	void DisplaySymbolTable() { m_symtab.DisplaySymbolTable(); }
+	void DisplaySymbolTable() { m_symtab.DisplaySymbolTable(*m_listing); }
+
+	// The assembly errors found, by line number.
+	const multimap<int, string> &GetErrors() { return m_errorList.GetErrors(); }
 
-	// Run emulator on the translation.
-	void RunEmulator();
+	// Ways the translation can be run.
+	enum RunMode {
+		RM_Interpret,       // With the interpreter.
+		RM_Jit,             // As native code, where the JIT is available.
+		RM_Profile,         // With the interpreter, counting into the profiler.
+		RM_Trace,           // With the interpreter, recording into the trace set by SetTrace.
+		RM_Undo             // With the interpreter, recording into the undo log set by SetUndoLog.
+	};
+
+	// Runs the translation on the emulator and reports how the run ended.
+	emulator::RunResult Run(RunMode a_mode);
+
+	// Records the translation, with its symbols and lines, in an object file.
+	void WriteObject(ObjectWriter &a_object);
+
+	// Loads the translation from an object file instead of assembling it.
+	void LoadObject(const ObjectFile &a_object);
+
+	// Records the source of each location for the profile; call before Pass II.
+	void EnableProfiling() { m_profile = true; }
+
+	// Runs the passes on at most a_workers threads; 0, the default, is one
+	// for each core.
+	void SetWorkerCount(int a_workers) { m_workers = a_workers; }
+
+	// The open trace an RM_Trace run records into.
+	void SetTrace(TraceWriter *a_trace) { m_trace = a_trace; }
+
+	// The undo log an RM_Undo run records into.
+	void SetUndoLog(UndoLog *a_log) { m_undo = a_log; }
+
+	// The profile of the last RM_Profile run.
+	Profiler &GetProfiler() { return m_profiler; }
+
+	// The emulator holding the translation, ready to run.  Its input, output
+	// and limits are set through it before Run.
+	const emulator &GetEmulator() const { return m_emul; }
+	emulator &GetEmulator() { return m_emul; }
+
+	// The location given by the END statement, -1 if there was none.
+	int GetStartLocation() { return m_inst.GetStartLocation(); }
 
 	//Load contents into the emulator
 	bool LoadIntoEmulator(int location, string contents);
 
-	//Calculate the machine code instructions
-	string CalculateContents(int symbolLocation, string invalidSymbol);
+	//Calculate the machine code instructions of a parsed line
+	string CalculateContents(int a_index, int symbolLocation, string invalidSymbol);
 
 	//Find symbol from symbol table if necessary
-	bool FindSymbol(int &symbolLocation, string &invalidSymbol);
+	bool FindSymbol(int a_index, int &symbolLocation, string &invalidSymbol);
 
 private:
 
+	string m_fileName;      // The source file, empty for source held in memory.
 	FileAccess m_facc;	    // File Access object
 	SymbolTable m_symtab;	// Symbol table object
 	Instruction m_inst;	    // Instruction object
+	Errors m_errorList;     // The errors found in this program.
+	ParsedProgram m_program;// Every line as it was parsed.
 	emulator m_emul;        // Emulator for VC3600
+	bool m_profile;         // Record the source for the profiler.
+	int m_workers;          // Most threads a pass runs on, 0 for one for each core.
+	Profiler m_profiler;    // The counts and source of the profiled run.
+	TraceWriter *m_trace;   // Where an RM_Trace run is recorded, NULL if not set.
+	UndoLog *m_undo;        // Where an RM_Undo run is recorded, NULL if not set.
+	ostream m_discard;      // Discards the listing until SetListing is called.
+	ostream *m_listing;     // Where the translation is displayed.
+	ostream *m_errors;      // Where assembly errors are displayed.
+	ListingWriter m_writer; // Writes the translation and its errors to them.
+
+	// Kinds of line in the listing kept by SinglePass.
+	enum StatementKind {
+		SK_Comment,         // Comment or blank line.
+		SK_End,             // End statement.
+		SK_Translated       // Machine or assembler language instruction.
+	};
+
+	// A line as SinglePass leaves it for DisplayTranslation.
+	struct Statement {
+		StatementKind kind;
+		int line;               // The line number, for its errors.
+		string text;            // The original statement.
+		OpCodeId opCode;        // Decides what the listing shows.
+		int location;
+		string contents;        // The translation, once its address is known.
+		string symbol;          // The label the address comes from, empty if none.
+		string prefix;          // The contents before that address.
+		bool loads;             // The contents go into memory; not DS or ORG.
+		bool finished;          // The contents are known and in memory.
+	};
+
+	// The lines read by SinglePass, the statements referring to each label,
+	// the last statement loaded into each location, and the line whose
+	// errors end the listing, -1 if it ended at the end statement.
+	vector<Statement> m_statements;
+	map<string, vector<int> > m_references;
+	vector<int> m_loadedBy;
+	int m_finalLine;
+
+	// Sets up the parts shared by the constructors.
+	void Initialize();
+
+	// The lines one task of Pass I parses, and what it found.
+	struct ParsedChunk {
+		int begin;                  // The first line, from 0.
+		int end;                    // One past the last line.
+		ParsedProgram program;      // The lines, parsed.
+		SymbolTable names;          // The names of the lines, by their ids in program.
+		Errors errors;              // The errors found parsing the lines.
+		int startLocation;          // Set by the last ORG with a number, -1 if none.
+		int firstValue;             // The first entry to set the operand value, -1 if none.
+		int lastValue;              // The operand value the chunk leaves.
+		int firstCode;              // The first entry to set the numeric opcode, -1 if none.
+		int lastCode;               // The numeric opcode the chunk leaves.
+		bool setsLocation;          // The chunk sets the location rather than adding to it,
+		int locationChange;         // by this amount.
+		int location;               // The location the chunk starts at.
+	};
+
+	// The number of workers each pass runs on.
+	int GetWorkerCount(int a_chunks);
+
+	// The stages of Pass I for one chunk.
+	void ParseChunk(ParsedChunk *a_chunk);
+	void SizeChunk(ParsedChunk *a_chunk, int a_carriedValue, int a_carriedCode);
+	void LocateChunk(ParsedChunk *a_chunk);
+
+	// The lines one task of Pass II translates, and what it made of them.
+	struct TranslatedChunk {
+		int begin;                  // The first entry.
+		int end;                    // One past the last entry.
+		ListingWriter listing;      // The listing of the lines and their errors.
+		Errors errors;              // The errors of the lines, those of Pass I first.
+	};
+
+	// The number of lines Pass I and Pass II give each task.
+	const static int CHUNK_LINES = 4096;
+
+	// Translates the lines of a chunk; a_endIndex is the first end statement.
+	void TranslateChunk(TranslatedChunk *a_chunk, int a_endIndex);
+
+	// The errors TranslateLine finds in a line, as bits.
+	enum TranslationError {
+		TE_UndefinedLabel = 1,
+		TE_InvalidWrite = 2,
+		TE_InvalidLocation = 4
+	};
+
+	// Translates an assembly or machine instruction; returns its TranslationError bits.
+	int TranslateLine(int a_index, string &a_contents);
+
+	// Adds a line, translated by TranslateLine if it is an instruction, to a
+	// listing, with its errors recorded in a_errors and displayed after it.
+	void ListLine(int a_index, int a_endIndex, const string &a_contents, int a_translationErrors,
+		Errors &a_errors, ListingWriter &a_listing);
+
+	// What Reassemble keeps from one assembly to the next: the lines parsed
+	// so far, which line of the cache each entry was copied from, and so the
+	// text it was assembled from, the contents and TranslationError bits of
+	// each entry, the entry of each call to SymbolTable::AddSymbol, and the
+	// entries whose translation could have changed.
+	ParseCache m_cache;
+	Instruction m_parser;
+	vector<int> m_parsedAs;
+	vector<string> m_contents;
+	vector<unsigned char> m_translationErrors;
+	vector<int> m_definedBy;
+	vector<unsigned char> m_stale;
+	int m_reparsed;
+	int m_retranslated;
+
+	// The cache is started over once it holds more lines than this many
+	// more than twice the lines of the source.
+	const static int CACHE_SLACK = 4096;
+
+	// The two passes of Reassemble.
+	void UpdatePassI();
+	void UpdatePassII();
+
+	// Displays the column headers of the translation.
+	void DisplayTranslationHeader();
+
+	// Loads the words of the translation made by Pass II into the emulator.
+	void LoadTranslation();
+
+	// Checks whether the operand of a parsed line is looked up in the symbol table.
+	bool HasSymbolOperand(int a_index);
+
+	// Sets the address of a statement from its label, if it is defined yet.
+	bool ResolveStatement(int a_index);
+
+	// Loads a statement and records its errors, once its address is settled.
+	void FinishStatement(int a_index);
+
+	// Resolves the statements referring to a label that was just defined.
+	void ResolveReferences(const string &a_symbol);
+
+	// Finishes the statements whose labels were never defined.
+	void FinishReferences();
 };
@@ -0,0 +1,708 @@
+//
+//  Implementation of the BatchRunner class.
+//
+#include "stdafx.h"
+#include "BatchRunner.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+
+// Reads a non-negative number option, terminating if it is not one.
+long long BatchRunner::NumberOption(int argc, char *argv[], int &i)
+{
+	long long value = -1;
+	if (i + 1 < argc) {
+		istringstream in(argv[++i]);
+		if (!(in >> value) || !in.eof()) {
+			value = -1;
+		}
+	}
+	if (value < 0) {
+		cerr << "Option " << argv[i] << " needs a number" << endl;
+		exit(1);
+	}
+	return value;
+}
+
+/*
+NAME
+
+BatchRunner - Constructor for the BatchRunner class.
+
+SYNOPSIS
+
+BatchRunner::BatchRunner(int argc, char *argv[]);
+
+argc - the number of command line arguments.
+
+argv - the commmand line arguments in an array.
+
+DESCRIPTION
+
+Reads the options of a batch run:
+
+	--batch <manifest>   the file listing the jobs (required)
+	--threads <n>        worker threads, the number of processors by default
+	--steps <n>          most instructions each job may execute
+	--time <ms>          most milliseconds each job may take
+	--output <bytes>     most bytes each job may WRITE
+	--results <file>     where the results go, the screen by default
+	--jit                run the jobs with the JIT when there is no step or
+	                     time limit
+	--lanes              run the jobs of each program in groups of
+	                     LaneEmulator::LANES in lockstep
+	--snapshot           run each program up to its first READ once and
+	                     resume every job of it from there; not used
+	                     with --lanes
+	--detect-loops       stop a job as non-terminating when its machine
+	                     comes back to a state it was in; not used with
+	                     --lanes, and the jobs are interpreted
+
+Any error in the options terminates the program.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+BatchRunner::BatchRunner(int argc, char *argv[])
+{
+	m_threads = (int)thread::hardware_concurrency();
+	if (m_threads < 1) {
+		m_threads = 1;
+	}
+	m_stepLimit = emulator::NO_LIMIT;
+	m_timeLimit = emulator::NO_LIMIT;
+	m_outputLimit = emulator::NO_LIMIT;
+	m_useJit = false;
+	m_useLanes = false;
+	m_useSnapshots = false;
+	m_detectLoops = false;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--batch" && i + 1 < argc) {
+			m_manifestName = argv[++i];
+		}
+		else if (arg == "--results" && i + 1 < argc) {
+			m_resultsName = argv[++i];
+		}
+		else if (arg == "--threads") {
+			m_threads = (int)NumberOption(argc, argv, i);
+		}
+		else if (arg == "--steps") {
+			m_stepLimit = NumberOption(argc, argv, i);
+		}
+		else if (arg == "--time") {
+			m_timeLimit = NumberOption(argc, argv, i);
+		}
+		else if (arg == "--output") {
+			m_outputLimit = NumberOption(argc, argv, i);
+		}
+		else if (arg == "--jit") {
+			m_useJit = true;
+		}
+		else if (arg == "--lanes") {
+			m_useLanes = true;
+		}
+		else if (arg == "--snapshot") {
+			m_useSnapshots = true;
+		}
+		else if (arg == "--detect-loops") {
+			m_detectLoops = true;
+		}
+		else {
+			m_manifestName = "";
+			break;
+		}
+	}
+	if (m_manifestName.empty() || m_threads < 1) {
+		cerr << "Usage: Assem --batch <Manifest> [--threads N] [--steps N] [--time MS]"
+			<< " [--output BYTES] [--results <FileName>] [--jit] [--lanes] [--snapshot]"
+			<< " [--detect-loops]" << endl;
+		exit(1);
+	}
+}
+
+// Destructor releases the assembled programs, their snapshots and the emulators.
+BatchRunner::~BatchRunner()
+{
+	for (int i = 0; i < (int)m_prefixes.size(); i++) {
+		delete m_prefixes[i].snapshot;
+	}
+	for (int i = 0; i < (int)m_programs.size(); i++) {
+		delete m_programs[i];
+	}
+	for (int i = 0; i < (int)m_emulators.size(); i++) {
+		delete m_emulators[i];
+	}
+	for (int i = 0; i < (int)m_laneEmulators.size(); i++) {
+		delete m_laneEmulators[i];
+	}
+}
+
+
+
+/*
+NAME
+
+Run - Runs every job in the manifest.
+
+SYNOPSIS
+
+int BatchRunner::Run();
+
+DESCRIPTION
+
+Reads the manifest and assembles each distinct program once on this
+thread.  The jobs are then run
+on a work stealing thread pool.  Each worker has one emulator that is
+loaded again from the assembled program for every job it runs, so no
+memory is allocated per job.  With --snapshot each program is first run
+up to its first READ, and the jobs are restored from there instead of
+being loaded.  With --lanes the jobs of each program are
+instead dealt out in groups that run in lockstep on a LaneEmulator.  The
+results are written in manifest order once every job has finished.
+
+RETURNS
+
+The exit status for the program: 0 if the batch ran, 1 if the manifest
+or results file could not be opened.
+
+AUTHOR
+
+Charles Snyder
+*/
+int BatchRunner::Run()
+{
+	if (!ReadManifest()) {
+		return 1;
+	}
+	AssemblePrograms();
+
+	ThreadPool pool(m_threads);
+	for (int i = 0; i < pool.GetWorkerCount(); i++) {
+		m_emulators.push_back(new emulator);
+		if (m_useLanes) {
+			m_laneEmulators.push_back(new LaneEmulator);
+		}
+	}
+
+	if (m_useSnapshots && !m_useLanes) {
+		ProgramPrefix none = { NULL, emulator::RS_AtRead, 0, "" };
+		m_prefixes.assign(m_programs.size(), none);
+		for (int i = 0; i < (int)m_programs.size(); i++) {
+			pool.Submit(bind(&BatchRunner::RunPrefix, this, i, placeholders::_1));
+		}
+		pool.Run();
+	}
+
+	if (m_useLanes) {
+		// Group the jobs of each program in manifest order.
+		vector< vector<int> > groups(m_programs.size());
+		for (int i = 0; i < (int)m_jobs.size(); i++) {
+			int program = m_jobs[i].programIndex;
+			if (program == -1) {
+				pool.Submit(bind(&BatchRunner::RunJob, this, i, placeholders::_1));
+				continue;
+			}
+			groups[program].push_back(i);
+			if ((int)groups[program].size() == LaneEmulator::LANES) {
+				pool.Submit(bind(&BatchRunner::RunLaneGroup, this, groups[program], placeholders::_1));
+				groups[program].clear();
+			}
+		}
+		for (int i = 0; i < (int)groups.size(); i++) {
+			if (!groups[i].empty()) {
+				pool.Submit(bind(&BatchRunner::RunLaneGroup, this, groups[i], placeholders::_1));
+			}
+		}
+	}
+	else {
+		for (int i = 0; i < (int)m_jobs.size(); i++) {
+			pool.Submit(bind(&BatchRunner::RunJob, this, i, placeholders::_1));
+		}
+	}
+	pool.Run();
+
+	if (m_resultsName.empty()) {
+		WriteResults(cout);
+		return 0;
+	}
+	ofstream results(m_resultsName.c_str());
+	if (!results) {
+		cerr << "Results file could not be opened" << endl;
+		return 1;
+	}
+	WriteResults(results);
+	return 0;
+}
+
+
+
+/*
+NAME
+
+ReadManifest - Reads the jobs from the manifest.
+
+SYNOPSIS
+
+bool BatchRunner::ReadManifest();
+
+DESCRIPTION
+
+Each line of the manifest names a program and, optionally, a file of
+input for its READ instructions.  Blank lines and lines starting with
+';' or '#' are ignored.
+
+RETURNS
+
+False if the manifest could not be opened, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool BatchRunner::ReadManifest()
+{
+	ifstream manifest(m_manifestName.c_str());
+	if (!manifest) {
+		cerr << "Manifest file could not be opened" << endl;
+		return false;
+	}
+
+	string line;
+	while (getline(manifest, line)) {
+		BatchJob job;
+		istringstream fields(line);
+		if (!(fields >> job.program) || job.program[0] == ';' || job.program[0] == '#') {
+			continue;
+		}
+		fields >> job.input;
+		job.programIndex = -1;
+		job.steps = 0;
+		job.milliseconds = 0;
+		m_jobs.push_back(job);
+	}
+	return true;
+}
+
+
+
+/*
+NAME
+
+AssemblePrograms - Assembles each distinct program of the jobs.
+
+SYNOPSIS
+
+void BatchRunner::AssemblePrograms();
+
+DESCRIPTION
+
+The listing and the assembly errors are discarded; the program is run
+as it was translated, just as the assembler itself would run it.  A
+program that is an object file, written with --object, is loaded from
+it instead of being assembled.  Jobs whose program could not be opened
+keep a programIndex of -1.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void BatchRunner::AssemblePrograms()
+{
+	map<string, int> assembled;
+
+	for (int i = 0; i < (int)m_jobs.size(); i++) {
+		BatchJob &job = m_jobs[i];
+		map<string, int>::iterator found = assembled.find(job.program);
+		if (found != assembled.end()) {
+			job.programIndex = found->second;
+			continue;
+		}
+
+		ObjectFile object;
+		Assembler *assem = NULL;
+		if (object.Open(job.program)) {
+			assem = new Assembler("", 0);
+			assem->LoadObject(object);
+		}
+		else {
+			assem = new Assembler(job.program);
+			if (assem->isOpen()) {
+				assem->Assemble();
+			}
+		}
+		if (assem->isOpen()) {
+			job.programIndex = (int)m_programs.size();
+			m_programs.push_back(assem);
+		}
+		else {
+			delete assem;
+		}
+		assembled[job.program] = job.programIndex;
+	}
+}
+
+
+
+/*
+NAME
+
+RunPrefix - Runs a program up to its first READ.
+
+SYNOPSIS
+
+void BatchRunner::RunPrefix(int a_program, int a_worker);
+
+a_program - the index of the program in m_programs.
+
+a_worker - the index of the worker running it.
+
+DESCRIPTION
+
+Runs the program with no input and within the limits of a job until it
+reaches a READ, and keeps the snapshot and the output up to there.  If
+the program ends before any READ, every job of it ends the same way, so
+that result is kept instead.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void BatchRunner::RunPrefix(int a_program, int a_worker)
+{
+	ProgramPrefix &prefix = m_prefixes[a_program];
+	Assembler *program = m_programs[a_program];
+	emulator &emul = *m_emulators[a_worker];
+	istringstream noInput;
+	ostringstream output;
+	emul.LoadFrom(program->GetEmulator());
+	emul.SetIO(noInput, output, false);
+	emul.SetOutputBuffer(OUTPUT_BUFFER_SIZE);
+	emul.SetLimits(m_stepLimit, m_timeLimit, m_outputLimit);
+	emul.SetLoopDetection(m_detectLoops);
+
+	prefix.snapshot = new emulator::Snapshot;
+	prefix.status = emul.runToRead(program->GetStartLocation(), *prefix.snapshot);
+	prefix.steps = emul.GetStepCount();
+	prefix.output = output.str();
+}
+
+
+
+/*
+NAME
+
+RunJob - Runs one job.
+
+SYNOPSIS
+
+void BatchRunner::RunJob(int a_job, int a_worker);
+
+a_job - the index of the job in m_jobs.
+
+a_worker - the index of the worker running it.
+
+DESCRIPTION
+
+Loads the worker's emulator from the assembled program, connects READ to
+the job's input file, mapped into memory, and WRITE to a buffered string,
+and runs it within the limits.
+Error messages from the run are part of its output, as they would be on
+the screen.  With --snapshot the emulator is restored to the program's
+first READ instead, and the output before it is put in front; the time
+of a job then leaves out the time before the READ.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void BatchRunner::RunJob(int a_job, int a_worker)
+{
+	BatchJob &job = m_jobs[a_job];
+	if (job.programIndex == -1) {
+		job.status = "no-program";
+		return;
+	}
+
+	MappedFile inputFile;
+	if (!job.input.empty() && !inputFile.Open(job.input)) {
+		job.status = "no-input";
+		return;
+	}
+
+	Assembler *program = m_programs[job.programIndex];
+	emulator &emul = *m_emulators[a_worker];
+	ProgramPrefix *prefix = NULL;
+	if (m_useSnapshots && !m_useLanes) {
+		prefix = &m_prefixes[job.programIndex];
+		if (prefix->status != emulator::RS_AtRead) {
+			job.status = StatusName(prefix->status);
+			job.steps = m_useJit && m_stepLimit == emulator::NO_LIMIT && m_timeLimit == emulator::NO_LIMIT
+				&& !m_detectLoops ? -1 : prefix->steps;
+			job.milliseconds = 0;
+			job.output = prefix->output;
+			return;
+		}
+	}
+
+	istringstream noInput;
+	ostringstream output;
+	if (prefix != NULL) {
+		emul.RestoreSnapshot(*prefix->snapshot);
+	}
+	else {
+		emul.LoadFrom(program->GetEmulator());
+	}
+	emul.SetIO(noInput, output, false);
+	if (!job.input.empty()) {
+		emul.SetInputBuffer(inputFile.GetData(), inputFile.GetData() + inputFile.GetSize());
+	}
+	emul.SetOutputBuffer(OUTPUT_BUFFER_SIZE);
+	emul.SetLimits(m_stepLimit, m_timeLimit, m_outputLimit);
+	emul.SetLoopDetection(m_detectLoops);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	emulator::RunStatus status;
+	if (prefix != NULL) {
+		status = m_useJit ? emul.resumeProgramJit() : emul.resumeProgram();
+	}
+	else if (m_useJit) {
+		status = emul.runProgramJit(program->GetStartLocation());
+	}
+	else {
+		status = emul.runProgram(program->GetStartLocation());
+	}
+	chrono::steady_clock::duration elapsed = chrono::steady_clock::now() - start;
+
+	job.status = StatusName(status);
+	job.steps = m_useJit && m_stepLimit == emulator::NO_LIMIT && m_timeLimit == emulator::NO_LIMIT
+		&& !m_detectLoops ? -1 : emul.GetStepCount();
+	job.milliseconds = chrono::duration_cast<chrono::milliseconds>(elapsed).count();
+	job.output = prefix != NULL ? prefix->output + output.str() : output.str();
+}
+
+
+
+/*
+NAME
+
+RunLaneGroup - Runs jobs of the same program together.
+
+SYNOPSIS
+
+void BatchRunner::RunLaneGroup(vector<int> a_jobs, int a_worker);
+
+a_jobs - the indexes in m_jobs of up to LaneEmulator::LANES jobs that
+		 all run the same program.
+
+a_worker - the index of the worker running them.
+
+DESCRIPTION
+
+Each job gets a lane of the worker's lane emulator, with its own input
+file, mapped into memory as RunJob maps it, and output.  The time of each job is the time of the whole group.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void BatchRunner::RunLaneGroup(vector<int> a_jobs, int a_worker)
+{
+	LaneEmulator::Lane lanes[LaneEmulator::LANES];
+	MappedFile inputFiles[LaneEmulator::LANES];
+	ostringstream outputs[LaneEmulator::LANES];
+	vector<int> running;
+
+	for (int i = 0; i < (int)a_jobs.size(); i++) {
+		BatchJob &job = m_jobs[a_jobs[i]];
+		int lane = (int)running.size();
+		lanes[lane].inputNext = lanes[lane].inputEnd = "";
+		if (!job.input.empty()) {
+			if (!inputFiles[lane].Open(job.input)) {
+				job.status = "no-input";
+				continue;
+			}
+			if (inputFiles[lane].GetData() != NULL) {
+				lanes[lane].inputNext = inputFiles[lane].GetData();
+				lanes[lane].inputEnd = inputFiles[lane].GetData() + inputFiles[lane].GetSize();
+			}
+		}
+		lanes[lane].output = &outputs[lane];
+		running.push_back(a_jobs[i]);
+	}
+	if (running.empty()) {
+		return;
+	}
+
+	Assembler *program = m_programs[m_jobs[running[0]].programIndex];
+	LaneEmulator &laneEmul = *m_laneEmulators[a_worker];
+	laneEmul.SetLimits(m_stepLimit, m_timeLimit, m_outputLimit);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	laneEmul.Run(program->GetEmulator(), program->GetStartLocation(),
+		lanes, (int)running.size(), *m_emulators[a_worker]);
+	chrono::steady_clock::duration elapsed = chrono::steady_clock::now() - start;
+
+	for (int i = 0; i < (int)running.size(); i++) {
+		BatchJob &job = m_jobs[running[i]];
+		job.status = StatusName(lanes[i].status);
+		job.steps = lanes[i].steps;
+		job.milliseconds = chrono::duration_cast<chrono::milliseconds>(elapsed).count();
+		job.output = outputs[i].str();
+	}
+}
+
+
+
+/*
+NAME
+
+WriteResults - Writes the result of each job.
+
+SYNOPSIS
+
+void BatchRunner::WriteResults(ostream &a_out);
+
+a_out - the stream to write to.
+
+DESCRIPTION
+
+Writes a header and then one tab separated line for each job in manifest
+order: the job number, program, input, status, steps executed (-1 when
+run with the JIT), milliseconds taken and the escaped output.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void BatchRunner::WriteResults(ostream &a_out)
+{
+	a_out << "job\tprogram\tinput\tstatus\tsteps\tms\toutput" << endl;
+	for (int i = 0; i < (int)m_jobs.size(); i++) {
+		const BatchJob &job = m_jobs[i];
+		a_out << i + 1 << '\t' << Escape(job.program) << '\t' << Escape(job.input) << '\t'
+			<< job.status << '\t' << job.steps << '\t' << job.milliseconds << '\t'
+			<< Escape(job.output) << '\n';
+	}
+	a_out.flush();
+}
+
+
+
+/*
+NAME
+
+StatusName - The name of a run status.
+
+SYNOPSIS
+
+const char *BatchRunner::StatusName(emulator::RunStatus a_status);
+
+a_status - how the run ended.
+
+DESCRIPTION
+
+Gives the word used for the status in the results.
+
+RETURNS
+
+The name.
+
+AUTHOR
+
+Charles Snyder
+*/
+const char *BatchRunner::StatusName(emulator::RunStatus a_status)
+{
+	switch (a_status) {
+	case emulator::RS_Halted:
+		return "halted";
+	case emulator::RS_RuntimeError:
+		return "error";
+	case emulator::RS_StepLimit:
+		return "step-limit";
+	case emulator::RS_TimeLimit:
+		return "time-limit";
+	case emulator::RS_OutputLimit:
+		return "output-limit";
+	case emulator::RS_AtRead:
+		return "at-read";
+	case emulator::RS_NonTerminating:
+		return "non-terminating";
+	}
+	return "unknown";
+}
+
+
+
+/*
+NAME
+
+Escape - Escapes a field of the results.
+
+SYNOPSIS
+
+string BatchRunner::Escape(const string &a_text);
+
+a_text - the text of the field.
+
+DESCRIPTION
+
+Replaces backslashes, tabs and newlines with \\, \t and \n so that each
+job stays on one line of the results.
+
+RETURNS
+
+The escaped text.
+
+AUTHOR
+
+Charles Snyder
+*/
+string BatchRunner::Escape(const string &a_text)
+{
+	string escaped;
+	escaped.reserve(a_text.length());
+	for (int i = 0; i < (int)a_text.length(); i++) {
+		switch (a_text[i]) {
+		case '\\':
+			escaped += "\\\\";
+			break;
+		case '\t':
+			escaped += "\\t";
+			break;
+		case '\n':
+			escaped += "\\n";
+			break;
+		default:
+			escaped += a_text[i];
+			break;
+		}
+	}
+	return escaped;
+}
@@ -0,0 +1,92 @@
+//
+//		BatchRunner class - runs many VC3600 programs and inputs in parallel.
+//
+#ifndef _BATCHRUNNER_H
+#define _BATCHRUNNER_H
+
+#include "Assembler.h"
+#include "LaneEmulator.h"
+
+class BatchRunner {
+
+public:
+
+	// Reads the batch options from the command line.
+	BatchRunner(int argc, char *argv[]);
+	~BatchRunner();
+
+	// Runs every job in the manifest and writes the results.
+	int Run();
+
+	// Reads the number after the option at argv[i], terminating if there is none.
+	static long long NumberOption(int argc, char *argv[], int &i);
+
+	// The name of a run status as it appears in the results.
+	static const char *StatusName(emulator::RunStatus a_status);
+
+private:
+
+	// One run of a program on one input.
+	struct BatchJob {
+		string program;		// The source file.
+		string input;		// The input file, empty if there is none.
+		int programIndex;	// Index into m_programs, -1 if it could not be assembled.
+
+		// The result.
+		string status;
+		long long steps;
+		long long milliseconds;
+		string output;
+	};
+
+	// The part of a program's run before its first READ, run once (--snapshot).
+	struct ProgramPrefix {
+		emulator::Snapshot *snapshot;	// The state at the READ, NULL if not run.
+		emulator::RunStatus status;		// RS_AtRead, or how every run of the program ends.
+		long long steps;				// Instructions executed before the READ.
+		string output;					// What was displayed before the READ.
+	};
+
+	// Bytes of a job's output collected before it is added to the result.
+	const static int OUTPUT_BUFFER_SIZE = 1 << 16;
+
+	string m_manifestName;		// The manifest file (--batch).
+	string m_resultsName;		// The results file (--results), empty for cout.
+	int m_threads;				// Worker threads (--threads).
+	long long m_stepLimit;		// Limits for each job (--steps, --time, --output).
+	long long m_timeLimit;
+	long long m_outputLimit;
+	bool m_useJit;				// Run the jobs with the JIT (--jit).
+	bool m_useLanes;			// Run jobs of one program in lockstep (--lanes).
+	bool m_useSnapshots;		// Resume jobs from their program's first READ (--snapshot).
+	bool m_detectLoops;			// Stop jobs that repeat a state (--detect-loops).
+
+	vector<BatchJob> m_jobs;			// The jobs in manifest order.
+	vector<Assembler *> m_programs;		// Each distinct program, assembled once.
+	vector<ProgramPrefix> m_prefixes;	// The prefix of each program (--snapshot).
+	vector<emulator *> m_emulators;		// One reusable emulator for each worker.
+	vector<LaneEmulator *> m_laneEmulators;	// One lane emulator for each worker (--lanes).
+
+	// Reads the manifest into m_jobs.
+	bool ReadManifest();
+
+	// Assembles each distinct program of the jobs.
+	void AssemblePrograms();
+
+	// Runs a program up to its first READ on the emulator of the given worker.
+	void RunPrefix(int a_program, int a_worker);
+
+	// Runs one job on the emulator of the given worker.
+	void RunJob(int a_job, int a_worker);
+
+	// Runs jobs of the same program together on the lane emulator of the given worker.
+	void RunLaneGroup(vector<int> a_jobs, int a_worker);
+
+	// Writes one line for each job.
+	void WriteResults(ostream &a_out);
+
+	// Escapes tabs, newlines and backslashes so a field fits on one line.
+	static string Escape(const string &a_text);
+};
+
+#endif
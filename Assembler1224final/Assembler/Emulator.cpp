@@ -1,5 +1,9 @@
 #include "stdafx.h"
 #include "Emulator.h"
+#include "Profiler.h"
+#include "TraceWriter.h"
+#include "UndoLog.h"
+#include "JitCompiler.h"
 
 
 
@@ -21,8 +25,9 @@ a_contents - the six digit machine code instructions.
 DESCRIPTION
 
 If a valid location is specified the contents are loaded into the
-emulator's memory at that location.  Otherwise no insertion is
-performed.
+emulator's memory at that location, as the number atoi makes of them,
+and they are kept as the text WRITE displays until the word is stored
+into.  Otherwise no insertion is performed.
 
 RETURNS
 
@@ -34,73 +39,2436 @@ Charles Snyder
 */
 bool emulator::insertMemory(int a_location, string a_contents)
 {
-	if (a_location >= 0 && a_location <= 9999) {
-		m_memory[a_location] = a_contents;
-		return true;
+	if (a_location < 0 || a_location > 9999) {
+		return false;
+	}
+	m_restoredFrom = NULL;
+	const char *text = a_contents.c_str();
+	SetText(a_location, atoi(text), text, text + a_contents.length());
+	DecodeLocation(a_location);
+	return true;
+}
+
+
+
+/*
+NAME
+
+insertWords - stores words at consecutive locations.
+
+SYNOPSIS
+
+bool emulator::insertWords(int a_location, const int *a_words, int a_count);
+
+a_location - the location of the first word.
+
+a_words - the words, as ContentsToWord makes them of six digit contents.
+
+a_count - the number of words.
+
+DESCRIPTION
+
+If every location is valid the words are copied into memory at once,
+shown as six digits, and predecoded, as insertMemory would do for the
+contents they came from.  Otherwise no insertion is performed.  This is
+how an object file is loaded.
+
+RETURNS
+
+True if insert is successful, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::insertWords(int a_location, const int *a_words, int a_count)
+{
+	if (a_location < 0 || a_count < 0 || a_count > MEMSZ - a_location) {
+		return false;
+	}
+	m_restoredFrom = NULL;
+	memcpy(m_memory + a_location, a_words, a_count * sizeof(int));
+	for (int i = a_location; i < a_location + a_count; i++) {
+		m_shown[i] = (unsigned short)(m_memory[i] >= 100000 ? SHOWN_NUMBER : 6);
+		DecodeLocation(i);
+	}
+	return true;
+}
+
+
+
+/*
+NAME
+
+ContentsToWord - Turns the translation of an instruction into a word.
+
+SYNOPSIS
+
+static bool emulator::ContentsToWord(const string &a_contents, int &a_word);
+
+a_contents - the six digit machine code instructions.
+
+a_word - passed by reference, set to the number the contents are.
+
+DESCRIPTION
+
+Nearly every translation is six digits, which insertWords can load from
+their number alone.  Anything else, such as contents the assembler
+flagged with question marks or an instruction referring to a multiply
+defined label, has to be loaded from its text with insertMemory.
+
+RETURNS
+
+True if the contents are six digits, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::ContentsToWord(const string &a_contents, int &a_word)
+{
+	if (a_contents.length() != 6) {
+		return false;
+	}
+	int word = 0;
+	for (int i = 0; i < 6; i++) {
+		if (a_contents[i] < '0' || a_contents[i] > '9') {
+			return false;
+		}
+		word = word * 10 + (a_contents[i] - '0');
+	}
+	a_word = word;
+	return true;
+}
+
+
+
+/*
+NAME
+
+LoadFrom - makes this emulator a fresh copy of another loaded emulator.
+
+SYNOPSIS
+
+void emulator::LoadFrom(const emulator &a_other);
+
+a_other - an emulator that a program has been inserted into.
+
+DESCRIPTION
+
+Copies the memory, how its words are shown and the predecoded
+instructions of a_other and resets the registers and counters, so one
+loaded program can be run many times without being inserted again.  The
+input, output and limits of this emulator are kept.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::LoadFrom(const emulator &a_other) {
+	m_restoredFrom = NULL;
+	memcpy(m_memory, a_other.m_memory, sizeof(m_memory));
+	memcpy(m_shown, a_other.m_shown, sizeof(m_shown));
+	m_texts = a_other.m_texts;
+	memcpy(m_decoded, a_other.m_decoded, sizeof(m_decoded));
+	accumulator = 0;
+	activeLocation = 0;
+	m_stepCount = 0;
+	m_fusedCount = 0;
+	m_fusionEnabled = true;
+	m_outputCount = 0;
+}
+
+
+
+/*
+NAME
+
+LoadWords - loads memory from words spaced apart.
+
+SYNOPSIS
+
+void emulator::LoadWords(const int *a_words, int a_stride, int a_accumulator);
+
+a_words - the word for location 0.
+
+a_stride - the distance between the words of consecutive locations.
+
+a_accumulator - the value for the accumulator.
+
+DESCRIPTION
+
+Loads all of memory from a_words[0], a_words[a_stride], and so on, and
+resets the counters as LoadFrom does.  A word that differs from the one
+already in memory is shown as its number, as a STORE would leave it;
+the rest keep the text they were loaded with.  This is how the final
+memory of an evaluated program is put back.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::LoadWords(const int *a_words, int a_stride, int a_accumulator) {
+	m_restoredFrom = NULL;
+	for (int i = 0; i < MEMSZ; i++) {
+		int word = a_words[i * a_stride];
+		if (word != m_memory[i]) {
+			m_memory[i] = word;
+			m_shown[i] = SHOWN_NUMBER;
+		}
+		DecodeLocation(i);
+	}
+	accumulator = a_accumulator;
+	activeLocation = 0;
+	m_stepCount = 0;
+	m_fusedCount = 0;
+	m_fusionEnabled = true;
+	m_outputCount = 0;
+}
+
+
+
+/*
+NAME
+
+SetIO - sets where READ and WRITE go.
+
+SYNOPSIS
+
+void emulator::SetIO(istream &a_input, ostream &a_output, bool a_prompt);
+
+a_input - the stream READ takes its values from.
+
+a_output - the stream WRITE and the error messages are displayed on.
+
+a_prompt - true to display "? " before each READ.
+
+DESCRIPTION
+
+Until this is called READ reads nothing, as at the end of a file, and
+nothing is displayed, so an emulator inside another program stays quiet.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::SetIO(istream &a_input, ostream &a_output, bool a_prompt) {
+	FlushOutput();
+	m_input = &a_input;
+	m_inputNext = NULL;
+	m_inputEnd = NULL;
+	m_output = &a_output;
+	m_prompt = a_prompt;
+}
+
+
+
+/*
+NAME
+
+GetResult - Puts together the result of a run.
+
+SYNOPSIS
+
+emulator::RunResult emulator::GetResult(RunStatus a_status);
+
+a_status - how the run ended, as returned by the run function.
+
+DESCRIPTION
+
+Collects the status, the runtime error if there was one, the location
+the run stopped at, the number of instructions executed and the range of
+locations of a loop that was found, so that a program embedding the
+emulator does not have to read the messages.
+
+RETURNS
+
+The result.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunResult emulator::GetResult(RunStatus a_status) {
+	RunResult result;
+	result.status = a_status;
+	result.error = (a_status == RS_RuntimeError) ? m_error : RE_None;
+	result.location = activeLocation;
+	result.steps = m_stepCount;
+	result.loopFirst = (a_status == RS_NonTerminating) ? m_loopFirst : -1;
+	result.loopLast = (a_status == RS_NonTerminating) ? m_loopLast : -1;
+	return result;
+}
+
+
+
+/*
+NAME
+
+SetInputBuffer - takes READ values from memory.
+
+SYNOPSIS
+
+void emulator::SetInputBuffer(const char *a_begin, const char *a_end);
+
+a_begin - the first character of the input.
+
+a_end - just past the last character of the input.
+
+DESCRIPTION
+
+READ takes its values from the characters between a_begin and a_end,
+such as a mapped input file, instead of the input stream.  The values
+are separated by white space, as they are on the stream.  The buffer
+must stay valid until SetIO is called again.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::SetInputBuffer(const char *a_begin, const char *a_end) {
+	m_inputNext = a_begin;
+	m_inputEnd = a_end;
+	if (m_inputNext == NULL) {
+		// An empty file has no data; it must still not fall back to the stream.
+		m_inputNext = m_inputEnd = "";
+	}
+}
+
+
+
+/*
+NAME
+
+SetOutputBuffer - buffers the output.
+
+SYNOPSIS
+
+void emulator::SetOutputBuffer(int a_size);
+
+a_size - the size of the buffer in bytes, or zero for none.
+
+DESCRIPTION
+
+WRITE output and error messages are collected in the buffer, which is
+written out when it fills up and when a run ends, instead of each line
+being written out, and flushed, as it is displayed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::SetOutputBuffer(int a_size) {
+	FlushOutput();
+	m_outputBuffer.resize(a_size);
+}
+
+
+
+/*
+NAME
+
+DisplayLine - displays a line of output.
+
+SYNOPSIS
+
+void emulator::DisplayLine(const char *a_text, int a_length);
+
+a_text - the text of the line, without the newline.
+
+a_length - the number of characters in a_text.
+
+DESCRIPTION
+
+Adds the line to the output buffer, writing the buffer out first if
+there is no room.  Without a buffer the line is written out and flushed,
+as it has always been.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::DisplayLine(const char *a_text, int a_length) {
+	if (m_output == NULL) {
+		return;
+	}
+	if (m_outputBuffer.empty()) {
+		m_output->write(a_text, a_length);
+		*m_output << endl;
+		return;
+	}
+	if (m_outputUsed + a_length + 1 > (int)m_outputBuffer.size()) {
+		FlushOutput();
+		if (a_length + 1 > (int)m_outputBuffer.size()) {
+			m_output->write(a_text, a_length);
+			m_output->put('\n');
+			return;
+		}
+	}
+	memcpy(&m_outputBuffer[m_outputUsed], a_text, a_length);
+	m_outputUsed += a_length;
+	m_outputBuffer[m_outputUsed++] = '\n';
+}
+
+
+
+/*
+NAME
+
+FlushOutput - writes out the buffered output.
+
+SYNOPSIS
+
+void emulator::FlushOutput();
+
+DESCRIPTION
+
+Writes whatever is in the output buffer to the output stream in one
+piece and flushes the stream.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::FlushOutput() {
+	if (m_outputUsed > 0 && m_output != NULL) {
+		m_output->write(&m_outputBuffer[0], m_outputUsed);
+		m_output->flush();
+	}
+	m_outputUsed = 0;
+}
+
+
+
+/*
+NAME
+
+SetLimits - sets the limits on a run of the program.
+
+SYNOPSIS
+
+void emulator::SetLimits(long long a_steps, long long a_milliseconds, long long a_outputBytes);
+
+a_steps - the most instructions that may be executed.
+
+a_milliseconds - the longest the run may take.
+
+a_outputBytes - the most bytes that WRITE may display.
+
+DESCRIPTION
+
+Any of the limits may be NO_LIMIT.  The step limit is exact; the time
+limit is checked every CHECK_INTERVAL steps.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::SetLimits(long long a_steps, long long a_milliseconds, long long a_outputBytes) {
+	m_stepLimit = a_steps;
+	m_timeLimit = a_milliseconds;
+	m_outputLimit = a_outputBytes;
+}
+
+
+
+/*
+NAME
+
+NowMilliseconds - the current time in milliseconds.
+
+SYNOPSIS
+
+long long emulator::NowMilliseconds();
+
+DESCRIPTION
+
+Reads a steady clock, so the result only means something when compared
+with another call.
+
+RETURNS
+
+The time in milliseconds.
+
+AUTHOR
+
+Charles Snyder
+*/
+long long emulator::NowMilliseconds() {
+	return chrono::duration_cast<chrono::milliseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+
+
+/*
+NAME
+
+DecodeLocation - Predecodes the word at a location.
+
+SYNOPSIS
+
+void emulator::DecodeLocation(int location);
+
+location - the address of the word to decode.
+
+DESCRIPTION
+
+Splits the word into its opcode and address and validates both, so that
+runProgram never has to look at the raw word.  Words that cannot be run
+are decoded to a handler that reports the same error the emulator has
+always given for them.  A word shown with any text but its number is
+split as that text always has been: the first two characters are the
+opcode and the rest the address; "??" in the opcode or "????" as the
+address is checked first, then the opcode, then the address.  So an
+instruction referring to a multiply defined label ("09-999") or to an
+address past the end of memory ("0510020") stops with the address
+error.  A word shown as its number, as stored, or as six digits, as
+almost every word is loaded, is split into its first and last four
+digits without making the text.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::DecodeLocation(int location) {
+	DecodedInstruction &decoded = m_decoded[location];
+	decoded.address = 0;
+
+	int opcode;
+	int address;
+	int shown = m_shown[location];
+	if (shown == SHOWN_NUMBER || shown == 6) {
+		opcode = m_memory[location] / 10000;
+		address = m_memory[location] % 10000;
+	}
+	else {
+		char text[WORD_TEXT_SIZE + 1];
+		int length = FormatLocation(location, text);
+		text[length] = '\0';
+		char opcodeText[3] = { 0, 0, 0 };
+		memcpy(opcodeText, text, length < 2 ? length : 2);
+		const char *addressText = text + (length < 2 ? length : 2);
+		if (strcmp(addressText, "????") == 0 || strcmp(opcodeText, "??") == 0) {
+			decoded.handler = DH_InvalidWord;
+			return;
+		}
+		opcode = atoi(opcodeText);
+		address = atoi(addressText);
+	}
+
+	if (!OpCodeTable::IsMachineCode(opcode)) {
+		decoded.handler = DH_InvalidOpCode;
+	}
+	else if (address < 0 || address > 9999) {
+		decoded.handler = DH_InvalidAddress;
+	}
+	else {
+		decoded.handler = (unsigned short)opcode;
+		decoded.address = (unsigned short)address;
+	}
+}
+
+
+
+/*
+NAME
+
+SetText - Puts a word into memory with the text it is displayed as.
+
+SYNOPSIS
+
+void emulator::SetText(int a_location, int a_value, const char *a_begin, const char *a_end);
+
+a_location - the location of the word.
+
+a_value - the word, the number atoi makes of the text.
+
+a_begin - the first character of the text.
+
+a_end - just past the last character of the text.
+
+DESCRIPTION
+
+Stores the word and how it is shown: as its number if that is its text,
+as its number with zeros in front if that is, and otherwise as the text
+itself, which is added to m_texts unless it is there already.  Texts are
+only added when a translation is loaded and when READ is given input
+such as "-007", so the search is short; should the table ever fill up,
+the word is shown as its number.  The word is not predecoded.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::SetText(int a_location, int a_value, const char *a_begin, const char *a_end) {
+	m_memory[a_location] = a_value;
+	int length = (int)(a_end - a_begin);
+	if (IsPlainNumber(a_begin, a_end, a_value)) {
+		m_shown[a_location] = SHOWN_NUMBER;
+		return;
+	}
+
+	// Zeros in front of a number.
+	char digits[WORD_TEXT_SIZE];
+	int count = FormatWord(a_value, digits);
+	if (a_value >= 0 && length > count && length <= SHOWN_WIDTH && memcmp(a_end - count, digits, count) == 0) {
+		const char *p = a_begin;
+		while (p < a_end - count && *p == '0') {
+			p++;
+		}
+		if (p == a_end - count) {
+			m_shown[a_location] = (unsigned short)length;
+			return;
+		}
+	}
+
+	if (length > WORD_TEXT_SIZE) {
+		length = WORD_TEXT_SIZE;
+	}
+	string text(a_begin, length);
+	int index = 0;
+	while (index < (int)m_texts.size() && m_texts[index] != text) {
+		index++;
+	}
+	if (SHOWN_TEXT + index > 0xFFFF) {
+		m_shown[a_location] = SHOWN_NUMBER;
+		return;
+	}
+	if (index == (int)m_texts.size()) {
+		m_texts.push_back(text);
+	}
+	m_shown[a_location] = (unsigned short)(SHOWN_TEXT + index);
+}
+
+
+
+/*
+NAME
+
+IsPlainNumber - Whether a text is just the number it stands for.
+
+SYNOPSIS
+
+static bool emulator::IsPlainNumber(const char *a_begin, const char *a_end, int a_value);
+
+a_begin - the first character of the text.
+
+a_end - just past the last character of the text.
+
+a_value - the number atoi makes of the text.
+
+DESCRIPTION
+
+Compares the text with the number as FormatWord writes it.  This is how
+almost all input to READ looks, and such a word needs nothing kept to
+display it.
+
+RETURNS
+
+True if the text is the number, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::IsPlainNumber(const char *a_begin, const char *a_end, int a_value) {
+	char digits[WORD_TEXT_SIZE];
+	int count = FormatWord(a_value, digits);
+	return a_end - a_begin == count && memcmp(a_begin, digits, count) == 0;
+}
+
+
+
+/*
+NAME
+
+UpdateLocation - Redecodes a location whose word has changed.
+
+SYNOPSIS
+
+void emulator::UpdateLocation(int location);
+
+location - the address of the word that was stored.
+
+DESCRIPTION
+
+Redecodes the word.  If it decodes differently than before, then since
+a fused group covers three words, the two words before it are redecoded
+as well and any group that starts at one of the three locations is
+fused again.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::UpdateLocation(int location) {
+	MarkDirty(location);
+
+	// Most stores are data; if the word decodes as it did before, nothing
+	// about any group can have changed.
+	DecodedInstruction before = m_decoded[location];
+	DecodeLocation(location);
+	if (m_decoded[location].handler == before.handler && m_decoded[location].address == before.address) {
+		return;
+	}
+
+	int first = (location >= 2) ? location - 2 : 0;
+	for (int i = first; i <= location; i++) {
+		DecodeLocation(i);
+	}
+	for (int i = first; i <= location; i++) {
+		FuseLocation(i);
+	}
+}
+
+
+
+/*
+NAME
+
+FuseInstructions - Combines common instruction sequences into fused groups.
+
+SYNOPSIS
+
+void emulator::FuseInstructions();
+
+DESCRIPTION
+
+Scans the loaded program for LOAD/ADD/STORE, LOAD/SUB/STORE and
+LOAD/SUB/branch sequences and replaces the handler of each LOAD with one
+that runs the whole group, saving two dispatches.  A group can only
+start with a LOAD and never has a LOAD in its other two places, so
+groups never overlap.  The number of instructions fused is kept for
+GetFusedCount.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::FuseInstructions() {
+	m_restoredFrom = NULL;
+	m_fusedCount = 0;
+	for (int i = 0; i < MEMSZ; i++) {
+		if (FuseLocation(i)) {
+			m_fusedCount += 3;
+		}
+	}
+}
+
+
+
+/*
+NAME
+
+FuseLocation - Fuses the group starting at a location, if there is one.
+
+SYNOPSIS
+
+bool emulator::FuseLocation(int location);
+
+location - the address of the first word of the possible group.
+
+DESCRIPTION
+
+If the predecoded words at location, location + 1 and location + 2 form
+one of the fused sequences, the handler at location is replaced with the
+handler for the group.
+
+RETURNS
+
+True if a group was fused, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::FuseLocation(int location) {
+	if (!m_fusionEnabled || location + 2 >= MEMSZ || m_decoded[location].handler != DH_Load) {
+		return false;
+	}
+
+	int second = m_decoded[location + 1].handler;
+	int third = m_decoded[location + 2].handler;
+	int fused;
+	if (second == DH_Add && third == DH_Store) {
+		fused = DH_LoadAddStore;
+	}
+	else if (second != DH_Sub) {
+		return false;
+	}
+	else if (third == DH_Store) {
+		fused = DH_LoadSubStore;
+	}
+	else if (third == DH_BranchMinus) {
+		fused = DH_LoadSubBranchMinus;
+	}
+	else if (third == DH_BranchZero) {
+		fused = DH_LoadSubBranchZero;
+	}
+	else if (third == DH_BranchPositive) {
+		fused = DH_LoadSubBranchPositive;
+	}
+	else {
+		return false;
+	}
+	m_decoded[location].handler = (unsigned short)fused;
+	return true;
+}
+
+
+
+/*
+NAME
+
+UnfuseInstructions - Returns all fused groups to their separate instructions.
+
+SYNOPSIS
+
+void emulator::UnfuseInstructions();
+
+DESCRIPTION
+
+Redecodes every word without fusing, and keeps later stores from fusing
+again.  Used when a run comes close to its step limit, so that the limit
+falls exactly between two instructions.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::UnfuseInstructions() {
+	m_restoredFrom = NULL;
+	m_fusionEnabled = false;
+	for (int i = 0; i < MEMSZ; i++) {
+		if (m_decoded[i].handler >= DH_LoadAddStore) {
+			DecodeLocation(i);
+		}
+	}
+}
+
+
+
+/*
+NAME
+
+CheckLimits - Checks the limits of a run and decides when to check next.
+
+SYNOPSIS
+
+bool emulator::CheckLimits(long long a_startTime, long long &a_nextCheck, RunStatus &a_status);
+
+a_startTime - the time in milliseconds the run started.
+
+a_nextCheck - passed by reference, set to the step count at which the
+			  limits must be checked again.
+
+a_status - passed by reference, set to why the run must stop.
+
+DESCRIPTION
+
+The run loop only compares its step count against a_nextCheck, so this
+is where the step and time limits are really enforced.  The time is
+looked at every CHECK_INTERVAL steps.  Once the step limit is within
+reach, fusion is undone so the run can stop exactly at the limit.
+
+RETURNS
+
+True if the run may continue, false if it has reached a limit.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::CheckLimits(long long a_startTime, long long &a_nextCheck, RunStatus &a_status) {
+	if (m_stepLimit != NO_LIMIT && m_stepCount >= m_stepLimit) {
+		a_status = RS_StepLimit;
+		return false;
+	}
+	if (m_timeLimit != NO_LIMIT && NowMilliseconds() - a_startTime >= m_timeLimit) {
+		a_status = RS_TimeLimit;
+		return false;
+	}
+
+	a_nextCheck = m_stepCount + CHECK_INTERVAL;
+	if (m_stepLimit != NO_LIMIT && a_nextCheck + 2 >= m_stepLimit) {
+		// A fused group counts three steps at once and could step over the limit.
+		UnfuseInstructions();
+		a_nextCheck = m_stepLimit;
+	}
+	return true;
+}
+
+
+
+/*
+NAME
+
+ReportDecodeError - Displays the error for a word that cannot be run.
+
+SYNOPSIS
+
+void emulator::ReportDecodeError(int handler);
+
+handler - the DecodedHandler the word was decoded to.
+
+DESCRIPTION
+
+Displays the error message associated with the decoded handler and
+records the error for GetResult.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::ReportDecodeError(int handler) {
+	if (handler == DH_InvalidWord) {
+		m_error = RE_InvalidWord;
+		DisplayLine("Invalid Opcode or address");
+	}
+	else if (handler == DH_InvalidOpCode) {
+		m_error = RE_InvalidOpCode;
+		DisplayLine("Invalid Opcode");
+	}
+	else {
+		m_error = RE_InvalidAddress;
+		DisplayLine("Unable to access memory location");
+	}
+}
+
+
+
+/*
+NAME
+
+runProgram - Runs the emulator from inserted instructions.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::runProgram(int startLocation)
+
+startLocation - the address where the first instruction is located.
+
+DESCRIPTION
+
+Interprets the program and then writes out any buffered output, so that
+whatever way the run ends the output is complete.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::runProgram(int startLocation) {
+	RunStatus status = Interpret(startLocation);
+	FlushOutput();
+	return status;
+}
+
+
+
+/*
+NAME
+
+Interpret - Runs the predecoded instructions.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::Interpret(int startLocation)
+
+startLocation - the address where the first instruction is located.
+
+DESCRIPTION
+
+Fuses common instruction sequences and then runs the predecoded
+instructions starting at startLocation with Dispatch.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::Interpret(int startLocation) {
+	if (startLocation == -1) {
+		m_error = RE_NoStartLocation;
+		DisplayLine("No start location specified");
+		return RS_RuntimeError;
+	}
+
+	FuseInstructions();
+
+	// A start outside memory is run from the entry past the end, which stops
+	// the run with the address error.
+	activeLocation = startLocation >= 0 && startLocation < MEMSZ ? startLocation : MEMSZ;
+	m_stepCount = 0;
+	m_outputCount = 0;
+	return Dispatch();
+}
+
+
+
+/*
+NAME
+
+Dispatch - Runs the predecoded instructions from the active location.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::Dispatch()
+
+DESCRIPTION
+
+Runs the predecoded instructions starting at activeLocation until a halt
+command is encountered or a limit is reached.  The step and output
+counts carry on from where they are, so a run restored from a snapshot
+continues within the same limits.  The time limit counts from here.
+When runToRead has asked for it, the run stops just before a READ
+without counting it.  With loop detection on, every branch taken to the
+same or an earlier location is passed to CheckLoop, and the run stops
+with RS_NonTerminating at the branch target if the state repeated.
+Nothing is decoded or validated
+here; each step just looks up the handler for the active location and
+jumps to it.  With GCC and Clang the jump is a computed goto from one
+handler straight to the next, otherwise a switch over the handler is
+used.  At any point if an error occurs, it is displayed and the run stops
+with activeLocation at the instruction that failed.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::Dispatch() {
+	RunStatus status;
+	long long startTime = NowMilliseconds();
+	long long nextCheck;
+	if (!CheckLimits(startTime, nextCheck, status)) {
+		return status;
+	}
+	if (m_detectLoops) {
+		StartLoopDetection();
+	}
+
+#if defined(__GNUC__)
+	// Direct threaded dispatch.  The table is indexed by DecodedHandler.
+	static void *const handlers[] = {
+		&&invalid, &&add, &&sub, &&multiply, &&divide, &&load, &&store, &&read,
+		&&write, &&branch, &&branchMinus, &&branchZero, &&branchPositive,
+		&&halt, &&invalid, &&invalid,
+		&&loadAddStore, &&loadSubStore, &&loadSubBranchMinus, &&loadSubBranchZero,
+		&&loadSubBranchPositive
+	};
+
+	// The machine state is kept in locals so that it can stay in registers.
+	// It is written back before anything that uses the members: READ, WRITE,
+	// and the Execute function that reports an error.
+	const DecodedInstruction *decoded;
+	int acc = accumulator;
+	int loc = activeLocation;
+	long long steps = m_stepCount;
+	const bool detectLoops = m_detectLoops;
+
+#define SYNC() accumulator = acc; activeLocation = loc; m_stepCount = steps
+#define RELOAD() acc = accumulator; loc = activeLocation
+#define DISPATCH() if (steps >= nextCheck) goto check; \
+	steps++; decoded = &m_decoded[loc]; goto *handlers[decoded->handler]
+
+	// The common path of each instruction.  Anything unusual is passed to the
+	// Execute function so the error is reported in exactly one place.
+#define DO_ADD(a) acc += m_memory[a]; loc++
+#define DO_SUB(a) acc -= m_memory[a]; loc++
+#define DO_LOAD(a) { int value = m_memory[a]; \
+	if (value < -999999 || value > 999999) { SYNC(); ExecuteLoad(a); return RS_RuntimeError; } \
+	acc = value; loc++; }
+#define DO_STORE(a) { if (acc < -999999 || acc > 999999) { SYNC(); ExecuteStore(a); return RS_RuntimeError; } \
+	if (detectLoops) m_memoryHash ^= HashWord(a, m_memory[a]) ^ HashWord(a, acc); \
+	m_memory[a] = acc; m_shown[a] = SHOWN_NUMBER; UpdateLocation(a); loc++; }
+
+	// A branch taken from source back to loc may close a loop.
+#define LOOP_CHECK(source) if (detectLoops && loc <= (source) && !CheckLoop(acc, (source), loc)) { \
+	SYNC(); return RS_NonTerminating; }
+#define DO_BRANCH_IF(condition, a, source) if (condition) { loc = a; LOOP_CHECK(source); } else loc++
+#define HERE ((int)(decoded - m_decoded))
+
+	DISPATCH();
+check:
+	SYNC();
+	if (!CheckLimits(startTime, nextCheck, status)) {
+		return status;
+	}
+	steps++; decoded = &m_decoded[loc]; goto *handlers[decoded->handler];
+
+add:			DO_ADD(decoded->address);									DISPATCH();
+sub:			DO_SUB(decoded->address);									DISPATCH();
+multiply:		acc *= m_memory[decoded->address]; loc++;					DISPATCH();
+divide:
+	if (m_memory[decoded->address] == 0) {
+		SYNC(); ExecuteDivide(decoded->address); return RS_RuntimeError;
+	}
+	acc /= m_memory[decoded->address]; loc++;
+	DISPATCH();
+load:			DO_LOAD(decoded->address);									DISPATCH();
+store:			DO_STORE(decoded->address);									DISPATCH();
+read:
+	if (m_stopAtRead) {
+		steps--; SYNC(); return RS_AtRead;
+	}
+	SYNC(); ExecuteRead(decoded->address); RELOAD();
+	DISPATCH();
+write:
+	SYNC();
+	if (!ExecuteWrite(decoded->address)) {
+		return RS_OutputLimit;
+	}
+	RELOAD();
+	DISPATCH();
+branch:			DO_BRANCH_IF(true, decoded->address, HERE);				DISPATCH();
+branchMinus:	DO_BRANCH_IF(acc < 0, decoded->address, HERE);				DISPATCH();
+branchZero:		DO_BRANCH_IF(acc == 0, decoded->address, HERE);				DISPATCH();
+branchPositive:	DO_BRANCH_IF(acc > 0, decoded->address, HERE);				DISPATCH();
+
+	// Fused groups.  Each instruction of the group is counted as it runs.
+loadAddStore:
+	DO_LOAD(decoded[0].address);
+	steps++; DO_ADD(decoded[1].address);
+	steps++; DO_STORE(decoded[2].address);
+	DISPATCH();
+loadSubStore:
+	DO_LOAD(decoded[0].address);
+	steps++; DO_SUB(decoded[1].address);
+	steps++; DO_STORE(decoded[2].address);
+	DISPATCH();
+loadSubBranchMinus:
+	DO_LOAD(decoded[0].address);
+	steps++; DO_SUB(decoded[1].address);
+	steps++; DO_BRANCH_IF(acc < 0, decoded[2].address, HERE + 2);
+	DISPATCH();
+loadSubBranchZero:
+	DO_LOAD(decoded[0].address);
+	steps++; DO_SUB(decoded[1].address);
+	steps++; DO_BRANCH_IF(acc == 0, decoded[2].address, HERE + 2);
+	DISPATCH();
+loadSubBranchPositive:
+	DO_LOAD(decoded[0].address);
+	steps++; DO_SUB(decoded[1].address);
+	steps++; DO_BRANCH_IF(acc > 0, decoded[2].address, HERE + 2);
+	DISPATCH();
+
+invalid:		SYNC(); ReportDecodeError(decoded->handler); return RS_RuntimeError;
+halt:			SYNC(); return RS_Halted;
+
+#undef HERE
+#undef DO_BRANCH_IF
+#undef LOOP_CHECK
+#undef DO_STORE
+#undef DO_LOAD
+#undef DO_SUB
+#undef DO_ADD
+#undef DISPATCH
+#undef RELOAD
+#undef SYNC
+#else
+	// Portable dispatch.
+	for (;;) {
+		if (m_stepCount >= nextCheck && !CheckLimits(startTime, nextCheck, status)) {
+			return status;
+		}
+		const DecodedInstruction &decoded = m_decoded[activeLocation];
+		m_stepCount++;
+		if (decoded.handler >= DH_LoadAddStore) {
+			int source = activeLocation + 2;
+			if (!ExecuteFusedGroup(decoded.handler)) {
+				return RS_RuntimeError;
+			}
+			if (m_detectLoops && decoded.handler >= DH_LoadSubBranchMinus && activeLocation <= source
+				&& !CheckLoop(accumulator, source, activeLocation)) {
+				return RS_NonTerminating;
+			}
+			continue;
+		}
+		if (decoded.handler == DH_Halt) {
+			return RS_Halted;
+		}
+		if (decoded.handler == DH_InvalidOpCode || decoded.handler > DH_Halt) {
+			ReportDecodeError(decoded.handler);
+			return RS_RuntimeError;
+		}
+		if (decoded.handler == DH_Read && m_stopAtRead) {
+			m_stepCount--;
+			return RS_AtRead;
+		}
+		int source = activeLocation;
+		if (!ExecuteOpCode(decoded.handler, decoded.address, status)) {
+			return status;
+		}
+		if (m_detectLoops && decoded.handler >= DH_Branch && decoded.handler <= DH_BranchPositive
+			&& activeLocation <= source && !CheckLoop(accumulator, source, activeLocation)) {
+			return RS_NonTerminating;
+		}
+	}
+#endif
+}
+
+
+
+/*
+NAME
+
+StartLoopDetection - Prepares a run to look for loops.
+
+SYNOPSIS
+
+void emulator::StartLoopDetection();
+
+DESCRIPTION
+
+Memory may have been changed in any way since the last run, so its hash
+is computed from every word here.  From then on each store updates it
+with the old and the new value, so the state can be hashed in constant
+time at every backward branch.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::StartLoopDetection() {
+	m_memoryHash = 0;
+	for (int i = 0; i < MEMSZ; i++) {
+		m_memoryHash ^= HashWord(i, m_memory[i]);
+	}
+	ResetLoopSearch();
+}
+
+
+
+/*
+NAME
+
+ResetLoopSearch - Starts the search for a loop over.
+
+SYNOPSIS
+
+void emulator::ResetLoopSearch();
+
+DESCRIPTION
+
+Forgets the saved state, so that the next backward branch saves a new one.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::ResetLoopSearch() {
+	m_loopLocation = -1;
+	m_loopPower = 1;
+	m_loopLength = 0;
+}
+
+
+
+/*
+NAME
+
+CheckLoop - Looks for a repeated state at a backward branch.
+
+SYNOPSIS
+
+bool emulator::CheckLoop(int a_accumulator, int a_source, int a_target);
+
+a_accumulator - the accumulator, which the run may be keeping elsewhere.
+
+a_source - the location of the branch.
+
+a_target - the location branched to, no greater than a_source.
+
+DESCRIPTION
+
+Every loop of the program passes through a backward branch, so the
+state is only looked at there.  Its hash is compared with that of the
+state saved by Brent's algorithm, and only if they are the same are the
+accumulator, the location and all of memory compared, so the answer is
+exact and the usual cost is a few operations.  A state is saved after
+1, 2, 4, 8 ... branches, which finds any cycle within a small multiple
+of the branches in it.  The locations branched from and to since the
+save give the range of the loop: its highest location must branch back
+and its lowest must be branched back to.  Nothing outside the memory
+and the accumulator can change what a program does until the next READ.
+
+RETURNS
+
+False if the state is the same as the one saved, so the program will
+never terminate, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::CheckLoop(int a_accumulator, int a_source, int a_target) {
+	if (a_target < m_loopFirst) {
+		m_loopFirst = a_target;
+	}
+	if (a_source > m_loopLast) {
+		m_loopLast = a_source;
+	}
+
+	unsigned long long hash = m_memoryHash ^ HashWord(MEMSZ, a_accumulator) ^ HashWord(MEMSZ + 1, a_target);
+	if (hash == m_loopHash && a_target == m_loopLocation && a_accumulator == m_loopAccumulator
+		&& memcmp(&m_loopMemory[0], m_memory, sizeof(m_memory)) == 0) {
+		return false;
+	}
+
+	if (m_loopLocation == -1 || ++m_loopLength == m_loopPower) {
+		if (m_loopLocation != -1) {
+			m_loopPower *= 2;
+		}
+		m_loopLength = 0;
+		m_loopHash = hash;
+		m_loopAccumulator = a_accumulator;
+		m_loopLocation = a_target;
+		m_loopMemory.assign(m_memory, m_memory + MEMSZ);
+		m_loopFirst = MEMSZ;
+		m_loopLast = -1;
+	}
+	return true;
+}
+
+
+
+/*
+NAME
+
+runProgramJit - Runs the emulator by compiling the program to native code.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::runProgramJit(int startLocation)
+
+startLocation - the address where the first instruction is located.
+
+DESCRIPTION
+
+Runs the program with the JitCompiler, which translates each basic block
+into x86-64 code the first time it is reached.  The results, output and
+error messages are the same as runProgram.  The generated code does not
+count steps, look at the clock or look for loops, so where the JIT is
+not available, a step or time limit is set, loop detection is on or the
+start location is outside memory the program is interpreted by
+runProgram instead.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::runProgramJit(int startLocation) {
+	if (startLocation == -1) {
+		m_error = RE_NoStartLocation;
+		DisplayLine("No start location specified");
+		return RS_RuntimeError;
+	}
+
+	RunStatus status;
+	JitCompiler *jit = new JitCompiler(*this);
+	if (jit->isAvailable() && m_stepLimit == NO_LIMIT && m_timeLimit == NO_LIMIT && !m_detectLoops
+		&& startLocation >= 0 && startLocation < MEMSZ) {
+		m_stepCount = 0;
+		m_outputCount = 0;
+		status = jit->Run(startLocation);
+		m_restoredFrom = NULL;
+		FlushOutput();
+	}
+	else {
+		status = runProgram(startLocation);
+	}
+	delete jit;
+	return status;
+}
+
+
+
+/*
+NAME
+
+runToRead - Runs the program up to its first READ.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::runToRead(int startLocation, Snapshot &a_snapshot)
+
+startLocation - the address where the first instruction is located.
+
+a_snapshot - passed by reference, set to the state of the machine at the READ.
+
+DESCRIPTION
+
+Many programs do the same work before their first READ whatever their
+input is.  This runs that part once, with the limits and output as
+runProgram would, and stops just before the READ, so that a run for each
+input can be resumed from the snapshot instead of starting over.  The
+output of the part that was run is not in the snapshot; the caller keeps
+it to put in front of the output of each resumed run.
+
+RETURNS
+
+RS_AtRead if a READ was reached and a_snapshot was set, otherwise how
+the run ended, which is how every run of the program would end.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::runToRead(int startLocation, Snapshot &a_snapshot) {
+	m_stopAtRead = true;
+	RunStatus status = Interpret(startLocation);
+	m_stopAtRead = false;
+	FlushOutput();
+	if (status == RS_AtRead) {
+		TakeSnapshot(a_snapshot);
+	}
+	return status;
+}
+
+
+
+/*
+NAME
+
+TakeSnapshot - Records the state of the machine.
+
+SYNOPSIS
+
+void emulator::TakeSnapshot(Snapshot &a_snapshot);
+
+a_snapshot - passed by reference, set to the state of the machine.
+
+DESCRIPTION
+
+Copies memory, how its words are shown, the predecoded words and the
+registers and counts into the snapshot.  Since memory now matches the
+snapshot, no page is dirty.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::TakeSnapshot(Snapshot &a_snapshot) {
+	memcpy(a_snapshot.memory, m_memory, sizeof(m_memory));
+	memcpy(a_snapshot.shown, m_shown, sizeof(m_shown));
+	a_snapshot.texts = m_texts;
+	memcpy(a_snapshot.decoded, m_decoded, sizeof(m_decoded));
+	a_snapshot.fusionEnabled = m_fusionEnabled;
+	a_snapshot.fusedCount = m_fusedCount;
+	a_snapshot.accumulator = accumulator;
+	a_snapshot.activeLocation = activeLocation;
+	a_snapshot.stepCount = m_stepCount;
+	a_snapshot.outputCount = m_outputCount;
+
+	m_restoredFrom = &a_snapshot;
+	memset(m_dirty, 0, sizeof(m_dirty));
+}
+
+
+
+/*
+NAME
+
+RestoreSnapshot - Puts the machine back in the state of a snapshot.
+
+SYNOPSIS
+
+void emulator::RestoreSnapshot(const Snapshot &a_snapshot);
+
+a_snapshot - the state to restore.
+
+DESCRIPTION
+
+If memory was last taken or restored from this same snapshot and has
+only been changed by stores since, just the pages stored into are
+copied back, so a run that touches little memory is cheap to restore
+after.  Otherwise all of memory is copied.  The snapshot must not change
+while an emulator has been restored from it.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::RestoreSnapshot(const Snapshot &a_snapshot) {
+	if (m_restoredFrom == &a_snapshot) {
+		for (int page = 0; page < PAGES; page++) {
+			if (!m_dirty[page]) {
+				continue;
+			}
+			int first = page * PAGE_WORDS;
+			int count = (first + PAGE_WORDS <= MEMSZ) ? PAGE_WORDS : MEMSZ - first;
+			memcpy(&m_memory[first], &a_snapshot.memory[first], count * sizeof(m_memory[0]));
+			memcpy(&m_shown[first], &a_snapshot.shown[first], count * sizeof(m_shown[0]));
+			memcpy(&m_decoded[first], &a_snapshot.decoded[first], count * sizeof(m_decoded[0]));
+		}
+
+		// Texts are only ever added after the ones the snapshot has.
+		m_texts.resize(a_snapshot.texts.size());
+	}
+	else {
+		memcpy(m_memory, a_snapshot.memory, sizeof(m_memory));
+		memcpy(m_shown, a_snapshot.shown, sizeof(m_shown));
+		m_texts = a_snapshot.texts;
+		memcpy(m_decoded, a_snapshot.decoded, sizeof(m_decoded));
+	}
+	m_fusionEnabled = a_snapshot.fusionEnabled;
+	m_fusedCount = a_snapshot.fusedCount;
+	accumulator = a_snapshot.accumulator;
+	activeLocation = a_snapshot.activeLocation;
+	m_stepCount = a_snapshot.stepCount;
+	m_outputCount = a_snapshot.outputCount;
+
+	m_restoredFrom = &a_snapshot;
+	memset(m_dirty, 0, sizeof(m_dirty));
+}
+
+
+
+/*
+NAME
+
+MarkDirty - Records that a stored location differs from the snapshot.
+
+SYNOPSIS
+
+void emulator::MarkDirty(int location);
+
+location - the address that was stored into.
+
+DESCRIPTION
+
+A store can change the predecoded words of the two locations before it,
+where a fused group covering it would start, so their page is marked too.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::MarkDirty(int location) {
+	m_dirty[location / PAGE_WORDS] = true;
+	if (location >= 2) {
+		m_dirty[(location - 2) / PAGE_WORDS] = true;
+	}
+}
+
+
+
+/*
+NAME
+
+resumeProgram - Continues a run restored from a snapshot.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::resumeProgram()
+
+DESCRIPTION
+
+Runs the program from the READ the snapshot stopped at, with the input
+and output set since, and then writes out any buffered output.  Steps
+and output carry on from the counts in the snapshot, so the limits apply
+to the whole run as if it had never stopped.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::resumeProgram() {
+	RunStatus status = Dispatch();
+	FlushOutput();
+	return status;
+}
+
+
+
+/*
+NAME
+
+resumeProgramJit - Continues a run restored from a snapshot as native code.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::resumeProgramJit()
+
+DESCRIPTION
+
+As resumeProgram, but compiled by the JitCompiler when runProgramJit
+would use it.  The compiled code stores without marking pages dirty, so
+the next restore copies all of memory.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::resumeProgramJit() {
+	if (m_stepLimit != NO_LIMIT || m_timeLimit != NO_LIMIT || m_detectLoops) {
+		return resumeProgram();
+	}
+
+	RunStatus status;
+	JitCompiler *jit = new JitCompiler(*this);
+	if (jit->isAvailable()) {
+		status = jit->Run(activeLocation);
+		m_restoredFrom = NULL;
+		FlushOutput();
+	}
+	else {
+		status = resumeProgram();
+	}
+	delete jit;
+	return status;
+}
+
+
+
+/*
+NAME
+
+runProgramProfiled - Runs the emulator while profiling the program.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::runProgramProfiled(int startLocation, Profiler &a_profiler)
+
+startLocation - the address where the first instruction is located.
+
+a_profiler - where the executions, data accesses and branches are counted.
+
+DESCRIPTION
+
+Runs the program the same way runProgram does, with the same results and
+output, but through a separate loop that counts each instruction, so the
+counting costs nothing when the program is not being profiled.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::runProgramProfiled(int startLocation, Profiler &a_profiler) {
+	RunStatus status = InterpretProfiled(startLocation, a_profiler);
+	FlushOutput();
+	return status;
+}
+
+
+
+/*
+NAME
+
+InterpretProfiled - Runs the instructions one at a time and counts them.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::InterpretProfiled(int startLocation, Profiler &a_profiler)
+
+startLocation - the address where the first instruction is located.
+
+a_profiler - where the counts go.
+
+DESCRIPTION
+
+Undoes fusion, so that each instruction is counted at its own location,
+and runs the predecoded instructions through ExecuteOpCode.  Before each
+instruction its location is counted as executed, the address it uses is
+counted as read or written, and for BM, BZ and BP whether the branch is
+taken is counted.  The limits are checked as they are by Interpret.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::InterpretProfiled(int startLocation, Profiler &a_profiler) {
+	if (startLocation == -1) {
+		m_error = RE_NoStartLocation;
+		DisplayLine("No start location specified");
+		return RS_RuntimeError;
+	}
+
+	UnfuseInstructions();
+	activeLocation = startLocation >= 0 && startLocation < MEMSZ ? startLocation : MEMSZ;
+	m_stepCount = 0;
+	m_outputCount = 0;
+
+	RunStatus status;
+	long long startTime = NowMilliseconds();
+	long long nextCheck;
+	if (!CheckLimits(startTime, nextCheck, status)) {
+		return status;
+	}
+
+	for (;;) {
+		if (m_stepCount >= nextCheck && !CheckLimits(startTime, nextCheck, status)) {
+			return status;
+		}
+		const DecodedInstruction &decoded = m_decoded[activeLocation];
+		m_stepCount++;
+		if (activeLocation == MEMSZ) {
+			ReportDecodeError(decoded.handler);
+			return RS_RuntimeError;
+		}
+		a_profiler.CountExecution(activeLocation);
+		switch (decoded.handler) {
+		case DH_Add: case DH_Sub: case DH_Multiply: case DH_Divide: case DH_Load: case DH_Write:
+			a_profiler.CountRead(decoded.address);
+			break;
+		case DH_Store: case DH_Read:
+			a_profiler.CountWrite(decoded.address);
+			break;
+		case DH_BranchMinus:
+			a_profiler.CountBranch(activeLocation, accumulator < 0);
+			break;
+		case DH_BranchZero:
+			a_profiler.CountBranch(activeLocation, accumulator == 0);
+			break;
+		case DH_BranchPositive:
+			a_profiler.CountBranch(activeLocation, accumulator > 0);
+			break;
+		}
+
+		if (decoded.handler == DH_Halt) {
+			return RS_Halted;
+		}
+		if (decoded.handler == DH_InvalidOpCode || decoded.handler > DH_Halt) {
+			ReportDecodeError(decoded.handler);
+			return RS_RuntimeError;
+		}
+		if (!ExecuteOpCode(decoded.handler, decoded.address, status)) {
+			return status;
+		}
+	}
+}
+
+
+
+/*
+NAME
+
+runProgramTraced - Runs the emulator while recording a trace.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::runProgramTraced(int startLocation, TraceWriter &a_trace)
+
+startLocation - the address where the first instruction is located.
+
+a_trace - an open trace, where each instruction is recorded.
+
+DESCRIPTION
+
+Runs the program the same way runProgram does, with the same results and
+output, but through a separate loop that records each instruction, so
+the recording costs nothing when the program is not being traced.  How
+the run ended is recorded last.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::runProgramTraced(int startLocation, TraceWriter &a_trace) {
+	RunStatus status = InterpretTraced(startLocation, a_trace);
+	FlushOutput();
+	a_trace.RecordEnd(GetResult(status));
+	return status;
+}
+
+
+
+/*
+NAME
+
+InterpretTraced - Runs the instructions one at a time and records them.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::InterpretTraced(int startLocation, TraceWriter &a_trace)
+
+startLocation - the address where the first instruction is located.
+
+a_trace - where the instructions are recorded.
+
+DESCRIPTION
+
+Fuses common instruction sequences and runs the predecoded instructions
+as Dispatch does, with a computed goto from one handler to the next
+under GCC and Clang; otherwise fusion is undone and a switch is used,
+passing only divide, READ and WRITE to ExecuteOpCode.  After each
+instruction, including each of a fused group, its location and the
+accumulator are recorded, and for a READ the value read, so that the
+run can be replayed without its input.  An instruction that stops the
+run with an error is not recorded.  The state of the machine is
+recorded before the first instruction and every
+TraceWriter::CHECKPOINT_INTERVAL instructions after it, or up to two
+later when a fused group runs past that.  The limits are checked as
+they are by Dispatch.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::InterpretTraced(int startLocation, TraceWriter &a_trace) {
+	if (startLocation == -1) {
+		m_error = RE_NoStartLocation;
+		DisplayLine("No start location specified");
+		return RS_RuntimeError;
+	}
+
+#if defined(__GNUC__)
+	FuseInstructions();
+#else
+	UnfuseInstructions();
+#endif
+	activeLocation = startLocation >= 0 && startLocation < MEMSZ ? startLocation : MEMSZ;
+	m_stepCount = 0;
+	m_outputCount = 0;
+
+	RunStatus status;
+	long long startTime = NowMilliseconds();
+	long long nextCheck;
+	if (!CheckLimits(startTime, nextCheck, status)) {
+		return status;
+	}
+
+	// As in Dispatch, the machine state is kept in locals and written back
+	// before anything that uses the members.
+	int acc = accumulator;
+	int loc = activeLocation;
+	long long steps = m_stepCount;
+	long long nextCheckpoint = 0;
+	long long nextEvent = 0;	// The sooner of nextCheck and nextCheckpoint.
+
+#define SYNC() accumulator = acc; activeLocation = loc; m_stepCount = steps
+#define RELOAD() acc = accumulator; loc = activeLocation
+
+#if defined(__GNUC__)
+	// Direct threaded dispatch, as in Dispatch.  The table is indexed by DecodedHandler.
+	static void *const handlers[] = {
+		&&invalid, &&add, &&sub, &&multiply, &&divide, &&load, &&store, &&read,
+		&&write, &&branch, &&branchMinus, &&branchZero, &&branchPositive,
+		&&halt, &&invalid, &&invalid,
+		&&loadAddStore, &&loadSubStore, &&loadSubBranchMinus, &&loadSubBranchZero,
+		&&loadSubBranchPositive
+	};
+	const DecodedInstruction *decoded;
+
+#define DISPATCH() if (steps >= nextEvent) goto event; \
+	steps++; decoded = &m_decoded[loc]; goto *handlers[decoded->handler]
+#define RECORD(location) a_trace.RecordStep((location), acc)
+#define DO_ADD(a) acc += m_memory[a]; loc++
+#define DO_SUB(a) acc -= m_memory[a]; loc++
+#define DO_LOAD(a) { int value = m_memory[a]; \
+	if (value < -999999 || value > 999999) { SYNC(); ExecuteLoad(a); return RS_RuntimeError; } \
+	acc = value; loc++; }
+#define DO_STORE(a) { if (acc < -999999 || acc > 999999) { SYNC(); ExecuteStore(a); return RS_RuntimeError; } \
+	m_memory[a] = acc; m_shown[a] = SHOWN_NUMBER; UpdateLocation(a); loc++; }
+#define DO_BRANCH_IF(condition, a) if (condition) loc = a; else loc++
+#define HERE ((int)(decoded - m_decoded))
+
+	DISPATCH();
+event:
+	SYNC();
+	if (steps >= nextCheck && !CheckLimits(startTime, nextCheck, status)) {
+		return status;
+	}
+	if (steps >= nextCheckpoint) {
+		a_trace.RecordCheckpoint(steps, loc, acc, *this);
+		nextCheckpoint += TraceWriter::CHECKPOINT_INTERVAL;
+	}
+	nextEvent = (nextCheck < nextCheckpoint) ? nextCheck : nextCheckpoint;
+	steps++; decoded = &m_decoded[loc]; goto *handlers[decoded->handler];
+
+add:			DO_ADD(decoded->address);			RECORD(HERE);	DISPATCH();
+sub:			DO_SUB(decoded->address);			RECORD(HERE);	DISPATCH();
+multiply:		acc *= m_memory[decoded->address]; loc++;	RECORD(HERE);	DISPATCH();
+divide:
+	if (m_memory[decoded->address] == 0) {
+		SYNC(); ExecuteDivide(decoded->address); return RS_RuntimeError;
+	}
+	acc /= m_memory[decoded->address]; loc++;
+	RECORD(HERE);
+	DISPATCH();
+load:			DO_LOAD(decoded->address);			RECORD(HERE);	DISPATCH();
+store:			DO_STORE(decoded->address);			RECORD(HERE);	DISPATCH();
+read:
+	SYNC(); ExecuteRead(decoded->address); RELOAD();
+	RECORD(HERE);
+	RecordTracedRead(decoded->address, loc != HERE, a_trace);
+	DISPATCH();
+write:
+	SYNC();
+	if (!ExecuteWrite(decoded->address)) {
+		return RS_OutputLimit;
+	}
+	RELOAD();
+	RECORD(HERE);
+	DISPATCH();
+branch:			loc = decoded->address;				RECORD(HERE);	DISPATCH();
+branchMinus:	DO_BRANCH_IF(acc < 0, decoded->address);	RECORD(HERE);	DISPATCH();
+branchZero:		DO_BRANCH_IF(acc == 0, decoded->address);	RECORD(HERE);	DISPATCH();
+branchPositive:	DO_BRANCH_IF(acc > 0, decoded->address);	RECORD(HERE);	DISPATCH();
+
+	// Fused groups.  Each instruction of the group is counted and recorded
+	// as it runs, so the trace is the same as it is without fusion.
+loadAddStore:
+	DO_LOAD(decoded[0].address); RECORD(HERE);
+	steps++; DO_ADD(decoded[1].address); RECORD(HERE + 1);
+	steps++; DO_STORE(decoded[2].address); RECORD(HERE + 2);
+	DISPATCH();
+loadSubStore:
+	DO_LOAD(decoded[0].address); RECORD(HERE);
+	steps++; DO_SUB(decoded[1].address); RECORD(HERE + 1);
+	steps++; DO_STORE(decoded[2].address); RECORD(HERE + 2);
+	DISPATCH();
+loadSubBranchMinus:
+	DO_LOAD(decoded[0].address); RECORD(HERE);
+	steps++; DO_SUB(decoded[1].address); RECORD(HERE + 1);
+	steps++; DO_BRANCH_IF(acc < 0, decoded[2].address); RECORD(HERE + 2);
+	DISPATCH();
+loadSubBranchZero:
+	DO_LOAD(decoded[0].address); RECORD(HERE);
+	steps++; DO_SUB(decoded[1].address); RECORD(HERE + 1);
+	steps++; DO_BRANCH_IF(acc == 0, decoded[2].address); RECORD(HERE + 2);
+	DISPATCH();
+loadSubBranchPositive:
+	DO_LOAD(decoded[0].address); RECORD(HERE);
+	steps++; DO_SUB(decoded[1].address); RECORD(HERE + 1);
+	steps++; DO_BRANCH_IF(acc > 0, decoded[2].address); RECORD(HERE + 2);
+	DISPATCH();
+
+invalid:		SYNC(); ReportDecodeError(decoded->handler); return RS_RuntimeError;
+halt:			SYNC(); RECORD(HERE); return RS_Halted;
+
+#undef HERE
+#undef DO_BRANCH_IF
+#undef DO_STORE
+#undef DO_LOAD
+#undef DO_SUB
+#undef DO_ADD
+#undef RECORD
+#undef DISPATCH
+#else
+	for (;;) {
+		if (steps >= nextEvent) {
+			SYNC();
+			if (steps >= nextCheck && !CheckLimits(startTime, nextCheck, status)) {
+				return status;
+			}
+			if (steps >= nextCheckpoint) {
+				a_trace.RecordCheckpoint(steps, loc, acc, *this);
+				nextCheckpoint += TraceWriter::CHECKPOINT_INTERVAL;
+			}
+			nextEvent = (nextCheck < nextCheckpoint) ? nextCheck : nextCheckpoint;
+		}
+
+		// A copy, since a store can redecode the instruction's own location.
+		DecodedInstruction decoded = m_decoded[loc];
+		int location = loc;
+		steps++;
+		switch (decoded.handler) {
+		case DH_Add:
+			acc += m_memory[decoded.address];
+			loc++;
+			break;
+		case DH_Sub:
+			acc -= m_memory[decoded.address];
+			loc++;
+			break;
+		case DH_Multiply:
+			acc *= m_memory[decoded.address];
+			loc++;
+			break;
+		case DH_Load:
+			if (m_memory[decoded.address] < -999999 || m_memory[decoded.address] > 999999) {
+				SYNC(); ExecuteLoad(decoded.address); return RS_RuntimeError;
+			}
+			acc = m_memory[decoded.address];
+			loc++;
+			break;
+		case DH_Store:
+			if (acc < -999999 || acc > 999999) {
+				SYNC(); ExecuteStore(decoded.address); return RS_RuntimeError;
+			}
+			m_memory[decoded.address] = acc;
+			m_shown[decoded.address] = SHOWN_NUMBER;
+			UpdateLocation(decoded.address);
+			loc++;
+			break;
+		case DH_Branch:
+			loc = decoded.address;
+			break;
+		case DH_BranchMinus:
+			loc = (acc < 0) ? decoded.address : loc + 1;
+			break;
+		case DH_BranchZero:
+			loc = (acc == 0) ? decoded.address : loc + 1;
+			break;
+		case DH_BranchPositive:
+			loc = (acc > 0) ? decoded.address : loc + 1;
+			break;
+		case DH_Halt:
+			SYNC();
+			a_trace.RecordStep(location, acc);
+			return RS_Halted;
+		case DH_Divide: case DH_Read: case DH_Write:
+			SYNC();
+			if (!ExecuteOpCode(decoded.handler, decoded.address, status)) {
+				return status;
+			}
+			RELOAD();
+			break;
+		default:
+			SYNC();
+			ReportDecodeError(decoded.handler);
+			return RS_RuntimeError;
+		}
+
+		a_trace.RecordStep(location, acc);
+		if (decoded.handler == DH_Read) {
+			RecordTracedRead(decoded.address, loc != location, a_trace);
+		}
+	}
+#endif
+
+#undef RELOAD
+#undef SYNC
+}
+
+
+
+/*
+NAME
+
+RecordTracedRead - Records the value a READ took in a trace.
+
+SYNOPSIS
+
+void emulator::RecordTracedRead(int a_address, bool a_valid, TraceWriter &a_trace)
+
+a_address - the address read into.
+
+a_valid - whether the input was valid, so that the READ was done.
+
+a_trace - where the value is recorded.
+
+DESCRIPTION
+
+Input such as "007" is shown as it was typed, so its text is recorded
+along with its value.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void emulator::RecordTracedRead(int a_address, bool a_valid, TraceWriter &a_trace) {
+	char text[WORD_TEXT_SIZE];
+	int length = 0;
+	bool typed = a_valid && m_shown[a_address] != SHOWN_NUMBER;
+	if (typed) {
+		length = FormatLocation(a_address, text);
+	}
+	a_trace.RecordRead(a_valid, m_memory[a_address], typed ? text : NULL, length);
+}
+
+
+
+/*
+NAME
+
+runProgramUndoable - Runs the emulator while recording how to take it back.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::runProgramUndoable(int startLocation, UndoLog &a_log)
+
+startLocation - the address where the first instruction is located.
+
+a_log - where what each instruction changes is recorded.
+
+DESCRIPTION
+
+Runs the program the same way runProgram does, with the same results and
+output, but through a separate loop that records each instruction in the
+log, so the recording costs nothing when it is not wanted.  The log is
+cleared first.  Once the run has stopped, StepBack and ReverseContinue
+take it back.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::runProgramUndoable(int startLocation, UndoLog &a_log) {
+	a_log.Clear();
+	RunStatus status = InterpretUndoable(startLocation, a_log);
+	FlushOutput();
+	return status;
+}
+
+
+
+/*
+NAME
+
+InterpretUndoable - Runs the instructions one at a time and records what they change.
+
+SYNOPSIS
+
+emulator::RunStatus emulator::InterpretUndoable(int startLocation, UndoLog &a_log)
+
+startLocation - the address where the first instruction is located.
+
+a_log - where the instructions are recorded.
+
+DESCRIPTION
+
+Undoes fusion, so that each instruction is taken back at its own
+location, and runs the predecoded instructions with a switch, passing
+only divide, READ and WRITE to ExecuteOpCode.  After each instruction
+its location and the accumulator before it are recorded, and for a STORE
+or a READ that was given a valid value, the word it wrote over.  Steps
+are counted as every engine counts them, each instruction that is
+started, so an instruction that stops the run with an error is counted
+too; it changed nothing, and is recorded as changing nothing so that
+taking it back leaves it as the next to run.  The limits are checked as
+they are by Interpret.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus emulator::InterpretUndoable(int startLocation, UndoLog &a_log) {
+	if (startLocation == -1) {
+		m_error = RE_NoStartLocation;
+		DisplayLine("No start location specified");
+		return RS_RuntimeError;
 	}
-	else {
-		return false;
+
+	UnfuseInstructions();
+	activeLocation = startLocation >= 0 && startLocation < MEMSZ ? startLocation : MEMSZ;
+	m_stepCount = 0;
+	m_outputCount = 0;
+
+	RunStatus status;
+	long long startTime = NowMilliseconds();
+	long long nextCheck;
+	if (!CheckLimits(startTime, nextCheck, status)) {
+		return status;
+	}
+
+	// As in Dispatch, the machine state is kept in locals and written back
+	// before anything that uses the members.
+	int acc = accumulator;
+	int loc = activeLocation;
+	long long steps = m_stepCount;
+
+#define SYNC() accumulator = acc; activeLocation = loc; m_stepCount = steps
+	// The instruction that ends the run is recorded as changing nothing.
+#define STOPPED() a_log.Record(location, before, -1, 0, 0)
+
+	for (;;) {
+		if (steps >= nextCheck) {
+			SYNC();
+			if (!CheckLimits(startTime, nextCheck, status)) {
+				return status;
+			}
+		}
+
+		// A copy, since a store can redecode the instruction's own location.
+		DecodedInstruction decoded = m_decoded[loc];
+		int location = loc;
+		int before = acc;
+		int written = -1;
+		int word = 0;
+		int shown = SHOWN_NUMBER;
+		steps++;
+		switch (decoded.handler) {
+		case DH_Add:
+			acc += m_memory[decoded.address];
+			loc++;
+			break;
+		case DH_Sub:
+			acc -= m_memory[decoded.address];
+			loc++;
+			break;
+		case DH_Multiply:
+			acc *= m_memory[decoded.address];
+			loc++;
+			break;
+		case DH_Load:
+			if (m_memory[decoded.address] < -999999 || m_memory[decoded.address] > 999999) {
+				SYNC(); STOPPED(); ExecuteLoad(decoded.address); return RS_RuntimeError;
+			}
+			acc = m_memory[decoded.address];
+			loc++;
+			break;
+		case DH_Store:
+			if (acc < -999999 || acc > 999999) {
+				SYNC(); STOPPED(); ExecuteStore(decoded.address); return RS_RuntimeError;
+			}
+			written = decoded.address;
+			word = m_memory[written];
+			shown = m_shown[written];
+			m_memory[written] = acc;
+			m_shown[written] = SHOWN_NUMBER;
+			UpdateLocation(written);
+			loc++;
+			break;
+		case DH_Branch:
+			loc = decoded.address;
+			break;
+		case DH_BranchMinus:
+			loc = (acc < 0) ? decoded.address : loc + 1;
+			break;
+		case DH_BranchZero:
+			loc = (acc == 0) ? decoded.address : loc + 1;
+			break;
+		case DH_BranchPositive:
+			loc = (acc > 0) ? decoded.address : loc + 1;
+			break;
+		case DH_Halt:
+			SYNC();
+			STOPPED();
+			return RS_Halted;
+		case DH_Divide: case DH_Read: case DH_Write:
+			SYNC();
+			word = m_memory[decoded.address];
+			shown = m_shown[decoded.address];
+			if (!ExecuteOpCode(decoded.handler, decoded.address, status)) {
+				STOPPED();
+				return status;
+			}
+			acc = accumulator;
+			loc = activeLocation;
+			// A READ only writes when its input was valid and it moved on.
+			if (decoded.handler == DH_Read && loc != location) {
+				written = decoded.address;
+			}
+			break;
+		default:
+			SYNC();
+			STOPPED();
+			ReportDecodeError(decoded.handler);
+			return RS_RuntimeError;
+		}
+
+		a_log.Record(location, before, written, word, shown);
 	}
+
+#undef SYNC
+#undef STOPPED
 }
 
 
+
 /*
 NAME
 
-runProgram - Runs the emulator from inserted instructions.
+StepBack - Takes back the last instruction of a run.
 
 SYNOPSIS
 
-void emulator::runProgram(int startLocation)
+bool emulator::StepBack(UndoLog &a_log);
 
-startLocation - the address where the first instruction is located.
+a_log - the log the run was recorded in by runProgramUndoable.
 
 DESCRIPTION
 
-Reads through all the machine code instructions that were inserted into the
-emulator. At any point if an error occurs, it is displayed to the screen
-and the program will exit.  Otherwise each instruction will be
-executed until a halt command is encountered.
+Puts back the accumulator and the word the instruction wrote over, as it
+was shown, makes its location the active location again and sets the
+step count to the steps still recorded, without copying the rest of the
+machine.  Output already displayed and input already read stay as they
+are.
 
 RETURNS
 
-Nothing.
+True if an instruction was taken back, false if the log holds none.
 
 AUTHOR
 
 Charles Snyder
 */
-void emulator::runProgram(int startLocation) {
-	int opcode, address;
-	string strOpcode, strAddress;
-	if (startLocation == -1) {
-		cout << "No start location specified" << endl;
-		exit(1);
+bool emulator::StepBack(UndoLog &a_log) {
+	UndoLog::Entry entry;
+	if (!a_log.Undo(entry)) {
+		return false;
+	}
+	if (entry.address != -1) {
+		m_memory[entry.address] = entry.word;
+		m_shown[entry.address] = entry.shown;
+		UpdateLocation(entry.address);
 	}
+	accumulator = entry.accumulator;
+	activeLocation = entry.location;
+	m_stepCount = a_log.GetSteps();
+	m_error = RE_None;
+	return true;
+}
 
-	activeLocation = startLocation;
-	for (;;) {
-		strOpcode = m_memory[activeLocation].substr(0, 2);
-		strAddress = m_memory[activeLocation].substr(2, m_memory[activeLocation].length());
-		if (strAddress == "????" || strOpcode == "??") {
-			cout << "Invalid Opcode or address" << endl;
-			exit(1);
-		}
-		opcode = atoi(strOpcode.c_str());
-		address = atoi(strAddress.c_str());
-		if (opcode < 1 || opcode > 13) {
-			cout << "Invalid Opcode" << endl;
-			exit(1);
-		}
-		if (address < 0 || address > 9999) {
-			cout << "Unable to access memory location" << endl;
-			exit(1);
-		}
-		if (opcode == 13) {
-			return;
+
+
+/*
+NAME
+
+ReverseContinue - Takes back instructions until a location is reached.
+
+SYNOPSIS
+
+bool emulator::ReverseContinue(UndoLog &a_log, int a_location, long long &a_steps);
+
+a_log - the log the run was recorded in by runProgramUndoable.
+
+a_location - the location to stop at.
+
+a_steps - passed by reference, set to the instructions taken back.
+
+DESCRIPTION
+
+Takes back at least one instruction, stopping once the instruction at
+a_location is the next to run, or when the log runs out.
+
+RETURNS
+
+True if the location was reached, false if the log ran out first.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::ReverseContinue(UndoLog &a_log, int a_location, long long &a_steps) {
+	a_steps = 0;
+	while (StepBack(a_log)) {
+		a_steps++;
+		if (activeLocation == a_location) {
+			return true;
 		}
-		ExecuteOpCode(opcode, address);
 	}
+	return false;
 }
 
 
@@ -112,10 +2480,12 @@ ExecuteOpCode - Runs the emulator from inserted instructions.
 
 SYNOPSIS
 
-void emulator::ExecuteOpCode(int opcode, int address)
+bool emulator::ExecuteOpCode(int opcode, int address, RunStatus &a_status)
 
 opcode - the numeric opcode value,
 address - the address on which to execute the specified opcode command.
+a_status - passed by reference, set to why the run must stop.  It is
+		   only meaningful when false is returned.
 
 DESCRIPTION
 
@@ -123,53 +2493,116 @@ Performs particular action based on opcode value.
 
 RETURNS
 
-Nothing.
+True if the run may continue, false if the instruction stopped it.
 
 AUTHOR
 
 Charles Snyder
 */
-void emulator::ExecuteOpCode(int opcode, int address) {
+bool emulator::ExecuteOpCode(int opcode, int address, RunStatus &a_status) {
+	bool ok = true;
 	switch (opcode) {
-	case 1:
+	case DH_Add:
 		ExecuteAdd(address);
 		break;
-	case 2:
+	case DH_Sub:
 		ExecuteSub(address);
 		break;
-	case 3:
+	case DH_Multiply:
 		ExecuteMultiply(address);
 		break;
-	case 4:
-		ExecuteDivide(address);
+	case DH_Divide:
+		ok = ExecuteDivide(address);
+		a_status = RS_RuntimeError;
 		break;
-	case 5:
-		ExecuteLoad(address);
+	case DH_Load:
+		ok = ExecuteLoad(address);
+		a_status = RS_RuntimeError;
 		break;
-	case 6:
-		ExecuteStore(address);
+	case DH_Store:
+		ok = ExecuteStore(address);
+		a_status = RS_RuntimeError;
 		break;
-	case 7:
+	case DH_Read:
 		ExecuteRead(address);
 		break;
-	case 8:
-		ExecuteWrite(address);
+	case DH_Write:
+		ok = ExecuteWrite(address);
+		a_status = RS_OutputLimit;
 		break;
-	case 9:
+	case DH_Branch:
 		ExecuteBranch(address);
 		break;
-	case 10:
+	case DH_BranchMinus:
 		ExecuteBranchMinus(address);
 		break;
-	case 11:
+	case DH_BranchZero:
 		ExecuteBranchZero(address);
 		break;
-	case 12:
+	case DH_BranchPositive:
 		ExecuteBranchPositive(address);
 		break;
 	}
+	return ok;
+}
+
+/*
+NAME
+
+ExecuteFusedGroup - Runs a fused group of three instructions.
+
+SYNOPSIS
+
+bool emulator::ExecuteFusedGroup(int handler)
+
+handler - the fused DecodedHandler at the active location.
+
+DESCRIPTION
+
+Runs the three instructions of the group one after another, exactly as
+if each had been dispatched on its own, counting each one as it runs.
+
+RETURNS
+
+False if one of the instructions failed, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::ExecuteFusedGroup(int handler) {
+	const DecodedInstruction *group = &m_decoded[activeLocation];
+
+	if (!ExecuteLoad(group[0].address)) {
+		return false;
+	}
+	m_stepCount++;
+	if (handler == DH_LoadAddStore) {
+		ExecuteAdd(group[1].address);
+	}
+	else {
+		ExecuteSub(group[1].address);
+	}
+	m_stepCount++;
+	switch (handler) {
+	case DH_LoadAddStore:
+	case DH_LoadSubStore:
+		return ExecuteStore(group[2].address);
+	case DH_LoadSubBranchMinus:
+		ExecuteBranchMinus(group[2].address);
+		break;
+	case DH_LoadSubBranchZero:
+		ExecuteBranchZero(group[2].address);
+		break;
+	case DH_LoadSubBranchPositive:
+		ExecuteBranchPositive(group[2].address);
+		break;
+	}
+	return true;
 }
 
+
+
 /*
 NAME
 
@@ -195,7 +2628,7 @@ AUTHOR
 Charles Snyder
 */
 void emulator::ExecuteAdd(int address) {
-	accumulator = accumulator + atoi(m_memory[address].c_str());
+	accumulator = accumulator + m_memory[address];
 	activeLocation++;
 }
 
@@ -227,7 +2660,7 @@ AUTHOR
 Charles Snyder
 */
 void emulator::ExecuteSub(int address) {
-	accumulator = accumulator - atoi(m_memory[address].c_str());
+	accumulator = accumulator - m_memory[address];
 	activeLocation++;
 }
 
@@ -258,7 +2691,7 @@ AUTHOR
 Charles Snyder
 */
 void emulator::ExecuteMultiply(int address) {
-	accumulator = accumulator * atoi(m_memory[address].c_str());
+	accumulator = accumulator * m_memory[address];
 	activeLocation++;
 }
 
@@ -271,7 +2704,7 @@ ExecuteDivide - Divide contents of accumulator with contents of address.
 
 SYNOPSIS
 
-void emulator::ExecuteDivide(int address)
+bool emulator::ExecuteDivide(int address)
 
 address - the address on which to execute the specified opcode command.
 
@@ -283,21 +2716,24 @@ active location by one.
 
 RETURNS
 
-Nothing.
+False on a divide by zero, true otherwise.
 
 AUTHOR
 
 Charles Snyder
 */
-void emulator::ExecuteDivide(int address) {
-	if (atoi(m_memory[address].c_str()) != 0) {
-		accumulator = accumulator / atoi(m_memory[address].c_str());
+bool emulator::ExecuteDivide(int address) {
+	int divisor = m_memory[address];
+	if (divisor != 0) {
+		accumulator = accumulator / divisor;
 	}
 	else {
-		cout << "Error, Divide by zero" << endl;
-		exit(1);
+		m_error = RE_DivideByZero;
+		DisplayLine("Error, Divide by zero");
+		return false;
 	}
 	activeLocation++;
+	return true;
 }
 
 
@@ -309,7 +2745,7 @@ ExecuteLoad - Load contents of address into the accumulator.
 
 SYNOPSIS
 
-void emulator::ExecuteLoad(int address)
+bool emulator::ExecuteLoad(int address)
 
 address - the address on which to execute the specified opcode command.
 
@@ -321,19 +2757,22 @@ the active location increases by one.
 
 RETURNS
 
-Nothing.
+False if the value was too large, true otherwise.
 
 AUTHOR
 
 Charles Snyder
 */
-void emulator::ExecuteLoad(int address) {
-	if (atoi(m_memory[address].c_str()) < -999999 || atoi(m_memory[address].c_str()) > 999999) {
-		cout << "Value too large to load into accumulator" << endl;
-		exit(1);
+bool emulator::ExecuteLoad(int address) {
+	int value = m_memory[address];
+	if (value < -999999 || value > 999999) {
+		m_error = RE_LoadOverflow;
+		DisplayLine("Value too large to load into accumulator");
+		return false;
 	}
-	accumulator = atoi(m_memory[address].c_str());
+	accumulator = value;
 	activeLocation++;
+	return true;
 }
 
 
@@ -345,7 +2784,7 @@ ExecuteStore - Store into address the contents of the accumulator.
 
 SYNOPSIS
 
-void emulator::ExecuteStore(int address)
+bool emulator::ExecuteStore(int address)
 
 address - the address on which to execute the specified opcode command.
 
@@ -353,25 +2792,31 @@ DESCRIPTION
 
 Store into address the contents of the accumulator.  If the value from the accumulator
 is larger than six digits, it will not store in memory and an error occurs.  Otherwise
-it is stored and the active location increases by one.
+it is stored, the address is predecoded again in case it holds an instruction,
+and the active location increases by one.
 
 RETURNS
 
-Nothing.
+False if the value was too large, true otherwise.
 
 AUTHOR
 
 Charles Snyder
 */
-void emulator::ExecuteStore(int address) {
-	stringstream intToString;
+bool emulator::ExecuteStore(int address) {
 	if (accumulator < -999999 || accumulator > 999999) {
-		cout << "Value too large to store in memory" << endl;
-		exit(1);
+		m_error = RE_StoreOverflow;
+		DisplayLine("Value too large to store in memory");
+		return false;
 	}
-	intToString << accumulator;
-	m_memory[address] = intToString.str();
+	if (m_detectLoops) {
+		m_memoryHash ^= HashWord(address, m_memory[address]) ^ HashWord(address, accumulator);
+	}
+	m_memory[address] = accumulator;
+	m_shown[address] = SHOWN_NUMBER;
+	UpdateLocation(address);
 	activeLocation++;
+	return true;
 }
 
 
@@ -391,8 +2836,11 @@ DESCRIPTION
 
 A line is read and its first 6 digits are placed in the specified address. If the input
 is not a digit the function returns without increase the active location so the operation
-will be performed again. Once valid input is entered it is stored in memory and the
-active location is increased by one.
+will be performed again. Once valid input is entered it is stored in memory, shown as
+the characters that were read, the address is predecoded again, and the active location
+is increased by one.  The "? " prompt is
+only shown when the emulator is interactive.  Since what follows a READ depends on
+the input, any loop has to be found again after it.
 
 RETURNS
 
@@ -403,23 +2851,138 @@ AUTHOR
 Charles Snyder
 */
 void emulator::ExecuteRead(int address) {
-	cout << "? ";
+	if (m_prompt && m_output != NULL) {
+		FlushOutput();
+		*m_output << "? ";
+	}
+	if (m_detectLoops) {
+		ResetLoopSearch();
+	}
 	string input;
-	cin >> input;
-	for (int i = 0; i < (int)input.length(); i++) {
-		if (isdigit(input[i]) == 0 && input[i] != '-') {
-			cout << "Invalid input" << endl;
-			return;
+	const char *begin;
+	const char *end;
+	if (m_inputNext != NULL) {
+		// Take the next white space separated value from the buffer.
+		while (m_inputNext < m_inputEnd && isspace((unsigned char)*m_inputNext)) {
+			m_inputNext++;
+		}
+		begin = m_inputNext;
+		while (m_inputNext < m_inputEnd && !isspace((unsigned char)*m_inputNext)) {
+			m_inputNext++;
+		}
+		end = m_inputNext;
+	}
+	else {
+		if (m_input != NULL) {
+			*m_input >> input;
 		}
+		begin = input.c_str();
+		end = begin + input.length();
+	}
+	int value;
+	if (!ParseInput(begin, end, value)) {
+		DisplayLine("Invalid input");
+		return;
+	}
+	if (end - begin > INPUT_SIZE) {
+		end = begin + INPUT_SIZE;
 	}
-	input = input.substr(0, 6);
 
-	m_memory[address] = input;
+	if (m_detectLoops) {
+		m_memoryHash ^= HashWord(address, m_memory[address]) ^ HashWord(address, value);
+	}
+	SetText(address, value, begin, end);
+	UpdateLocation(address);
 	activeLocation++;
 }
 
 
 
+/*
+NAME
+
+ParseInput - Converts a line of input for READ.
+
+SYNOPSIS
+
+bool emulator::ParseInput(const string &a_input, int &a_value);
+
+a_input - the input that was read.
+
+a_value - passed by reference, set to the value of its first 6 characters.
+
+DESCRIPTION
+
+The input must be made of digits and minus signs only.
+
+RETURNS
+
+True if the input was valid, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::ParseInput(const string &a_input, int &a_value) {
+	const char *text = a_input.c_str();
+	return ParseInput(text, text + a_input.length(), a_value);
+}
+
+
+
+/*
+NAME
+
+ParseInput - Converts a value of input for READ.
+
+SYNOPSIS
+
+bool emulator::ParseInput(const char *a_begin, const char *a_end, int &a_value);
+
+a_begin - the first character of the value.
+
+a_end - just past the last character of the value.
+
+a_value - passed by reference, set to the value of its first 6 characters.
+
+DESCRIPTION
+
+The input must be made of digits and minus signs only.  The first 6
+characters are converted the way atoi would: an optional minus sign and
+then digits up to the first character that is not one.  No string is
+made, so this is quick enough for large input files.
+
+RETURNS
+
+True if the input was valid, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool emulator::ParseInput(const char *a_begin, const char *a_end, int &a_value) {
+	for (const char *p = a_begin; p < a_end; p++) {
+		if ((*p < '0' || *p > '9') && *p != '-') {
+			return false;
+		}
+	}
+
+	const char *last = a_end - a_begin > INPUT_SIZE ? a_begin + INPUT_SIZE : a_end;
+	const char *p = a_begin;
+	bool negative = p < last && *p == '-';
+	if (negative) {
+		p++;
+	}
+	int value = 0;
+	while (p < last && *p >= '0' && *p <= '9') {
+		value = value * 10 + (*p++ - '0');
+	}
+	a_value = negative ? -value : value;
+	return true;
+}
+
+
+
 /*
 NAME
 
@@ -427,26 +2990,190 @@ ExecuteWrite - Contents of address are displayed to the console.
 
 SYNOPSIS
 
-void emulator::ExecuteWrite(int address)
+bool emulator::ExecuteWrite(int address)
 
 address - the address on which to execute the specified opcode command.
 
 DESCRIPTION
 
 Contents of address are displayed to the console and active location is
-increased by one.
+increased by one.  A word is shown as it was loaded or read until it is
+stored into, so "dc 1" shows 000001, a word with an assembly error shows
+its question marks and a location nothing was loaded into shows an empty
+line.  The bytes written are counted against the output limit.
 
 RETURNS
 
-Nothing.
+False if the output limit has been exceeded, true otherwise.
 
 AUTHOR
 
 Charles Snyder
 */
-void emulator::ExecuteWrite(int address) {
-	cout << m_memory[address] << endl;
+bool emulator::ExecuteWrite(int address) {
+	char text[WORD_TEXT_SIZE];
+	int length = FormatLocation(address, text);
+	DisplayLine(text, length);
 	activeLocation++;
+
+	m_outputCount += length + 1;
+	return m_outputLimit == NO_LIMIT || m_outputCount <= m_outputLimit;
+}
+
+
+
+/*
+NAME
+
+FormatWord - A word as a number.
+
+SYNOPSIS
+
+string emulator::FormatWord(int a_word);
+
+a_word - the word to display.
+
+DESCRIPTION
+
+Makes the decimal number of the word, as a STORE leaves it for WRITE.
+
+RETURNS
+
+The text, without a newline.
+
+AUTHOR
+
+Charles Snyder
+*/
+string emulator::FormatWord(int a_word) {
+	char text[WORD_TEXT_SIZE];
+	int length = FormatWord(a_word, text);
+	return string(text, length);
+}
+
+
+
+/*
+NAME
+
+FormatWord - Puts a word as a number in a buffer.
+
+SYNOPSIS
+
+int emulator::FormatWord(int a_word, char *a_text);
+
+a_word - the word to display.
+
+a_text - where the text goes; at least WORD_TEXT_SIZE characters.
+
+DESCRIPTION
+
+The same text as the other FormatWord, made without a string or a
+stream.  The text is not terminated.
+
+RETURNS
+
+The number of characters in the text.
+
+AUTHOR
+
+Charles Snyder
+*/
+int emulator::FormatWord(int a_word, char *a_text) {
+	// Build the digits backwards, then move them to the front.
+	char digits[WORD_TEXT_SIZE];
+	int count = 0;
+	unsigned int magnitude = a_word < 0 ? 0u - (unsigned int)a_word : (unsigned int)a_word;
+	do {
+		digits[count++] = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	int length = 0;
+	if (a_word < 0) {
+		a_text[length++] = '-';
+	}
+	while (count > 0) {
+		a_text[length++] = digits[--count];
+	}
+	return length;
+}
+
+
+
+/*
+NAME
+
+FormatLocation - The text WRITE displays for the word at a location.
+
+SYNOPSIS
+
+string emulator::FormatLocation(int a_location) const;
+
+a_location - the location of the word.
+
+DESCRIPTION
+
+Makes the text the word was loaded or read as, or its number once it
+has been stored into.
+
+RETURNS
+
+The text, without a newline.
+
+AUTHOR
+
+Charles Snyder
+*/
+string emulator::FormatLocation(int a_location) const {
+	char text[WORD_TEXT_SIZE];
+	int length = FormatLocation(a_location, text);
+	return string(text, length);
+}
+
+
+
+/*
+NAME
+
+FormatLocation - Puts the text WRITE displays for a location in a buffer.
+
+SYNOPSIS
+
+int emulator::FormatLocation(int a_location, char *a_text) const;
+
+a_location - the location of the word.
+
+a_text - where the text goes; at least WORD_TEXT_SIZE characters.
+
+DESCRIPTION
+
+The same text as the other FormatLocation, made without a string.  The
+text is not terminated.
+
+RETURNS
+
+The number of characters in the text.
+
+AUTHOR
+
+Charles Snyder
+*/
+int emulator::FormatLocation(int a_location, char *a_text) const {
+	int shown = m_shown[a_location];
+	if (shown >= SHOWN_TEXT) {
+		const string &text = m_texts[shown - SHOWN_TEXT];
+		memcpy(a_text, text.data(), text.length());
+		return (int)text.length();
+	}
+
+	int length = FormatWord(m_memory[a_location], a_text);
+	if (shown > length) {
+		memmove(a_text + shown - length, a_text, length);
+		memset(a_text, '0', shown - length);
+		length = shown;
+	}
+	return length;
 }
 
 
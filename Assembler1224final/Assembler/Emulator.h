@@ -4,23 +4,335 @@
 #ifndef _EMULATOR_H      // UNIX way of preventing multiple inclusions.
 #define _EMULATOR_H
 
+#include "OpCodeTable.h"
+
+class Profiler;
+class TraceWriter;
+class UndoLog;
+
 class emulator {
 
 public:
 
 	const static int MEMSZ = 10000;	// The size of the memory of the VC3600.
-	emulator() {}
+
+	// How a run of the program ended.
+	enum RunStatus {
+		RS_Halted,          // A HALT instruction was reached.
+		RS_RuntimeError,    // An error was displayed; activeLocation is where.
+		RS_StepLimit,       // The step limit was reached.
+		RS_TimeLimit,       // The time limit was reached.
+		RS_OutputLimit,     // The output limit was reached.
+		RS_AtRead,          // runToRead stopped before a READ.
+		RS_NonTerminating   // Loop detection found the machine in a state it was in before.
+	};
+
+	const static long long NO_LIMIT = -1;	// Value for SetLimits meaning unlimited.
+
+	// What went wrong when a run ends with RS_RuntimeError.
+	enum RuntimeError {
+		RE_None,
+		RE_NoStartLocation,     // The program has no END location to start at.
+		RE_InvalidWord,         // The word held "??" from an assembly error.
+		RE_InvalidOpCode,       // The opcode is not one of the 13 instructions.
+		RE_InvalidAddress,      // The address is outside of memory.
+		RE_DivideByZero,
+		RE_LoadOverflow,        // LOAD of a value too large for the accumulator.
+		RE_StoreOverflow        // STORE of an accumulator too large for memory.
+	};
+
+	// How a run ended, for programs that embed the emulator.
+	struct RunResult {
+		RunStatus status;
+		RuntimeError error;     // RE_None unless status is RS_RuntimeError.
+		int location;           // The location of the instruction the run stopped at.
+		long long steps;        // Instructions interpreted; the JIT does not count them.
+		int loopFirst;          // The locations the loop runs through when the
+		int loopLast;           // status is RS_NonTerminating, otherwise -1.
+	};
+
+	emulator() {
+		memset(m_memory, 0, sizeof(m_memory));
+		for (int i = 0; i < MEMSZ; i++) {
+			m_shown[i] = SHOWN_EMPTY;
+		}
+		m_texts.push_back("");
+		memset(m_decoded, 0, sizeof(m_decoded));
+		m_decoded[MEMSZ].handler = DH_InvalidAddress;
+		accumulator = 0;
+		activeLocation = 0;
+		m_stepCount = 0;
+		m_fusedCount = 0;
+		m_fusionEnabled = true;
+		m_input = NULL;
+		m_inputNext = NULL;
+		m_inputEnd = NULL;
+		m_output = NULL;
+		m_outputUsed = 0;
+		m_prompt = false;
+		m_error = RE_None;
+		m_outputCount = 0;
+		m_stopAtRead = false;
+		m_restoredFrom = NULL;
+		m_detectLoops = false;
+		m_memoryHash = 0;
+		m_loopHash = 0;
+		m_loopAccumulator = 0;
+		m_loopLocation = -1;
+		m_loopPower = 1;
+		m_loopLength = 0;
+		m_loopFirst = -1;
+		m_loopLast = -1;
+		SetLimits(NO_LIMIT, NO_LIMIT, NO_LIMIT);
+	}
 
 	// Records instructions and data into VC3600 memory.
 	bool insertMemory(int a_location, string a_contents);
 
+	// The same for a_count translations of six digits, given as the words
+	// ContentsToWord made of them, at consecutive locations from a_location.
+	bool insertWords(int a_location, const int *a_words, int a_count);
+
+	// The word the translation of an instruction is stored as; false if it
+	// is not six digits and has to be inserted as text with insertMemory.
+	static bool ContentsToWord(const string &a_contents, int &a_word);
+
+	// Makes this emulator a fresh copy of another loaded emulator.
+	void LoadFrom(const emulator &a_other);
+
+	// Loads memory from words a_stride apart and sets the accumulator.
+	void LoadWords(const int *a_words, int a_stride, int a_accumulator);
+
+	// The words of memory, for copying a loaded program.
+	const int *GetMemory() const { return m_memory; }
+
+	// Sets where READ and WRITE go and whether READ prompts.
+	void SetIO(istream &a_input, ostream &a_output, bool a_prompt);
+
+	// Takes READ values from memory, such as a mapped file, instead of the stream.
+	void SetInputBuffer(const char *a_begin, const char *a_end);
+
+	// Collects output in a buffer of a_size bytes, written out when full and
+	// when a run ends.  Zero writes each line as it is displayed.
+	void SetOutputBuffer(int a_size);
+
+	// Sets the step, time (in milliseconds) and output (in bytes) limits.
+	void SetLimits(long long a_steps, long long a_milliseconds, long long a_outputBytes);
+
+	// Makes interpreted runs stop with RS_NonTerminating when the machine
+	// comes back to a state it was in before.
+	void SetLoopDetection(bool a_enabled) { m_detectLoops = a_enabled; }
+
 	// Runs the VC3600 program recorded in memory.
-	void runProgram(int startLocation);
+	RunStatus runProgram(int startLocation);
+
+	// Runs the VC3600 program recorded in memory as native code.
+	RunStatus runProgramJit(int startLocation);
+
+	// Runs the VC3600 program, counting each instruction in a_profiler.
+	RunStatus runProgramProfiled(int startLocation, Profiler &a_profiler);
+
+	// Runs the VC3600 program, recording each instruction into a_trace.
+	RunStatus runProgramTraced(int startLocation, TraceWriter &a_trace);
+
+	// Runs the VC3600 program, recording what each instruction changes into
+	// a_log so that the run can be taken back a step at a time.
+	RunStatus runProgramUndoable(int startLocation, UndoLog &a_log);
+
+	// Takes back the last instruction recorded in a_log; false if there is none.
+	bool StepBack(UndoLog &a_log);
+
+	// Takes back instructions until the one at a_location is the next to run,
+	// setting a_steps to how many were taken back; false if the log ran out first.
+	bool ReverseContinue(UndoLog &a_log, int a_location, long long &a_steps);
+
+	// The state of a run stopped by runToRead, from which it can be resumed
+	// any number of times.
+	struct Snapshot;
+
+	// Runs the program up to its first READ and records the state there.
+	RunStatus runToRead(int startLocation, Snapshot &a_snapshot);
+
+	// Puts the machine back in the state recorded in a snapshot.
+	void RestoreSnapshot(const Snapshot &a_snapshot);
+
+	// Continues a restored run, with the interpreter or as native code.
+	RunStatus resumeProgram();
+	RunStatus resumeProgramJit();
+
+	// The location of the instruction being executed when the run stopped.
+	int GetActiveLocation() { return activeLocation; }
+
+	// The contents of the accumulator.
+	int GetAccumulator() { return accumulator; }
+
+	// Puts together the result of a run that ended with a_status.
+	RunResult GetResult(RunStatus a_status);
+
+	// The number of instructions executed by runProgram.
+	long long GetStepCount() { return m_stepCount; }
+
+	// The number of instructions combined into fused groups at load.
+	int GetFusedCount() { return m_fusedCount; }
+
+	// Converts a line of input for READ; false if it is not a number.
+	static bool ParseInput(const string &a_input, int &a_value);
+	static bool ParseInput(const char *a_begin, const char *a_end, int &a_value);
+
+	// The characters of a line of input READ keeps, the first INPUT_SIZE.
+	const static int INPUT_SIZE = 6;
+
+	// A word as a number.
+	static string FormatWord(int a_word);
+
+	// Puts a word as a number in a_text, returning its length.
+	static int FormatWord(int a_word, char *a_text);
+
+	// The text WRITE displays for the word at a location.
+	string FormatLocation(int a_location) const;
+
+	// Puts the text WRITE displays for the word at a location in a_text,
+	// returning its length.
+	int FormatLocation(int a_location, char *a_text) const;
+
+	// Whether READ of this text leaves a word that is shown as its number.
+	static bool IsPlainNumber(const char *a_begin, const char *a_end, int a_value);
+
+	// The most characters FormatWord and FormatLocation can produce.
+	const static int WORD_TEXT_SIZE = 16;
+
+	// Memory is restored from a snapshot in pages of this many words, and
+	// only the pages stored into since the last restore are copied.
+	const static int PAGE_WORDS = 256;
+	const static int PAGES = (MEMSZ + PAGE_WORDS - 1) / PAGE_WORDS;
 
 private:
 
-	// The memory of the VC3600.
-	string m_memory[MEMSZ];
+	// The JIT reads and writes the machine state directly.
+	friend class JitCompiler;
+
+	// The lanes decode with the same handler numbers.
+	friend class LaneEmulator;
+
+	// The memory of the VC3600.  Each word is kept as an integer so that no
+	// string conversions are needed while the program is running: the number
+	// atoi makes of its text, which is what the emulator has always used as
+	// an operand.  So a location nothing was loaded into holds 0, and so does
+	// "00????"; "05????" holds 5.
+	int m_memory[MEMSZ];
+
+	// How WRITE displays each word, as the text it was loaded or read as.
+	// SHOWN_NUMBER is the number in m_memory, which is how a STORE leaves
+	// it; 1 to SHOWN_WIDTH is the number with zeros in front, up to that many
+	// characters, as in most translations ("000001", "080104"); from
+	// SHOWN_TEXT on it is m_texts[m_shown - SHOWN_TEXT], for anything else
+	// ("00????", "09-999").  m_texts[0] is empty, for locations nothing was
+	// loaded into.
+	unsigned short m_shown[MEMSZ];
+	vector<string> m_texts;
+	const static int SHOWN_NUMBER = 0;
+	const static int SHOWN_WIDTH = WORD_TEXT_SIZE - 1;
+	const static int SHOWN_TEXT = WORD_TEXT_SIZE;
+	const static int SHOWN_EMPTY = SHOWN_TEXT;
+
+	// Handlers an instruction word can decode to.  The machine instructions
+	// keep their opcode numbers from the opcode table; the rest report a bad
+	// word when run.
+	enum DecodedHandler {
+		DH_InvalidOpCode = OC_Invalid,  // Opcode outside of 1-13.
+		DH_Add = OC_Add, DH_Sub = OC_Sub, DH_Multiply = OC_Mult, DH_Divide = OC_Div,
+		DH_Load = OC_Load, DH_Store = OC_Store, DH_Read = OC_Read, DH_Write = OC_Write,
+		DH_Branch = OC_Branch, DH_BranchMinus = OC_BranchMinus, DH_BranchZero = OC_BranchZero,
+		DH_BranchPositive = OC_BranchPositive,
+		DH_Halt = OC_Halt,      // Opcode 13.
+		DH_InvalidWord,         // The word's text has "??" or "????".
+		DH_InvalidAddress,      // The address is outside of memory.
+
+		// Fused groups of three instructions, placed on the first (the LOAD).
+		// The other two locations keep their own handlers so that branches
+		// into the middle of a group still work.
+		DH_LoadAddStore,        // LOAD x / ADD y / STORE z
+		DH_LoadSubStore,        // LOAD x / SUB y / STORE z
+		DH_LoadSubBranchMinus,  // LOAD x / SUB y / BM t
+		DH_LoadSubBranchZero,   // LOAD x / SUB y / BZ t
+		DH_LoadSubBranchPositive// LOAD x / SUB y / BP t
+	};
+
+	// A memory word split into its handler and address ahead of time.
+	struct DecodedInstruction {
+		unsigned short handler;	// One of the DecodedHandler values.
+		unsigned short address;	// The address portion of the word.
+	};
+
+	// The predecoded form of every memory word.  Kept in step with m_memory
+	// and m_shown by insertMemory, ExecuteStore and ExecuteRead.  The entry past the end
+	// of memory never changes and decodes as DH_InvalidAddress, so a run
+	// that falls off the last location stops with the address error.
+	DecodedInstruction m_decoded[MEMSZ + 1];
+
+	// The snapshot memory was last taken or restored from, NULL if memory
+	// has since changed other than by stores, and the pages stored into.
+	const Snapshot *m_restoredFrom;
+	bool m_dirty[PAGES];
+
+	// Makes runs stop at a READ, for runToRead.
+	bool m_stopAtRead;
+
+	// Instructions executed so far.
+	long long m_stepCount;
+
+	// Instructions placed into fused groups by FuseInstructions.
+	int m_fusedCount;
+
+	// False once fusion has been undone so that steps can be counted one at
+	// a time up to the step limit.
+	bool m_fusionEnabled;
+
+	// Where READ takes its input and WRITE and errors display their output.
+	// Both are NULL until SetIO is called: READ then reads nothing and
+	// nothing is displayed.
+	istream *m_input;
+	ostream *m_output;
+	bool m_prompt;              // Display "? " before a READ.
+
+	// The unread part of the input buffer; m_inputNext is NULL if READ uses m_input.
+	const char *m_inputNext;
+	const char *m_inputEnd;
+
+	// Output waiting to be written to m_output; empty if output is not buffered.
+	vector<char> m_outputBuffer;
+	int m_outputUsed;
+
+	// Limits on a run; NO_LIMIT if there is none.
+	long long m_stepLimit;
+	long long m_timeLimit;      // In milliseconds.
+	long long m_outputLimit;    // In bytes.
+
+	// Bytes displayed by WRITE so far.
+	long long m_outputCount;
+
+	// The last runtime error reported.
+	RuntimeError m_error;
+
+	// Loop detection (SetLoopDetection).  While it is on, m_memoryHash is the
+	// exclusive or of HashWord of every word of memory, kept up by each store.
+	bool m_detectLoops;
+	unsigned long long m_memoryHash;
+
+	// Brent's cycle search over the states at backward branches: the state
+	// saved at the last power of two branches, with m_loopLocation -1 if there
+	// is none, the branches since then and the range of locations they cover.
+	unsigned long long m_loopHash;
+	vector<int> m_loopMemory;
+	int m_loopAccumulator;
+	int m_loopLocation;
+	long long m_loopPower;
+	long long m_loopLength;
+	int m_loopFirst;
+	int m_loopLast;
+
+	// How many steps may run between checks of the limits.
+	const static long long CHECK_INTERVAL = 1 << 20;
 
 	// The current location to process.
 	int activeLocation;
@@ -28,8 +340,92 @@ private:
 	// Extra word to hold values for mathematical operations.
 	int accumulator;
 
+	// Decodes the word at a location into m_decoded.
+	void DecodeLocation(int location);
+
+	// Puts a word into memory with the text it is displayed as.
+	void SetText(int a_location, int a_value, const char *a_begin, const char *a_end);
+
+	// Puts a word stored by the program into memory, shown as its number.
+	void SetWord(int a_location, int a_value) {
+		m_memory[a_location] = a_value;
+		m_shown[a_location] = SHOWN_NUMBER;
+		DecodeLocation(a_location);
+	}
+
+	// Redecodes a location after a store, along with any group it belongs to.
+	void UpdateLocation(int location);
+
+	// Combines common instruction sequences into fused groups.
+	void FuseInstructions();
+
+	// Replaces the handler at location with a fused one if a group starts there.
+	bool FuseLocation(int location);
+
+	// Runs the program with the interpreter; runProgram flushes the output after.
+	RunStatus Interpret(int startLocation);
+
+	// Runs the interpreter from the active location, keeping the counts so far.
+	RunStatus Dispatch();
+
+	// Records the state of the machine in a snapshot.
+	void TakeSnapshot(Snapshot &a_snapshot);
+
+	// Records that a location and the group before it may have changed.
+	void MarkDirty(int location);
+
+	// Hashes all of memory and starts the search for a loop over.
+	void StartLoopDetection();
+
+	// Forgets the saved state, as after a READ changes what follows.
+	void ResetLoopSearch();
+
+	// Records the state after a backward branch; false if it was seen before.
+	bool CheckLoop(int a_accumulator, int a_source, int a_target);
+
+	// A Zobrist style key for a value at a location.  The accumulator and the
+	// active location are hashed as locations MEMSZ and MEMSZ + 1.
+	static unsigned long long HashWord(int a_location, int a_value) {
+		unsigned long long key = ((unsigned long long)(unsigned int)a_location << 32) | (unsigned int)a_value;
+		key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+		return key ^ (key >> 31);
+	}
+
+	// Runs the program one counted instruction at a time.
+	RunStatus InterpretProfiled(int startLocation, Profiler &a_profiler);
+
+	// Runs the program recording each instruction, and the value of a READ.
+	RunStatus InterpretTraced(int startLocation, TraceWriter &a_trace);
+	void RecordTracedRead(int a_address, bool a_valid, TraceWriter &a_trace);
+
+	// Runs the program one instruction at a time, recording what each changes.
+	RunStatus InterpretUndoable(int startLocation, UndoLog &a_log);
+
+	// Displays a line of output or an error message.
+	void DisplayLine(const char *a_text, int a_length);
+	void DisplayLine(const char *a_text) { DisplayLine(a_text, (int)strlen(a_text)); }
+
+	// Writes out the buffered output.
+	void FlushOutput();
+
+	// Returns all fused groups to their individual instructions.
+	void UnfuseInstructions();
+
+	// Decides when the run must next check its limits.
+	bool CheckLimits(long long a_startTime, long long &a_nextCheck, RunStatus &a_status);
+
+	// The current time in milliseconds, for the time limit.
+	static long long NowMilliseconds();
+
+	// Executes the fused group starting at the active location.
+	bool ExecuteFusedGroup(int handler);
+
+	// Displays the error for a word that does not hold a valid instruction.
+	void ReportDecodeError(int handler);
+
 	// Determines which action to perform based on OpCode.
-	void ExecuteOpCode(int opcode, int address);
+	bool ExecuteOpCode(int opcode, int address, RunStatus &a_status);
 
 	// Adds contents of accumulator with contents of address.
 	void ExecuteAdd(int address);
@@ -41,19 +437,19 @@ private:
 	void ExecuteMultiply(int address);
 
 	// Divide contents of accumulator with contents of address.
-	void ExecuteDivide(int address);
+	bool ExecuteDivide(int address);
 
 	// Load contents of address into the accumulator.
-	void ExecuteLoad(int address);
+	bool ExecuteLoad(int address);
 
 	// Store into address the contents of the accumulator.
-	void ExecuteStore(int address);
+	bool ExecuteStore(int address);
 
 	// A line is read and its first 6 digits are placed in the specified address.
 	void ExecuteRead(int address);
 
 	// Contents of address are displayed to the console.
-	void ExecuteWrite(int address);
+	bool ExecuteWrite(int address);
 
 	// Go to address for next instruction.
 	void ExecuteBranch(int address);
@@ -68,4 +464,17 @@ private:
 	void ExecuteBranchPositive(int address);
 };
 
+struct emulator::Snapshot {
+	int memory[MEMSZ];
+	unsigned short shown[MEMSZ];
+	vector<string> texts;
+	DecodedInstruction decoded[MEMSZ + 1];
+	bool fusionEnabled;
+	int fusedCount;
+	int accumulator;
+	int activeLocation;		// The location of the READ.
+	long long stepCount;
+	long long outputCount;
+};
+
 #endif
@@ -79,6 +79,41 @@ void Errors::RecordError(int line, string &a_emsg) {
 
 
 
+/*
+NAME
+
+MergeErrors - record the errors of another list.
+
+SYNOPSIS
+
+void Errors::MergeErrors(const Errors &a_other);
+
+a_other - the errors to record, such as those found by one thread.
+
+DESCRIPTION
+
+Records each error of a_other with RecordError, line by line and in the
+order they were recorded there, so an error already in the multimap is
+not recorded twice.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Errors::MergeErrors(const Errors &a_other) {
+	for (multimap<int, string>::const_iterator errorIterator = a_other.m_ErrorMsgs.begin(); errorIterator != a_other.m_ErrorMsgs.end(); errorIterator++) {
+		string message = errorIterator->second;
+		RecordError(errorIterator->first, message);
+	}
+}
+
+
+
+
 /*
 NAME
 
@@ -86,15 +121,20 @@ DisplayErrors - display the contents of error multimap for a given line.
 
 SYNOPSIS
 
-void Errors::DisplayErrors(int line);
+void Errors::DisplayErrors(int line, ostream &a_errors, ostream &a_listing);
 
 line - the line in the file where the error occured.
 
+a_errors - the stream the messages are written to.
+
+a_listing - the stream the listing is written to.
+
 DESCRIPTION
 
 If there are no errors for the line the function does nothing; otherwise
-it iterates through the multimap displaying to the console all errors
-that are associated with the particular line key value.
+it iterates through the multimap displaying all errors that are
+associated with the particular line key value, then ends the line of
+the listing.
 
 RETURNS
 
@@ -104,14 +144,55 @@ AUTHOR
 
 Charles Snyder
 */
-void Errors::DisplayErrors(int line) {
+void Errors::DisplayErrors(int line, ostream &a_errors, ostream &a_listing) {
 	if (m_ErrorMsgs.count(line) != 0) {
 		int count = 0;
 		for (multimap<int, string>::iterator errorIterator = m_ErrorMsgs.find(line); count < (int)m_ErrorMsgs.count(line); count++, errorIterator++) {
-			cerr << errorIterator->second << ", ";
+			a_errors << errorIterator->second << ", ";
 		}
-		cout << endl;
+		a_listing << endl;
 	}
 }
 
-multimap<int, string> Errors::m_ErrorMsgs;
\ No newline at end of file
+
+
+/*
+NAME
+
+DisplayErrors - display the errors for a given line through a listing writer.
+
+SYNOPSIS
+
+void Errors::DisplayErrors(int line, ListingWriter &a_listing);
+
+line - the line in the file where the error occured.
+
+a_listing - the writer of the listing.
+
+DESCRIPTION
+
+Writes the errors associated with the line as errors, in the same form as
+DisplayErrors on streams, then ends the line of the listing.  The writer
+keeps them in their place among the lines of the listing.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Errors::DisplayErrors(int line, ListingWriter &a_listing) {
+	typedef multimap<int, string>::const_iterator ErrorIterator;
+	pair<ErrorIterator, ErrorIterator> found = m_ErrorMsgs.equal_range(line);
+	if (found.first != found.second) {
+		string text;
+		for (ErrorIterator errorIterator = found.first; errorIterator != found.second; errorIterator++) {
+			text += errorIterator->second;
+			text += ", ";
+		}
+		a_listing.WriteError(text);
+		a_listing.EndErrors();
+	}
+}
@@ -1,27 +1,39 @@
 //
-// Class to manage error reporting. Note: all members are static so we can access them anywhere.
-// What other choices do we have to accomplish the same thing?
+// Class to manage error reporting.  Each assembly has its own, shared with
+// its Instruction, so that any number of programs can be assembled in one
+// process.
 //
 #pragma once
 
 #include <string>
 #include <map>
 
+#include "ListingWriter.h"
+
 class Errors {
 
 public:
 
 	// Initializes error reports.
-	static void InitErrorReporting();
+	void InitErrorReporting();
 
 	// Records an error message.
-	static void RecordError(int line, string &a_emsg);
+	void RecordError(int line, string &a_emsg);
+
+	// Records every error of another list, in its order.
+	void MergeErrors(const Errors &a_other);
+
+	// Displays the collected error message on the given streams.
+	void DisplayErrors(int line, ostream &a_errors, ostream &a_listing);
+
+	// The same, through a listing writer.
+	void DisplayErrors(int line, ListingWriter &a_listing);
 
-	// Displays the collected error message.
-	static void DisplayErrors(int line);
+	// The error messages recorded, by line.
+	const multimap<int, string> &GetErrors() { return m_ErrorMsgs; }
 
 private:
 
 	// Multimap to store multiple errors per line.
-	static multimap<int, string> m_ErrorMsgs;
+	multimap<int, string> m_ErrorMsgs;
 };
\ No newline at end of file
@@ -0,0 +1,297 @@
+//
+//		Implementation of the Evaluator class.
+//
+#include "stdafx.h"
+#include "Evaluator.h"
+
+// The first line of a cache file; changed whenever its layout changes.
+static const char *const CACHE_HEADER = "VC3600 evaluation 3";
+
+// Constructor for evaluating a translation.
+Evaluator::Evaluator(const emulator &a_program, int a_startLocation)
+: m_program(a_program)
+{
+	m_startLocation = a_startLocation;
+	m_cached = false;
+	m_accumulator = 0;
+	m_result.status = emulator::RS_Halted;
+	m_result.error = emulator::RE_None;
+	m_result.location = 0;
+	m_result.steps = 0;
+	m_result.loopFirst = -1;
+	m_result.loopLast = -1;
+	ComputeKey();
+}
+// Destructor currently does nothing.
+Evaluator::~Evaluator()
+{
+}
+
+
+
+/*
+NAME
+
+Evaluate - Gets the result of a program without running it later.
+
+SYNOPSIS
+
+bool Evaluator::Evaluate(const string &a_cacheName, long long a_budget);
+
+a_cacheName - the cache file kept next to the source.
+
+a_budget - the most instructions the program may execute to be evaluated.
+
+DESCRIPTION
+
+A program that never executes a READ does the same thing every time it
+is run.  If the cache file holds the result for this same translation it
+is used as it is.  Otherwise the program is run in a separate emulator,
+stopping at the first READ or when the budget runs out, and if it
+finished the result is written to the cache file for next time.
+
+RETURNS
+
+True if the result is known, false if the program has to be run normally.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool Evaluator::Evaluate(const string &a_cacheName, long long a_budget)
+{
+	if (ReadCache(a_cacheName)) {
+		m_cached = true;
+		return true;
+	}
+	if (!Run(a_budget)) {
+		return false;
+	}
+	WriteCache(a_cacheName);
+	return true;
+}
+
+
+
+/*
+NAME
+
+ComputeKey - Identifies the translation.
+
+SYNOPSIS
+
+void Evaluator::ComputeKey();
+
+DESCRIPTION
+
+Hashes every word of memory, as the text WRITE would show it, and the
+start location with 64 bit FNV-1a, so a cache file written for another
+version of the program, even one that only loads "001" where this loads
+"000001", is not used.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Evaluator::ComputeKey()
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	char text[emulator::WORD_TEXT_SIZE];
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		int length = m_program.FormatLocation(i, text);
+		for (int c = 0; c < length; c++) {
+			hash ^= (unsigned char)text[c];
+			hash *= 1099511628211ULL;
+		}
+		// Ends the text, so that the words cannot run into each other.
+		hash ^= 0xFF;
+		hash *= 1099511628211ULL;
+	}
+	unsigned int start = (unsigned int)m_startLocation;
+	for (int byte = 0; byte < 4; byte++) {
+		hash ^= (start >> (8 * byte)) & 0xFF;
+		hash *= 1099511628211ULL;
+	}
+	ostringstream key;
+	key << hex << setw(16) << setfill('0') << hash;
+	m_key = key.str();
+}
+
+
+
+/*
+NAME
+
+Run - Runs the program to find its result.
+
+SYNOPSIS
+
+bool Evaluator::Run(long long a_budget);
+
+a_budget - the most instructions the program may execute.
+
+DESCRIPTION
+
+Runs a copy of the translation with no input, collecting its output,
+until it halts, stops with a runtime error, reaches a READ or uses up
+the step budget or the output budget.
+
+RETURNS
+
+True if it halted or stopped with an error, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool Evaluator::Run(long long a_budget)
+{
+	emulator *sandbox = new emulator;
+	emulator::Snapshot *snapshot = new emulator::Snapshot;
+	istringstream noInput;
+	ostringstream output;
+	sandbox->LoadFrom(m_program);
+	sandbox->SetIO(noInput, output, false);
+	sandbox->SetOutputBuffer(1 << 16);
+	sandbox->SetLimits(a_budget, emulator::NO_LIMIT, OUTPUT_BUDGET);
+
+	emulator::RunStatus status = sandbox->runToRead(m_startLocation, *snapshot);
+	bool finished = status == emulator::RS_Halted || status == emulator::RS_RuntimeError;
+	if (finished) {
+		m_result = sandbox->GetResult(status);
+		m_output = output.str();
+		m_memory.assign(sandbox->GetMemory(), sandbox->GetMemory() + emulator::MEMSZ);
+		m_accumulator = sandbox->GetAccumulator();
+	}
+	delete snapshot;
+	delete sandbox;
+	return finished;
+}
+
+
+
+/*
+NAME
+
+ReadCache - Reads a result from the cache file.
+
+SYNOPSIS
+
+bool Evaluator::ReadCache(const string &a_cacheName);
+
+a_cacheName - the cache file.
+
+DESCRIPTION
+
+The file holds the header and key lines, the result, the final
+accumulator, the length of the output followed by the output itself, and
+then the number of words of memory that are not zero followed by the
+location and word of each.
+
+RETURNS
+
+True if the file was read and is for this translation, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool Evaluator::ReadCache(const string &a_cacheName)
+{
+	ifstream cache(a_cacheName.c_str(), ios::binary);
+	if (!cache) {
+		return false;
+	}
+
+	string header;
+	string key;
+	if (!getline(cache, header) || header != CACHE_HEADER || !getline(cache, key) || key != m_key) {
+		return false;
+	}
+	int status;
+	int error;
+	size_t length;
+	if (!(cache >> status >> error >> m_result.location >> m_result.steps >> m_accumulator >> length)) {
+		return false;
+	}
+	m_result.status = (emulator::RunStatus)status;
+	m_result.error = (emulator::RuntimeError)error;
+
+	// The output follows the newline after its length.
+	cache.get();
+	m_output.resize(length);
+	if (length != 0 && !cache.read(&m_output[0], length)) {
+		return false;
+	}
+
+	int count;
+	if (!(cache >> count)) {
+		return false;
+	}
+	m_memory.assign(emulator::MEMSZ, 0);
+	for (int i = 0; i < count; i++) {
+		int location;
+		int word;
+		if (!(cache >> location >> word) || location < 0 || location >= emulator::MEMSZ) {
+			return false;
+		}
+		m_memory[location] = word;
+	}
+	return true;
+}
+
+
+
+/*
+NAME
+
+WriteCache - Writes the result to the cache file.
+
+SYNOPSIS
+
+void Evaluator::WriteCache(const string &a_cacheName);
+
+a_cacheName - the cache file.
+
+DESCRIPTION
+
+Writes the file read by ReadCache.  If it cannot be written the result
+is simply not cached.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Evaluator::WriteCache(const string &a_cacheName)
+{
+	ofstream cache(a_cacheName.c_str(), ios::binary);
+	if (!cache) {
+		return;
+	}
+
+	cache << CACHE_HEADER << "\n" << m_key << "\n";
+	cache << (int)m_result.status << " " << (int)m_result.error << " " << m_result.location
+		<< " " << m_result.steps << " " << m_accumulator << " " << m_output.length() << "\n";
+	cache << m_output;
+
+	int count = 0;
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		if (m_memory[i] != 0) {
+			count++;
+		}
+	}
+	cache << count << "\n";
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		if (m_memory[i] != 0) {
+			cache << i << " " << m_memory[i] << "\n";
+		}
+	}
+}
@@ -0,0 +1,62 @@
+//
+//		Evaluator class - runs programs that never READ once, when they are assembled.
+//
+#ifndef _EVALUATOR_H
+#define _EVALUATOR_H
+
+#include "Emulator.h"
+
+class Evaluator {
+
+public:
+
+	// Steps a program may take to be evaluated, unless another budget is given.
+	const static long long DEFAULT_BUDGET = 10000000;
+
+	// Evaluates the translation held in a_program, starting at a_startLocation.
+	Evaluator(const emulator &a_program, int a_startLocation);
+	~Evaluator();
+
+	// Finds the result in the cache file or runs the program for it; false
+	// if the program reads input or did not finish within the budget.
+	bool Evaluate(const string &a_cacheName, long long a_budget);
+
+	// The result, the output, the final memory and the final accumulator
+	// of an evaluated program.
+	const emulator::RunResult &GetResult() const { return m_result; }
+	const string &GetOutput() const { return m_output; }
+	const vector<int> &GetMemory() const { return m_memory; }
+	int GetAccumulator() const { return m_accumulator; }
+
+	// Whether the result came from the cache file.
+	bool isCached() const { return m_cached; }
+
+private:
+
+	// The most output kept from a program; more and it is run normally.
+	const static long long OUTPUT_BUDGET = 1 << 20;
+
+	const emulator &m_program;	// The translation.
+	int m_startLocation;
+	string m_key;				// Identifies the translation in the cache file.
+
+	emulator::RunResult m_result;
+	string m_output;
+	vector<int> m_memory;
+	int m_accumulator;
+	bool m_cached;
+
+	// Computes m_key from the words of the translation and the start location.
+	void ComputeKey();
+
+	// Runs the program in a separate emulator, up to the first READ.
+	bool Run(long long a_budget);
+
+	// Reads the result from the cache file if it is for this translation.
+	bool ReadCache(const string &a_cacheName);
+
+	// Writes the result to the cache file.
+	void WriteCache(const string &a_cacheName);
+};
+
+#endif
@@ -11,15 +11,16 @@ FileAccess - Constructor for FileAccess class.
 
 SYNOPSIS
 
-FileAccess::FileAccess(int argc, char *argv[]);
+FileAccess::FileAccess(const string &a_fileName);
 
-argc - the number of command line arguments.
-
-argv - the commmand line arguments in an array.
+a_fileName - the name of the source file, "-" for standard input.
 
 DESCRIPTION
 
-Opens the file specified from the command line arguments.  
+Maps the named file into memory, so that its lines can be handed out
+without copying them and read again at no cost.  A file that cannot be
+mapped, such as a pipe, and standard input are read into memory instead.
+A failure is not fatal; the caller checks isOpen.
 
 RETURNS
 
@@ -29,22 +30,73 @@ AUTHOR
 
 Charles Snyder
 */
-FileAccess::FileAccess(int argc, char *argv[])
+FileAccess::FileAccess(const string &a_fileName)
 {
-	// Check that there is exactly one run time parameter.
-	if (argc != 2) {
-		cerr << "Usage: Assem <FileName>" << endl;
-		exit(1);
+	m_open = false;
+	if (a_fileName == "-") {
+		ostringstream text;
+		text << cin.rdbuf();
+		m_buffer = text.str();
+		m_open = true;
+	}
+	else if (m_file.Open(a_fileName) && m_file.GetSize() != 0) {
+		m_open = true;
+	}
+	else {
+		// Pipes and devices map as empty files, so they are read instead.
+		m_file.Close();
+		ifstream source(a_fileName.c_str(), ios::binary);
+		if (source) {
+			ostringstream text;
+			text << source.rdbuf();
+			m_buffer = text.str();
+			m_open = true;
+		}
 	}
-	// Open the file.
-	m_sfile.open(argv[1]);
-
-	// If the open failed, report the error and terminate.
-	if (!m_sfile) {
-		cerr << "Source file could not be opened, assembler terminated."
-			<< endl;
-		exit(1);
+	if (m_file.GetSize() != 0) {
+		m_text = m_file.GetData();
+		m_size = m_file.GetSize();
 	}
+	else {
+		m_text = m_buffer.data();
+		m_size = m_buffer.size();
+	}
+	IndexLines();
+}
+
+/*
+NAME
+
+FileAccess - Constructor for FileAccess class.
+
+SYNOPSIS
+
+FileAccess::FileAccess(const char *a_text, size_t a_length);
+
+a_text - the source text.
+
+a_length - the number of characters in a_text.
+
+DESCRIPTION
+
+Reads the source from a copy of text held in memory instead of a file,
+so that a program can be assembled without writing it out first.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+FileAccess::FileAccess(const char *a_text, size_t a_length)
+: m_buffer(a_text, a_length)
+{
+	m_open = true;
+	m_text = m_buffer.data();
+	m_size = m_buffer.size();
+	IndexLines();
 }
 
 /*
@@ -58,7 +110,7 @@ FileAccess::~FileAccess();
 
 DESCRIPTION
 
-Closes the file specified from the command line arguments.  
+Unmaps the source file.
 
 RETURNS
 
@@ -70,7 +122,98 @@ Charles Snyder
 */
 FileAccess::~FileAccess()
 {
-	m_sfile.close();
+	m_file.Close();
+}
+
+
+
+/*
+NAME
+
+Reread - Reads the source file again.
+
+SYNOPSIS
+
+bool FileAccess::Reread(const string &a_fileName);
+
+a_fileName - the name of the source file.
+
+DESCRIPTION
+
+Reads the whole file into memory and finds its lines, replacing the
+source read before.  The file is copied rather than mapped, since it is
+being edited: a mapping would change, or lose its pages, as the file is
+written.  Lines handed out before are no longer valid.  The source is
+left as it was if the file cannot be read.
+
+RETURNS
+
+True if the file was read, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool FileAccess::Reread(const string &a_fileName)
+{
+	ifstream source(a_fileName.c_str(), ios::binary);
+	if (!source) {
+		return false;
+	}
+	ostringstream text;
+	text << source.rdbuf();
+	m_buffer = text.str();
+	m_file.Close();
+	m_open = true;
+	m_text = m_buffer.data();
+	m_size = m_buffer.size();
+	IndexLines();
+	return true;
+}
+
+
+
+/*
+NAME
+
+IndexLines - Finds the start of every line.
+
+SYNOPSIS
+
+void FileAccess::IndexLines();
+
+DESCRIPTION
+
+Scans the text for newlines with memchr, which the C library does many
+bytes at a time.  The text is split at every newline, so text that ends
+with one has an empty last line, as getline would read from a stream.
+A carriage return before a newline is left out of the line, as reading
+in text mode does.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void FileAccess::IndexLines()
+{
+	m_lineStarts.clear();
+	m_lineStarts.push_back(0);
+	const char *next = m_text;
+	const char *end = m_text + m_size;
+	while (next < end) {
+		const char *newline = (const char *)memchr(next, '\n', end - next);
+		if (newline == NULL) {
+			break;
+		}
+		next = newline + 1;
+		m_lineStarts.push_back(next - m_text);
+	}
+	m_lineStarts.push_back(m_size + 1);
+	m_nextLine = 0;
 }
 
 
@@ -100,15 +243,49 @@ Charles Snyder
 */
 bool FileAccess::GetNextLine(string &a_buff)
 {
-	if (m_sfile.eof()) return false;
+	LineView line;
+	if (!GetNextLine(line)) return false;
 
-	getline(m_sfile, a_buff);
+	a_buff.assign(line.data, line.length);
 
 	// Return indicating success.
 	return true;
 }
 
 
+
+/*
+NAME
+
+GetNextLine - Get the next line from the file without copying it.
+
+SYNOPSIS
+
+bool FileAccess::GetNextLine(LineView &a_line)
+
+a_line - passed by reference, set to the next line.
+
+DESCRIPTION
+
+Sets a_line to the next line of the text in memory.
+
+RETURNS
+
+True if a new line was read, false if there were no more lines in the file.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool FileAccess::GetNextLine(LineView &a_line)
+{
+	if (m_nextLine >= GetLineCount()) return false;
+
+	a_line = GetLine(m_nextLine++);
+	return true;
+}
+
+
 /*
 NAME
 
@@ -120,8 +297,8 @@ void FileAccess::rewind();
 
 DESCRIPTION
 
-Clears end of file flag and then seeks back to the start of the file in
-order to read it again.
+Starts reading from the first line again.  The source is already in
+memory, so this costs nothing.
 
 RETURNS
 
@@ -133,9 +310,7 @@ Charles Snyder
 */
 void FileAccess::rewind()
 {
-	// Clean the end of file flag and go back to the beginning of the file.
-	m_sfile.clear();
-	m_sfile.seekg(0, ios::beg);
+	m_nextLine = 0;
 }
 
 
@@ -151,22 +326,21 @@ bool FileAccess::isEndLine();
 
 DESCRIPTION
 
-Checks the end of file flag and returns a bool value based on whether
-or not it is set.
+Checks whether the line read last was the last line of the file.
 
 RETURNS
 
-True if the end of file flag is set, false if it is NOT set.
+True if there are no more lines, false otherwise.
 
 AUTHOR
 
 Charles Snyder
 */
 bool FileAccess::isEndLine() {
-	if (!m_sfile.eof()) {
+	if (m_nextLine < GetLineCount()) {
 		return false;
 	}
 	else {
 		return true;
 	}
-}
\ No newline at end of file
+}
@@ -1,34 +1,88 @@
 //
 //		File access to source file.
 //
-#ifndef _FILEACCESS_H 
+#ifndef _FILEACCESS_H
 #define _FILEACCESS_H
 
 #include <fstream>
+#include <sstream>
 #include <stdlib.h>
 #include <string>
+#include "MappedFile.h"
+
+// A line of the source without its newline.  It points into the text held
+// by the FileAccess it came from, so it is only valid as long as that is.
+struct LineView {
+	const char *data;
+	size_t length;
+
+	// A copy of the line.
+	string str() const { return string(data, length); }
+};
 
 class FileAccess {
 
 public:
 
-	// Opens the file.
-	FileAccess(int argc, char *argv[]);
+	// Opens the named file, or standard input for "-"; isOpen reports whether it could be.
+	FileAccess(const string &a_fileName);
+
+	// Reads the source from text in memory.
+	FileAccess(const char *a_text, size_t a_length);
 
 	// Closes the file.
 	~FileAccess();
 
+	// Reads the named file again, into memory of its own; false if it could not be read.
+	bool Reread(const string &a_fileName);
+
 	// Get the next line from the source file.
 	bool GetNextLine(string &a_buff);
 
+	// The same without copying the line.
+	bool GetNextLine(LineView &a_line);
+
 	// Put the file pointer back to the beginning of the file.
 	void rewind();
 
 	// Checks to see if the file has any more lines
 	bool isEndLine();
 
+	// Checks whether the file was opened.
+	bool isOpen() { return m_open; }
+
+	// The lines of the source, which can be read in any order and from any
+	// thread, independently of GetNextLine.
+	int GetLineCount() { return (int)m_lineStarts.size() - 1; }
+	LineView GetLine(int a_index) {
+		LineView line;
+		line.data = m_text + m_lineStarts[a_index];
+		line.length = m_lineStarts[a_index + 1] - 1 - m_lineStarts[a_index];
+		if (line.length != 0 && line.data[line.length - 1] == '\r' && a_index + 1 < GetLineCount()) {
+			line.length--;
+		}
+		return line;
+	}
+
 private:
 
-	ifstream m_sfile;		// Source file object.
+	bool m_open;			// The source could be read.
+	MappedFile m_file;		// The source file, mapped into memory.
+	string m_buffer;		// The source when it could not be mapped: text, standard input or a pipe.
+	const char *m_text;		// The source, in whichever of the two it is.
+	size_t m_size;
+
+	// Where each line starts, followed by one past the end of the text, so
+	// that a line ends one before the start of the next.
+	vector<size_t> m_lineStarts;
+
+	int m_nextLine;			// The line GetNextLine returns next.
+
+	// Finds the start of every line.
+	void IndexLines();
+
+	// A source cannot be copied.
+	FileAccess(const FileAccess &);
+	FileAccess &operator=(const FileAccess &);
 };
 #endif
@@ -0,0 +1,184 @@
+//
+//		Implementation of the FileWatcher class.
+//
+#include "stdafx.h"
+#include "FileWatcher.h"
+
+#ifndef _WIN32
+#include <sys/inotify.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+// Constructor for a watcher that is not watching yet.
+FileWatcher::FileWatcher()
+{
+	m_inotify = -1;
+}
+
+// Destructor stops watching.
+FileWatcher::~FileWatcher()
+{
+#ifndef _WIN32
+	if (m_inotify != -1) {
+		close(m_inotify);
+	}
+#endif
+}
+
+
+
+/*
+NAME
+
+Open - Starts watching a file.
+
+SYNOPSIS
+
+bool FileWatcher::Open(const string &a_fileName);
+
+a_fileName - the name of the file.
+
+DESCRIPTION
+
+Watches the directory of the file for files in it being written, or
+moved or renamed into it; WaitForChange picks out the events for the
+file.  The file need not exist yet.
+
+RETURNS
+
+True if the directory can be watched, false otherwise or on Windows.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool FileWatcher::Open(const string &a_fileName)
+{
+#ifdef _WIN32
+	return false;
+#else
+	size_t slash = a_fileName.rfind('/');
+	string directory = slash == string::npos ? "." : a_fileName.substr(0, slash + 1);
+	m_name = slash == string::npos ? a_fileName : a_fileName.substr(slash + 1);
+
+	m_inotify = inotify_init();
+	if (m_inotify == -1) {
+		return false;
+	}
+	if (inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO) == -1) {
+		close(m_inotify);
+		m_inotify = -1;
+		return false;
+	}
+	return true;
+#endif
+}
+
+
+
+/*
+NAME
+
+WaitForChange - Waits for the file to be written.
+
+SYNOPSIS
+
+bool FileWatcher::WaitForChange();
+
+DESCRIPTION
+
+Blocks until there is an event for the file, then goes on reading events
+until none has come for SETTLE_MILLISECONDS, so that a save made of many
+writes is reported once, when it is done.
+
+RETURNS
+
+True when the file has changed, false if the events could not be read.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool FileWatcher::WaitForChange()
+{
+#ifdef _WIN32
+	return false;
+#else
+	struct pollfd waiting;
+	waiting.fd = m_inotify;
+	waiting.events = POLLIN;
+	bool changed = false;
+	for (;;) {
+		waiting.revents = 0;
+		int ready = poll(&waiting, 1, changed ? SETTLE_MILLISECONDS : -1);
+		if (ready == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		if (ready == 0) {
+			return true;
+		}
+		if ((waiting.revents & POLLIN) == 0) {
+			return false;
+		}
+		if (ReadEvents()) {
+			changed = true;
+		}
+	}
+#endif
+}
+
+
+
+/*
+NAME
+
+ReadEvents - Reads the events waiting.
+
+SYNOPSIS
+
+bool FileWatcher::ReadEvents();
+
+DESCRIPTION
+
+Reads what inotify has ready, which is at least one event, and looks for
+events naming the file.
+
+RETURNS
+
+True if an event was for the file, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool FileWatcher::ReadEvents()
+{
+#ifdef _WIN32
+	return false;
+#else
+	// Aligned as the events in it are.
+	union {
+		struct inotify_event event;
+		char bytes[1 << 14];
+	} buffer;
+	ssize_t length = read(m_inotify, buffer.bytes, sizeof(buffer.bytes));
+	if (length <= 0) {
+		return false;
+	}
+
+	bool found = false;
+	for (ssize_t offset = 0; offset < length; ) {
+		const struct inotify_event *event = (const struct inotify_event *)(buffer.bytes + offset);
+		if (event->len != 0 && m_name == event->name) {
+			found = true;
+		}
+		offset += sizeof(struct inotify_event) + event->len;
+	}
+	return found;
+#endif
+}
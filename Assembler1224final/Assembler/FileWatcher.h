@@ -0,0 +1,43 @@
+//
+//		FileWatcher class - waits for a file to be written.
+//
+#ifndef _FILEWATCHER_H
+#define _FILEWATCHER_H
+
+// The directory holding the file is watched with inotify rather than the
+// file itself, so that a file an editor saves by writing a new one and
+// renaming it over the old is still followed.  This needs inotify, so it
+// is not available on Windows.
+class FileWatcher {
+
+public:
+
+	// Milliseconds without another change before a change is reported, so
+	// the writes of one save are taken together.
+	const static int SETTLE_MILLISECONDS = 50;
+
+	FileWatcher();
+
+	// Stops watching.
+	~FileWatcher();
+
+	// Starts watching the named file; false if it cannot be watched.
+	bool Open(const string &a_fileName);
+
+	// Waits until the file has been written; false if watching failed.
+	bool WaitForChange();
+
+private:
+
+	int m_inotify;          // The inotify instance, -1 if not open.
+	string m_name;          // The name of the file within its directory.
+
+	// Reads the events waiting; true if any was for the file.
+	bool ReadEvents();
+
+	// A watcher cannot be copied.
+	FileWatcher(const FileWatcher &);
+	FileWatcher &operator=(const FileWatcher &);
+};
+
+#endif
@@ -0,0 +1,326 @@
+//
+//  Implementation of the ForkServer class.
+//
+#include "stdafx.h"
+#include "ForkServer.h"
+#include "BatchRunner.h"
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/*
+NAME
+
+ForkServer - Constructor for the ForkServer class.
+
+SYNOPSIS
+
+ForkServer::ForkServer(int argc, char *argv[]);
+
+argc - the number of command line arguments.
+
+argv - the commmand line arguments in an array.
+
+DESCRIPTION
+
+Reads the options of the server:
+
+	--fork-server <file>  the program to run (required)
+	--threads <n>         most runs at once, the number of processors by default
+	--steps <n>           most instructions each run may execute
+	--time <ms>           most milliseconds each run may take after the READ
+	--output <bytes>      most bytes each run may WRITE
+
+Any error in the options terminates the program.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+ForkServer::ForkServer(int argc, char *argv[])
+{
+	m_children = (int)thread::hardware_concurrency();
+	if (m_children < 1) {
+		m_children = 1;
+	}
+	m_stepLimit = emulator::NO_LIMIT;
+	m_timeLimit = emulator::NO_LIMIT;
+	m_outputLimit = emulator::NO_LIMIT;
+	m_program = NULL;
+	m_emul = new emulator;
+	m_snapshot = new emulator::Snapshot;
+	m_prefixStatus = emulator::RS_AtRead;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--fork-server" && i + 1 < argc) {
+			m_programName = argv[++i];
+		}
+		else if (arg == "--threads") {
+			m_children = (int)BatchRunner::NumberOption(argc, argv, i);
+		}
+		else if (arg == "--steps") {
+			m_stepLimit = BatchRunner::NumberOption(argc, argv, i);
+		}
+		else if (arg == "--time") {
+			m_timeLimit = BatchRunner::NumberOption(argc, argv, i);
+		}
+		else if (arg == "--output") {
+			m_outputLimit = BatchRunner::NumberOption(argc, argv, i);
+		}
+		else {
+			m_programName = "";
+			break;
+		}
+	}
+	if (m_programName.empty() || m_children < 1) {
+		cerr << "Usage: Assem --fork-server <FileName> [--threads N] [--steps N] [--time MS]"
+			<< " [--output BYTES]" << endl;
+		exit(1);
+	}
+}
+
+// Destructor releases the program and the emulator.
+ForkServer::~ForkServer()
+{
+	delete m_program;
+	delete m_emul;
+	delete m_snapshot;
+}
+
+
+
+/*
+NAME
+
+Run - Serves the requests read from standard input.
+
+SYNOPSIS
+
+int ForkServer::Run();
+
+DESCRIPTION
+
+Assembles the program, discarding the listing, and runs it up to its
+first READ once.  Then each line of standard input names an input file
+and an output file; blank lines and lines starting with ';' or '#' are
+ignored.  For each request a child process is forked from the stopped
+emulator and runs the rest of the program on that input.  The child
+shares the memory of the server until it writes to it, so only the pages
+the run touches are copied, by the operating system.  When a child
+finishes, a line with the input file, the output file and the status is
+written to standard output.  This needs fork(), so it is not available
+on Windows.
+
+RETURNS
+
+The exit status for the program: 0 if the requests were served, 1 if
+the program could not be opened or the server cannot run here.
+
+AUTHOR
+
+Charles Snyder
+*/
+int ForkServer::Run()
+{
+#ifdef _WIN32
+	cerr << "The fork server is not available on this system" << endl;
+	return 1;
+#else
+	m_program = new Assembler(m_programName);
+	if (!m_program->isOpen()) {
+		cerr << "Program file could not be opened" << endl;
+		return 1;
+	}
+	m_program->Assemble();
+
+	istringstream noInput;
+	ostringstream output;
+	m_emul->LoadFrom(m_program->GetEmulator());
+	m_emul->SetIO(noInput, output, false);
+	m_emul->SetOutputBuffer(OUTPUT_BUFFER_SIZE);
+	m_emul->SetLimits(m_stepLimit, m_timeLimit, m_outputLimit);
+	m_prefixStatus = m_emul->runToRead(m_program->GetStartLocation(), *m_snapshot);
+	m_prefixOutput = output.str();
+
+	string line;
+	while (getline(cin, line)) {
+		string input;
+		string outputName;
+		istringstream fields(line);
+		if (!(fields >> input) || input[0] == ';' || input[0] == '#') {
+			continue;
+		}
+		if (!(fields >> outputName)) {
+			cout << input << "\t\tno-output" << endl;
+			continue;
+		}
+		while ((int)m_running.size() >= m_children) {
+			WaitForChild();
+		}
+		StartChild(input, outputName);
+	}
+	while (!m_running.empty()) {
+		WaitForChild();
+	}
+	return 0;
+#endif
+}
+
+#ifndef _WIN32
+
+/*
+NAME
+
+StartChild - Starts a child process for one request.
+
+SYNOPSIS
+
+void ForkServer::StartChild(const string &a_input, const string &a_output);
+
+a_input - the input file for READ.
+
+a_output - the file the output of the run goes to.
+
+DESCRIPTION
+
+Standard output is flushed first, so that the child does not carry a
+copy of what is waiting in it.  If the child cannot be started the
+request is reported as failed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ForkServer::StartChild(const string &a_input, const string &a_output)
+{
+	cout.flush();
+	pid_t child = fork();
+	if (child == 0) {
+		RunChild(a_input, a_output);
+	}
+	if (child == -1) {
+		cout << a_input << "\t" << a_output << "\tfailed" << endl;
+		return;
+	}
+	m_running[(int)child] = a_input + "\t" + a_output;
+}
+
+
+
+/*
+NAME
+
+RunChild - Runs one request in the child process.
+
+SYNOPSIS
+
+void ForkServer::RunChild(const string &a_input, const string &a_output);
+
+a_input - the input file for READ.
+
+a_output - the file the output of the run goes to.
+
+DESCRIPTION
+
+Writes the output from before the READ and resumes the emulator, which
+is just as the server left it, on the mapped input file.  The child
+leaves with _exit so that nothing of the server is flushed or destroyed
+twice.
+
+RETURNS
+
+Does not return; the exit code is the emulator::RunStatus of the run,
+or EXIT_NoInput or EXIT_NoOutput.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ForkServer::RunChild(const string &a_input, const string &a_output)
+{
+	MappedFile inputFile;
+	if (!inputFile.Open(a_input)) {
+		_exit(EXIT_NoInput);
+	}
+	ofstream outputFile(a_output.c_str(), ios::binary);
+	if (!outputFile) {
+		_exit(EXIT_NoOutput);
+	}
+	outputFile << m_prefixOutput;
+
+	emulator::RunStatus status = m_prefixStatus;
+	if (status == emulator::RS_AtRead) {
+		istringstream noInput;
+		m_emul->SetIO(noInput, outputFile, false);
+		m_emul->SetInputBuffer(inputFile.GetData(), inputFile.GetData() + inputFile.GetSize());
+		status = m_emul->resumeProgram();
+	}
+	outputFile.close();
+	_exit((int)status);
+}
+
+
+
+/*
+NAME
+
+WaitForChild - Waits for a child to finish.
+
+SYNOPSIS
+
+void ForkServer::WaitForChild();
+
+DESCRIPTION
+
+Reports the request of the child that finished, with the status it
+exited with.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ForkServer::WaitForChild()
+{
+	int result;
+	pid_t child = waitpid(-1, &result, 0);
+	map<int, string>::iterator request = m_running.find((int)child);
+	if (child == -1 || request == m_running.end()) {
+		m_running.clear();
+		return;
+	}
+
+	const char *status = "failed";
+	if (WIFEXITED(result)) {
+		int code = WEXITSTATUS(result);
+		if (code <= emulator::RS_NonTerminating) {
+			status = BatchRunner::StatusName((emulator::RunStatus)code);
+		}
+		else if (code == EXIT_NoInput) {
+			status = "no-input";
+		}
+		else if (code == EXIT_NoOutput) {
+			status = "no-output";
+		}
+	}
+	cout << request->second << "\t" << status << endl;
+	m_running.erase(request);
+}
+
+#endif
@@ -0,0 +1,54 @@
+//
+//		ForkServer class - runs one program over many inputs by forking at its first READ.
+//
+#ifndef _FORKSERVER_H
+#define _FORKSERVER_H
+
+#include "Assembler.h"
+
+class ForkServer {
+
+public:
+
+	// Reads the server options from the command line.
+	ForkServer(int argc, char *argv[]);
+	~ForkServer();
+
+	// Serves the requests read from standard input.
+	int Run();
+
+private:
+
+	// Exit codes of a child that could not run, past those of emulator::RunStatus.
+	const static int EXIT_NoInput = 100;
+	const static int EXIT_NoOutput = 101;
+
+	// Bytes of a child's output collected before it is written.
+	const static int OUTPUT_BUFFER_SIZE = 1 << 16;
+
+	string m_programName;		// The program to run (--fork-server).
+	int m_children;				// Most children running at once (--threads).
+	long long m_stepLimit;		// Limits for each run (--steps, --time, --output).
+	long long m_timeLimit;
+	long long m_outputLimit;
+
+	Assembler *m_program;		// The assembled program.
+	emulator *m_emul;			// Stopped at the first READ; each child resumes it.
+	emulator::Snapshot *m_snapshot;		// The state at the READ.
+	emulator::RunStatus m_prefixStatus;	// RS_AtRead, or how every run ends.
+	string m_prefixOutput;		// What was displayed before the READ.
+
+	// The requests of the children still running, by process id.
+	map<int, string> m_running;
+
+	// Starts a child for one request.
+	void StartChild(const string &a_input, const string &a_output);
+
+	// Runs one request in the child and exits with its status.
+	void RunChild(const string &a_input, const string &a_output);
+
+	// Waits for a child to finish and reports its result.
+	void WaitForChild();
+};
+
+#endif
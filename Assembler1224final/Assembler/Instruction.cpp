@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "Instruction.h"
+#include "Lexer.h"
 
 /*
 NAME
@@ -37,67 +38,66 @@ Instruction::InstructionType Instruction::RecordInstruction(string &a_buff)
 	m_Label = "";  // Reset the label.
 	m_IsNumericOperand = false; // Reset the numeric operand flag.
 
-	// Parse out any comments
-	int pos = (int)a_buff.find_first_of(';');
-	string noCommentString = a_buff.substr(0, pos);
-	trimBlanks(noCommentString);
+	// Split the line into its fields, leaving out any comment.
+	Lexer::Fields fields;
+	bool hasFields = Lexer::Split(a_buff.data(), a_buff.size(), fields);
 
-	string label, opcode, operand, error;
-
-	// Read in the contents of the line.
-	istringstream parseLine(noCommentString);
+	string label = fields.label.str();
+	string opcode = fields.opCode.str();
+	string operand = fields.operand.str();
+	string error = fields.overflow.str();
 
 	// The line was not a comment.
-	if (!noCommentString.empty()) {
+	if (hasFields) {
 		// Check to see if a label exists on the line.
-		if (noCommentString[0] != ' ' && noCommentString[0] != '\t') {
-			parseLine >> label >> opcode >> operand >> error;
+		if (fields.hasLabel) {
 			makeUpperCase(opcode);
 			SetLabel(label);
 			SetOpCode(opcode);
 			SetOperand(operand);
+			const OpCodeTable::Descriptor &info = OpCodeTable::Get(m_OpCode);
 
 			FindBlankAndGarbageValues(opcode, operand, error, true);
 
-			if (opcode == "ORG" || opcode == "HALT" || opcode == "END") {
+			if (info.label == OpCodeTable::LR_Forbidden) {
 				string error = "Command should not have label";
-				Errors::RecordError(lineCount, error);
+				m_errors->RecordError(lineCount, error);
 			}
 
 			if (m_IsNumericOperand == true) {
 				SetNumOperandValue(operand);
 			}
 
-			if (isAssemblerInstruction(opcode) == true) {
+			if (info.kind == OpCodeTable::OK_Directive) {
 				AssemblyLabelError();
 				m_type = ST_AssemblerInstr;
 				return ST_AssemblerInstr;
 			}
 			else {
 				MachineNoSymbolOperandError();
-				DetermineNumOpCode(opcode);
+				m_NumOpCode = info.code;
 				m_type = ST_MachineLanguage;
 				return ST_MachineLanguage;
 			}
 		}
 		// Line contained no symbol value.
 		else {
-			parseLine >> opcode >> operand >> error;
 			makeUpperCase(opcode);
 			SetOpCode(opcode);
 			SetOperand(operand);
+			const OpCodeTable::Descriptor &info = OpCodeTable::Get(m_OpCode);
 
-			if (opcode == "DS" || opcode == "DC") {
+			if (info.label == OpCodeTable::LR_Required) {
 				string error = "Missing symbol";
-				Errors::RecordError(lineCount, error);
+				m_errors->RecordError(lineCount, error);
 			}
 
-			if (opcode == "HALT" || opcode == "END") {
+			if (info.operand == OpCodeTable::OR_None) {
 				if (!operand.empty()) {
 					string errorMessage = "Operand after halt or end";
-					Errors::RecordError(lineCount, errorMessage);
+					m_errors->RecordError(lineCount, errorMessage);
 				}
-				if (opcode == "END") {
+				if (m_OpCode == OC_End) {
 					m_type = ST_End;
 					return ST_End;
 				}
@@ -107,18 +107,18 @@ Instruction::InstructionType Instruction::RecordInstruction(string &a_buff)
 
 			if (m_IsNumericOperand == true) {
 				SetNumOperandValue(operand);
-				if (opcode == "ORG") {
+				if (info.size == OpCodeTable::SE_Origin) {
 					startLocation = m_OperandValue;
 				}
 			}
-			if (isAssemblerInstruction(opcode) == true) {
+			if (info.kind == OpCodeTable::OK_Directive) {
 				AssemblyLabelError();
 				m_type = ST_AssemblerInstr;
 				return ST_AssemblerInstr;
 			}
 			else {
 				MachineNoSymbolOperandError();
-				DetermineNumOpCode(opcode);
+				m_NumOpCode = info.code;
 				m_type = ST_MachineLanguage;
 				return ST_MachineLanguage;
 			}
@@ -159,11 +159,7 @@ AUTHOR
 Charles Snyder
 */
 void Instruction::trimBlanks(string &a_str) {
-	string space = "";
-	regex findSpace("\\s+$");
-
-	string result = regex_replace(a_str, findSpace, space);
-	a_str = result;
+	a_str.resize(Lexer::TrimmedLength(a_str.data(), a_str.size()));
 }
 
 
@@ -175,7 +171,7 @@ FindBlankAndGarbageValues - Perform error checking on line parameters.
 
 SYNOPSIS
 
-void Instruction::FindBlankAndGarbageValues(string opcode, string operand, string overflow, bool labelFlag);
+void Instruction::FindBlankAndGarbageValues(const string &opcode, const string &operand, const string &overflow, bool labelFlag);
 
 opcode - opcode value from instruction.
 
@@ -198,25 +194,25 @@ AUTHOR
 
 Charles Snyder
 */
-void Instruction::FindBlankAndGarbageValues(string opcode, string operand, string overflow, bool labelFlag) {
+void Instruction::FindBlankAndGarbageValues(const string &opcode, const string &operand, const string &overflow, bool labelFlag) {
 	if (!overflow.empty()) {
 		string errorMessage = "Too many fields";
-		Errors::RecordError(lineCount, errorMessage);
+		m_errors->RecordError(lineCount, errorMessage);
 	}
 	if (labelFlag == true) {
 		if (opcode == "") {
 			string errorMessage = "Missing opcode";
-			Errors::RecordError(lineCount, errorMessage);
+			m_errors->RecordError(lineCount, errorMessage);
 		}
 		if (operand == "") {
 			string errorMessage = "Missing operand";
-			Errors::RecordError(lineCount, errorMessage);
+			m_errors->RecordError(lineCount, errorMessage);
 		}
 	}
 	else {
-		if (operand == "" && opcode != "HALT") {
+		if (operand == "" && OpCodeTable::Get(m_OpCode).operand != OpCodeTable::OR_None) {
 			string errorMessage = "Missing operand";
-			Errors::RecordError(lineCount, errorMessage);
+			m_errors->RecordError(lineCount, errorMessage);
 		}
 	}
 }
@@ -246,19 +242,10 @@ AUTHOR
 Charles Snyder
 */
 void Instruction::AssemblyLabelError() {
-	if (m_OpCode == "DC" && m_IsNumericOperand == false) {
-		string error = "DC opcode has symbol operand";
-		Errors::RecordError(lineCount, error);
-		m_Operand = "????";
-	}
-	else if (m_OpCode == "DS" && m_IsNumericOperand == false) {
-		string error = "DS opcode has symbol operand";
-		Errors::RecordError(lineCount, error);
-		m_Operand = "????";
-	}
-	else if (m_OpCode == "ORG" && m_IsNumericOperand == false) {
-		string error = "ORG opcode has symbol operand";
-		Errors::RecordError(lineCount, error);
+	const OpCodeTable::Descriptor &info = OpCodeTable::Get(m_OpCode);
+	if (info.operand == OpCodeTable::OR_Number && m_IsNumericOperand == false) {
+		string error = string(info.mnemonic) + " opcode has symbol operand";
+		m_errors->RecordError(lineCount, error);
 		m_Operand = "????";
 	}
 }
@@ -289,7 +276,7 @@ Charles Snyder
 void Instruction::MachineNoSymbolOperandError() {
 	if (m_IsNumericOperand == true) {
 		string error = "OpCode does not have symbolic operand";
-		Errors::RecordError(lineCount, error);
+		m_errors->RecordError(lineCount, error);
 		m_Operand = "????";
 	}
 }
@@ -321,7 +308,7 @@ Charles Snyder
 */
 void Instruction::makeUpperCase(string &word) {
 	for (int i = 0; i < (int)word.length(); i++) {
-		word[i] = toupper(word[i]);
+		word[i] = Lexer::ToUpper(word[i]);
 	}
 }
 
@@ -334,7 +321,7 @@ isValidLabel - ensure the label value meets specified requirements.
 
 SYNOPSIS
 
-void Instruction::isValidLabel(string label)
+void Instruction::isValidLabel(const string &label)
 
 label - the label value parsed from the line.
 
@@ -350,10 +337,10 @@ AUTHOR
 
 Charles Snyder
 */
-bool Instruction::isValidLabel(string label) {
-	if (label.length() > 10 || isalpha(label[0]) == 0) {
+bool Instruction::isValidLabel(const string &label) {
+	if (label.length() > 10 || !Lexer::IsAlpha(label[0])) {
 		string error = "Invalid label";
-		Errors::RecordError(lineCount, error);
+		m_errors->RecordError(lineCount, error);
 		return false;
 	}
 	else {
@@ -370,7 +357,7 @@ isValidOperand - ensure the operand value meets specified requirements.
 
 SYNOPSIS
 
-void Instruction::isValidOperand(string operand)
+void Instruction::isValidOperand(const string &operand)
 
 operand - the operand value parsed from the line.
 
@@ -388,14 +375,14 @@ AUTHOR
 
 Charles Snyder
 */
-bool Instruction::isValidOperand(string operand) {
+bool Instruction::isValidOperand(const string &operand) {
 	if (operand == "") {
 		return false;
 	}
 	if (DetermineNumericOperand(operand) == false) {
-		if (isalpha(operand[0]) == 0 || operand.length() > 10) {
+		if (!Lexer::IsAlpha(operand[0]) || operand.length() > 10) {
 			string error = "Invalid operand";
-			Errors::RecordError(lineCount, error);
+			m_errors->RecordError(lineCount, error);
 			return false;
 		}
 		else {
@@ -421,13 +408,13 @@ isValidOpCode - ensure the opcode value meets specified requirements.
 
 SYNOPSIS
 
-void Instruction::isValidOpCode(string opcode)
+void Instruction::isValidOpCode(const string &opcode)
 
 opcode - the opcode value parsed from the line.
 
 DESCRIPTION
 
-Checks to see that the opcode is equal to one of the values existing in the language library.
+Checks to see that the opcode, in any case, is one of the mnemonics in the opcode table.
 
 RETURNS
 
@@ -437,16 +424,12 @@ AUTHOR
 
 Charles Snyder
 */
-bool Instruction::isValidOpCode(string opcode) {
-	string opCodeArray[17] = { "ADD", "SUB", "MULT", "DIV", "LOAD", "STORE", "READ", "WRITE", "B", "BM", "BZ", "BP", "HALT", "ORG", "DC", "DS", "END" };
-	makeUpperCase(opcode);
-	for (int i = 0; i < 17; i++) {
-		if (opcode == opCodeArray[i]) {
-			return true;
-		}
+bool Instruction::isValidOpCode(const string &opcode) {
+	if (OpCodeTable::Find(opcode) != OC_Invalid) {
+		return true;
 	}
 	string error = "Invalid OpCode";
-	Errors::RecordError(lineCount, error);
+	m_errors->RecordError(lineCount, error);
 	return false;
 }
 
@@ -477,14 +460,16 @@ AUTHOR
 Charles Snyder
 */
 int Instruction::LocationNextInstruction(int a_loc) {
-	if (m_OpCode == "ORG") {
+	switch (OpCodeTable::Get(m_OpCode).size) {
+	case OpCodeTable::SE_Origin:
 		a_loc = m_OperandValue;
-	}
-	else if (m_OpCode == "DS") {
+		break;
+	case OpCodeTable::SE_Reserve:
 		a_loc = a_loc + m_OperandValue;
-	}
-	else {
+		break;
+	default:
 		a_loc++;
+		break;
 	}
 	return a_loc;
 }
@@ -497,7 +482,7 @@ DetermineNumericOperand - Check whether the operand is a symbol or number.
 
 SYNOPSIS
 
-bool Instruction::DetermineNumericOperand(string operand);
+bool Instruction::DetermineNumericOperand(const string &operand);
 
 operand - the operand value to be determined if it is a symbol or number.
 
@@ -514,12 +499,12 @@ AUTHOR
 
 Charles Snyder
 */
-bool Instruction::DetermineNumericOperand(string operand) {
+bool Instruction::DetermineNumericOperand(const string &operand) {
 	if (operand == "") {
 		return false;
 	}
 	for (int i = 0; i < (int)operand.length(); i++) {
-		if (isdigit(operand[0]) == 0) {
+		if (!Lexer::IsDigit(operand[0])) {
 			m_IsNumericOperand = false;
 			return false;
 		}
@@ -537,13 +522,14 @@ DetermineNumOpCode - Set the numeric op code value based on the opcode from the
 
 SYNOPSIS
 
-void Instruction::DetermineNumOpCode(string opcode);
+void Instruction::DetermineNumOpCode(const string &opcode);
 
 opcode - the opcode from the line.
 
 DESCRIPTION
 
-Based on the opcode set a numeric value to m_NumOpCode.
+Sets m_NumOpCode to the VC3600 opcode of the mnemonic from the opcode table,
+0 if it is a directive or not a mnemonic.
 
 RETURNS
 
@@ -553,50 +539,8 @@ AUTHOR
 
 Charles Snyder
 */
-void Instruction::DetermineNumOpCode(string opcode) {
-	makeUpperCase(opcode);
-	if (opcode == "ADD") {
-		m_NumOpCode = 1;
-	}
-	else if (opcode == "SUB") {
-		m_NumOpCode = 2;
-	}
-	else if (opcode == "MULT") {
-		m_NumOpCode = 3;
-	}
-	else if (opcode == "DIV") {
-		m_NumOpCode = 4;
-	}
-	else if (opcode == "LOAD") {
-		m_NumOpCode = 5;
-	}
-	else if (opcode == "STORE") {
-		m_NumOpCode = 6;
-	}
-	else if (opcode == "READ") {
-		m_NumOpCode = 7;
-	}
-	else if (opcode == "WRITE") {
-		m_NumOpCode = 8;
-	}
-	else if (opcode == "B") {
-		m_NumOpCode = 9;
-	}
-	else if (opcode == "BM") {
-		m_NumOpCode = 10;
-	}
-	else if (opcode == "BZ") {
-		m_NumOpCode = 11;
-	}
-	else if (opcode == "BP") {
-		m_NumOpCode = 12;
-	}
-	else if (opcode == "HALT") {
-		m_NumOpCode = 13;
-	}
-	else {
-		m_NumOpCode = 0;
-	}
+void Instruction::DetermineNumOpCode(const string &opcode) {
+	m_NumOpCode = OpCodeTable::Get(OpCodeTable::Find(opcode)).code;
 }
 
 
@@ -609,13 +553,13 @@ isAssemblerInstruction - determines whether the opcode is an assembler instructi
 
 SYNOPSIS
 
-bool Instruction::isAssemblerInstruction(string opcode)
+bool Instruction::isAssemblerInstruction(const string &opcode)
 
 opcode - the opcode from the line.
 
 DESCRIPTION
 
-Determine if the opcode matches any of the assembler instructions.
+Looks the opcode up in the opcode table to see whether it is a directive.
 
 RETURNS
 
@@ -625,14 +569,8 @@ AUTHOR
 
 Charles Snyder
 */
-bool Instruction::isAssemblerInstruction(string opcode) {
-	makeUpperCase(opcode);
-	if (opcode == "ORG" || opcode == "END" || opcode == "DC" || opcode == "DS") {
-		return true;
-	}
-	else {
-		return false;
-	}
+bool Instruction::isAssemblerInstruction(const string &opcode) {
+	return OpCodeTable::Get(OpCodeTable::Find(opcode)).kind == OpCodeTable::OK_Directive;
 }
 
 
@@ -643,13 +581,15 @@ PrintTranslation - Prints the machine code and original instructions to the scre
 
 SYNOPSIS
 
-void Instruction::PrintTranslation(string contents)
+void Instruction::PrintTranslation(string contents, ostream &a_listing)
 
 contents - the machine code contents.
 
+a_listing - the stream the listing is written to.
+
 DESCRIPTION
 
-Print the contents and original instruction to the screen for various
+Print the contents and original instruction to the listing for various
 opcode scenarios.
 
 RETURNS
@@ -660,16 +600,99 @@ AUTHOR
 
 Charles Snyder
 */
-void Instruction::PrintTranslation(string contents) {
-	if (m_OpCode == "DC") {
-		cout << contents << "     " << m_instruction << endl;
+void Instruction::PrintTranslation(string contents, ostream &a_listing) {
+	PrintTranslation(m_OpCode, contents, m_instruction, a_listing);
+}
+
+
+
+/*
+NAME
+
+PrintTranslation - Prints the translation of an instruction recorded earlier.
+
+SYNOPSIS
+
+static void Instruction::PrintTranslation(OpCodeId a_opCode, const string &a_contents,
+	const string &a_instruction, ostream &a_listing);
+
+a_opCode - the opcode of the instruction.
+
+a_contents - the machine code contents.
+
+a_instruction - the original instruction.
+
+a_listing - the stream the listing is written to.
+
+DESCRIPTION
+
+Prints the line the same way as for the instruction just recorded, for
+the single pass, which displays its listing once the whole source has
+been read.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Instruction::PrintTranslation(OpCodeId a_opCode, const string &a_contents, const string &a_instruction, ostream &a_listing) {
+	if (OpCodeTable::Get(a_opCode).size == OpCodeTable::SE_Word) {
+		a_listing << a_contents << "     " << a_instruction << endl;
+	}
+	else {
+		a_listing << "           " << a_instruction << endl;
 	}
-	else if (m_OpCode == "DS" || m_OpCode == "ORG") {
-		cout << "           " << m_instruction << endl;
+}
+
+
+
+/*
+NAME
+
+PrintTranslation - Writes the translation of an instruction to a listing writer.
+
+SYNOPSIS
+
+static void Instruction::PrintTranslation(OpCodeId a_opCode, const string &a_contents, const char *a_instruction,
+	size_t a_length, ListingWriter &a_listing);
+
+a_opCode - the opcode of the instruction.
+
+a_contents - the machine code contents.
+
+a_instruction - the original instruction, which is not copied.
+
+a_length - the number of characters in a_instruction.
+
+a_listing - the writer of the listing.
+
+DESCRIPTION
+
+Writes the line the same way as to a stream.  The original instruction
+must stay where it is until the listing is flushed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Instruction::PrintTranslation(OpCodeId a_opCode, const string &a_contents, const char *a_instruction, size_t a_length,
+	ListingWriter &a_listing) {
+	if (OpCodeTable::Get(a_opCode).size == OpCodeTable::SE_Word) {
+		a_listing.Write(a_contents);
+		a_listing.Write("     ", 5);
 	}
 	else {
-		cout << contents << "     " << m_instruction << endl;
+		a_listing.Write("           ", 11);
 	}
+	a_listing.WriteSource(a_instruction, a_length);
+	a_listing.Write('\n');
 }
 
 
@@ -732,10 +755,10 @@ Charles Snyder
 */
 void Instruction::SetOpCode(string a_opcode) {
 	if (isValidOpCode(a_opcode) == true) {
-		m_OpCode = a_opcode;
+		m_OpCode = OpCodeTable::Find(a_opcode);
 	}
 	else {
-		m_OpCode = "??";
+		m_OpCode = OC_Invalid;
 	}
 }
 
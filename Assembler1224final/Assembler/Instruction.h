@@ -4,6 +4,7 @@
 #pragma once
 
 #include "Errors.h"
+#include "OpCodeTable.h"
 using namespace std;
 
 // The elements of an instruction.
@@ -11,7 +12,7 @@ class Instruction {
 
 public:
 
-	Instruction() { startLocation = -1; };
+	Instruction() { startLocation = -1; m_errors = NULL; m_OpCode = OC_Invalid; m_NumOpCode = 0; m_OperandValue = 0; };
 	~Instruction() { };
 
 	// Codes to indicate the type of instruction we are processing.
@@ -29,7 +30,7 @@ public:
 	void trimBlanks(string &a_str);
 
 	// Sets error if any values are missing or too many values are on a line.
-	void FindBlankAndGarbageValues(string opcode, string operand, string overflow, bool labelFlag);
+	void FindBlankAndGarbageValues(const string &opcode, const string &operand, const string &overflow, bool labelFlag);
 
 	//  Sets error if assembly instruction has symbol operand.
 	void AssemblyLabelError();
@@ -41,13 +42,13 @@ public:
 	void makeUpperCase(string &word);
 
 	// Checks whether a label meets specified requirements.
-	bool isValidLabel(string label);
+	bool isValidLabel(const string &label);
 
 	// Checks whether the operand meets specified requirements.
-	bool isValidOperand(string operand);
+	bool isValidOperand(const string &operand);
 
 	// Checks whether the opcode meets specified requirements.
-	bool isValidOpCode(string opcode);
+	bool isValidOpCode(const string &opcode);
 
 	// Compute the location of the next instruction.
 	int LocationNextInstruction(int a_loc);
@@ -65,15 +66,20 @@ public:
 	};
 
 	// Determine whether the operand is a number or symbol.
-	bool DetermineNumericOperand(string operand);
+	bool DetermineNumericOperand(const string &operand);
 
 
 
 	// Determine and set the numeric op code.
-	void DetermineNumOpCode(string opcode);
+	void DetermineNumOpCode(const string &opcode);
 
 	// Determine whether the current instruction is assembly or machine instruction.
-	bool isAssemblerInstruction(string opcode);
+	bool isAssemblerInstruction(const string &opcode);
+
+	// Sets where the errors found in instructions are recorded.
+	inline void SetErrors(Errors *a_errors) {
+		m_errors = a_errors;
+	}
 
 	// Set the line count value.
 	inline void setLineCount(int lc) {
@@ -82,8 +88,15 @@ public:
 		}
 	}
 
-	// Print the machine code and original instruction to the console.
-	void PrintTranslation(string contents);
+	// Print the machine code and original instruction to the listing.
+	void PrintTranslation(string contents, ostream &a_listing);
+
+	// The same for an instruction recorded earlier, from its opcode and original text.
+	static void PrintTranslation(OpCodeId a_opCode, const string &a_contents, const string &a_instruction, ostream &a_listing);
+
+	// The same through a listing writer, which refers to the original text where it is.
+	static void PrintTranslation(OpCodeId a_opCode, const string &a_contents, const char *a_instruction, size_t a_length,
+		ListingWriter &a_listing);
 
 
 	inline void SetNumOperandValue(string operand) {
@@ -103,7 +116,7 @@ public:
 		 return m_Operand;
 	};
 
-	inline string GetOpCode() {
+	inline OpCodeId GetOpCode() {
 		return m_OpCode;
 	};
 
@@ -119,6 +132,10 @@ public:
 		return startLocation;
 	};
 
+	inline void SetStartLocation(int a_loc) {
+		startLocation = a_loc;
+	};
+
 	void SetLabel(string a_label);
 
 	void SetOpCode(string a_opcode);
@@ -130,7 +147,7 @@ private:
 
 	// The elemements of a instruction
 	string m_Label;            // The label.
-	string m_OpCode;       // The symbolic op code.
+	OpCodeId m_OpCode;     // The op code, OC_Invalid if it was not one.
 	string m_Operand;      // The operand.
 
 
@@ -147,5 +164,7 @@ private:
 	int lineCount;
 	int startLocation;
 
+	Errors *m_errors;     // Where errors are recorded, shared with the assembler.
+
 };
 
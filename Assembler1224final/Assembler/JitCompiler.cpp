@@ -0,0 +1,883 @@
+//
+//      Implementation of the JitCompiler class.
+//
+#include "stdafx.h"
+#include "JitCompiler.h"
+
+#if JIT_SUPPORTED && !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#include <stddef.h>
+
+// Register assignment inside generated code:
+//     rbx  - base of emulator memory
+//     r12d - the accumulator
+//     r13  - the JitContext
+//     r14  - base of the code map
+// All four are callee saved on both ABIs, so they survive the callbacks.
+
+// Condition codes for the two byte conditional jump (0F 80+cc rel32).
+const unsigned char CC_Less = 0x0C;
+const unsigned char CC_Greater = 0x0F;
+const unsigned char CC_Zero = 0x04;
+const unsigned char CC_NotZero = 0x05;
+const unsigned char CC_Sign = 0x08;
+
+/*
+NAME
+
+JitCompiler - Constructor for the JitCompiler class.
+
+SYNOPSIS
+
+JitCompiler::JitCompiler(emulator &a_emul);
+
+a_emul - the emulator whose memory will be compiled and run.
+
+DESCRIPTION
+
+Obtains a buffer of executable memory and writes the entry and exit
+trampolines into it.  If executable memory is not available, or this
+is not an x86-64 build, the compiler is left unavailable.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+JitCompiler::JitCompiler(emulator &a_emul)
+: m_emul(a_emul)
+{
+	m_code = NULL;
+	m_codeEnd = NULL;
+	m_enter = NULL;
+
+#if JIT_SUPPORTED
+#ifdef _WIN32
+	m_code = (unsigned char *)VirtualAlloc(NULL, CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+	void *buffer = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	m_code = (buffer == MAP_FAILED) ? NULL : (unsigned char *)buffer;
+#endif
+#endif
+	if (m_code == NULL) {
+		return;
+	}
+
+	m_context.memory = m_emul.m_memory;
+	m_context.codeMap = m_codeMap;
+	m_context.accumulator = 0;
+	m_context.exitLocation = 0;
+	m_context.patchSite = NULL;
+	m_context.compiler = this;
+
+	m_codeEnd = m_code;
+	EmitTrampolines();
+	m_blockStart = m_codeEnd;
+	Flush();
+}
+
+/*
+NAME
+
+~JitCompiler - Destructor for the JitCompiler class.
+
+SYNOPSIS
+
+JitCompiler::~JitCompiler();
+
+DESCRIPTION
+
+Releases the executable memory.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+JitCompiler::~JitCompiler()
+{
+	if (m_code == NULL) {
+		return;
+	}
+#ifdef _WIN32
+	VirtualFree(m_code, 0, MEM_RELEASE);
+#elif JIT_SUPPORTED
+	munmap(m_code, CODE_SIZE);
+#endif
+}
+
+
+
+/*
+NAME
+
+Run - Runs the program in the emulator's memory as native code.
+
+SYNOPSIS
+
+emulator::RunStatus JitCompiler::Run(int startLocation);
+
+startLocation - the address where the first instruction is located.
+
+DESCRIPTION
+
+This is the dispatcher.  It enters the block for the current location and
+waits for the generated code to hand control back.  Blocks that exit to a
+successor that has not been compiled yet are compiled and then patched to
+jump to it directly, so a hot loop soon runs without coming back here at
+all.  Anything the generated code does not handle itself - errors, stores
+into compiled code and invalid words - comes back as a request to run a
+single instruction with the interpreter, so the messages are the same.
+
+RETURNS
+
+How the run ended.
+
+AUTHOR
+
+Charles Snyder
+*/
+emulator::RunStatus JitCompiler::Run(int startLocation)
+{
+	m_context.accumulator = m_emul.accumulator;
+
+	emulator::RunStatus status;
+	bool flushed;
+	unsigned char *block = GetBlock(startLocation, flushed);
+	for (;;) {
+		int reason = m_enter(&m_context, block);
+		int location = m_context.exitLocation;
+
+		if (reason == EXIT_Halt) {
+			m_emul.activeLocation = location;
+			status = emulator::RS_Halted;
+			break;
+		}
+		if (reason == EXIT_Stop) {
+			status = m_status;
+			break;
+		}
+		if (reason == EXIT_Interpret) {
+			if (InterpretStep(location, status) == false) {
+				break;
+			}
+			location = m_emul.activeLocation;
+		}
+		block = GetBlock(location, flushed);
+		if (reason == EXIT_Chain && !flushed) {
+			PatchRel32(m_context.patchSite, block);
+		}
+	}
+	m_emul.accumulator = m_context.accumulator;
+
+	// Stores made by generated code did not keep the predecoded words current.
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		m_emul.DecodeLocation(i);
+	}
+	return status;
+}
+
+
+
+/*
+NAME
+
+InterpretStep - Runs one instruction with the interpreter.
+
+SYNOPSIS
+
+bool JitCompiler::InterpretStep(int location, emulator::RunStatus &a_status);
+
+location - the address of the instruction to run.
+
+a_status - passed by reference, set to why the run must stop.
+
+DESCRIPTION
+
+Runs the instruction at location exactly as runProgram would.  If it
+reports an error, the run stops there just as it does when interpreted.
+If it stored into a word that has been compiled, all compiled code is
+discarded.
+
+RETURNS
+
+False if the run must stop, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool JitCompiler::InterpretStep(int location, emulator::RunStatus &a_status)
+{
+	m_emul.activeLocation = location;
+	if (location < 0 || location >= emulator::MEMSZ) {
+		m_emul.ReportDecodeError(emulator::DH_InvalidAddress);
+		a_status = emulator::RS_RuntimeError;
+		return false;
+	}
+
+	m_emul.DecodeLocation(location);
+	const emulator::DecodedInstruction &decoded = m_emul.m_decoded[location];
+	if (decoded.handler == emulator::DH_Halt) {
+		a_status = emulator::RS_Halted;
+		return false;
+	}
+	if (decoded.handler == emulator::DH_InvalidOpCode || decoded.handler > emulator::DH_Halt) {
+		m_emul.ReportDecodeError(decoded.handler);
+		a_status = emulator::RS_RuntimeError;
+		return false;
+	}
+
+	m_emul.accumulator = m_context.accumulator;
+	bool ok = m_emul.ExecuteOpCode(decoded.handler, decoded.address, a_status);
+	m_context.accumulator = m_emul.accumulator;
+	if (!ok) {
+		return false;
+	}
+
+	if ((decoded.handler == emulator::DH_Store || decoded.handler == emulator::DH_Read)
+		&& m_codeMap[decoded.address] != 0) {
+		Flush();
+	}
+	return true;
+}
+
+
+
+/*
+NAME
+
+Flush - Discards all compiled code.
+
+SYNOPSIS
+
+void JitCompiler::Flush();
+
+DESCRIPTION
+
+Forgets every compiled block so that the buffer can be reused.  The
+trampolines at the start of the buffer are kept.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void JitCompiler::Flush()
+{
+	m_codeEnd = m_blockStart;
+	memset(m_blocks, 0, sizeof(m_blocks));
+	memset(m_codeMap, 0, sizeof(m_codeMap));
+}
+
+
+
+/*
+NAME
+
+GetBlock - Finds the code for the block that starts at a location.
+
+SYNOPSIS
+
+unsigned char *JitCompiler::GetBlock(int location, bool &a_flushed);
+
+location - the VC3600 address the block starts at.
+
+a_flushed - passed by reference, set to true if older code was discarded
+			to make room, in which case no old exit may be patched.
+
+DESCRIPTION
+
+Returns the block already compiled for location, or compiles it.  A
+location past the end of memory gets a block that simply reports the
+error through the interpreter.
+
+RETURNS
+
+The address of the generated code.
+
+AUTHOR
+
+Charles Snyder
+*/
+unsigned char *JitCompiler::GetBlock(int location, bool &a_flushed)
+{
+	a_flushed = false;
+	if (location >= 0 && location < emulator::MEMSZ && m_blocks[location] != NULL) {
+		return m_blocks[location];
+	}
+	if (m_codeEnd + MAX_BLOCK_BYTES > m_code + CODE_SIZE) {
+		Flush();
+		a_flushed = true;
+	}
+	return CompileBlock(location);
+}
+
+
+
+/*
+NAME
+
+CompileBlock - Translates a basic block into x86-64 code.
+
+SYNOPSIS
+
+unsigned char *JitCompiler::CompileBlock(int location);
+
+location - the VC3600 address the block starts at.
+
+DESCRIPTION
+
+Translates instructions starting at location until a branch, HALT, or an
+invalid word ends the block.  Arithmetic, LOAD and STORE are done inline
+on the accumulator in r12d.  The divide by zero test, the six digit range
+tests of LOAD and STORE, and a test for a STORE into compiled code are
+all side exits to the interpreter, which reports the error exactly as it
+always has.  READ and WRITE call back into the emulator.
+
+RETURNS
+
+The address of the generated code.
+
+AUTHOR
+
+Charles Snyder
+*/
+unsigned char *JitCompiler::CompileBlock(int location)
+{
+	unsigned char *start = m_codeEnd;
+	vector<SideExit> exits;
+
+	if (location < 0 || location >= emulator::MEMSZ) {
+		EmitExit(EXIT_Interpret, location);
+		return start;
+	}
+	m_blocks[location] = start;
+
+	for (int count = 0; ; count++, location++) {
+		if (location >= emulator::MEMSZ || count == MAX_BLOCK_LENGTH) {
+			EmitChainExit(location);
+			break;
+		}
+		m_emul.DecodeLocation(location);
+		const emulator::DecodedInstruction &decoded = m_emul.m_decoded[location];
+		int address = decoded.address;
+		m_codeMap[location] = 1;
+
+		bool endOfBlock = false;
+		switch (decoded.handler) {
+		case emulator::DH_Add: {
+			// add r12d, [rbx + disp32]
+			static const unsigned char op[] = { 0x44, 0x03, 0xA3 };
+			EmitMemoryOperand(op, sizeof(op), address);
+			break;
+		}
+		case emulator::DH_Sub: {
+			// sub r12d, [rbx + disp32]
+			static const unsigned char op[] = { 0x44, 0x2B, 0xA3 };
+			EmitMemoryOperand(op, sizeof(op), address);
+			break;
+		}
+		case emulator::DH_Multiply: {
+			// imul r12d, [rbx + disp32]
+			static const unsigned char op[] = { 0x44, 0x0F, 0xAF, 0xA3 };
+			EmitMemoryOperand(op, sizeof(op), address);
+			break;
+		}
+		case emulator::DH_Divide: {
+			// mov ecx, [rbx + disp32]; test ecx, ecx; jz exit
+			static const unsigned char load[] = { 0x8B, 0x8B };
+			EmitMemoryOperand(load, sizeof(load), address);
+			EmitByte(0x85); EmitByte(0xC9);
+			EmitSideExitJump(CC_Zero, EXIT_Interpret, location, exits);
+			// mov eax, r12d; cdq; idiv ecx; mov r12d, eax
+			static const unsigned char divide[] = { 0x44, 0x89, 0xE0, 0x99, 0xF7, 0xF9, 0x41, 0x89, 0xC4 };
+			EmitBytes(divide, sizeof(divide));
+			break;
+		}
+		case emulator::DH_Load: {
+			// mov eax, [rbx + disp32]; range check; mov r12d, eax
+			static const unsigned char load[] = { 0x8B, 0x83 };
+			EmitMemoryOperand(load, sizeof(load), address);
+			EmitByte(0x3D); EmitDword(999999);
+			EmitSideExitJump(CC_Greater, EXIT_Interpret, location, exits);
+			EmitByte(0x3D); EmitDword(-999999);
+			EmitSideExitJump(CC_Less, EXIT_Interpret, location, exits);
+			EmitByte(0x41); EmitByte(0x89); EmitByte(0xC4);
+			break;
+		}
+		case emulator::DH_Store: {
+			// cmp r12d, imm32 twice for the range check.
+			EmitByte(0x41); EmitByte(0x81); EmitByte(0xFC); EmitDword(999999);
+			EmitSideExitJump(CC_Greater, EXIT_Interpret, location, exits);
+			EmitByte(0x41); EmitByte(0x81); EmitByte(0xFC); EmitDword(-999999);
+			EmitSideExitJump(CC_Less, EXIT_Interpret, location, exits);
+			// cmp byte [r14 + disp32], 0; jne exit
+			EmitByte(0x41); EmitByte(0x80); EmitByte(0xBE); EmitDword(address); EmitByte(0x00);
+			EmitSideExitJump(CC_NotZero, EXIT_Interpret, location, exits);
+			// mov [rbx + disp32], r12d
+			static const unsigned char store[] = { 0x44, 0x89, 0xA3 };
+			EmitMemoryOperand(store, sizeof(store), address);
+			// mov word [rbx + disp32], SHOWN_NUMBER; m_shown lies a fixed distance from m_memory.
+			int shown = (int)((char *)&m_emul.m_shown[address] - (char *)m_emul.m_memory);
+			EmitByte(0x66); EmitByte(0xC7); EmitByte(0x83); EmitDword(shown);
+			EmitByte(emulator::SHOWN_NUMBER); EmitByte(0x00);
+			break;
+		}
+		case emulator::DH_Read:
+			EmitCallback((void *)&JitCompiler::ReadCallback, location);
+			// test eax, eax; jnz exit
+			EmitByte(0x85); EmitByte(0xC0);
+			EmitSideExitJump(CC_NotZero, EXIT_Resume, location, exits);
+			break;
+		case emulator::DH_Write:
+			EmitCallback((void *)&JitCompiler::WriteCallback, location);
+			// test eax, eax; jnz exit
+			EmitByte(0x85); EmitByte(0xC0);
+			EmitSideExitJump(CC_NotZero, EXIT_Stop, location + 1, exits);
+			break;
+		case emulator::DH_Branch:
+			EmitChainExit(address);
+			endOfBlock = true;
+			break;
+		case emulator::DH_BranchMinus:
+		case emulator::DH_BranchZero:
+		case emulator::DH_BranchPositive: {
+			// test r12d, r12d; jcc taken
+			EmitByte(0x45); EmitByte(0x85); EmitByte(0xE4);
+			unsigned char condition = CC_Sign;
+			if (decoded.handler == emulator::DH_BranchZero) condition = CC_Zero;
+			if (decoded.handler == emulator::DH_BranchPositive) condition = CC_Greater;
+			EmitSideExitJump(condition, EXIT_Chain, address, exits);
+			EmitChainExit(location + 1);
+			endOfBlock = true;
+			break;
+		}
+		case emulator::DH_Halt:
+			EmitExit(EXIT_Halt, location);
+			endOfBlock = true;
+			break;
+		default:
+			// The word cannot be run; let the interpreter report it.
+			EmitExit(EXIT_Interpret, location);
+			endOfBlock = true;
+			break;
+		}
+		if (endOfBlock) {
+			break;
+		}
+	}
+
+	// Place the side exits after the body so the common path falls straight through.
+	for (int i = 0; i < (int)exits.size(); i++) {
+		PatchRel32(exits[i].jumpSite, m_codeEnd);
+		if (exits[i].reason == EXIT_Chain) {
+			EmitChainExit(exits[i].location);
+		}
+		else {
+			EmitExit(exits[i].reason, exits[i].location);
+		}
+	}
+	return start;
+}
+
+
+
+/*
+NAME
+
+EmitTrampolines - Emits the entry and exit sequences.
+
+SYNOPSIS
+
+void JitCompiler::EmitTrampolines();
+
+DESCRIPTION
+
+The entry sequence saves the callee saved registers, loads the memory
+base, code map and accumulator from the context and jumps to the block
+passed as its second argument.  The exit sequence writes the accumulator
+back to the context and returns the exit reason in eax.  Both stay at
+the start of the buffer for the life of the compiler.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void JitCompiler::EmitTrampolines()
+{
+	m_enter = (int(*)(JitContext *, unsigned char *))m_codeEnd;
+
+	// push rbx; push r12; push r13; push r14; push r15; sub rsp, 32
+	static const unsigned char save[] = { 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57, 0x48, 0x83, 0xEC, 0x20 };
+	EmitBytes(save, sizeof(save));
+#ifdef _WIN32
+	// mov r13, rcx
+	EmitByte(0x49); EmitByte(0x89); EmitByte(0xCD);
+#else
+	// mov r13, rdi
+	EmitByte(0x49); EmitByte(0x89); EmitByte(0xFD);
+#endif
+	// mov rbx, [r13 + memory]; mov r14, [r13 + codeMap]; mov r12d, [r13 + accumulator]
+	EmitByte(0x49); EmitByte(0x8B); EmitByte(0x5D); EmitByte(offsetof(JitContext, memory));
+	EmitByte(0x4D); EmitByte(0x8B); EmitByte(0x75); EmitByte(offsetof(JitContext, codeMap));
+	EmitByte(0x45); EmitByte(0x8B); EmitByte(0x65); EmitByte(offsetof(JitContext, accumulator));
+#ifdef _WIN32
+	// jmp rdx
+	EmitByte(0xFF); EmitByte(0xE2);
+#else
+	// jmp rsi
+	EmitByte(0xFF); EmitByte(0xE6);
+#endif
+
+	m_epilogue = m_codeEnd;
+	// mov [r13 + accumulator], r12d
+	EmitByte(0x45); EmitByte(0x89); EmitByte(0x65); EmitByte(offsetof(JitContext, accumulator));
+	// add rsp, 32; pop r15; pop r14; pop r13; pop r12; pop rbx; ret
+	static const unsigned char restore[] = { 0x48, 0x83, 0xC4, 0x20, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3 };
+	EmitBytes(restore, sizeof(restore));
+}
+
+
+
+/*
+NAME
+
+EmitChainExit - Emits a block exit that can be linked to its successor.
+
+SYNOPSIS
+
+void JitCompiler::EmitChainExit(int location);
+
+location - the VC3600 address execution continues at.
+
+DESCRIPTION
+
+The exit starts with a jump to the next instruction, so until it is
+patched it falls into a sequence that records location and the address
+of its own jump and returns EXIT_Chain.  Once the dispatcher has the successor
+block it rewrites the jump to go there directly.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void JitCompiler::EmitChainExit(int location)
+{
+	unsigned char *site = m_codeEnd;
+	// jmp rel32 to the next instruction
+	EmitByte(0xE9); EmitDword(0);
+	// mov dword [r13 + exitLocation], location
+	EmitByte(0x41); EmitByte(0xC7); EmitByte(0x45); EmitByte(offsetof(JitContext, exitLocation)); EmitDword(location);
+	// lea rax, [rip - back to the rel32 of the jump]; mov [r13 + patchSite], rax
+	EmitByte(0x48); EmitByte(0x8D); EmitByte(0x05);
+	EmitDword((int)(site + 1 - (m_codeEnd + 4)));
+	EmitByte(0x49); EmitByte(0x89); EmitByte(0x45); EmitByte(offsetof(JitContext, patchSite));
+	// mov eax, EXIT_Chain; jmp epilogue
+	EmitByte(0xB8); EmitDword(EXIT_Chain);
+	EmitByte(0xE9); EmitDword(0);
+	PatchRel32(m_codeEnd - 4, m_epilogue);
+}
+
+
+
+/*
+NAME
+
+EmitExit - Emits a return to the dispatcher.
+
+SYNOPSIS
+
+void JitCompiler::EmitExit(int reason, int location);
+
+reason - the ExitReason to report.
+
+location - the VC3600 location to report.  Not recorded for EXIT_Resume,
+		   where the callback has already set it.
+
+DESCRIPTION
+
+Emits code that records the location and returns reason to the dispatcher.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void JitCompiler::EmitExit(int reason, int location)
+{
+	if (reason != EXIT_Resume) {
+		// mov dword [r13 + exitLocation], location
+		EmitByte(0x41); EmitByte(0xC7); EmitByte(0x45); EmitByte(offsetof(JitContext, exitLocation)); EmitDword(location);
+	}
+	// mov eax, reason; jmp epilogue
+	EmitByte(0xB8); EmitDword(reason);
+	EmitByte(0xE9); EmitDword(0);
+	PatchRel32(m_codeEnd - 4, m_epilogue);
+}
+
+
+
+/*
+NAME
+
+EmitSideExitJump - Emits a conditional jump to a side exit.
+
+SYNOPSIS
+
+void JitCompiler::EmitSideExitJump(unsigned char condition, int reason, int location, vector<SideExit> &a_exits);
+
+condition - the x86 condition code to jump on.
+
+reason - the ExitReason the side exit reports.
+
+location - the VC3600 location the side exit reports.
+
+a_exits - passed by reference, the side exits of the block being compiled.
+
+DESCRIPTION
+
+Emits the jump with a placeholder target and records it so that the exit
+itself can be placed after the body of the block.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void JitCompiler::EmitSideExitJump(unsigned char condition, int reason, int location, vector<SideExit> &a_exits)
+{
+	EmitByte(0x0F); EmitByte(0x80 + condition); EmitDword(0);
+	SideExit sideExit;
+	sideExit.jumpSite = m_codeEnd - 4;
+	sideExit.reason = reason;
+	sideExit.location = location;
+	a_exits.push_back(sideExit);
+}
+
+
+
+/*
+NAME
+
+EmitCallback - Emits a call to a READ or WRITE callback.
+
+SYNOPSIS
+
+void JitCompiler::EmitCallback(void *a_function, int location);
+
+a_function - the callback to call.
+
+location - the VC3600 location of the instruction, passed as the second argument.
+
+DESCRIPTION
+
+Passes the context and location in the argument registers of the host ABI
+and calls the function.  The stack is already aligned with shadow space
+by the entry sequence.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void JitCompiler::EmitCallback(void *a_function, int location)
+{
+#ifdef _WIN32
+	// mov rcx, r13; mov edx, location
+	EmitByte(0x4C); EmitByte(0x89); EmitByte(0xE9);
+	EmitByte(0xBA); EmitDword(location);
+#else
+	// mov rdi, r13; mov esi, location
+	EmitByte(0x4C); EmitByte(0x89); EmitByte(0xEF);
+	EmitByte(0xBE); EmitDword(location);
+#endif
+	// mov rax, imm64; call rax
+	EmitByte(0x48); EmitByte(0xB8); EmitQword(a_function);
+	EmitByte(0xFF); EmitByte(0xD0);
+}
+
+
+
+/*
+NAME
+
+EmitMemoryOperand - Emits an instruction addressing a memory word.
+
+SYNOPSIS
+
+void JitCompiler::EmitMemoryOperand(const unsigned char *a_prefix, int a_prefixLength, int address);
+
+a_prefix - the instruction bytes up to and including the ModRM byte,
+		   which must select [rbx + disp32].
+
+a_prefixLength - the number of bytes in a_prefix.
+
+address - the VC3600 address of the word.
+
+DESCRIPTION
+
+Emits the prefix followed by the byte displacement of the word.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void JitCompiler::EmitMemoryOperand(const unsigned char *a_prefix, int a_prefixLength, int address)
+{
+	EmitBytes(a_prefix, a_prefixLength);
+	EmitDword(address * (int)sizeof(int));
+}
+
+
+
+// Emit a sequence of bytes.
+void JitCompiler::EmitBytes(const unsigned char *a_bytes, int a_length)
+{
+	memcpy(m_codeEnd, a_bytes, a_length);
+	m_codeEnd += a_length;
+}
+
+// Emit a 32 bit little endian value.
+void JitCompiler::EmitDword(int value)
+{
+	memcpy(m_codeEnd, &value, 4);
+	m_codeEnd += 4;
+}
+
+// Emit a 64 bit pointer.
+void JitCompiler::EmitQword(void *a_pointer)
+{
+	memcpy(m_codeEnd, &a_pointer, 8);
+	m_codeEnd += 8;
+}
+
+// Point the rel32 at a_site, which ends the instruction, to a_target.
+void JitCompiler::PatchRel32(unsigned char *a_site, unsigned char *a_target)
+{
+	int rel = (int)(a_target - (a_site + 4));
+	memcpy(a_site, &rel, 4);
+}
+
+
+
+/*
+NAME
+
+ReadCallback - Performs a READ for the generated code.
+
+SYNOPSIS
+
+int JitCompiler::ReadCallback(JitContext *a_context, int location);
+
+a_context - the context of the running compiler.
+
+location - the VC3600 location of the READ instruction.
+
+DESCRIPTION
+
+Runs the READ through the emulator.  If the input was rejected the READ
+has to be repeated, and if it was stored into compiled code that code
+has to be discarded; either way the generated code must return to the
+dispatcher, which will continue at exitLocation.
+
+RETURNS
+
+Zero if the generated code may continue, nonzero if it must exit.
+
+AUTHOR
+
+Charles Snyder
+*/
+int JitCompiler::ReadCallback(JitContext *a_context, int location)
+{
+	JitCompiler *compiler = a_context->compiler;
+	emulator &emul = compiler->m_emul;
+	int address = emul.m_decoded[location].address;
+
+	emul.activeLocation = location;
+	emul.ExecuteRead(address);
+	a_context->exitLocation = emul.activeLocation;
+
+	if (emul.activeLocation != location + 1) {
+		return 1;
+	}
+	if (compiler->m_codeMap[address] != 0) {
+		compiler->Flush();
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+NAME
+
+WriteCallback - Performs a WRITE for the generated code.
+
+SYNOPSIS
+
+int JitCompiler::WriteCallback(JitContext *a_context, int location);
+
+a_context - the context of the running compiler.
+
+location - the VC3600 location of the WRITE instruction.
+
+DESCRIPTION
+
+Runs the WRITE through the emulator so the output is formatted the same
+and counted against the output limit.
+
+RETURNS
+
+Zero if the generated code may continue, nonzero if the output limit
+was exceeded and the run must stop.
+
+AUTHOR
+
+Charles Snyder
+*/
+int JitCompiler::WriteCallback(JitContext *a_context, int location)
+{
+	JitCompiler *compiler = a_context->compiler;
+	emulator &emul = compiler->m_emul;
+	emul.activeLocation = location;
+	if (!emul.ExecuteWrite(emul.m_decoded[location].address)) {
+		compiler->m_status = emulator::RS_OutputLimit;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,124 @@
+//
+//		JitCompiler class - translates VC3600 basic blocks into x86-64 code.
+//
+#ifndef _JITCOMPILER_H
+#define _JITCOMPILER_H
+
+#include "Emulator.h"
+
+// The JIT is only built where the generated x86-64 code can run.
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+// State shared between the dispatcher and the generated code.  The generated
+// code addresses these fields by offset from r13, so keep it a plain struct.
+struct JitContext {
+	int *memory;					// Base of the emulator memory (kept in rbx).
+	unsigned char *codeMap;			// Nonzero for words that are compiled (kept in r14).
+	int accumulator;				// Accumulator while outside generated code (r12d inside).
+	int exitLocation;				// VC3600 location to continue at after an exit.
+	unsigned char *patchSite;		// rel32 to patch when a block exit is chained.
+	class JitCompiler *compiler;	// Owner, for the READ and WRITE callbacks.
+};
+
+class JitCompiler {
+
+public:
+
+	JitCompiler(emulator &a_emul);
+	~JitCompiler();
+
+	// Determines whether executable memory could be obtained.
+	bool isAvailable() { return m_code != NULL; }
+
+	// Runs the program in the emulator's memory as native code.
+	emulator::RunStatus Run(int startLocation);
+
+private:
+
+	// Reasons the generated code hands control back to the dispatcher.
+	enum ExitReason {
+		EXIT_Chain = 1,     // A block ended and its successor is not linked yet.
+		EXIT_Interpret,     // The instruction at exitLocation needs the interpreter.
+		EXIT_Resume,        // A callback has already set exitLocation.
+		EXIT_Halt,          // A HALT instruction was reached.
+		EXIT_Stop           // A callback has stopped the run; m_status says why.
+	};
+
+	// A conditional side exit that is emitted after the body of a block.
+	struct SideExit {
+		unsigned char *jumpSite;	// Where the rel32 of the conditional jump is.
+		int reason;					// EXIT_Chain, EXIT_Interpret or EXIT_Resume.
+		int location;				// The VC3600 location to report.
+	};
+
+	const static int CODE_SIZE = 16 * 1024 * 1024;	// Size of the code buffer.
+	const static int MAX_BLOCK_LENGTH = 256;		// Instructions in one block.
+	const static int MAX_BLOCK_BYTES = 64 * 1024;	// Room a block may need.
+
+	emulator &m_emul;			// The emulator whose memory is being run.
+	JitContext m_context;		// State shared with the generated code.
+	emulator::RunStatus m_status;	// Why a callback stopped the run.
+
+	unsigned char *m_code;		// The executable buffer.
+	unsigned char *m_codeEnd;	// Next free byte in the buffer.
+	unsigned char *m_blockStart;// Where the first block may go.
+	unsigned char *m_epilogue;	// Common exit sequence.
+
+	// Entry trampoline: saves registers, loads state, jumps to the block.
+	int(*m_enter)(JitContext *a_context, unsigned char *a_block);
+
+	// Compiled code for each location, NULL if not yet compiled.
+	unsigned char *m_blocks[emulator::MEMSZ];
+
+	// Nonzero if the word at a location is part of a compiled block.
+	unsigned char m_codeMap[emulator::MEMSZ];
+
+	// Discards all compiled code.
+	void Flush();
+
+	// Returns the code for the block starting at location, compiling it if needed.
+	unsigned char *GetBlock(int location, bool &a_flushed);
+
+	// Translates the basic block starting at location.
+	unsigned char *CompileBlock(int location);
+
+	// Runs one instruction with the interpreter.
+	bool InterpretStep(int location, emulator::RunStatus &a_status);
+
+	// Emits the fixed entry and exit sequences at the start of the buffer.
+	void EmitTrampolines();
+
+	// Emits an exit that can later be patched to jump straight to a block.
+	void EmitChainExit(int location);
+
+	// Emits an exit that reports the given reason and location.
+	void EmitExit(int reason, int location);
+
+	// Emits a conditional jump whose target is a side exit after the block.
+	void EmitSideExitJump(unsigned char condition, int reason, int location, vector<SideExit> &a_exits);
+
+	// Emits a call to one of the READ and WRITE callbacks.
+	void EmitCallback(void *a_function, int location);
+
+	// Emits an instruction that uses [rbx + 4 * address] as its operand.
+	void EmitMemoryOperand(const unsigned char *a_prefix, int a_prefixLength, int address);
+
+	// Emit raw bytes into the code buffer.
+	void EmitByte(int value) { *m_codeEnd++ = (unsigned char)value; }
+	void EmitBytes(const unsigned char *a_bytes, int a_length);
+	void EmitDword(int value);
+	void EmitQword(void *a_pointer);
+
+	// Points the rel32 at a_site to a_target.
+	static void PatchRel32(unsigned char *a_site, unsigned char *a_target);
+
+	// Callbacks made by the generated code.
+	static int ReadCallback(JitContext *a_context, int location);
+	static int WriteCallback(JitContext *a_context, int location);
+};
+
+#endif
@@ -0,0 +1,859 @@
+//
+//  Implementation of the LaneEmulator class.
+//
+#include "stdafx.h"
+#include "LaneEmulator.h"
+
+// The current time in milliseconds.
+static long long NowMilliseconds()
+{
+	return chrono::duration_cast<chrono::milliseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Constructor for the lane emulator.  The memory is too large for the stack.
+LaneEmulator::LaneEmulator()
+{
+	m_memory = new int[emulator::MEMSZ][LANES];
+	m_program = NULL;
+	m_lanes = NULL;
+	m_scalar = NULL;
+	m_startTime = 0;
+	m_scalarCount = 0;
+	SetLimits(emulator::NO_LIMIT, emulator::NO_LIMIT, emulator::NO_LIMIT);
+}
+
+// Destructor releases the memory.
+LaneEmulator::~LaneEmulator()
+{
+	delete[] m_memory;
+}
+
+
+
+/*
+NAME
+
+SetLimits - Sets the limits on each lane.
+
+SYNOPSIS
+
+void LaneEmulator::SetLimits(long long a_steps, long long a_milliseconds, long long a_outputBytes);
+
+a_steps - the most instructions that a lane may execute.
+
+a_milliseconds - the longest the whole run may take.
+
+a_outputBytes - the most bytes that a lane may WRITE.
+
+DESCRIPTION
+
+The limits mean the same as they do for emulator::SetLimits.  Any of
+them may be emulator::NO_LIMIT.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void LaneEmulator::SetLimits(long long a_steps, long long a_milliseconds, long long a_outputBytes)
+{
+	m_stepLimit = a_steps;
+	m_timeLimit = a_milliseconds;
+	m_outputLimit = a_outputBytes;
+}
+
+
+
+/*
+NAME
+
+Run - Runs one program over several inputs in lockstep.
+
+SYNOPSIS
+
+void LaneEmulator::Run(const emulator &a_program, int a_startLocation, Lane *a_lanes, int a_count, emulator &a_scalar);
+
+a_program - an emulator the program has been loaded into.
+
+a_startLocation - the address where the first instruction is located.
+
+a_lanes - the lanes to run; their status and steps are filled in.
+
+a_count - the number of lanes, at most LANES.
+
+a_scalar - an emulator used to finish lanes on their own.
+
+DESCRIPTION
+
+Each lane has its own accumulator, active location and column of memory.
+Every round the smallest active location of the running lanes is chosen
+and the instruction there is executed for all the lanes at that location
+at once; lanes whose branches went elsewhere are masked off until the
+others catch up with them, where they merge again.  The arithmetic,
+loads, stores and branches work on all the lanes at once in a
+LaneVector, choosing the lanes taking part with a LaneMask instead of
+testing each one: one AVX2 or AVX-512 instruction for all eight lanes
+where the program was compiled for them, plain loops otherwise.  DIVIDE,
+READ and WRITE are run a lane at a time.
+
+While all the running lanes are at the same location RunConverged runs
+them without masks.
+
+Anything unusual - an error, an invalid word, running off the end of
+memory - hands that lane to the scalar emulator, which runs it to the
+end exactly as runProgram would and reports the error the same way.  If
+on average fewer than half the running lanes take part in each round, or
+a lane has been kept waiting for CHECK_INTERVAL rounds, the lanes have
+diverged too far to gain anything and all of them are finished by the
+scalar emulator.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void LaneEmulator::Run(const emulator &a_program, int a_startLocation, Lane *a_lanes, int a_count, emulator &a_scalar)
+{
+	m_program = &a_program;
+	m_lanes = a_lanes;
+	m_scalar = &a_scalar;
+	m_scalarCount = 0;
+	m_startTime = NowMilliseconds();
+
+	const int *words = a_program.GetMemory();
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		for (int lane = 0; lane < LANES; lane++) {
+			m_memory[i][lane] = words[i];
+		}
+
+		// The program decoded its words from the text they were loaded with.
+		// Words that cannot be run decode to 0, sending them to the general loop.
+		const emulator::DecodedInstruction &decoded = a_program.m_decoded[i];
+		bool valid = decoded.handler >= emulator::DH_Add && decoded.handler <= emulator::DH_Halt;
+		m_decoded[i].handler = (unsigned short)(valid ? decoded.handler : 0);
+		m_decoded[i].address = (unsigned short)(valid ? decoded.address : 0);
+		m_written[i] = 0;
+	}
+	for (int lane = 0; lane < LANES; lane++) {
+		m_accumulator[lane] = 0;
+		m_location[lane] = a_startLocation;
+		m_steps[lane] = 0;
+		m_outputCount[lane] = 0;
+		m_active[lane] = lane < a_count;
+	}
+
+	// Let the emulator report the missing start location.
+	if (a_startLocation == -1) {
+		for (int lane = 0; lane < a_count; lane++) {
+			RunScalar(lane);
+		}
+		return;
+	}
+
+	long long rounds = 0;
+	long long nextCheck = CHECK_INTERVAL;
+	long long executed = 0;		// Lane instructions executed since the last check.
+	long long activeSum = 0;	// Lanes running, summed over the rounds since the last check.
+	long long checkSteps[LANES];// The steps of each lane at the last check.
+
+	for (int lane = 0; lane < LANES; lane++) {
+		checkSteps[lane] = 0;
+	}
+
+	for (;;) {
+		// Find the smallest location of the running lanes.
+		int location = emulator::MEMSZ;
+		int activeCount = 0;
+		for (int lane = 0; lane < LANES; lane++) {
+			if (m_active[lane]) {
+				activeCount++;
+				if (m_location[lane] < location) {
+					location = m_location[lane];
+				}
+			}
+		}
+		if (activeCount == 0) {
+			return;
+		}
+
+		// Most of the time the lanes are together.
+		bool together = true;
+		for (int lane = 0; lane < LANES; lane++) {
+			if (m_active[lane] && m_location[lane] != location) {
+				together = false;
+			}
+		}
+		if (together) {
+			long long count = RunConverged(location);
+			if (count > 0) {
+				rounds += count;
+				executed += count * activeCount;
+				activeSum += count * activeCount;
+				continue;
+			}
+		}
+
+		if (++rounds >= nextCheck) {
+			nextCheck = rounds + CHECK_INTERVAL;
+			if (m_timeLimit != emulator::NO_LIMIT && NowMilliseconds() - m_startTime >= m_timeLimit) {
+				for (int lane = 0; lane < LANES; lane++) {
+					if (m_active[lane]) {
+						StopLane(lane, emulator::RS_TimeLimit);
+					}
+				}
+				return;
+			}
+			// A lane that has not run at all is waiting on one that may never
+			// get past it.
+			bool starved = false;
+			for (int lane = 0; lane < LANES; lane++) {
+				if (m_active[lane] && m_steps[lane] == checkSteps[lane]) {
+					starved = true;
+				}
+				checkSteps[lane] = m_steps[lane];
+			}
+			if (executed * 2 < activeSum || activeCount == 1 || starved) {
+				for (int lane = 0; lane < LANES; lane++) {
+					if (m_active[lane]) {
+						RunScalar(lane);
+					}
+				}
+				return;
+			}
+			executed = 0;
+			activeSum = 0;
+		}
+		activeSum += activeCount;
+
+		int mask = 0;		// A bit for each lane taking part in this round.
+		for (int lane = 0; lane < LANES; lane++) {
+			mask |= (m_active[lane] && m_location[lane] == location) << lane;
+		}
+		// The lane whose word is run this round; taken in turn so that lanes
+		// whose words differ all get to run.
+		int lead = (int)(rounds % LANES);
+		while (((mask >> lead) & 1) == 0) {
+			lead = (lead + 1) % LANES;
+		}
+		if (location >= emulator::MEMSZ) {
+			for (int lane = 0; lane < LANES; lane++) {
+				if ((mask >> lane) & 1) {
+					RunScalar(lane);
+				}
+			}
+			continue;
+		}
+
+		// A lane that stored into its own code may hold a different word here,
+		// or one decoded differently from the same number; it waits for a
+		// later round, since its location stays the smallest.
+		const int *here = m_memory[location];
+		int word = here[lead];
+		int leadWritten = (m_written[location] >> lead) & 1;
+		mask &= LaneBits(LaneEqual(LaneLoad(here), LaneSplat(word)));
+		mask &= leadWritten != 0 ? m_written[location] : ~m_written[location];
+		if (m_stepLimit != emulator::NO_LIMIT) {
+			for (int lane = 0; lane < LANES; lane++) {
+				if (((mask >> lane) & 1) && m_steps[lane] >= m_stepLimit) {
+					StopLane(lane, emulator::RS_StepLimit);
+					mask &= ~(1 << lane);
+				}
+			}
+		}
+
+		// Decode as emulator::DecodeLocation does, a stored word by its number;
+		// anything it would not run goes to the scalar emulator so the error
+		// is the same.
+		int opcode = m_decoded[location].handler;
+		int address = m_decoded[location].address;
+		if (leadWritten != 0) {
+			opcode = word / 10000;
+			address = word % 10000;
+			if (!OpCodeTable::IsMachineCode(opcode) || address < 0) {
+				opcode = 0;
+			}
+		}
+		if (opcode == 0) {
+			for (int lane = 0; lane < LANES; lane++) {
+				if ((mask >> lane) & 1) {
+					RunScalar(lane);
+				}
+			}
+			continue;
+		}
+		int *operand = m_memory[address];
+		LaneVector operands = LaneLoad(operand);
+		LaneVector acc = LaneLoad(m_accumulator);
+		LaneVector locations = LaneLoad(m_location);
+
+		// The lanes this instruction would fail in are finished on their own.
+		int fails = 0;
+		switch (opcode) {
+		case emulator::DH_Divide:
+			fails = LaneBits(LaneEqual(operands, LaneSplat(0)));
+			break;
+		case emulator::DH_Load:
+			fails = LaneBits(OutsideValues(operands));
+			break;
+		case emulator::DH_Store:
+			fails = LaneBits(OutsideValues(acc));
+			break;
+		}
+		fails &= mask;
+		for (int lane = 0; lane < LANES; lane++) {
+			if ((fails >> lane) & 1) {
+				RunScalar(lane);
+			}
+		}
+		mask &= ~fails;
+
+		for (int lane = 0; lane < LANES; lane++) {
+			m_steps[lane] += (mask >> lane) & 1;
+			executed += (mask >> lane) & 1;
+		}
+
+		LaneMask lanes = LaneMaskFromBits(mask);
+		switch (opcode) {
+		case emulator::DH_Add:
+			LaneStore(m_accumulator, LaneSelect(lanes, LaneAdd(acc, operands), acc));
+			break;
+		case emulator::DH_Sub:
+			LaneStore(m_accumulator, LaneSelect(lanes, LaneSubtract(acc, operands), acc));
+			break;
+		case emulator::DH_Multiply:
+			LaneStore(m_accumulator, LaneSelect(lanes, LaneMultiply(acc, operands), acc));
+			break;
+		case emulator::DH_Divide:
+			// There is no vector instruction for dividing integers.
+			for (int lane = 0; lane < LANES; lane++) {
+				if ((mask >> lane) & 1) {
+					m_accumulator[lane] /= operand[lane];
+				}
+			}
+			break;
+		case emulator::DH_Load:
+			LaneStore(m_accumulator, LaneSelect(lanes, operands, acc));
+			break;
+		case emulator::DH_Store:
+			LaneStore(operand, LaneSelect(lanes, acc, operands));
+			m_written[address] |= (unsigned char)mask;
+			break;
+		case emulator::DH_Read:
+			for (int lane = 0; lane < LANES; lane++) {
+				if ((mask >> lane) & 1) {
+					ReadLane(lane, address);
+				}
+			}
+			continue;
+		case emulator::DH_Write:
+			for (int lane = 0; lane < LANES; lane++) {
+				if ((mask >> lane) & 1) {
+					WriteLane(lane, address);
+				}
+			}
+			continue;
+		case emulator::DH_Branch:
+			LaneStore(m_location, LaneSelect(lanes, LaneSplat(address), locations));
+			continue;
+		case emulator::DH_BranchMinus:
+		case emulator::DH_BranchZero:
+		case emulator::DH_BranchPositive: {
+			LaneVector zero = LaneSplat(0);
+			LaneMask taken = opcode == emulator::DH_BranchMinus ? LaneGreater(zero, acc)
+				: opcode == emulator::DH_BranchZero ? LaneEqual(acc, zero) : LaneGreater(acc, zero);
+			LaneVector target = LaneSelect(taken, LaneSplat(address), LaneAdd(locations, LaneSplat(1)));
+			LaneStore(m_location, LaneSelect(lanes, target, locations));
+			continue;
+		}
+		case emulator::DH_Halt:
+			for (int lane = 0; lane < LANES; lane++) {
+				if ((mask >> lane) & 1) {
+					StopLane(lane, emulator::RS_Halted);
+				}
+			}
+			continue;
+		}
+
+		// Everything else goes on to the next location.
+		LaneStore(m_location, LaneSelect(lanes, LaneAdd(locations, LaneSplat(1)), locations));
+	}
+}
+
+
+
+/*
+NAME
+
+RunConverged - Runs the lanes while they are all at one location.
+
+SYNOPSIS
+
+long long LaneEmulator::RunConverged(int a_location);
+
+a_location - the location of every running lane.
+
+DESCRIPTION
+
+With every running lane at the same location there is no need for masks
+or for finding the next location: the instructions are run for all the
+lanes at once, including the stopped ones, whose state no longer
+matters.  It returns, with each lane's location brought up to date, as
+soon as the lanes could part or something needs the general loop in Run:
+a branch that not all lanes take, a READ that some lanes reject, a word
+that differs between lanes or cannot be run, an instruction that would
+fail in some lane, or CHECK_INTERVAL instructions, so the limits are
+checked.  The instruction that made it return is not run.
+
+RETURNS
+
+The number of instructions run by each lane.
+
+AUTHOR
+
+Charles Snyder
+*/
+long long LaneEmulator::RunConverged(int a_location)
+{
+	int runningBits = 0;	// A bit for each running lane, as in m_written.
+	int lead = -1;
+	long long budget = CHECK_INTERVAL;
+	for (int lane = 0; lane < LANES; lane++) {
+		if (m_active[lane]) {
+			runningBits |= 1 << lane;
+			if (lead == -1) {
+				lead = lane;
+			}
+			if (m_stepLimit != emulator::NO_LIMIT && m_stepLimit - m_steps[lane] < budget) {
+				budget = m_stepLimit - m_steps[lane];
+			}
+		}
+	}
+	LaneMask running = LaneMaskFromBits(runningBits);
+
+	// The accumulators are kept in a register, which no store into memory
+	// can change.
+	LaneVector acc = LaneLoad(m_accumulator);
+
+	int loc = a_location;
+	long long total = 0;	// Instructions run by each lane.
+	long long count = 0;	// Of those, the ones not yet added to m_steps.
+	bool parted = false;	// The lanes' own locations are already set.
+	while (count < budget && loc < emulator::MEMSZ) {
+		int opcode = m_decoded[loc].handler;
+		int address = m_decoded[loc].address;
+		int written = m_written[loc] & runningBits;
+		if (written != 0) {
+			const int *here = m_memory[loc];
+			int word = here[lead];
+			bool differs = LaneAny(LaneAndNot(running, LaneEqual(LaneLoad(here), LaneSplat(word))));
+			opcode = word / 10000;
+			address = word % 10000;
+			if (differs || written != runningBits || opcode > OC_Halt || address < 0) {
+				break;
+			}
+		}
+		if (opcode < 1) {
+			break;
+		}
+		int *operand = m_memory[address];
+		LaneVector operands = LaneLoad(operand);
+
+		// Leave anything that would fail in some lane to the general loop.
+		bool fails = false;
+		if (opcode == emulator::DH_Divide) {
+			fails = LaneAny(LaneAnd(running, LaneEqual(operands, LaneSplat(0))));
+		}
+		else if (opcode == emulator::DH_Load) {
+			fails = LaneAny(LaneAnd(running, OutsideValues(operands)));
+		}
+		else if (opcode == emulator::DH_Store) {
+			fails = LaneAny(LaneAnd(running, OutsideValues(acc)));
+		}
+		if (fails) {
+			break;
+		}
+
+		if (opcode == emulator::DH_Read || opcode == emulator::DH_Write || opcode == emulator::DH_Halt
+			|| opcode >= emulator::DH_BranchMinus) {
+			// These look at each lane, so bring the lanes up to date first.
+			LaneStore(m_accumulator, acc);
+			for (int lane = 0; lane < LANES; lane++) {
+				if (m_active[lane]) {
+					m_location[lane] = loc;
+					m_steps[lane] += count + 1;
+				}
+			}
+			count++;
+			total++;
+			parted = true;
+
+			int taken = 0;
+			int active = 0;
+			for (int lane = 0; lane < LANES; lane++) {
+				if (!m_active[lane]) {
+					continue;
+				}
+				active++;
+				switch (opcode) {
+				case emulator::DH_Read:
+					ReadLane(lane, address);
+					taken += m_location[lane] == loc + 1;
+					break;
+				case emulator::DH_Write:
+					WriteLane(lane, address);
+					break;
+				case emulator::DH_Halt:
+					StopLane(lane, emulator::RS_Halted);
+					break;
+				default: {
+					int value = m_accumulator[lane];
+					bool branch = opcode == emulator::DH_BranchMinus ? value < 0
+						: opcode == emulator::DH_BranchZero ? value == 0 : value > 0;
+					m_location[lane] = branch ? address : loc + 1;
+					taken += branch;
+					break;
+				}
+				}
+			}
+			if (opcode == emulator::DH_Halt || (opcode == emulator::DH_Read && taken != active)
+				|| (opcode >= emulator::DH_BranchMinus && taken != 0 && taken != active)) {
+				return total;
+			}
+			if (opcode == emulator::DH_Read || opcode == emulator::DH_Write) {
+				runningBits = 0;
+				for (int lane = 0; lane < LANES; lane++) {
+					runningBits |= m_active[lane] << lane;
+				}
+				running = LaneMaskFromBits(runningBits);
+				if (!m_active[lead]) {
+					return total;
+				}
+			}
+			loc = opcode >= emulator::DH_BranchMinus && taken != 0 ? address : loc + 1;
+
+			// The lanes are counted from here on again.
+			budget -= count;
+			count = 0;
+			parted = false;
+			continue;
+		}
+
+		switch (opcode) {
+		case emulator::DH_Add:
+			acc = LaneAdd(acc, operands);
+			break;
+		case emulator::DH_Sub:
+			acc = LaneSubtract(acc, operands);
+			break;
+		case emulator::DH_Multiply:
+			acc = LaneMultiply(acc, operands);
+			break;
+		case emulator::DH_Divide: {
+			// There is no vector instruction for dividing integers.
+			int values[LANES];
+			LaneStore(values, acc);
+			for (int lane = 0; lane < LANES; lane++) {
+				if ((runningBits >> lane) & 1) {
+					values[lane] /= operand[lane];
+				}
+			}
+			acc = LaneLoad(values);
+			break;
+		}
+		case emulator::DH_Load:
+			acc = operands;
+			break;
+		case emulator::DH_Store:
+			LaneStore(operand, acc);
+			m_written[address] = ALL_LANES;
+			break;
+		case emulator::DH_Branch:
+			loc = address - 1;
+			break;
+		}
+		loc++;
+		count++;
+		total++;
+	}
+
+	LaneStore(m_accumulator, acc);
+	for (int lane = 0; lane < LANES; lane++) {
+		if (m_active[lane] && !parted) {
+			m_location[lane] = loc;
+			m_steps[lane] += count;
+		}
+	}
+	return total;
+}
+
+
+
+/*
+NAME
+
+StopLane - Stops a lane.
+
+SYNOPSIS
+
+void LaneEmulator::StopLane(int a_lane, emulator::RunStatus a_status);
+
+a_lane - the lane to stop.
+
+a_status - why it stopped.
+
+DESCRIPTION
+
+Records the status and steps of the lane and takes it out of the rounds.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void LaneEmulator::StopLane(int a_lane, emulator::RunStatus a_status)
+{
+	m_lanes[a_lane].status = a_status;
+	m_lanes[a_lane].steps = m_steps[a_lane];
+	m_active[a_lane] = false;
+}
+
+
+
+/*
+NAME
+
+RunScalar - Runs the rest of a lane on the scalar emulator.
+
+SYNOPSIS
+
+void LaneEmulator::RunScalar(int a_lane);
+
+a_lane - the lane to finish.
+
+DESCRIPTION
+
+Loads the lane into the scalar emulator and runs it from the lane's
+active location with what is left of the limits.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void LaneEmulator::RunScalar(int a_lane)
+{
+	LoadScalar(a_lane);
+	ResumeScalar(a_lane);
+}
+
+
+
+/*
+NAME
+
+LoadScalar - Puts a lane's memory and accumulator into the scalar emulator.
+
+SYNOPSIS
+
+void LaneEmulator::LoadScalar(int a_lane);
+
+a_lane - the lane to load.
+
+DESCRIPTION
+
+Starts from the program as it was loaded, so the words the lane has not
+written keep the text they are shown and decoded with, and puts in the
+words the lane has stored or read as their numbers.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void LaneEmulator::LoadScalar(int a_lane)
+{
+	m_scalar->LoadFrom(*m_program);
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		if ((m_written[i] >> a_lane) & 1) {
+			m_scalar->SetWord(i, m_memory[i][a_lane]);
+		}
+	}
+	m_scalar->accumulator = m_accumulator[a_lane];
+}
+
+
+
+/*
+NAME
+
+ResumeScalar - Runs the lane loaded into the scalar emulator.
+
+SYNOPSIS
+
+void LaneEmulator::ResumeScalar(int a_lane);
+
+a_lane - the lane loaded by LoadScalar.
+
+DESCRIPTION
+
+Runs the scalar emulator from the lane's active location with what is
+left of the limits, and stops the lane with the status it ends with.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void LaneEmulator::ResumeScalar(int a_lane)
+{
+	Lane &lane = m_lanes[a_lane];
+	m_scalarCount++;
+
+	long long steps = emulator::NO_LIMIT;
+	if (m_stepLimit != emulator::NO_LIMIT) {
+		steps = m_stepLimit > m_steps[a_lane] ? m_stepLimit - m_steps[a_lane] : 0;
+	}
+	long long milliseconds = emulator::NO_LIMIT;
+	if (m_timeLimit != emulator::NO_LIMIT) {
+		milliseconds = m_timeLimit - (NowMilliseconds() - m_startTime);
+		if (milliseconds < 0) {
+			milliseconds = 0;
+		}
+	}
+	long long outputBytes = emulator::NO_LIMIT;
+	if (m_outputLimit != emulator::NO_LIMIT) {
+		outputBytes = m_outputLimit - m_outputCount[a_lane];
+	}
+
+	istringstream noInput;
+	m_scalar->SetIO(noInput, *lane.output, false);
+	m_scalar->SetInputBuffer(lane.inputNext, lane.inputEnd);
+	m_scalar->SetLimits(steps, milliseconds, outputBytes);
+	emulator::RunStatus status = m_scalar->runProgram(m_location[a_lane]);
+	m_steps[a_lane] += m_scalar->GetStepCount();
+	StopLane(a_lane, status);
+}
+
+
+
+/*
+NAME
+
+ReadLane - Runs a READ for one lane.
+
+SYNOPSIS
+
+void LaneEmulator::ReadLane(int a_lane, int a_address);
+
+a_lane - the lane.
+
+a_address - the address to read into.
+
+DESCRIPTION
+
+Takes the next white space separated value from the lane's input exactly
+as emulator::ExecuteRead does from its buffer, never prompting.  Invalid input leaves the lane at the READ to try again.  A
+value read as anything but its number, such as "007", is to be shown as
+it was typed, which only the scalar emulator keeps, so the lane is
+finished there.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void LaneEmulator::ReadLane(int a_lane, int a_address)
+{
+	Lane &lane = m_lanes[a_lane];
+	while (lane.inputNext < lane.inputEnd && isspace((unsigned char)*lane.inputNext)) {
+		lane.inputNext++;
+	}
+	const char *begin = lane.inputNext;
+	while (lane.inputNext < lane.inputEnd && !isspace((unsigned char)*lane.inputNext)) {
+		lane.inputNext++;
+	}
+	const char *end = lane.inputNext;
+	int value;
+	if (!emulator::ParseInput(begin, end, value)) {
+		*lane.output << "Invalid input" << endl;
+		return;
+	}
+	m_memory[a_address][a_lane] = value;
+	m_location[a_lane]++;
+
+	if (end - begin > emulator::INPUT_SIZE) {
+		end = begin + emulator::INPUT_SIZE;
+	}
+	if (emulator::IsPlainNumber(begin, end, value)) {
+		m_written[a_address] |= (unsigned char)(1 << a_lane);
+		return;
+	}
+	LoadScalar(a_lane);
+	m_scalar->SetText(a_address, value, begin, end);
+	m_scalar->DecodeLocation(a_address);
+	ResumeScalar(a_lane);
+}
+
+
+
+/*
+NAME
+
+WriteLane - Runs a WRITE for one lane.
+
+SYNOPSIS
+
+void LaneEmulator::WriteLane(int a_lane, int a_address);
+
+a_lane - the lane.
+
+a_address - the address to write.
+
+DESCRIPTION
+
+Writes to the lane's output exactly as emulator::ExecuteWrite does, and
+stops the lane once it is over the output limit.  A word the lane has
+not written is shown as the program was loaded with it.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void LaneEmulator::WriteLane(int a_lane, int a_address)
+{
+	string text = (m_written[a_address] >> a_lane) & 1 ? emulator::FormatWord(m_memory[a_address][a_lane])
+		: m_program->FormatLocation(a_address);
+	*m_lanes[a_lane].output << text << endl;
+	m_location[a_lane]++;
+
+	m_outputCount[a_lane] += text.length() + 1;
+	if (m_outputLimit != emulator::NO_LIMIT && m_outputCount[a_lane] > m_outputLimit) {
+		StopLane(a_lane, emulator::RS_OutputLimit);
+	}
+}
@@ -0,0 +1,101 @@
+//
+//		LaneEmulator class - runs copies of one program over many inputs in lockstep.
+//
+#ifndef _LANEEMULATOR_H
+#define _LANEEMULATOR_H
+
+#include "Emulator.h"
+#include "LaneVector.h"
+
+class LaneEmulator {
+
+public:
+
+	// Copies run side by side, one in each word of a vector register.
+	const static int LANES = LANE_COUNT;
+
+	// One copy of the program: the unread part of its input, such as a
+	// mapped file, where its WRITE goes, and how it ended.
+	struct Lane {
+		const char *inputNext;
+		const char *inputEnd;
+		ostream *output;
+		emulator::RunStatus status;
+		long long steps;
+	};
+
+	LaneEmulator();
+	~LaneEmulator();
+
+	// Sets the step, time (in milliseconds) and output (in bytes) limits of each lane.
+	void SetLimits(long long a_steps, long long a_milliseconds, long long a_outputBytes);
+
+	// Runs the program in a_program once for each of the a_count lanes.
+	void Run(const emulator &a_program, int a_startLocation, Lane *a_lanes, int a_count, emulator &a_scalar);
+
+	// The number of lanes that were finished by the scalar emulator.
+	int GetScalarCount() { return m_scalarCount; }
+
+private:
+
+	// Divergence is measured over this many rounds.
+	const static int CHECK_INTERVAL = 4096;
+
+	// Accumulator values that can be loaded and stored.
+	const static int MAX_VALUE = 999999;
+
+	// The lanes holding words that cannot be loaded or stored.
+	static LaneMask OutsideValues(LaneVector a_words) {
+		return LaneOr(LaneGreater(a_words, LaneSplat(MAX_VALUE)), LaneGreater(LaneSplat(-MAX_VALUE), a_words));
+	}
+
+	// One word for each lane at every location: m_memory[location][lane].
+	int (*m_memory)[LANES];
+
+	// The program as loaded, decoded, and a bit for each lane that has
+	// stored or read into a location since, after which the lanes may no
+	// longer agree on it and the word is shown as its number.
+	const emulator *m_program;
+	emulator::DecodedInstruction m_decoded[emulator::MEMSZ];
+	unsigned char m_written[emulator::MEMSZ];
+	const static int ALL_LANES = (1 << LANES) - 1;
+
+	int m_accumulator[LANES];		// The accumulator of each lane.
+	int m_location[LANES];			// The active location of each lane.
+	long long m_steps[LANES];		// Instructions executed by each lane.
+	long long m_outputCount[LANES];	// Bytes written by each lane.
+	bool m_active[LANES];			// False once a lane has stopped.
+
+	Lane *m_lanes;					// The lanes of the current run.
+	emulator *m_scalar;				// Finishes lanes that cannot run in lockstep.
+	long long m_startTime;			// When the current run started.
+	int m_scalarCount;
+
+	// Limits on each lane; emulator::NO_LIMIT if there is none.
+	long long m_stepLimit;
+	long long m_timeLimit;
+	long long m_outputLimit;
+
+	// Runs instructions while all the running lanes are at one location.
+	long long RunConverged(int a_location);
+
+	// Stops a lane with the given status.
+	void StopLane(int a_lane, emulator::RunStatus a_status);
+
+	// Runs the rest of a lane on the scalar emulator.
+	void RunScalar(int a_lane);
+
+	// Puts a lane's memory and accumulator into the scalar emulator.
+	void LoadScalar(int a_lane);
+
+	// Runs the lane loaded into the scalar emulator from its active location.
+	void ResumeScalar(int a_lane);
+
+	// Runs a READ for one lane.
+	void ReadLane(int a_lane, int a_address);
+
+	// Runs a WRITE for one lane.
+	void WriteLane(int a_lane, int a_address);
+};
+
+#endif
@@ -0,0 +1,235 @@
+//
+//		LaneVector - the words of the lanes of a LaneEmulator, held in one vector register.
+//
+#ifndef _LANEVECTOR_H
+#define _LANEVECTOR_H
+
+// The instructions the lanes are run with, chosen when the program is
+// compiled, as the JIT is: AVX-512, whose mask registers select lanes
+// without blending, or AVX2, where the compiler may use them (/arch:AVX512
+// or /arch:AVX2, -mavx512vl or -mavx2, as the Release build is); otherwise
+// plain loops over the lanes, which run the same on any processor.
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+#define LANE_VECTORS 512
+#elif defined(__AVX2__)
+#define LANE_VECTORS 256
+#else
+#define LANE_VECTORS 0
+#endif
+
+#if LANE_VECTORS
+#include <immintrin.h>
+#endif
+
+// The number of lanes, one 32 bit word each, that fill a 256 bit register.
+const int LANE_COUNT = 8;
+
+// A word for each lane.
+struct LaneVector {
+#if LANE_VECTORS
+	__m256i v;
+#else
+	int v[LANE_COUNT];
+#endif
+};
+
+// A choice of lanes.  AVX-512 keeps it in a mask register, AVX2 as a
+// vector with every bit set in the lanes chosen, and the loops as a bit
+// for each lane.
+#if LANE_VECTORS == 512
+typedef __mmask8 LaneMask;
+#elif LANE_VECTORS == 256
+struct LaneMask {
+	__m256i v;
+};
+#else
+typedef int LaneMask;
+#endif
+
+// Loads and stores the words of the lanes; a_words need not be aligned.
+inline LaneVector LaneLoad(const int *a_words)
+{
+	LaneVector result;
+#if LANE_VECTORS
+	result.v = _mm256_loadu_si256((const __m256i *)a_words);
+#else
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		result.v[lane] = a_words[lane];
+	}
+#endif
+	return result;
+}
+inline void LaneStore(int *a_words, LaneVector a_value)
+{
+#if LANE_VECTORS
+	_mm256_storeu_si256((__m256i *)a_words, a_value.v);
+#else
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		a_words[lane] = a_value.v[lane];
+	}
+#endif
+}
+
+// The same word in every lane.
+inline LaneVector LaneSplat(int a_word)
+{
+	LaneVector result;
+#if LANE_VECTORS
+	result.v = _mm256_set1_epi32(a_word);
+#else
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		result.v[lane] = a_word;
+	}
+#endif
+	return result;
+}
+
+// Arithmetic in each lane, wrapping around as the scalar emulator's does.
+inline LaneVector LaneAdd(LaneVector a_left, LaneVector a_right)
+{
+#if LANE_VECTORS
+	a_left.v = _mm256_add_epi32(a_left.v, a_right.v);
+#else
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		a_left.v[lane] = (int)((unsigned)a_left.v[lane] + (unsigned)a_right.v[lane]);
+	}
+#endif
+	return a_left;
+}
+inline LaneVector LaneSubtract(LaneVector a_left, LaneVector a_right)
+{
+#if LANE_VECTORS
+	a_left.v = _mm256_sub_epi32(a_left.v, a_right.v);
+#else
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		a_left.v[lane] = (int)((unsigned)a_left.v[lane] - (unsigned)a_right.v[lane]);
+	}
+#endif
+	return a_left;
+}
+inline LaneVector LaneMultiply(LaneVector a_left, LaneVector a_right)
+{
+#if LANE_VECTORS
+	a_left.v = _mm256_mullo_epi32(a_left.v, a_right.v);
+#else
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		a_left.v[lane] = (int)((unsigned)a_left.v[lane] * (unsigned)a_right.v[lane]);
+	}
+#endif
+	return a_left;
+}
+
+// The lanes where a_left is equal to or greater than a_right.
+inline LaneMask LaneEqual(LaneVector a_left, LaneVector a_right)
+{
+#if LANE_VECTORS == 512
+	return _mm256_cmpeq_epi32_mask(a_left.v, a_right.v);
+#elif LANE_VECTORS == 256
+	LaneMask result;
+	result.v = _mm256_cmpeq_epi32(a_left.v, a_right.v);
+	return result;
+#else
+	LaneMask result = 0;
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		result |= (a_left.v[lane] == a_right.v[lane]) << lane;
+	}
+	return result;
+#endif
+}
+inline LaneMask LaneGreater(LaneVector a_left, LaneVector a_right)
+{
+#if LANE_VECTORS == 512
+	return _mm256_cmpgt_epi32_mask(a_left.v, a_right.v);
+#elif LANE_VECTORS == 256
+	LaneMask result;
+	result.v = _mm256_cmpgt_epi32(a_left.v, a_right.v);
+	return result;
+#else
+	LaneMask result = 0;
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		result |= (a_left.v[lane] > a_right.v[lane]) << lane;
+	}
+	return result;
+#endif
+}
+
+// The lanes in both masks, in either, and in the first but not the second.
+inline LaneMask LaneAnd(LaneMask a_left, LaneMask a_right)
+{
+#if LANE_VECTORS == 256
+	a_left.v = _mm256_and_si256(a_left.v, a_right.v);
+	return a_left;
+#else
+	return (LaneMask)(a_left & a_right);
+#endif
+}
+inline LaneMask LaneOr(LaneMask a_left, LaneMask a_right)
+{
+#if LANE_VECTORS == 256
+	a_left.v = _mm256_or_si256(a_left.v, a_right.v);
+	return a_left;
+#else
+	return (LaneMask)(a_left | a_right);
+#endif
+}
+inline LaneMask LaneAndNot(LaneMask a_left, LaneMask a_right)
+{
+#if LANE_VECTORS == 256
+	a_left.v = _mm256_andnot_si256(a_right.v, a_left.v);
+	return a_left;
+#else
+	return (LaneMask)(a_left & ~a_right);
+#endif
+}
+
+// Converts between a mask and a bit for each lane, lane 0 the lowest.
+inline LaneMask LaneMaskFromBits(int a_bits)
+{
+#if LANE_VECTORS == 512
+	return (__mmask8)a_bits;
+#elif LANE_VECTORS == 256
+	const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	LaneMask result;
+	result.v = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(a_bits), bits), bits);
+	return result;
+#else
+	return a_bits & ((1 << LANE_COUNT) - 1);
+#endif
+}
+inline int LaneBits(LaneMask a_mask)
+{
+#if LANE_VECTORS == 256
+	return _mm256_movemask_ps(_mm256_castsi256_ps(a_mask.v));
+#else
+	return (int)a_mask;
+#endif
+}
+
+// Whether any lane is chosen.
+inline bool LaneAny(LaneMask a_mask)
+{
+#if LANE_VECTORS == 256
+	return !_mm256_testz_si256(a_mask.v, a_mask.v);
+#else
+	return a_mask != 0;
+#endif
+}
+
+// a_then in the chosen lanes and a_else in the others.
+inline LaneVector LaneSelect(LaneMask a_mask, LaneVector a_then, LaneVector a_else)
+{
+#if LANE_VECTORS == 512
+	a_else.v = _mm256_mask_mov_epi32(a_else.v, a_mask, a_then.v);
+#elif LANE_VECTORS == 256
+	a_else.v = _mm256_blendv_epi8(a_else.v, a_then.v, a_mask.v);
+#else
+	for (int lane = 0; lane < LANE_COUNT; lane++) {
+		if ((a_mask >> lane) & 1) {
+			a_else.v[lane] = a_then.v[lane];
+		}
+	}
+#endif
+	return a_else;
+}
+
+#endif
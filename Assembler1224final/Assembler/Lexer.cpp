@@ -0,0 +1,158 @@
+//
+//		Implementation of the Lexer class.
+//
+#include "stdafx.h"
+#include "Lexer.h"
+
+#define B Lexer::CC_Blank
+#define C Lexer::CC_Comment
+#define D Lexer::CC_Digit
+#define U Lexer::CC_Upper
+#define L Lexer::CC_Lower
+
+const unsigned char Lexer::CLASSES[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, B, B, B, B, B, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	B, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	D, D, D, D, D, D, D, D, D, D, 0, C, 0, 0, 0, 0,
+	0, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U,
+	U, U, U, U, U, U, U, U, U, U, U, 0, 0, 0, 0, 0,
+	0, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L,
+	L, L, L, L, L, L, L, L, L, L, L, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+#undef B
+#undef C
+#undef D
+#undef U
+#undef L
+
+
+
+/*
+NAME
+
+Split - Splits a line into its fields.
+
+SYNOPSIS
+
+static bool Lexer::Split(const char *a_line, size_t a_length, Fields &a_fields);
+
+a_line - the line, without its newline.
+
+a_length - the number of characters in a_line.
+
+a_fields - passed by reference, set to the fields of the line.
+
+DESCRIPTION
+
+Everything from the first ';' on is a comment and is dropped.  The rest
+is split at runs of blanks.  A line that does not start with a space or
+a tab has a label as its first field; the fields after it are the
+opcode, the operand and whatever follows the operand.  Only the first
+field after the operand is kept, as that is all that is needed to know
+the line has too many.
+
+RETURNS
+
+True if the line has any fields, false if it is blank or only a comment.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool Lexer::Split(const char *a_line, size_t a_length, Fields &a_fields)
+{
+	LineView empty = { a_line, 0 };
+	LineView fields[4] = { empty, empty, empty, empty };
+
+	a_fields.hasLabel = a_length != 0 && a_line[0] != ' ' && a_line[0] != '\t';
+	int wanted = a_fields.hasLabel ? 4 : 3;
+
+	int count = 0;
+	size_t start = 0;
+	bool inField = false;
+	size_t i = 0;
+	for (; i < a_length; i++) {
+		unsigned char classes = CLASSES[(unsigned char)a_line[i]];
+		if ((classes & CC_Comment) != 0) {
+			break;
+		}
+		if ((classes & CC_Blank) != 0) {
+			if (inField) {
+				fields[count].data = a_line + start;
+				fields[count].length = i - start;
+				inField = false;
+				if (++count == wanted) {
+					break;
+				}
+			}
+		}
+		else if (!inField) {
+			start = i;
+			inField = true;
+		}
+	}
+	if (inField) {
+		fields[count].data = a_line + start;
+		fields[count].length = i - start;
+		count++;
+	}
+
+	if (a_fields.hasLabel) {
+		a_fields.label = fields[0];
+		a_fields.opCode = fields[1];
+		a_fields.operand = fields[2];
+		a_fields.overflow = fields[3];
+	}
+	else {
+		a_fields.label = empty;
+		a_fields.opCode = fields[0];
+		a_fields.operand = fields[1];
+		a_fields.overflow = fields[2];
+	}
+	return count != 0;
+}
+
+
+
+/*
+NAME
+
+TrimmedLength - Finds where the trailing blanks of a line start.
+
+SYNOPSIS
+
+static size_t Lexer::TrimmedLength(const char *a_line, size_t a_length);
+
+a_line - the line.
+
+a_length - the number of characters in a_line.
+
+DESCRIPTION
+
+Steps back over the blanks at the end of the line.
+
+RETURNS
+
+The length of the line without its trailing blanks.
+
+AUTHOR
+
+Charles Snyder
+*/
+size_t Lexer::TrimmedLength(const char *a_line, size_t a_length)
+{
+	while (a_length != 0 && IsBlank(a_line[a_length - 1])) {
+		a_length--;
+	}
+	return a_length;
+}
@@ -0,0 +1,56 @@
+//
+//		Lexer class - splits a line of the source into its fields.
+//
+#ifndef _LEXER_H
+#define _LEXER_H
+
+#include "FileAccess.h"
+
+// Each byte of a line is looked up once in a table of its classes, so
+// splitting a line takes one pass, does not allocate and does not depend
+// on the locale.  The blanks are those isspace finds in the "C" locale,
+// which are the ones the fields were split at before.
+class Lexer {
+
+public:
+
+	// The classes a byte can be in.
+	enum CharClass {
+		CC_Blank = 1,	// Separates fields.
+		CC_Comment = 2,	// Starts a comment.
+		CC_Digit = 4,
+		CC_Upper = 8,
+		CC_Lower = 16
+	};
+
+	// The fields of a line, pointing into it.  A field the line does not
+	// have is empty.
+	struct Fields {
+		bool hasLabel;		// The line does not start with a blank.
+		LineView label;
+		LineView opCode;
+		LineView operand;
+		LineView overflow;	// The field after the operand, if any.
+	};
+
+	// Splits a line into its fields; false if it has none, being blank or
+	// only a comment.
+	static bool Split(const char *a_line, size_t a_length, Fields &a_fields);
+
+	// The length of a line without its trailing blanks.
+	static size_t TrimmedLength(const char *a_line, size_t a_length);
+
+	static bool IsBlank(char a_char) { return (CLASSES[(unsigned char)a_char] & CC_Blank) != 0; }
+	static bool IsDigit(char a_char) { return (CLASSES[(unsigned char)a_char] & CC_Digit) != 0; }
+	static bool IsAlpha(char a_char) { return (CLASSES[(unsigned char)a_char] & (CC_Upper | CC_Lower)) != 0; }
+	static char ToUpper(char a_char) {
+		return (CLASSES[(unsigned char)a_char] & CC_Lower) != 0 ? (char)(a_char - 'a' + 'A') : a_char;
+	}
+
+private:
+
+	// The classes of each byte.
+	static const unsigned char CLASSES[256];
+};
+
+#endif
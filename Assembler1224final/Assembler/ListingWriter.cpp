@@ -0,0 +1,658 @@
+//
+//  Implementation of the ListingWriter class.
+//
+#include "stdafx.h"
+#include "ListingWriter.h"
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#endif
+
+// The decimal digits of 0 to 99, two to a number.
+static const char DIGIT_PAIRS[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// The most characters an int takes in decimal.
+const static int NUMBER_SIZE = 12;
+
+/*
+NAME
+
+ToDecimal - Converts a number to decimal.
+
+SYNOPSIS
+
+static char *ToDecimal(int a_value, char *a_end);
+
+a_value - the number.
+
+a_end - the end of a buffer of at least NUMBER_SIZE characters.
+
+DESCRIPTION
+
+Writes the digits backwards from a_end, two at a time from DIGIT_PAIRS,
+with a minus sign in front of a negative number.
+
+RETURNS
+
+Where the number starts.
+
+AUTHOR
+
+Charles Snyder
+*/
+static char *ToDecimal(int a_value, char *a_end)
+{
+	unsigned int magnitude = a_value < 0 ? 0u - (unsigned int)a_value : (unsigned int)a_value;
+	char *start = a_end;
+	while (magnitude >= 100) {
+		unsigned int pair = (magnitude % 100) * 2;
+		magnitude /= 100;
+		*--start = DIGIT_PAIRS[pair + 1];
+		*--start = DIGIT_PAIRS[pair];
+	}
+	if (magnitude >= 10) {
+		*--start = DIGIT_PAIRS[magnitude * 2 + 1];
+		*--start = DIGIT_PAIRS[magnitude * 2];
+	}
+	else {
+		*--start = (char)('0' + magnitude);
+	}
+	if (a_value < 0) {
+		*--start = '-';
+	}
+	return start;
+}
+
+// Constructor discards the listing until SetStreams is called.
+ListingWriter::ListingWriter()
+{
+	m_listing = true;
+	m_listingStream = NULL;
+	m_errorStream = NULL;
+	m_listingFile = -1;
+	m_errorFile = -1;
+}
+
+
+
+/*
+NAME
+
+SetStreams - Sets the streams the listing and errors are written to.
+
+SYNOPSIS
+
+void ListingWriter::SetStreams(ostream *a_listing, ostream *a_errors);
+
+a_listing - the stream for the listing, NULL to discard it.
+
+a_errors - the stream for the errors, NULL to discard them.
+
+DESCRIPTION
+
+Any file descriptors set before are forgotten.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::SetStreams(ostream *a_listing, ostream *a_errors)
+{
+	m_listingStream = a_listing;
+	m_errorStream = a_errors;
+	m_listingFile = -1;
+	m_errorFile = -1;
+}
+
+
+
+/*
+NAME
+
+SetDescriptors - Writes to file descriptors instead of the streams.
+
+SYNOPSIS
+
+void ListingWriter::SetDescriptors(int a_listing, int a_errors);
+
+a_listing - the file descriptor of the listing, such as 1.
+
+a_errors - the file descriptor of the errors, such as 2.
+
+DESCRIPTION
+
+The streams set by SetStreams are kept, to be flushed before each write
+so that what was written through them comes first.  Where there is no
+writev the streams go on being written to.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::SetDescriptors(int a_listing, int a_errors)
+{
+#ifndef _WIN32
+	m_listingFile = a_listing;
+	m_errorFile = a_errors;
+#endif
+}
+
+
+
+/*
+NAME
+
+CopyTargets - Writes where another writer does.
+
+SYNOPSIS
+
+void ListingWriter::CopyTargets(const ListingWriter &a_writer);
+
+a_writer - the writer to copy the streams, file descriptors and whether
+		   the listing is displayed from.
+
+DESCRIPTION
+
+Lets a part of the listing be collected on its own, such as by a thread,
+and written in its turn.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::CopyTargets(const ListingWriter &a_writer)
+{
+	m_listing = a_writer.m_listing;
+	m_listingStream = a_writer.m_listingStream;
+	m_errorStream = a_writer.m_errorStream;
+	m_listingFile = a_writer.m_listingFile;
+	m_errorFile = a_writer.m_errorFile;
+}
+
+
+
+/*
+NAME
+
+Write - Adds text to the listing.
+
+SYNOPSIS
+
+void ListingWriter::Write(const char *a_text, size_t a_length);
+
+a_text - the text, which is copied.
+
+a_length - the number of characters in a_text.
+
+DESCRIPTION
+
+Nothing is kept if the listing is not displayed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::Write(const char *a_text, size_t a_length)
+{
+	if (m_listing) {
+		Buffer(a_text, a_length, false);
+	}
+}
+
+
+
+/*
+NAME
+
+Write - Adds a character to the listing.
+
+SYNOPSIS
+
+void ListingWriter::Write(char a_char);
+
+a_char - the character.
+
+DESCRIPTION
+
+Nothing is kept if the listing is not displayed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::Write(char a_char)
+{
+	if (m_listing) {
+		Buffer(&a_char, 1, false);
+	}
+}
+
+
+
+/*
+NAME
+
+WriteNumber - Adds a number to the listing.
+
+SYNOPSIS
+
+void ListingWriter::WriteNumber(int a_value);
+
+a_value - the number.
+
+DESCRIPTION
+
+Writes the number in decimal, as ostream would, without going through
+a stream.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::WriteNumber(int a_value)
+{
+	if (m_listing) {
+		char digits[NUMBER_SIZE];
+		char *start = ToDecimal(a_value, digits + NUMBER_SIZE);
+		Buffer(start, digits + NUMBER_SIZE - start, false);
+	}
+}
+
+
+
+/*
+NAME
+
+WriteSource - Adds text to the listing without copying it.
+
+SYNOPSIS
+
+void ListingWriter::WriteSource(const char *a_text, size_t a_length);
+
+a_text - the text, such as a line of the mapped source.
+
+a_length - the number of characters in a_text.
+
+DESCRIPTION
+
+Only where the text is, is kept; it must not change or go away before
+the listing is flushed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::WriteSource(const char *a_text, size_t a_length)
+{
+	if (!m_listing || a_length == 0) {
+		return;
+	}
+	Piece piece;
+	piece.text = a_text;
+	piece.offset = 0;
+	piece.length = a_length;
+	piece.error = false;
+	m_pieces.push_back(piece);
+}
+
+
+
+/*
+NAME
+
+WriteError - Adds an error message.
+
+SYNOPSIS
+
+void ListingWriter::WriteError(const string &a_message);
+
+a_message - the message, as it is to be displayed.
+
+DESCRIPTION
+
+The message goes to the errors, in its place among the lines of the
+listing, whether or not the listing is displayed.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::WriteError(const string &a_message)
+{
+	Buffer(a_message.data(), a_message.size(), true);
+}
+
+
+
+/*
+NAME
+
+EndErrors - Ends the line of errors.
+
+SYNOPSIS
+
+void ListingWriter::EndErrors();
+
+DESCRIPTION
+
+The line of the listing the errors were for is ended.  If the listing is
+not displayed the errors themselves are ended with a new line instead,
+so that each line's errors are on a line of their own.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::EndErrors()
+{
+	Buffer("\n", 1, !m_listing);
+}
+
+
+
+/*
+NAME
+
+Flush - Writes out everything buffered.
+
+SYNOPSIS
+
+void ListingWriter::Flush();
+
+DESCRIPTION
+
+Writes the pieces in order, each run of pieces going to the same place
+at once, then empties the buffer.  When writing to file descriptors the
+streams are flushed first.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::Flush()
+{
+	if (m_listingFile != -1) {
+		if (m_listingStream != NULL) {
+			m_listingStream->flush();
+		}
+		if (m_errorStream != NULL) {
+			m_errorStream->flush();
+		}
+	}
+
+	int count = (int)m_pieces.size();
+	int first = 0;
+	while (first < count) {
+		int last = first + 1;
+		while (last < count && m_pieces[last].error == m_pieces[first].error) {
+			last++;
+		}
+		if (m_pieces[first].error) {
+			WritePieces(&m_pieces[first], last - first, m_errorStream, m_errorFile);
+		}
+		else {
+			WritePieces(&m_pieces[first], last - first, m_listingStream, m_listingFile);
+		}
+		first = last;
+	}
+	m_pieces.clear();
+	m_buffer.clear();
+}
+
+
+
+/*
+NAME
+
+FormatNumber - Formats a number padded with zeros.
+
+SYNOPSIS
+
+static void ListingWriter::FormatNumber(int a_value, int a_width, string &a_text);
+
+a_value - the number.
+
+a_width - the least number of characters it takes up.
+
+a_text - passed by reference, the number is appended to it.
+
+DESCRIPTION
+
+Zeros are put in front of the number, and any minus sign, until it is
+a_width characters long, as setw(a_width) and setfill('0') do.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::FormatNumber(int a_value, int a_width, string &a_text)
+{
+	char digits[NUMBER_SIZE];
+	char *start = ToDecimal(a_value, digits + NUMBER_SIZE);
+	int length = (int)(digits + NUMBER_SIZE - start);
+	if (length < a_width) {
+		a_text.append(a_width - length, '0');
+	}
+	a_text.append(start, length);
+}
+
+
+
+/*
+NAME
+
+FormatText - Formats text padded with zeros.
+
+SYNOPSIS
+
+static void ListingWriter::FormatText(const string &a_value, int a_width, string &a_text);
+
+a_value - the text.
+
+a_width - the least number of characters it takes up.
+
+a_text - passed by reference, the text is appended to it.
+
+DESCRIPTION
+
+Zeros are put in front of the text until it is a_width characters long.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::FormatText(const string &a_value, int a_width, string &a_text)
+{
+	if ((int)a_value.size() < a_width) {
+		a_text.append(a_width - a_value.size(), '0');
+	}
+	a_text.append(a_value);
+}
+
+
+
+/*
+NAME
+
+Buffer - Copies text into the buffer.
+
+SYNOPSIS
+
+void ListingWriter::Buffer(const char *a_text, size_t a_length, bool a_error);
+
+a_text - the text.
+
+a_length - the number of characters in a_text.
+
+a_error - true if the text goes to the errors.
+
+DESCRIPTION
+
+Text going to the same place as the last piece, when that piece is at
+the end of the buffer, is added to it rather than making a new piece.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::Buffer(const char *a_text, size_t a_length, bool a_error)
+{
+	if (a_length == 0) {
+		return;
+	}
+	if (m_pieces.empty() || m_pieces.back().text != NULL || m_pieces.back().error != a_error) {
+		Piece piece;
+		piece.text = NULL;
+		piece.offset = m_buffer.size();
+		piece.length = 0;
+		piece.error = a_error;
+		m_pieces.push_back(piece);
+	}
+	m_buffer.insert(m_buffer.end(), a_text, a_text + a_length);
+	m_pieces.back().length += a_length;
+}
+
+
+
+/*
+NAME
+
+WritePieces - Writes a run of pieces.
+
+SYNOPSIS
+
+void ListingWriter::WritePieces(const Piece *a_pieces, int a_count, ostream *a_stream, int a_file);
+
+a_pieces - the pieces.
+
+a_count - the number of pieces.
+
+a_stream - the stream to write them to, NULL to discard them.
+
+a_file - the file descriptor to write them to instead, -1 if none.
+
+DESCRIPTION
+
+With a file descriptor the pieces are gathered into as few writev calls
+as it takes, going on after a write that was cut short.  Otherwise each
+piece is written to the stream.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ListingWriter::WritePieces(const Piece *a_pieces, int a_count, ostream *a_stream, int a_file)
+{
+#ifndef _WIN32
+	if (a_file != -1) {
+#ifdef IOV_MAX
+		const int maxVectors = IOV_MAX;
+#else
+		const int maxVectors = 1024;
+#endif
+		vector<iovec> vectors(a_count);
+		for (int i = 0; i < a_count; i++) {
+			const char *text = a_pieces[i].text != NULL ? a_pieces[i].text : &m_buffer[a_pieces[i].offset];
+			vectors[i].iov_base = (void *)text;
+			vectors[i].iov_len = a_pieces[i].length;
+		}
+		int next = 0;
+		while (next < a_count) {
+			int batch = a_count - next < maxVectors ? a_count - next : maxVectors;
+			ssize_t written = writev(a_file, &vectors[next], batch);
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return;
+			}
+			while (next < a_count && (size_t)written >= vectors[next].iov_len) {
+				written -= vectors[next].iov_len;
+				next++;
+			}
+			if (written > 0) {
+				vectors[next].iov_base = (char *)vectors[next].iov_base + written;
+				vectors[next].iov_len -= written;
+			}
+		}
+		return;
+	}
+#endif
+	if (a_stream == NULL) {
+		return;
+	}
+	for (int i = 0; i < a_count; i++) {
+		const char *text = a_pieces[i].text != NULL ? a_pieces[i].text : &m_buffer[a_pieces[i].offset];
+		a_stream->write(text, a_pieces[i].length);
+	}
+	a_stream->flush();
+}
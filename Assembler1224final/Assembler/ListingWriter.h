@@ -0,0 +1,100 @@
+//
+//		ListingWriter class - collects the listing and its errors and writes them in large pieces.
+//
+#ifndef _LISTINGWRITER_H
+#define _LISTINGWRITER_H
+
+// The listing is kept as a list of pieces, each going to the listing or
+// to the errors.  Text that is formatted is copied into a buffer the
+// writer owns; the original statements are not copied but referred to
+// where they are, in the mapped source, so they must stay put until the
+// listing is flushed.  Flush writes the pieces in order, with writev when
+// the writer is writing to file descriptors, so a line's errors still
+// appear right after it.
+class ListingWriter {
+
+public:
+
+	// Bytes buffered before FlushIfFull writes them.
+	const static int FLUSH_BYTES = 1 << 20;
+
+	// Pieces buffered before FlushIfFull writes them.
+	const static int FLUSH_PIECES = 1 << 14;
+
+	// Makes a writer that discards everything until it is given somewhere to write.
+	ListingWriter();
+
+	// Writes the listing to a_listing and the errors to a_errors.
+	void SetStreams(ostream *a_listing, ostream *a_errors);
+
+	// Writes straight to file descriptors instead, after flushing the
+	// streams given to SetStreams, which write to the same files.  Streams
+	// are used where there is no writev.
+	void SetDescriptors(int a_listing, int a_errors);
+
+	// Whether the listing is displayed; the errors always are.
+	void SetListing(bool a_listing) { m_listing = a_listing; }
+	bool isListing() const { return m_listing; }
+
+	// Writes where a_writer does.
+	void CopyTargets(const ListingWriter &a_writer);
+
+	// Adds text to the listing.
+	void Write(const char *a_text, size_t a_length);
+	void Write(const string &a_text) { Write(a_text.data(), a_text.size()); }
+	void Write(char a_char);
+
+	// Adds a number, in decimal, to the listing.
+	void WriteNumber(int a_value);
+
+	// Adds text that stays where it is until the listing is flushed.
+	void WriteSource(const char *a_text, size_t a_length);
+
+	// Adds an error message, then ends the line the errors were for.
+	void WriteError(const string &a_message);
+	void EndErrors();
+
+	// Writes out everything buffered.
+	void Flush();
+
+	// Writes out everything buffered if enough has been.
+	void FlushIfFull() {
+		if (m_buffer.size() >= FLUSH_BYTES || m_pieces.size() >= FLUSH_PIECES) {
+			Flush();
+		}
+	}
+
+	// Appends a_value in decimal to a_text, padded on the left with zeros
+	// to a_width characters, as setw and setfill('0') would.
+	static void FormatNumber(int a_value, int a_width, string &a_text);
+
+	// The same for text.
+	static void FormatText(const string &a_value, int a_width, string &a_text);
+
+private:
+
+	// A piece of the listing.
+	struct Piece {
+		const char *text;       // The text where it is, NULL if it is in the buffer,
+		size_t offset;          // at this offset.
+		size_t length;
+		bool error;             // The piece goes to the errors.
+	};
+
+	vector<char> m_buffer;      // The text that was formatted.
+	vector<Piece> m_pieces;     // The pieces in order.
+	bool m_listing;             // The listing is displayed.
+
+	ostream *m_listingStream;   // Where the listing and errors are written,
+	ostream *m_errorStream;     // NULL to discard them.
+	int m_listingFile;          // The file descriptors written to instead,
+	int m_errorFile;            // -1 to use the streams.
+
+	// Adds text to the buffer, as part of the last piece if it can be.
+	void Buffer(const char *a_text, size_t a_length, bool a_error);
+
+	// Writes pieces to a stream, or a file descriptor.
+	void WritePieces(const Piece *a_pieces, int a_count, ostream *a_stream, int a_file);
+};
+
+#endif
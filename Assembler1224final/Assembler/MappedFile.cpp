@@ -0,0 +1,157 @@
+//
+//  Implementation of the MappedFile class.
+//
+#include "stdafx.h"
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Constructor for a file that is not open yet.
+MappedFile::MappedFile()
+{
+	m_data = NULL;
+	m_size = 0;
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#endif
+}
+
+// Destructor unmaps the file.
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+
+
+/*
+NAME
+
+Open - Maps a file into memory.
+
+SYNOPSIS
+
+bool MappedFile::Open(const string &a_fileName);
+
+a_fileName - the name of the file.
+
+DESCRIPTION
+
+Maps the whole file read only, so it can be read without copying it or
+making a system call for each part.  An empty file opens with no data,
+since it cannot be mapped.
+
+RETURNS
+
+True if the file was opened, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool MappedFile::Open(const string &a_fileName)
+{
+	Close();
+
+#ifdef _WIN32
+	m_file = CreateFileA(a_fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size)) {
+		Close();
+		return false;
+	}
+	m_size = (size_t)size.QuadPart;
+	if (m_size == 0) {
+		return true;
+	}
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping == NULL) {
+		Close();
+		return false;
+	}
+	m_data = (const char *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_data == NULL) {
+		Close();
+		return false;
+	}
+#else
+	int fd = open(a_fileName.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(fd, &status) == -1) {
+		close(fd);
+		return false;
+	}
+	m_size = (size_t)status.st_size;
+	if (m_size != 0) {
+		void *data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			m_size = 0;
+			return false;
+		}
+		m_data = (const char *)data;
+	}
+	// The mapping stays valid once the file is closed.
+	close(fd);
+#endif
+	return true;
+}
+
+
+
+/*
+NAME
+
+Close - Unmaps the file.
+
+SYNOPSIS
+
+void MappedFile::Close();
+
+DESCRIPTION
+
+Releases the mapping and the file.  Does nothing if no file is open.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_data != NULL) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != NULL) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+	}
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	if (m_data != NULL) {
+		munmap((void *)m_data, m_size);
+	}
+#endif
+	m_data = NULL;
+	m_size = 0;
+}
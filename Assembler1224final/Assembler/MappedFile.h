@@ -0,0 +1,41 @@
+//
+//		MappedFile class - a read only view of a whole file in memory.
+//
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+class MappedFile {
+
+public:
+
+	MappedFile();
+
+	// Unmaps the file.
+	~MappedFile();
+
+	// Maps the named file; false if it could not be opened.
+	bool Open(const string &a_fileName);
+
+	// Unmaps the file, if one is mapped.
+	void Close();
+
+	// The contents of the file.  Empty files have no data.
+	const char *GetData() { return m_data; }
+	size_t GetSize() { return m_size; }
+
+private:
+
+	const char *m_data;		// The first byte of the file, NULL if empty or not open.
+	size_t m_size;			// The length of the file in bytes.
+
+#ifdef _WIN32
+	HANDLE m_file;			// The open file.
+	HANDLE m_mapping;		// The mapping object for the file.
+#endif
+
+	// A mapping cannot be copied.
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+};
+
+#endif
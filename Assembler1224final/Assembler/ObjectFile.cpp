@@ -0,0 +1,234 @@
+//
+//		Implementation of the ObjectFile class.
+//
+#include "stdafx.h"
+#include "ObjectFile.h"
+
+// Constructor for an object file that is not open yet.
+ObjectFile::ObjectFile()
+{
+	m_header = NULL;
+	m_segments = NULL;
+	m_words = NULL;
+	m_texts = NULL;
+	m_contents = NULL;
+	m_symbols = NULL;
+	m_names = NULL;
+	m_lines = NULL;
+}
+
+
+
+/*
+NAME
+
+Open - Maps an object file and checks it.
+
+SYNOPSIS
+
+bool ObjectFile::Open(const string &a_fileName);
+
+a_fileName - the name of the object file.
+
+DESCRIPTION
+
+Maps the file and finds its parts from the counts in the header.  The
+file must start with ObjectWriter::MAGIC, be of ObjectWriter::VERSION,
+have been written in this byte order and be exactly as long as its
+parts.  The start location must be -1, within memory or MEMSZ, the
+location past the end where a run stops with the address error.  Every
+word must be six digits, and every segment, text, symbol name and line
+must lie within memory or the file, so that nothing read through them
+later needs checking.
+
+RETURNS
+
+True if the file is a usable object file, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool ObjectFile::Open(const string &a_fileName)
+{
+	m_header = NULL;
+	if (!m_file.Open(a_fileName) || m_file.GetSize() < sizeof(ObjectWriter::Header)) {
+		return false;
+	}
+	const char *data = m_file.GetData();
+	const ObjectWriter::Header *header = (const ObjectWriter::Header *)data;
+	if (memcmp(header->magic, ObjectWriter::MAGIC, ObjectWriter::MAGIC_SIZE) != 0
+		|| header->version != ObjectWriter::VERSION || header->byteOrder != ObjectWriter::ORDER_MARK) {
+		return false;
+	}
+	if (header->startLocation < -1 || header->startLocation > emulator::MEMSZ) {
+		return false;
+	}
+	if (header->segmentCount < 0 || header->wordCount < 0 || header->wordCount > emulator::MEMSZ
+		|| header->textCount < 0 || header->textCount > emulator::MEMSZ || header->textBytes < 0
+		|| header->symbolCount < 0 || header->nameBytes < 0 || header->lineCount < 0
+		|| header->lineCount > emulator::MEMSZ) {
+		return false;
+	}
+
+	// The parts follow one another; the counts are small enough not to overflow.
+	unsigned long long offset = sizeof(ObjectWriter::Header);
+	unsigned long long segmentsAt = offset;
+	offset += (unsigned long long)header->segmentCount * sizeof(ObjectWriter::Segment);
+	unsigned long long wordsAt = offset;
+	offset += (unsigned long long)header->wordCount * sizeof(int);
+	unsigned long long textsAt = offset;
+	offset += (unsigned long long)header->textCount * sizeof(ObjectWriter::Text);
+	unsigned long long contentsAt = offset;
+	offset += (unsigned long long)header->textBytes;
+	unsigned long long symbolsAt = offset;
+	offset += (unsigned long long)header->symbolCount * sizeof(ObjectWriter::Symbol);
+	unsigned long long namesAt = offset;
+	offset += (unsigned long long)header->nameBytes;
+	unsigned long long linesAt = offset;
+	offset += (unsigned long long)header->lineCount * sizeof(ObjectWriter::Line);
+	if (offset != m_file.GetSize()) {
+		return false;
+	}
+	const ObjectWriter::Segment *segments = (const ObjectWriter::Segment *)(data + segmentsAt);
+	const int *words = (const int *)(data + wordsAt);
+	const ObjectWriter::Text *texts = (const ObjectWriter::Text *)(data + textsAt);
+	const ObjectWriter::Symbol *symbols = (const ObjectWriter::Symbol *)(data + symbolsAt);
+	const ObjectWriter::Line *lines = (const ObjectWriter::Line *)(data + linesAt);
+
+	// Segments must be in order, within memory, and hold all of the words.
+	int wordCount = 0;
+	int next = 0;
+	for (int i = 0; i < header->segmentCount; i++) {
+		if (segments[i].location < next || segments[i].length <= 0
+			|| segments[i].length > emulator::MEMSZ - segments[i].location) {
+			return false;
+		}
+		next = segments[i].location + segments[i].length;
+		wordCount += segments[i].length;
+	}
+	if (wordCount != header->wordCount) {
+		return false;
+	}
+	for (int i = 0; i < header->wordCount; i++) {
+		if (words[i] < 0 || words[i] > 999999) {
+			return false;
+		}
+	}
+	next = 0;
+	for (int i = 0; i < header->textCount; i++) {
+		if (texts[i].location < next || texts[i].location >= emulator::MEMSZ
+			|| texts[i].offset < 0 || texts[i].length < 0
+			|| texts[i].length > header->textBytes - texts[i].offset) {
+			return false;
+		}
+		next = texts[i].location + 1;
+	}
+	for (int i = 0; i < header->symbolCount; i++) {
+		if (symbols[i].nameOffset < 0 || symbols[i].nameLength < 0
+			|| symbols[i].nameLength > header->nameBytes - symbols[i].nameOffset) {
+			return false;
+		}
+	}
+	// Lines must be in order of location, for FindLine.
+	next = 0;
+	for (int i = 0; i < header->lineCount; i++) {
+		if (lines[i].location < next || lines[i].location >= emulator::MEMSZ) {
+			return false;
+		}
+		next = lines[i].location + 1;
+	}
+
+	m_header = header;
+	m_segments = segments;
+	m_words = words;
+	m_texts = texts;
+	m_contents = data + contentsAt;
+	m_symbols = symbols;
+	m_names = data + namesAt;
+	m_lines = lines;
+	return true;
+}
+
+
+
+/*
+NAME
+
+LoadInto - Loads the program into an emulator.
+
+SYNOPSIS
+
+void ObjectFile::LoadInto(emulator &a_emul) const;
+
+a_emul - the emulator, which has nothing else loaded.
+
+DESCRIPTION
+
+Copies each segment into memory with emulator::insertWords, straight
+from the mapped file, then inserts the texts with emulator::insertMemory.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ObjectFile::LoadInto(emulator &a_emul) const
+{
+	const int *words = m_words;
+	for (int i = 0; i < m_header->segmentCount; i++) {
+		a_emul.insertWords(m_segments[i].location, words, m_segments[i].length);
+		words += m_segments[i].length;
+	}
+	for (int i = 0; i < m_header->textCount; i++) {
+		a_emul.insertMemory(m_texts[i].location, string(m_contents + m_texts[i].offset, m_texts[i].length));
+	}
+}
+
+
+
+/*
+NAME
+
+FindLine - Finds the line of the source that loaded a location.
+
+SYNOPSIS
+
+int ObjectFile::FindLine(int a_location) const;
+
+a_location - the location.
+
+DESCRIPTION
+
+Searches the lines, which are in order of location.
+
+RETURNS
+
+The line number, from 1, or -1 if the location was not loaded or the
+object file was stripped.
+
+AUTHOR
+
+Charles Snyder
+*/
+int ObjectFile::FindLine(int a_location) const
+{
+	const ObjectWriter::Line *first = m_lines;
+	const ObjectWriter::Line *last = m_lines + m_header->lineCount;
+	while (first < last) {
+		const ObjectWriter::Line *middle = first + (last - first) / 2;
+		if (middle->location < a_location) {
+			first = middle + 1;
+		}
+		else {
+			last = middle;
+		}
+	}
+	if (first == m_lines + m_header->lineCount || first->location != a_location) {
+		return -1;
+	}
+	return first->line;
+}
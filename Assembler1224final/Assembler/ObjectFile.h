@@ -0,0 +1,56 @@
+//
+//		ObjectFile class - a mapped object file, loaded into an emulator without being parsed.
+//
+#ifndef _OBJECTFILE_H
+#define _OBJECTFILE_H
+
+#include "ObjectWriter.h"
+#include "MappedFile.h"
+
+// The file is mapped and its parts are used where they are, after Open
+// has checked that they fit in it; loading copies each segment into
+// memory as it stands.
+class ObjectFile {
+
+public:
+
+	ObjectFile();
+
+	// Maps the named object file; false if it could not be opened or is not
+	// an object file of this version and byte order.
+	bool Open(const string &a_fileName);
+
+	// The location the program starts at, -1 if it has none.
+	int GetStartLocation() const { return m_header->startLocation; }
+
+	// Copies the words and texts of the program into the memory of a_emul.
+	void LoadInto(emulator &a_emul) const;
+
+	// The symbols, in the order they are displayed.
+	int GetSymbolCount() const { return m_header->symbolCount; }
+	string GetSymbolName(int a_index) const {
+		return string(m_names + m_symbols[a_index].nameOffset, m_symbols[a_index].nameLength);
+	}
+	int GetSymbolLocation(int a_index) const { return m_symbols[a_index].location; }
+
+	// The line of the source that loaded a location, -1 if it is not known.
+	int FindLine(int a_location) const;
+
+private:
+
+	MappedFile m_file;
+	const ObjectWriter::Header *m_header;
+	const ObjectWriter::Segment *m_segments;
+	const int *m_words;
+	const ObjectWriter::Text *m_texts;
+	const char *m_contents;
+	const ObjectWriter::Symbol *m_symbols;
+	const char *m_names;
+	const ObjectWriter::Line *m_lines;
+
+	// An object file cannot be copied.
+	ObjectFile(const ObjectFile &);
+	ObjectFile &operator=(const ObjectFile &);
+};
+
+#endif
@@ -0,0 +1,205 @@
+//
+//		Implementation of the ObjectWriter class.
+//
+#include "stdafx.h"
+#include "ObjectWriter.h"
+
+const char ObjectWriter::MAGIC[] = "VC3600O1";
+
+// Constructor for a program with nothing loaded yet.
+ObjectWriter::ObjectWriter()
+{
+	m_startLocation = -1;
+	m_contents.assign(emulator::MEMSZ, "");
+	m_lines.assign(emulator::MEMSZ, 0);
+}
+
+
+
+/*
+NAME
+
+SetContents - Records the contents loaded at a location.
+
+SYNOPSIS
+
+bool ObjectWriter::SetContents(int a_location, const string &a_contents, int a_line);
+
+a_location - the location the contents are loaded at.
+
+a_contents - the translation, as the listing shows it.
+
+a_line - the line of the source that loaded it, from 1.
+
+DESCRIPTION
+
+Keeps the contents and their line, replacing any recorded at the
+location before, just as loading them into the emulator would.
+
+RETURNS
+
+False if the location is outside of memory, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool ObjectWriter::SetContents(int a_location, const string &a_contents, int a_line)
+{
+	if (a_location < 0 || a_location >= emulator::MEMSZ) {
+		return false;
+	}
+	m_contents[a_location] = a_contents;
+	m_lines[a_location] = a_line;
+	return true;
+}
+
+
+
+/*
+NAME
+
+AddSymbol - Records a symbol of the program.
+
+SYNOPSIS
+
+void ObjectWriter::AddSymbol(const string &a_name, int a_location);
+
+a_name - the name of the symbol.
+
+a_location - its location, as the symbol table gives it.
+
+DESCRIPTION
+
+Appends the symbol to those written, with its name added to the names.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ObjectWriter::AddSymbol(const string &a_name, int a_location)
+{
+	Symbol symbol;
+	symbol.location = a_location;
+	symbol.nameOffset = (int)m_names.size();
+	symbol.nameLength = (int)a_name.size();
+	m_symbols.push_back(symbol);
+	m_names += a_name;
+}
+
+
+
+/*
+NAME
+
+Save - Writes the object file.
+
+SYNOPSIS
+
+bool ObjectWriter::Save(const string &a_fileName, bool a_strip);
+
+a_fileName - the name of the object file.
+
+a_strip - true to leave out the symbols and lines.
+
+DESCRIPTION
+
+Gathers the locations that were loaded into segments of consecutive
+locations and writes the parts of the file, as ObjectWriter.h lays them
+out, in one pass.  Contents of six digits are written as their words and
+any others as texts, so that they load as the listing shows them.  A start location outside memory, which a numeric ORG
+can give, is written as MEMSZ, which runs the same.
+
+RETURNS
+
+True if the file was written, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool ObjectWriter::Save(const string &a_fileName, bool a_strip)
+{
+	vector<Segment> segments;
+	vector<int> words;
+	vector<Text> texts;
+	string contents;
+	vector<Line> lines;
+	for (int loc = 0; loc < emulator::MEMSZ; loc++) {
+		if (m_lines[loc] == 0) {
+			continue;
+		}
+		if (segments.empty() || segments.back().location + segments.back().length != loc) {
+			Segment segment;
+			segment.location = loc;
+			segment.length = 0;
+			segments.push_back(segment);
+		}
+		segments.back().length++;
+		int word = 0;
+		if (!emulator::ContentsToWord(m_contents[loc], word)) {
+			Text text;
+			text.location = loc;
+			text.offset = (int)contents.size();
+			text.length = (int)m_contents[loc].size();
+			texts.push_back(text);
+			contents += m_contents[loc];
+		}
+		words.push_back(word);
+		Line line;
+		line.location = loc;
+		line.line = m_lines[loc];
+		lines.push_back(line);
+	}
+
+	contents.resize((contents.size() + 3) & ~(size_t)3, '\0');
+
+	string names;
+	if (a_strip) {
+		lines.clear();
+	}
+	else {
+		names = m_names;
+		names.resize((names.size() + 3) & ~(size_t)3, '\0');
+	}
+
+	Header header;
+	memcpy(header.magic, MAGIC, MAGIC_SIZE);
+	header.version = VERSION;
+	header.byteOrder = ORDER_MARK;
+	header.startLocation = m_startLocation < -1 || m_startLocation > emulator::MEMSZ ? emulator::MEMSZ : m_startLocation;
+	header.segmentCount = (int)segments.size();
+	header.wordCount = (int)words.size();
+	header.textCount = (int)texts.size();
+	header.textBytes = (int)contents.size();
+	header.symbolCount = a_strip ? 0 : (int)m_symbols.size();
+	header.nameBytes = (int)names.size();
+	header.lineCount = (int)lines.size();
+
+	ofstream file(a_fileName.c_str(), ios::binary | ios::trunc);
+	if (!file) {
+		return false;
+	}
+	file.write((const char *)&header, sizeof(header));
+	if (!segments.empty()) {
+		file.write((const char *)&segments[0], segments.size() * sizeof(Segment));
+		file.write((const char *)&words[0], words.size() * sizeof(int));
+	}
+	if (!texts.empty()) {
+		file.write((const char *)&texts[0], texts.size() * sizeof(Text));
+	}
+	file.write(contents.data(), contents.size());
+	if (header.symbolCount != 0) {
+		file.write((const char *)&m_symbols[0], m_symbols.size() * sizeof(Symbol));
+	}
+	file.write(names.data(), names.size());
+	if (!lines.empty()) {
+		file.write((const char *)&lines[0], lines.size() * sizeof(Line));
+	}
+	file.close();
+	return !file.fail();
+}
@@ -0,0 +1,106 @@
+//
+//		ObjectWriter class - saves an assembled VC3600 program as a binary object file.
+//
+#ifndef _OBJECTWRITER_H
+#define _OBJECTWRITER_H
+
+#include "Emulator.h"
+
+// An object file holds what running the program needs, laid out so that
+// it can be mapped and copied into memory without being parsed.  Every
+// field is a 32 bit integer in the byte order of the machine that wrote
+// it, which ORDER_MARK records, and every part starts on a multiple of
+// four bytes:
+//
+//	Header     MAGIC, VERSION, ORDER_MARK, the start location, then the
+//	           number of segments, words, texts, bytes of contents, symbols,
+//	           bytes of names and lines.
+//	Segments   For each run of consecutive locations that were loaded, its
+//	           first location and its length, in order of location.
+//	Words      The words of the segments, one after another; 0 for a
+//	           location whose contents are not six digits.
+//	Texts      For each location whose contents are not six digits, such as
+//	           "00????", in order of location, the location and the offset
+//	           and length of its contents.
+//	Contents   The contents of the texts, padded with zeros to a multiple
+//	           of four bytes.
+//	Symbols    For each symbol, in the order they are displayed, its
+//	           location and the offset and length of its name.
+//	Names      The names of the symbols, padded with zeros to a multiple
+//	           of four bytes.
+//	Lines      For each location loaded, in order, the line of the source
+//	           that loaded it.
+//
+// The symbols and lines are left out of a stripped object.
+class ObjectWriter {
+
+public:
+
+	// The first bytes of an object file, and the version of the layout.
+	static const char MAGIC[];
+	const static int MAGIC_SIZE = 8;
+	const static int VERSION = 2;
+
+	// Reads back as this number only in the byte order it was written in.
+	const static int ORDER_MARK = 0x01020304;
+
+	// The parts of the file.
+	struct Header {
+		char magic[MAGIC_SIZE];
+		int version;
+		int byteOrder;
+		int startLocation;      // -1 if the program has none, MEMSZ if it is outside memory.
+		int segmentCount;
+		int wordCount;
+		int textCount;
+		int textBytes;          // Including the padding.
+		int symbolCount;
+		int nameBytes;          // Including the padding.
+		int lineCount;
+	};
+	struct Segment {
+		int location;
+		int length;
+	};
+	struct Text {
+		int location;
+		int offset;
+		int length;
+	};
+	struct Symbol {
+		int location;           // SymbolTable::MULTIPLY_DEFINED if defined more than once.
+		int nameOffset;
+		int nameLength;
+	};
+	struct Line {
+		int location;
+		int line;               // From 1.
+	};
+
+	ObjectWriter();
+
+	// Sets the location the program starts at.
+	void SetStartLocation(int a_location) { m_startLocation = a_location; }
+
+	// Records the contents loaded at a location by a line of the source; a
+	// later translation at the same location replaces it.  False if the
+	// location is outside of memory.
+	bool SetContents(int a_location, const string &a_contents, int a_line);
+
+	// Records a symbol; they are written in the order they are added.
+	void AddSymbol(const string &a_name, int a_location);
+
+	// Writes the object file, without the symbols and lines if a_strip;
+	// false if it could not be written.
+	bool Save(const string &a_fileName, bool a_strip);
+
+private:
+
+	int m_startLocation;
+	vector<string> m_contents;  // The contents of each location,
+	vector<int> m_lines;        // and the line that loaded it, 0 if none did.
+	vector<Symbol> m_symbols;
+	string m_names;
+};
+
+#endif
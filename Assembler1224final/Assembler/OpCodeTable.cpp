@@ -0,0 +1,85 @@
+//
+//		Implementation of the OpCodeTable class.
+//
+#include "stdafx.h"
+#include "OpCodeTable.h"
+#include "Lexer.h"
+
+// In the order of OpCodeId.
+const OpCodeTable::Descriptor OpCodeTable::DESCRIPTORS[OC_Count] = {
+	{ "??",    0,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "ADD",   1,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "SUB",   2,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "MULT",  3,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "DIV",   4,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "LOAD",  5,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "STORE", 6,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "READ",  7,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "WRITE", 8,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "B",     9,  OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "BM",    10, OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "BZ",    11, OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "BP",    12, OK_Machine,   OR_Symbol, LR_Optional,  SE_Word },
+	{ "HALT",  13, OK_Machine,   OR_None,   LR_Forbidden, SE_Word },
+	{ "ORG",   0,  OK_Directive, OR_Number, LR_Forbidden, SE_Origin },
+	{ "DC",    0,  OK_Directive, OR_Number, LR_Required,  SE_Word },
+	{ "DS",    0,  OK_Directive, OR_Number, LR_Required,  SE_Reserve },
+	{ "END",   0,  OK_Directive, OR_None,   LR_Forbidden, SE_Word },
+};
+
+// Filled in from the hash of each mnemonic, which Find computes.
+const unsigned char OpCodeTable::SLOTS[SLOT_COUNT] = {
+	OC_Load, OC_Invalid, OC_BranchPositive, OC_Invalid, OC_Halt, OC_End, OC_Org, OC_Invalid,
+	OC_Write, OC_Invalid, OC_Invalid, OC_Ds, OC_BranchZero, OC_Sub, OC_Branch, OC_Invalid,
+	OC_Invalid, OC_Invalid, OC_Read, OC_Mult, OC_Div, OC_Invalid, OC_Invalid, OC_Invalid,
+	OC_Invalid, OC_Add, OC_Invalid, OC_Dc, OC_Store, OC_Invalid, OC_Invalid, OC_BranchMinus,
+};
+
+
+
+/*
+NAME
+
+Find - Finds the mnemonic a word is.
+
+SYNOPSIS
+
+static OpCodeId OpCodeTable::Find(const char *a_text, size_t a_length);
+
+a_text - the word, in any case.
+
+a_length - the number of characters in a_text.
+
+DESCRIPTION
+
+Hashes the length, the first and the last letter of the word into one
+of the slots, then compares the word with the one mnemonic in that slot.
+
+RETURNS
+
+The mnemonic, or OC_Invalid if the word is not one.
+
+AUTHOR
+
+Charles Snyder
+*/
+OpCodeId OpCodeTable::Find(const char *a_text, size_t a_length)
+{
+	if (a_length == 0 || a_length > 5) {
+		return OC_Invalid;
+	}
+	unsigned hash = (unsigned)a_length * 6 + (unsigned char)Lexer::ToUpper(a_text[0]) * 3
+		+ (unsigned char)Lexer::ToUpper(a_text[a_length - 1]);
+	OpCodeId id = (OpCodeId)SLOTS[hash % SLOT_COUNT];
+
+	const char *mnemonic = DESCRIPTORS[id].mnemonic;
+	if (strlen(mnemonic) != a_length) {
+		return OC_Invalid;
+	}
+	for (size_t i = 0; i < a_length; i++) {
+		if (mnemonic[i] != Lexer::ToUpper(a_text[i])) {
+			return OC_Invalid;
+		}
+	}
+	return id;
+}
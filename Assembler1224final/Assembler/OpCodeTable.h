@@ -0,0 +1,81 @@
+//
+//		OpCodeTable class - what each mnemonic of the VC3600 is and how it is assembled.
+//
+#ifndef _OPCODETABLE_H
+#define _OPCODETABLE_H
+
+// The mnemonics.  The machine instructions have their VC3600 opcode
+// numbers, which the emulator decodes words to.
+enum OpCodeId {
+	OC_Invalid = 0,		// Not a mnemonic; shown as "??".
+	OC_Add = 1, OC_Sub, OC_Mult, OC_Div, OC_Load, OC_Store, OC_Read, OC_Write,
+	OC_Branch, OC_BranchMinus, OC_BranchZero, OC_BranchPositive,
+	OC_Halt,			// Opcode 13, the last machine instruction.
+	OC_Org, OC_Dc, OC_Ds, OC_End,
+	OC_Count
+};
+
+// One table describes every mnemonic, so that the assembler decides what
+// to do with a statement from its entry instead of comparing strings, and
+// the emulator knows which opcodes can be run.  A mnemonic is found with a
+// perfect hash: no two mnemonics hash to the same slot, so one comparison
+// tells whether a word is a mnemonic.
+class OpCodeTable {
+
+public:
+
+	// Whether the statement is translated to a machine instruction.
+	enum Kind {
+		OK_Machine,
+		OK_Directive
+	};
+
+	// What the operand must be.
+	enum OperandRule {
+		OR_Symbol,		// A symbol, the address of the instruction.
+		OR_Number,		// A number.
+		OR_None			// No operand.
+	};
+
+	// Whether the statement has a label.
+	enum LabelRule {
+		LR_Optional,
+		LR_Required,
+		LR_Forbidden
+	};
+
+	// What the statement does to the location of the next one.
+	enum SizeEffect {
+		SE_Word,		// Takes the one word its contents are loaded into.
+		SE_Reserve,		// Reserves as many words as the operand, with no contents.
+		SE_Origin		// Moves to the location in the operand, with no contents.
+	};
+
+	struct Descriptor {
+		const char *mnemonic;
+		int code;				// The VC3600 opcode, 0 for a directive.
+		Kind kind;
+		OperandRule operand;
+		LabelRule label;
+		SizeEffect size;
+	};
+
+	// Finds a mnemonic, whatever its case; OC_Invalid if it is not one.
+	static OpCodeId Find(const char *a_text, size_t a_length);
+	static OpCodeId Find(const string &a_text) { return Find(a_text.data(), a_text.size()); }
+
+	static const Descriptor &Get(OpCodeId a_id) { return DESCRIPTORS[a_id]; }
+
+	// Checks whether a word with this opcode can be run.
+	static bool IsMachineCode(int a_code) { return a_code >= OC_Add && a_code <= OC_Halt; }
+
+private:
+
+	static const Descriptor DESCRIPTORS[OC_Count];
+
+	// The mnemonic in each slot of the hash, OC_Invalid if none.
+	const static int SLOT_COUNT = 32;
+	static const unsigned char SLOTS[SLOT_COUNT];
+};
+
+#endif
@@ -0,0 +1,279 @@
+//
+//		Implementation of the ParseCache class.
+//
+#include "stdafx.h"
+#include "ParseCache.h"
+
+// Constructor makes an empty cache.
+ParseCache::ParseCache()
+{
+	Clear();
+}
+
+
+
+/*
+NAME
+
+Clear - Forgets every line.
+
+SYNOPSIS
+
+void ParseCache::Clear();
+
+DESCRIPTION
+
+Empties the lines and their text and makes a small empty hash table.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ParseCache::Clear()
+{
+	m_lines.Clear();
+	m_errors.clear();
+	m_text.clear();
+	m_offsets.clear();
+	m_lengths.clear();
+	m_hashes.clear();
+	m_slots.assign(64, (int)NOT_CACHED);
+}
+
+
+
+/*
+NAME
+
+Hash - Hashes the text of a line.
+
+SYNOPSIS
+
+static unsigned long long ParseCache::Hash(const char *a_text, size_t a_length);
+
+a_text - the line.
+
+a_length - the number of characters in a_text.
+
+DESCRIPTION
+
+Computes the 64 bit FNV-1a hash of the characters, then mixes the high
+bits into the low ones, which pick the slot.
+
+RETURNS
+
+The hash.
+
+AUTHOR
+
+Charles Snyder
+*/
+unsigned long long ParseCache::Hash(const char *a_text, size_t a_length)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < a_length; i++) {
+		hash ^= (unsigned char)a_text[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash ^ (hash >> 29);
+}
+
+
+
+/*
+NAME
+
+Find - Finds a line that has been parsed.
+
+SYNOPSIS
+
+int ParseCache::Find(const char *a_text, size_t a_length, unsigned long long a_hash) const;
+
+a_text - the line.
+
+a_length - the number of characters in a_text.
+
+a_hash - the hash of the line, from Hash.
+
+DESCRIPTION
+
+Probes the slots one after another from where the hash falls.  The
+hashes are compared first, then the text.
+
+RETURNS
+
+The index of the line, NOT_CACHED if it is not in the cache.
+
+AUTHOR
+
+Charles Snyder
+*/
+int ParseCache::Find(const char *a_text, size_t a_length, unsigned long long a_hash) const
+{
+	size_t mask = m_slots.size() - 1;
+	size_t slot = (size_t)a_hash & mask;
+	for (;;) {
+		int index = m_slots[slot];
+		if (index == NOT_CACHED) {
+			return NOT_CACHED;
+		}
+		if (IsLine(index, a_text, a_length, a_hash)) {
+			return index;
+		}
+		slot = (slot + 1) & mask;
+	}
+}
+
+
+
+/*
+NAME
+
+IsLine - Whether a cached line is the one given.
+
+SYNOPSIS
+
+bool ParseCache::IsLine(int a_index, const char *a_text, size_t a_length, unsigned long long a_hash) const;
+
+a_index - the index of the cached line.
+
+a_text - the line it is compared with.
+
+a_length - the number of characters in a_text.
+
+a_hash - the hash of a_text, from Hash.
+
+DESCRIPTION
+
+The hashes are compared first, so most lines that differ are told apart
+without reading the text; two lines whose hashes are equal are the same
+only if their text is too.
+
+RETURNS
+
+True if the cached line has the text given, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool ParseCache::IsLine(int a_index, const char *a_text, size_t a_length, unsigned long long a_hash) const
+{
+	return m_hashes[a_index] == a_hash && m_lengths[a_index] == (int)a_length
+		&& memcmp(m_text.data() + m_offsets[a_index], a_text, a_length) == 0;
+}
+
+
+
+/*
+NAME
+
+Parse - Parses a line and caches it.
+
+SYNOPSIS
+
+int ParseCache::Parse(const char *a_text, size_t a_length, unsigned long long a_hash, Instruction &a_inst,
+	SymbolTable &a_names);
+
+a_text - the line, which is not cached yet.
+
+a_length - the number of characters in a_text.
+
+a_hash - the hash of the line, from Hash.
+
+a_inst - the instruction to parse the line with.
+
+a_names - the symbol table the label and operand are interned in.
+
+DESCRIPTION
+
+Parses the line as line 1, with errors of its own and no start location,
+and adds it to the lines, marked PF_SetsStart if it set one.  The errors
+are kept in the order they were recorded, without the line number, so
+they can be given to whichever line the text turns up on.
+
+RETURNS
+
+The index of the line.
+
+AUTHOR
+
+Charles Snyder
+*/
+int ParseCache::Parse(const char *a_text, size_t a_length, unsigned long long a_hash, Instruction &a_inst,
+	SymbolTable &a_names)
+{
+	Errors errors;
+	a_inst.SetErrors(&errors);
+	a_inst.setLineCount(1);
+	a_inst.SetStartLocation(-1);
+	string buff(a_text, a_length);
+	Instruction::InstructionType st = a_inst.RecordInstruction(buff);
+	int index = m_lines.Add(a_inst, st, 0, 1, !errors.GetErrors().empty(), a_names);
+	if (a_inst.GetStartLocation() != -1) {
+		m_lines.AddFlag(index, ParsedProgram::PF_SetsStart);
+	}
+	a_inst.SetErrors(NULL);
+
+	m_errors.push_back(vector<string>());
+	const multimap<int, string> &found = errors.GetErrors();
+	for (multimap<int, string>::const_iterator error = found.begin(); error != found.end(); error++) {
+		m_errors.back().push_back(error->second);
+	}
+
+	m_offsets.push_back(m_text.size());
+	m_lengths.push_back((int)a_length);
+	m_hashes.push_back(a_hash);
+	m_text.append(a_text, a_length);
+
+	size_t mask = m_slots.size() - 1;
+	size_t slot = (size_t)a_hash & mask;
+	while (m_slots[slot] != NOT_CACHED) {
+		slot = (slot + 1) & mask;
+	}
+	m_slots[slot] = index;
+	if (m_hashes.size() * 2 > m_slots.size()) {
+		Grow();
+	}
+	return index;
+}
+
+
+
+/*
+NAME
+
+Grow - Doubles the hash table.
+
+SYNOPSIS
+
+void ParseCache::Grow();
+
+DESCRIPTION
+
+Puts every line into a table twice the size.  The indexes do not change.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ParseCache::Grow()
+{
+	m_slots.assign(m_slots.size() * 2, (int)NOT_CACHED);
+	size_t mask = m_slots.size() - 1;
+	for (int index = 0; index < (int)m_hashes.size(); index++) {
+		size_t slot = (size_t)m_hashes[index] & mask;
+		while (m_slots[slot] != NOT_CACHED) {
+			slot = (slot + 1) & mask;
+		}
+		m_slots[slot] = index;
+	}
+}
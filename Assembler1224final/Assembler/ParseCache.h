@@ -0,0 +1,70 @@
+//
+//		ParseCache class - lines of source already parsed, found again by their text.
+//
+#ifndef _PARSECACHE_H
+#define _PARSECACHE_H
+
+#include "ParsedProgram.h"
+#include "Errors.h"
+
+// Each distinct line of text is parsed once, on its own, and kept as an
+// entry of a ParsedProgram along with the errors found parsing it, so a
+// line that comes back after an edit, where it was or moved, is copied
+// instead of parsed.  What a line takes from the lines before it, the
+// location, the operand value and the numeric opcode, is left for Pass I
+// to fill in.  Lines are found through an open addressing hash table of
+// the hashes of their text; the text is kept to compare.
+class ParseCache {
+
+public:
+
+	ParseCache();
+
+	// Find returns this for a line that is not cached.
+	const static int NOT_CACHED = -1;
+
+	// Forgets every line.
+	void Clear();
+
+	// The number of lines cached.
+	int GetCount() const { return m_lines.GetCount(); }
+
+	// The hash of a line, which Find and Parse are given.
+	static unsigned long long Hash(const char *a_text, size_t a_length);
+
+	// The index of a line, NOT_CACHED if it has not been parsed.
+	int Find(const char *a_text, size_t a_length, unsigned long long a_hash) const;
+
+	// Whether a cached line has the text given, with the hash given.
+	bool IsLine(int a_index, const char *a_text, size_t a_length, unsigned long long a_hash) const;
+
+	// Parses a line with a_inst, with its names interned in a_names, and
+	// caches it; returns its index.
+	int Parse(const char *a_text, size_t a_length, unsigned long long a_hash, Instruction &a_inst,
+		SymbolTable &a_names);
+
+	// The lines cached, as parsed on their own.
+	const ParsedProgram &GetLines() const { return m_lines; }
+
+	// The errors found parsing a line, in the order they were recorded.
+	const vector<string> &GetErrors(int a_index) const { return m_errors[a_index]; }
+
+private:
+
+	ParsedProgram m_lines;
+	vector<vector<string> > m_errors;
+
+	// The text of each line, one after another, and its hash.
+	string m_text;
+	vector<size_t> m_offsets;
+	vector<int> m_lengths;
+	vector<unsigned long long> m_hashes;
+
+	// The index of each line; its size is a power of two, at most half full.
+	vector<int> m_slots;
+
+	// Doubles the hash table.
+	void Grow();
+};
+
+#endif
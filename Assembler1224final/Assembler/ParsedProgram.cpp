@@ -0,0 +1,320 @@
+//
+//		Implementation of the ParsedProgram class.
+//
+#include "stdafx.h"
+#include "ParsedProgram.h"
+
+// Replaces the elements of a_to from a_first up to a_last with all of a_from.
+template <class T>
+static void ReplaceRange(vector<T> &a_to, int a_first, int a_last, const vector<T> &a_from)
+{
+	if (a_last - a_first == (int)a_from.size()) {
+		copy(a_from.begin(), a_from.end(), a_to.begin() + a_first);
+		return;
+	}
+	a_to.erase(a_to.begin() + a_first, a_to.begin() + a_last);
+	a_to.insert(a_to.begin() + a_first, a_from.begin(), a_from.end());
+}
+
+// Constructor makes an empty program.
+ParsedProgram::ParsedProgram()
+{
+}
+// Destructor currently does nothing.
+ParsedProgram::~ParsedProgram()
+{
+}
+
+
+
+/*
+NAME
+
+Clear - Forgets every entry and name.
+
+SYNOPSIS
+
+void ParsedProgram::Clear();
+
+DESCRIPTION
+
+Empties every array, keeping the memory they hold for the next source.
+The names stay in the symbol table.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ParsedProgram::Clear()
+{
+	m_types.clear();
+	m_opCodes.clear();
+	m_numericOpCodes.clear();
+	m_flags.clear();
+	m_labels.clear();
+	m_operands.clear();
+	m_values.clear();
+	m_locations.clear();
+	m_lines.clear();
+	m_contents.clear();
+}
+
+
+
+/*
+NAME
+
+Add - Adds the line just parsed.
+
+SYNOPSIS
+
+int ParsedProgram::Add(Instruction &a_inst, Instruction::InstructionType a_type, int a_location, int a_line, bool a_errors,
+	SymbolTable &a_names);
+
+a_inst - the instruction the line was parsed into.
+
+a_type - what RecordInstruction returned for the line.
+
+a_location - the location of the line.
+
+a_line - the line number.
+
+a_errors - true if errors were recorded while the line was parsed.
+
+a_names - the symbol table, where the label and operand are interned.
+
+DESCRIPTION
+
+Appends the fields of the instruction to the arrays.  A comment has
+only its type, location and line; the fields the instruction still
+holds belong to an earlier line.
+
+RETURNS
+
+The index of the new entry.
+
+AUTHOR
+
+Charles Snyder
+*/
+int ParsedProgram::Add(Instruction &a_inst, Instruction::InstructionType a_type, int a_location, int a_line, bool a_errors,
+	SymbolTable &a_names)
+{
+	unsigned char flags = a_errors ? PF_Errors : 0;
+	int label = NO_NAME;
+	int operand = NO_NAME;
+	if (a_type != Instruction::ST_Comment) {
+		if (a_inst.GetIsNumericOperand()) {
+			flags |= PF_NumericOperand;
+		}
+		if (a_inst.isLabel()) {
+			label = a_names.Intern(a_inst.GetLabel());
+		}
+		operand = a_names.Intern(a_inst.GetOperand());
+	}
+
+	m_types.push_back((unsigned char)a_type);
+	m_opCodes.push_back((unsigned char)a_inst.GetOpCode());
+	m_numericOpCodes.push_back((unsigned char)a_inst.GetNumericOpCode());
+	m_flags.push_back(flags);
+	m_labels.push_back(label);
+	m_operands.push_back(operand);
+	m_values.push_back(a_inst.GetOperandValue());
+	m_locations.push_back(a_location);
+	m_lines.push_back(a_line);
+	m_contents.push_back("");
+	return GetCount() - 1;
+}
+
+
+
+/*
+NAME
+
+Append - Adds the entries of a chunk of the source.
+
+SYNOPSIS
+
+void ParsedProgram::Append(const ParsedProgram &a_chunk, const vector<int> &a_ids);
+
+a_chunk - the lines of the chunk, parsed with names of their own.
+
+a_ids - the id each name of a_chunk has here.
+
+DESCRIPTION
+
+Copies the arrays of a_chunk onto the end of these, changing the ids of
+its labels and operands through a_ids.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ParsedProgram::Append(const ParsedProgram &a_chunk, const vector<int> &a_ids)
+{
+	m_types.insert(m_types.end(), a_chunk.m_types.begin(), a_chunk.m_types.end());
+	m_opCodes.insert(m_opCodes.end(), a_chunk.m_opCodes.begin(), a_chunk.m_opCodes.end());
+	m_numericOpCodes.insert(m_numericOpCodes.end(), a_chunk.m_numericOpCodes.begin(), a_chunk.m_numericOpCodes.end());
+	m_flags.insert(m_flags.end(), a_chunk.m_flags.begin(), a_chunk.m_flags.end());
+	m_values.insert(m_values.end(), a_chunk.m_values.begin(), a_chunk.m_values.end());
+	m_locations.insert(m_locations.end(), a_chunk.m_locations.begin(), a_chunk.m_locations.end());
+	m_lines.insert(m_lines.end(), a_chunk.m_lines.begin(), a_chunk.m_lines.end());
+	m_contents.insert(m_contents.end(), a_chunk.m_contents.begin(), a_chunk.m_contents.end());
+	for (int i = 0; i < a_chunk.GetCount(); i++) {
+		int label = a_chunk.m_labels[i];
+		int operand = a_chunk.m_operands[i];
+		if (label != NO_NAME) {
+			label = a_ids[label];
+		}
+		if (operand != NO_NAME) {
+			operand = a_ids[operand];
+		}
+		m_labels.push_back(label);
+		m_operands.push_back(operand);
+	}
+}
+
+
+
+/*
+NAME
+
+AddCopy - Adds a copy of an entry of another program.
+
+SYNOPSIS
+
+int ParsedProgram::AddCopy(const ParsedProgram &a_from, int a_index, int a_line);
+
+a_from - the program holding the entry, with its names in the same
+		 symbol table as these.
+
+a_index - the entry in a_from.
+
+a_line - the line number the copy is for.
+
+DESCRIPTION
+
+Appends the fields of the entry as they are, apart from its line.  The
+location and contents are left for the passes to set.
+
+RETURNS
+
+The index of the new entry.
+
+AUTHOR
+
+Charles Snyder
+*/
+int ParsedProgram::AddCopy(const ParsedProgram &a_from, int a_index, int a_line)
+{
+	m_types.push_back(a_from.m_types[a_index]);
+	m_opCodes.push_back(a_from.m_opCodes[a_index]);
+	m_numericOpCodes.push_back(a_from.m_numericOpCodes[a_index]);
+	m_flags.push_back(a_from.m_flags[a_index]);
+	m_labels.push_back(a_from.m_labels[a_index]);
+	m_operands.push_back(a_from.m_operands[a_index]);
+	m_values.push_back(a_from.m_values[a_index]);
+	m_locations.push_back(0);
+	m_lines.push_back(a_line);
+	m_contents.push_back("");
+	return GetCount() - 1;
+}
+
+
+
+/*
+NAME
+
+Replace - Replaces a range of entries.
+
+SYNOPSIS
+
+void ParsedProgram::Replace(int a_first, int a_last, const ParsedProgram &a_entries);
+
+a_first - the first entry replaced.
+
+a_last - one past the last entry replaced.
+
+a_entries - the entries put in their place, with their names in the
+			same symbol table.
+
+DESCRIPTION
+
+Removes the entries from a_first up to a_last and inserts the entries of
+a_entries there, so the entries after them move by the difference.  When
+as many entries go in as come out they are copied over in place.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ParsedProgram::Replace(int a_first, int a_last, const ParsedProgram &a_entries)
+{
+	ReplaceRange(m_types, a_first, a_last, a_entries.m_types);
+	ReplaceRange(m_opCodes, a_first, a_last, a_entries.m_opCodes);
+	ReplaceRange(m_numericOpCodes, a_first, a_last, a_entries.m_numericOpCodes);
+	ReplaceRange(m_flags, a_first, a_last, a_entries.m_flags);
+	ReplaceRange(m_labels, a_first, a_last, a_entries.m_labels);
+	ReplaceRange(m_operands, a_first, a_last, a_entries.m_operands);
+	ReplaceRange(m_values, a_first, a_last, a_entries.m_values);
+	ReplaceRange(m_locations, a_first, a_last, a_entries.m_locations);
+	ReplaceRange(m_lines, a_first, a_last, a_entries.m_lines);
+	ReplaceRange(m_contents, a_first, a_last, a_entries.m_contents);
+}
+
+
+
+/*
+NAME
+
+NextLocation - Computes the location of the next instruction.
+
+SYNOPSIS
+
+int ParsedProgram::NextLocation(int a_index, int a_location) const;
+
+a_index - the entry.
+
+a_location - the location of the entry.
+
+DESCRIPTION
+
+ORG sets the location to its operand and DS adds its operand to it; any
+other instruction takes up one word.  Comments and the end statement
+leave it as it is.
+
+RETURNS
+
+The location of the next instruction.
+
+AUTHOR
+
+Charles Snyder
+*/
+int ParsedProgram::NextLocation(int a_index, int a_location) const
+{
+	Instruction::InstructionType type = GetType(a_index);
+	if (type == Instruction::ST_Comment || type == Instruction::ST_End) {
+		return a_location;
+	}
+	switch (OpCodeTable::Get(GetOpCode(a_index)).size) {
+	case OpCodeTable::SE_Origin:
+		return m_values[a_index];
+	case OpCodeTable::SE_Reserve:
+		return a_location + m_values[a_index];
+	default:
+		return a_location + 1;
+	}
+}
@@ -0,0 +1,97 @@
+//
+//		ParsedProgram class - every line of the source as Pass I parsed it.
+//
+#ifndef _PARSEDPROGRAM_H
+#define _PARSEDPROGRAM_H
+
+#include "Instruction.h"
+#include "SymTab.h"
+
+// One entry a line, in the order of the source, kept as a separate array
+// for each field so that a stage reading only some fields touches only
+// their memory.  Labels and operands are kept as their ids in the symbol
+// table, which holds each name once.  The text of a line is not copied;
+// its line number finds it in the source.
+class ParsedProgram {
+
+public:
+
+	ParsedProgram();
+	~ParsedProgram();
+
+	// What else is known about an entry.
+	enum Flag {
+		PF_NumericOperand = 1,  // The operand is a number.
+		PF_Errors = 2,          // Errors were recorded for the line when it was parsed.
+		PF_SetsStart = 4,       // The line sets the start location, to its operand value; for ParseCache.
+		PF_DuplicateLabel = 8   // The label was already in the symbol table; for Assembler::Reassemble.
+	};
+
+	// No entry has this label or operand.
+	const static int NO_NAME = -1;
+
+	// Forgets every entry and name.
+	void Clear();
+
+	// Adds the line just parsed into a_inst, at a_location, with its names
+	// interned in a_names; returns its index.
+	int Add(Instruction &a_inst, Instruction::InstructionType a_type, int a_location, int a_line, bool a_errors,
+		SymbolTable &a_names);
+
+	// Appends every entry of a_chunk, parsed on its own, mapping the name
+	// ids it has to those in a_ids.
+	void Append(const ParsedProgram &a_chunk, const vector<int> &a_ids);
+
+	// Appends a copy of an entry of another program, whose names are in the
+	// same symbol table, as line a_line; returns its index.
+	int AddCopy(const ParsedProgram &a_from, int a_index, int a_line);
+
+	// Replaces the entries from a_first up to a_last with those of a_entries.
+	void Replace(int a_first, int a_last, const ParsedProgram &a_entries);
+
+	// The number of entries.
+	int GetCount() const { return (int)m_types.size(); }
+
+	Instruction::InstructionType GetType(int a_index) const { return (Instruction::InstructionType)m_types[a_index]; }
+	OpCodeId GetOpCode(int a_index) const { return (OpCodeId)m_opCodes[a_index]; }
+
+	// The numeric opcode as the instruction had it, which for a directive
+	// is what the last machine instruction left.
+	int GetNumericOpCode(int a_index) const { return m_numericOpCodes[a_index]; }
+	bool HasFlag(int a_index, Flag a_flag) const { return (m_flags[a_index] & a_flag) != 0; }
+	int GetLabel(int a_index) const { return m_labels[a_index]; }
+	int GetOperand(int a_index) const { return m_operands[a_index]; }
+	int GetOperandValue(int a_index) const { return m_values[a_index]; }
+	int GetLocation(int a_index) const { return m_locations[a_index]; }
+	int GetLine(int a_index) const { return m_lines[a_index]; }
+
+	// Fixes up an entry once what came before it is known.
+	void AddFlag(int a_index, Flag a_flag) { m_flags[a_index] |= a_flag; }
+	void ClearFlag(int a_index, Flag a_flag) { m_flags[a_index] &= (unsigned char)~a_flag; }
+	void SetNumericOpCode(int a_index, int a_code) { m_numericOpCodes[a_index] = (unsigned char)a_code; }
+	void SetOperandValue(int a_index, int a_value) { m_values[a_index] = a_value; }
+	void SetLocation(int a_index, int a_location) { m_locations[a_index] = a_location; }
+	void SetLine(int a_index, int a_line) { m_lines[a_index] = a_line; }
+
+	// The location of the instruction after an entry at a_location.
+	int NextLocation(int a_index, int a_location) const;
+
+	// The contents the translation of an entry is loaded as, set by Pass II.
+	const string &GetContents(int a_index) const { return m_contents[a_index]; }
+	void SetContents(int a_index, const string &a_contents) { m_contents[a_index] = a_contents; }
+
+private:
+
+	vector<unsigned char> m_types;          // Instruction::InstructionType.
+	vector<unsigned char> m_opCodes;        // OpCodeId.
+	vector<unsigned char> m_numericOpCodes;
+	vector<unsigned char> m_flags;          // Flag bits.
+	vector<int> m_labels;                   // Name id, NO_NAME if none.
+	vector<int> m_operands;                 // Name id, NO_NAME for a comment.
+	vector<int> m_values;                   // The value of a numeric operand.
+	vector<int> m_locations;
+	vector<int> m_lines;                    // Line numbers, from 1.
+	vector<string> m_contents;
+};
+
+#endif
@@ -0,0 +1,407 @@
+//
+//		Implementation of the Profiler class.
+//
+#include "stdafx.h"
+#include "Profiler.h"
+
+// Constructor for a profiler with nothing counted or recorded.
+Profiler::Profiler()
+: m_statements(emulator::MEMSZ), m_lines(emulator::MEMSZ, 0), m_symbols(emulator::MEMSZ)
+{
+	Reset();
+}
+
+
+
+/*
+NAME
+
+Reset - Clears the counts.
+
+SYNOPSIS
+
+void Profiler::Reset();
+
+DESCRIPTION
+
+Sets every count back to zero.  The statements and symbols recorded
+from the assembly are kept.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Profiler::Reset()
+{
+	m_executions.assign(emulator::MEMSZ, 0);
+	m_reads.assign(emulator::MEMSZ, 0);
+	m_writes.assign(emulator::MEMSZ, 0);
+	m_taken.assign(emulator::MEMSZ, 0);
+	m_notTaken.assign(emulator::MEMSZ, 0);
+}
+
+
+
+/*
+NAME
+
+RecordStatement - Records the source statement of a location.
+
+SYNOPSIS
+
+void Profiler::RecordStatement(int a_location, int a_line, const string &a_statement);
+
+a_location - the location the statement was assembled at.
+
+a_line - the line number of the statement in the source file.
+
+a_statement - the original statement.
+
+DESCRIPTION
+
+Called by PassII for each statement that takes up memory, so that the
+counts of a location can be shown next to the statement that put it there.
+Locations outside of memory are ignored.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Profiler::RecordStatement(int a_location, int a_line, const string &a_statement)
+{
+	if (a_location < 0 || a_location >= emulator::MEMSZ) {
+		return;
+	}
+	m_statements[a_location] = a_statement;
+	m_lines[a_location] = a_line;
+}
+
+
+
+/*
+NAME
+
+RecordSymbols - Records the location of each symbol.
+
+SYNOPSIS
+
+void Profiler::RecordSymbols(const SymbolTable &a_symbols);
+
+a_symbols - the symbol table.
+
+DESCRIPTION
+
+Symbols that were multiply defined, and so have no usable location, are
+left out.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Profiler::RecordSymbols(const SymbolTable &a_symbols)
+{
+	vector<int> ids;
+	a_symbols.GetSortedSymbols(ids);
+	for (int i = 0; i < (int)ids.size(); i++) {
+		int location;
+		if (a_symbols.LookupSymbol(ids[i], location) && location >= 0 && location < emulator::MEMSZ) {
+			m_symbols[location] = a_symbols.GetName(ids[i]);
+		}
+	}
+}
+
+
+
+/*
+NAME
+
+LocationName - Names a location by its symbol.
+
+SYNOPSIS
+
+string Profiler::LocationName(int a_location);
+
+a_location - the location to name.
+
+DESCRIPTION
+
+Words reserved by a DS past the first have no symbol of their own, so
+they are named by the nearest symbol before them and the distance from it.
+
+RETURNS
+
+The name, or an empty string if no symbol comes before the location.
+
+AUTHOR
+
+Charles Snyder
+*/
+string Profiler::LocationName(int a_location)
+{
+	for (int location = a_location; location >= 0; location--) {
+		if (!m_symbols[location].empty()) {
+			if (location == a_location) {
+				return m_symbols[location];
+			}
+			return m_symbols[location] + "+" + to_string(a_location - location);
+		}
+	}
+	return "";
+}
+
+
+
+/*
+NAME
+
+Percent - Computes a share of a total.
+
+SYNOPSIS
+
+double Profiler::Percent(long long a_count, long long a_total);
+
+a_count - the part.
+
+a_total - the whole.
+
+DESCRIPTION
+
+Guards against a total of zero, when nothing was executed.
+
+RETURNS
+
+a_count as a percentage of a_total.
+
+AUTHOR
+
+Charles Snyder
+*/
+double Profiler::Percent(long long a_count, long long a_total)
+{
+	if (a_total == 0) {
+		return 0.0;
+	}
+	return 100.0 * (double)a_count / (double)a_total;
+}
+
+
+
+/*
+NAME
+
+DisplayReport - Displays the profile of a run.
+
+SYNOPSIS
+
+void Profiler::DisplayReport(const emulator &a_emul, int a_startLocation, ostream &a_out);
+
+a_emul - the emulator that ran the program, for its memory.
+
+a_startLocation - where the run started.
+
+a_out - where the report goes.
+
+DESCRIPTION
+
+Displays the total number of instructions executed, then the annotated
+listing and the basic block summary.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Profiler::DisplayReport(const emulator &a_emul, int a_startLocation, ostream &a_out)
+{
+	long long total = 0;
+	for (int location = 0; location < emulator::MEMSZ; location++) {
+		total += m_executions[location];
+	}
+
+	a_out << endl << "Execution profile:" << endl << endl;
+	a_out << "Instructions executed: " << total << endl;
+	DisplayListing(total, a_out);
+	DisplayBlocks(a_emul, a_startLocation, total, a_out);
+}
+
+
+
+/*
+NAME
+
+DisplayListing - Displays the annotated listing.
+
+SYNOPSIS
+
+void Profiler::DisplayListing(long long a_total, ostream &a_out);
+
+a_total - the number of instructions executed in the run.
+
+a_out - where the listing goes.
+
+DESCRIPTION
+
+Displays a line for every location that was executed, read or written,
+with its counts and source statement.  The most executed locations come
+first, then the most used data, so the hot spots are at the top.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Profiler::DisplayListing(long long a_total, ostream &a_out)
+{
+	vector<int> used;
+	for (int location = 0; location < emulator::MEMSZ; location++) {
+		if (m_executions[location] != 0 || m_reads[location] != 0 || m_writes[location] != 0) {
+			used.push_back(location);
+		}
+	}
+	stable_sort(used.begin(), used.end(), [this](int a_first, int a_second) {
+		if (m_executions[a_first] != m_executions[a_second]) {
+			return m_executions[a_first] > m_executions[a_second];
+		}
+		return m_reads[a_first] + m_writes[a_first] > m_reads[a_second] + m_writes[a_second];
+	});
+
+	a_out << endl << "Location    Executed  Percent       Reads      Writes       Taken   Not taken   Line   Statement" << endl;
+	for (size_t i = 0; i < used.size(); i++) {
+		int location = used[i];
+		a_out << setw(8) << location << setw(12) << m_executions[location]
+			<< setw(8) << fixed << setprecision(1) << Percent(m_executions[location], a_total) << "%"
+			<< setw(12) << m_reads[location] << setw(12) << m_writes[location];
+		if (m_taken[location] != 0 || m_notTaken[location] != 0) {
+			a_out << setw(12) << m_taken[location] << setw(12) << m_notTaken[location];
+		}
+		else {
+			a_out << setw(24) << "";
+		}
+		if (m_statements[location].empty()) {
+			a_out << setw(7) << "" << "   (" << LocationName(location) << ")" << endl;
+		}
+		else {
+			a_out << setw(7) << m_lines[location] << "   " << m_statements[location] << endl;
+		}
+	}
+}
+
+
+
+/*
+NAME
+
+DisplayBlocks - Displays the basic block summary.
+
+SYNOPSIS
+
+void Profiler::DisplayBlocks(const emulator &a_emul, int a_startLocation, long long a_total, ostream &a_out);
+
+a_emul - the emulator that ran the program, for the instruction words.
+
+a_startLocation - where the run started.
+
+a_total - the number of instructions executed in the run.
+
+a_out - where the summary goes.
+
+DESCRIPTION
+
+A block starts at the start location, at the target of a branch, after
+a branch or HALT, and wherever execution picks up after a location that
+never ran.  It ends at a branch or HALT or just before the next block.
+Each block is displayed with the number of times it was entered and the
+instructions executed in it, the hottest first.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void Profiler::DisplayBlocks(const emulator &a_emul, int a_startLocation, long long a_total, ostream &a_out)
+{
+	const int *memory = a_emul.GetMemory();
+
+	// Whether the instruction at a location ends a block: B, BM, BZ, BP or HALT.
+	vector<bool> ends(emulator::MEMSZ, false);
+	vector<bool> leaders(emulator::MEMSZ, false);
+	if (a_startLocation >= 0 && a_startLocation < emulator::MEMSZ) {
+		leaders[a_startLocation] = true;
+	}
+	for (int location = 0; location < emulator::MEMSZ; location++) {
+		if (m_executions[location] == 0) {
+			continue;
+		}
+		if (location == 0 || m_executions[location - 1] == 0) {
+			leaders[location] = true;
+		}
+		int opcode = memory[location] >= 0 ? memory[location] / 10000 : 0;
+		if (opcode >= 9 && opcode <= 13) {
+			ends[location] = true;
+			if (location + 1 < emulator::MEMSZ) {
+				leaders[location + 1] = true;
+			}
+			if (opcode != 13) {
+				leaders[memory[location] % 10000] = true;
+			}
+		}
+	}
+
+	struct Block {
+		int first;
+		int last;
+		long long entries;
+		long long executed;
+	};
+	vector<Block> blocks;
+	for (int location = 0; location < emulator::MEMSZ; location++) {
+		if (!leaders[location] || m_executions[location] == 0) {
+			continue;
+		}
+		Block block;
+		block.first = location;
+		block.last = location;
+		block.entries = m_executions[location];
+		block.executed = m_executions[location];
+		while (!ends[block.last] && block.last + 1 < emulator::MEMSZ &&
+			!leaders[block.last + 1] && m_executions[block.last + 1] != 0) {
+			block.last++;
+			block.executed += m_executions[block.last];
+		}
+		blocks.push_back(block);
+	}
+	stable_sort(blocks.begin(), blocks.end(), [](const Block &a_first, const Block &a_second) {
+		return a_first.executed > a_second.executed;
+	});
+
+	a_out << endl << "Basic blocks:" << endl << endl;
+	a_out << "   First    Last     Entries    Executed  Percent   Name" << endl;
+	for (size_t i = 0; i < blocks.size(); i++) {
+		const Block &block = blocks[i];
+		a_out << setw(8) << block.first << setw(8) << block.last << setw(12) << block.entries
+			<< setw(12) << block.executed
+			<< setw(8) << fixed << setprecision(1) << Percent(block.executed, a_total) << "%"
+			<< "   " << LocationName(block.first) << endl;
+	}
+}
@@ -0,0 +1,65 @@
+//
+//		Profiler class - counts where a VC3600 program spends its time.
+//
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include "Emulator.h"
+#include "SymTab.h"
+
+class Profiler {
+
+public:
+
+	Profiler();
+
+	// Clears the counts of a previous run.
+	void Reset();
+
+	// Records the source statement assembled at a location.
+	void RecordStatement(int a_location, int a_line, const string &a_statement);
+
+	// Records the symbols, so that locations can be shown by name.
+	void RecordSymbols(const SymbolTable &a_symbols);
+
+	// Counting, done by emulator::runProgramProfiled for each instruction.
+	void CountExecution(int a_location) { m_executions[a_location]++; }
+	void CountRead(int a_address) { m_reads[a_address]++; }
+	void CountWrite(int a_address) { m_writes[a_address]++; }
+	void CountBranch(int a_location, bool a_taken) {
+		if (a_taken) m_taken[a_location]++; else m_notTaken[a_location]++;
+	}
+
+	// Displays the annotated listing, hottest first, and the basic blocks.
+	void DisplayReport(const emulator &a_emul, int a_startLocation, ostream &a_out);
+
+private:
+
+	// Counts for each location.
+	vector<long long> m_executions;	// Instructions executed at the location.
+	vector<long long> m_reads;		// Data reads of the location.
+	vector<long long> m_writes;		// Data writes (STORE and READ) of the location.
+	vector<long long> m_taken;		// BM, BZ and BP at the location that branched.
+	vector<long long> m_notTaken;	// BM, BZ and BP at the location that fell through.
+
+	// The source of each location, from PassII.
+	vector<string> m_statements;	// The original statement, empty if none.
+	vector<int> m_lines;			// Its line number in the source file.
+
+	// The symbol defined at each location, empty if none.
+	vector<string> m_symbols;
+
+	// The name of a location: its symbol, or the nearest symbol before it and an offset.
+	string LocationName(int a_location);
+
+	// Displays every location that was used, hottest first.
+	void DisplayListing(long long a_total, ostream &a_out);
+
+	// Splits the executed code into basic blocks and displays them, hottest first.
+	void DisplayBlocks(const emulator &a_emul, int a_startLocation, long long a_total, ostream &a_out);
+
+	// The percentage of a_total that a_count is, for the report.
+	static double Percent(long long a_count, long long a_total);
+};
+
+#endif
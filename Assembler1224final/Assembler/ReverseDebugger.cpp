@@ -0,0 +1,232 @@
+//
+//		Implementation of the ReverseDebugger class.
+//
+#include "stdafx.h"
+#include "ReverseDebugger.h"
+
+// Constructor for debugging a recorded run.
+ReverseDebugger::ReverseDebugger(emulator &a_emul, UndoLog &a_log)
+: m_emul(a_emul), m_log(a_log)
+{
+}
+// Destructor currently does nothing.
+ReverseDebugger::~ReverseDebugger()
+{
+}
+
+
+
+/*
+NAME
+
+Run - Takes the run back as the commands ask.
+
+SYNOPSIS
+
+void ReverseDebugger::Run(istream &a_input, ostream &a_output);
+
+a_input - where the commands are read from, one a line.
+
+a_output - where the state and the answers are displayed.
+
+DESCRIPTION
+
+Displays the state the run stopped in, then carries out each command:
+
+	back [n]      take back n instructions, 1 if n is not given
+	to <loc>      take back instructions until the one at loc is next
+	writer <loc>  display the step and instruction that last wrote loc
+	state         display the state again
+	quit          stop debugging
+
+Taking back a step costs the same however long the run was, and the
+last writer is looked up at once.  Empty lines are skipped, and a
+command that is not understood displays the commands.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ReverseDebugger::Run(istream &a_input, ostream &a_output)
+{
+	a_output << endl << "Reverse debugging: the last " << m_log.GetCount()
+		<< " steps can be taken back" << endl;
+	DisplayState(a_output);
+
+	string line;
+	for (;;) {
+		a_output << "(back) " << flush;
+		if (!getline(a_input, line)) {
+			a_output << endl;
+			return;
+		}
+		istringstream words(line);
+		string command;
+		if (!(words >> command)) {
+			continue;
+		}
+
+		if (command == "quit" || command == "q") {
+			return;
+		}
+		else if (command == "state" || command == "s") {
+			DisplayState(a_output);
+		}
+		else if (command == "back" || command == "b") {
+			long long count = 1;
+			if (!(words >> count)) {
+				count = 1;
+			}
+			long long taken = 0;
+			while (taken < count && m_emul.StepBack(m_log)) {
+				taken++;
+			}
+			if (taken < count) {
+				a_output << "No more steps can be taken back" << endl;
+			}
+			DisplayState(a_output);
+		}
+		else if (command == "to" || command == "t") {
+			int location;
+			if (!(words >> location) || location < 0 || location >= emulator::MEMSZ) {
+				DisplayHelp(a_output);
+				continue;
+			}
+			long long taken;
+			if (m_emul.ReverseContinue(m_log, location, taken)) {
+				a_output << "Took back " << taken << " steps" << endl;
+			}
+			else {
+				a_output << "Location " << location << " was not reached in the " << taken
+					<< " steps taken back" << endl;
+			}
+			DisplayState(a_output);
+		}
+		else if (command == "writer" || command == "w") {
+			int location;
+			if (!(words >> location) || location < 0 || location >= emulator::MEMSZ) {
+				DisplayHelp(a_output);
+				continue;
+			}
+			DisplayWriter(location, a_output);
+		}
+		else {
+			DisplayHelp(a_output);
+		}
+	}
+}
+
+
+
+/*
+NAME
+
+DisplayState - Displays where the run is.
+
+SYNOPSIS
+
+void ReverseDebugger::DisplayState(ostream &a_output);
+
+a_output - where the state is displayed.
+
+DESCRIPTION
+
+Displays the steps executed, the location and word of the instruction
+that is next to run, and the accumulator.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ReverseDebugger::DisplayState(ostream &a_output)
+{
+	int location = m_emul.GetActiveLocation();
+	a_output << "Step " << m_emul.GetStepCount() << ": next instruction at location " << location;
+	if (location >= 0 && location < emulator::MEMSZ) {
+		a_output << ", word " << WordText(location);
+	}
+	a_output << ", accumulator " << m_emul.GetAccumulator() << endl;
+}
+
+
+
+/*
+NAME
+
+DisplayWriter - Displays what last wrote a location.
+
+SYNOPSIS
+
+void ReverseDebugger::DisplayWriter(int a_location, ostream &a_output);
+
+a_location - the location asked about.
+
+a_output - where the answer is displayed.
+
+DESCRIPTION
+
+Displays the contents of the location and the step and location of the
+STORE or READ that last wrote it, among the steps up to where the run
+has been taken back to.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ReverseDebugger::DisplayWriter(int a_location, ostream &a_output)
+{
+	a_output << "Location " << a_location << " holds "
+		<< WordText(a_location);
+	long long step;
+	int writer;
+	if (m_log.LastWrite(a_location, step, writer)) {
+		// Step numbers count from 1 here, as in DisplayState.
+		a_output << ", last written by step " << step + 1 << ", the instruction at location "
+			<< writer << endl;
+	}
+	else {
+		a_output << ", not written by any step that can be taken back" << endl;
+	}
+}
+
+
+
+/*
+NAME
+
+DisplayHelp - Displays the commands.
+
+SYNOPSIS
+
+static void ReverseDebugger::DisplayHelp(ostream &a_output);
+
+a_output - where the commands are displayed.
+
+DESCRIPTION
+
+Lists the commands Run understands.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ReverseDebugger::DisplayHelp(ostream &a_output)
+{
+	a_output << "Commands: back [N], to <Location>, writer <Location>, state, quit" << endl;
+}
@@ -0,0 +1,42 @@
+//
+//		ReverseDebugger class - takes a stopped run back with the commands it is given.
+//
+#ifndef _REVERSEDEBUGGER_H
+#define _REVERSEDEBUGGER_H
+
+#include "Emulator.h"
+#include "UndoLog.h"
+
+class ReverseDebugger {
+
+public:
+
+	// Debugs the run of a_emul recorded in a_log by runProgramUndoable.
+	ReverseDebugger(emulator &a_emul, UndoLog &a_log);
+	~ReverseDebugger();
+
+	// Reads commands until "quit" or the end of the input.
+	void Run(istream &a_input, ostream &a_output);
+
+private:
+
+	emulator &m_emul;
+	UndoLog &m_log;
+
+	// Displays the step, the next instruction and the accumulator.
+	void DisplayState(ostream &a_output);
+
+	// Displays which step and instruction last wrote a location.
+	void DisplayWriter(int a_location, ostream &a_output);
+
+	// Displays the commands.
+	static void DisplayHelp(ostream &a_output);
+
+	// The text a word is shown as: as it was loaded or typed, or its number.
+	string WordText(int a_location) const {
+		string text = m_emul.FormatLocation(a_location);
+		return text.empty() ? emulator::FormatWord(m_emul.GetMemory()[a_location]) : text;
+	}
+};
+
+#endif
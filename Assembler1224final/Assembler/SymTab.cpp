@@ -4,6 +4,102 @@
 #include "stdafx.h"
 #include "SymTab.h"
 
+// Constructor makes an empty table.
+SymbolTable::SymbolTable()
+{
+	Clear();
+}
+
+
+
+/*
+NAME
+
+Clear - forgets every name.
+
+SYNOPSIS
+
+void SymbolTable::Clear();
+
+DESCRIPTION
+
+Empties the arena and makes a small empty hash table.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void SymbolTable::Clear()
+{
+	m_arena.clear();
+	m_offsets.clear();
+	m_lengths.clear();
+	m_locations.clear();
+	m_flags.clear();
+	m_added.clear();
+
+	Slot empty;
+	empty.key.words[0] = 0;
+	empty.key.words[1] = 0;
+	empty.id = NO_ID;
+	m_slots.assign(64, empty);
+}
+
+
+
+/*
+NAME
+
+Intern - finds the id of a name.
+
+SYNOPSIS
+
+int SymbolTable::Intern(const string &a_name);
+
+a_name - the label or operand.
+
+DESCRIPTION
+
+A name seen for the first time is copied to the end of the arena and
+given the next id.  It is not a symbol until AddSymbol defines it.
+
+RETURNS
+
+The id of the name.
+
+AUTHOR
+
+Charles Snyder
+*/
+int SymbolTable::Intern(const string &a_name)
+{
+	Key key = MakeKey(a_name.data(), a_name.size());
+	size_t slot = FindSlot(a_name.data(), a_name.size(), key);
+	if (m_slots[slot].id != NO_ID) {
+		return m_slots[slot].id;
+	}
+
+	int id = (int)m_offsets.size();
+	m_offsets.push_back((int)m_arena.size());
+	m_lengths.push_back((int)a_name.size());
+	m_arena.insert(m_arena.end(), a_name.begin(), a_name.end());
+	m_locations.push_back(0);
+	m_flags.push_back(0);
+
+	m_slots[slot].key = key;
+	m_slots[slot].id = id;
+	if (m_offsets.size() * 2 > m_slots.size()) {
+		Grow();
+	}
+	return id;
+}
+
+
+
 /*
 NAME
 
@@ -11,16 +107,17 @@ AddSymbol - adds a new symbol to the symbol table.
 
 SYNOPSIS
 
-bool SymbolTable::AddSymbol(string &a_symbol, int a_loc)
+bool SymbolTable::AddSymbol(const string &a_symbol, int a_loc)
 
-a_symbol - string passed by reference, the symbol to add.
+a_symbol - the symbol to add.
 
 a_loc - the location to associate with the specified symbol.
 
 DESCRIPTION
 
 Place a_symbol into the symbol value table along with its associated
-location a_loc.
+location a_loc.  A symbol that is already in the table is marked as
+multiply defined instead.
 
 RETURNS
 
@@ -30,17 +127,55 @@ AUTHOR
 
 Charles Snyder
 */
-bool SymbolTable::AddSymbol(string &a_symbol, int a_loc)
+bool SymbolTable::AddSymbol(const string &a_symbol, int a_loc)
 {
+	return AddSymbol(Intern(a_symbol), a_loc);
+}
+
+
+
+/*
+NAME
+
+AddSymbol - adds the name with an id as a symbol.
+
+SYNOPSIS
+
+bool SymbolTable::AddSymbol(int a_id, int a_loc)
+
+a_id - the id of the name, from Intern.
+
+a_loc - the location to associate with the symbol.
+
+DESCRIPTION
+
+Defines the name as a symbol at a_loc, or marks it as multiply defined
+if it already is one.  What the name was before is kept for UndoAdded.
+
+RETURNS
+
+True if the add is successful, false if the symbol already exists in the table.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool SymbolTable::AddSymbol(int a_id, int a_loc)
+{
+	Added added;
+	added.id = a_id;
+	added.location = m_locations[a_id];
+	added.flags = m_flags[a_id];
+	m_added.push_back(added);
+
 	// If the symbol is already in the symbol table, record it as multiply defined.
-	map<string, int>::iterator st;
-	st = m_symbolTable.find(a_symbol);
-	if (st != m_symbolTable.end()) {
-		st->second = -999;
+	if ((m_flags[a_id] & SF_Defined) != 0) {
+		m_flags[a_id] |= SF_MultiplyDefined;
 		return false;
 	}
 	// Record a the  location in the symbol table.
-	m_symbolTable[a_symbol] = a_loc;
+	m_flags[a_id] |= SF_Defined;
+	m_locations[a_id] = a_loc;
 	return true;
 }
 
@@ -50,15 +185,56 @@ bool SymbolTable::AddSymbol(string &a_symbol, int a_loc)
 /*
 NAME
 
-DisplaySymbolTable - displays the contents of the symbol table to the screen.
+UndoAdded - takes back the latest symbols added.
+
+SYNOPSIS
+
+void SymbolTable::UndoAdded(int a_count);
+
+a_count - the number of calls to AddSymbol to keep, from GetAddedCount.
+
+DESCRIPTION
+
+Puts back the location and flags each later call found, latest first,
+so the table defines what it did after the first a_count calls.  This
+lets a reassembly define again only the labels from the first changed
+line on.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void SymbolTable::UndoAdded(int a_count)
+{
+	while ((int)m_added.size() > a_count) {
+		const Added &added = m_added.back();
+		m_locations[added.id] = added.location;
+		m_flags[added.id] = added.flags;
+		m_added.pop_back();
+	}
+}
+
+
+
+/*
+NAME
+
+DisplaySymbolTable - displays the contents of the symbol table.
 
 SYNOPSIS
 
-void SymbolTable::DisplaySymbolTable();
+void SymbolTable::DisplaySymbolTable(ostream &a_listing);
+
+a_listing - the stream the table is written to.
 
 DESCRIPTION
 
-Iterates through the symbol table and outputs each symbol and its associated location.
+Sorts the symbols and outputs each symbol and its associated location.
+The names that are only operands are not shown.
 
 RETURNS
 
@@ -68,15 +244,18 @@ AUTHOR
 
 Charles Snyder
 */
-void SymbolTable::DisplaySymbolTable()
+void SymbolTable::DisplaySymbolTable(ostream &a_listing)
 {
-	cout << "Symbol Table:" << endl << endl;
-	cout << "Symbol #" << "     " << "Symbol" << "     " << "Location" << endl;
-	int count = 0;
-	for (map<string, int>::iterator symbolIterator = m_symbolTable.begin(); symbolIterator != m_symbolTable.end(); ++symbolIterator)
+	a_listing << "Symbol Table:" << endl << endl;
+	a_listing << "Symbol #" << "     " << "Symbol" << "     " << "Location" << endl;
+
+	vector<int> ids;
+	GetSortedSymbols(ids);
+	for (int count = 0; count < (int)ids.size(); count++)
 	{
-		cout << setw(4) << count << setw(14) << symbolIterator->first << setw(10) << symbolIterator->second << endl;
-		count++;
+		int location = 0;
+		LookupSymbol(ids[count], location);
+		a_listing << setw(4) << count << setw(14) << GetName(ids[count]) << setw(10) << location << endl;
 	}
 }
 
@@ -92,7 +271,7 @@ LookUpSymbol - looks up a specified symbol from the symbol table.
 
 SYNOPSIS
 
-bool SymbolTable::LookupSymbol(string &a_symbol, int &a_loc);
+bool SymbolTable::LookupSymbol(const string &a_symbol, int &a_loc) const;
 
 a_symbol - passed by reference, the symbol to look up in the table.
 
@@ -112,12 +291,303 @@ AUTHOR
 
 Charles Snyder
 */
-bool SymbolTable::LookupSymbol(string &a_symbol, int &a_loc) {
-	if (m_symbolTable.count(a_symbol) != 0) {
-		a_loc = m_symbolTable[a_symbol];
-		return true;
+bool SymbolTable::LookupSymbol(const string &a_symbol, int &a_loc) const {
+	int id = Find(a_symbol);
+	if (id == NO_ID) {
+		return false;
 	}
-	else {
+	return LookupSymbol(id, a_loc);
+}
+
+
+
+/*
+NAME
+
+LookUpSymbol - looks up the symbol with an id.
+
+SYNOPSIS
+
+bool SymbolTable::LookupSymbol(int a_id, int &a_loc) const;
+
+a_id - the id of the name, from Intern.
+
+a_loc - passed by reference, the location associated with the found symbol.
+
+DESCRIPTION
+
+Checks whether the name was defined as a symbol and if so returns its
+location, which for a multiply defined symbol is MULTIPLY_DEFINED.
+
+RETURNS
+
+True if the name is a symbol, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool SymbolTable::LookupSymbol(int a_id, int &a_loc) const {
+	if ((m_flags[a_id] & SF_Defined) == 0) {
 		return false;
 	}
-}
\ No newline at end of file
+	a_loc = IsMultiplyDefined(a_id) ? MULTIPLY_DEFINED : m_locations[a_id];
+	return true;
+}
+
+
+
+// Orders the ids of names by their text, as std::string compares them.
+struct SymbolOrder {
+	const vector<char> *arena;
+	const vector<int> *offsets;
+	const vector<int> *lengths;
+
+	bool operator()(int a_left, int a_right) const {
+		int leftLength = (*lengths)[a_left];
+		int rightLength = (*lengths)[a_right];
+		int compared = memcmp(arena->data() + (*offsets)[a_left], arena->data() + (*offsets)[a_right],
+			leftLength < rightLength ? leftLength : rightLength);
+		return compared < 0 || (compared == 0 && leftLength < rightLength);
+	}
+};
+
+
+
+/*
+NAME
+
+GetSortedSymbols - lists the symbols in order.
+
+SYNOPSIS
+
+void SymbolTable::GetSortedSymbols(vector<int> &a_ids) const;
+
+a_ids - passed by reference, set to the ids of the symbols.
+
+DESCRIPTION
+
+Sorts the ids of the defined names by their text, byte by byte, which
+is the order they are displayed in.  Nothing is kept sorted otherwise.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void SymbolTable::GetSortedSymbols(vector<int> &a_ids) const
+{
+	a_ids.clear();
+	for (int id = 0; id < (int)m_flags.size(); id++) {
+		if ((m_flags[id] & SF_Defined) != 0) {
+			a_ids.push_back(id);
+		}
+	}
+	if (a_ids.empty()) {
+		return;
+	}
+	SymbolOrder order = { &m_arena, &m_offsets, &m_lengths };
+	sort(a_ids.begin(), a_ids.end(), order);
+}
+
+
+
+/*
+NAME
+
+MakeKey - makes the hash table key of a name.
+
+SYNOPSIS
+
+static SymbolTable::Key SymbolTable::MakeKey(const char *a_name, size_t a_length);
+
+a_name - the name.
+
+a_length - the number of characters in a_name.
+
+DESCRIPTION
+
+Copies the first KEY_BYTES bytes of the name into the key and pads it
+with zeros.
+
+RETURNS
+
+The key.
+
+AUTHOR
+
+Charles Snyder
+*/
+SymbolTable::Key SymbolTable::MakeKey(const char *a_name, size_t a_length)
+{
+	Key key;
+	key.words[0] = 0;
+	key.words[1] = 0;
+	memcpy(key.words, a_name, a_length < KEY_BYTES ? a_length : KEY_BYTES);
+	return key;
+}
+
+
+
+/*
+NAME
+
+Hash - hashes a key.
+
+SYNOPSIS
+
+static size_t SymbolTable::Hash(const Key &a_key, size_t a_length);
+
+a_key - the key of a name.
+
+a_length - the length of the name.
+
+DESCRIPTION
+
+Mixes the two words of the key and the length with multiplications, so
+that names differing in any byte of the key spread over the table.
+
+RETURNS
+
+The hash, to be masked to the size of the table.
+
+AUTHOR
+
+Charles Snyder
+*/
+size_t SymbolTable::Hash(const Key &a_key, size_t a_length)
+{
+	unsigned long long hash = (a_key.words[0] ^ (a_key.words[1] * 0x9E3779B97F4A7C15ULL) ^ a_length)
+		* 0xFF51AFD7ED558CCDULL;
+	return (size_t)(hash ^ (hash >> 29));
+}
+
+
+
+/*
+NAME
+
+FindSlot - finds the slot of a name.
+
+SYNOPSIS
+
+size_t SymbolTable::FindSlot(const char *a_name, size_t a_length, const Key &a_key) const;
+
+a_name - the name.
+
+a_length - the number of characters in a_name.
+
+a_key - the key of the name, from MakeKey.
+
+DESCRIPTION
+
+Probes the slots one after another from where the name hashes to.  The
+keys are compared first; only a name longer than a key also has the rest
+of its text compared.
+
+RETURNS
+
+The slot holding the name, or the empty slot where it would be added.
+
+AUTHOR
+
+Charles Snyder
+*/
+size_t SymbolTable::FindSlot(const char *a_name, size_t a_length, const Key &a_key) const
+{
+	size_t mask = m_slots.size() - 1;
+	size_t slot = Hash(a_key, a_length) & mask;
+	for (;;) {
+		const Slot &probe = m_slots[slot];
+		if (probe.id == NO_ID) {
+			return slot;
+		}
+		if (probe.key.words[0] == a_key.words[0] && probe.key.words[1] == a_key.words[1]
+			&& m_lengths[probe.id] == (int)a_length
+			&& (a_length <= KEY_BYTES || memcmp(&m_arena[m_offsets[probe.id]], a_name, a_length) == 0)) {
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+	}
+}
+
+
+
+/*
+NAME
+
+Find - finds the id of a name.
+
+SYNOPSIS
+
+int SymbolTable::Find(const string &a_name) const;
+
+a_name - the name.
+
+DESCRIPTION
+
+Looks the name up without adding it.
+
+RETURNS
+
+The id of the name, NO_ID if it has none.
+
+AUTHOR
+
+Charles Snyder
+*/
+int SymbolTable::Find(const string &a_name) const
+{
+	Key key = MakeKey(a_name.data(), a_name.size());
+	return m_slots[FindSlot(a_name.data(), a_name.size(), key)].id;
+}
+
+
+
+/*
+NAME
+
+Grow - doubles the hash table.
+
+SYNOPSIS
+
+void SymbolTable::Grow();
+
+DESCRIPTION
+
+Puts every name into a table twice the size.  The ids do not change.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void SymbolTable::Grow()
+{
+	vector<Slot> old;
+	old.swap(m_slots);
+
+	Slot empty;
+	empty.key.words[0] = 0;
+	empty.key.words[1] = 0;
+	empty.id = NO_ID;
+	m_slots.assign(old.size() * 2, empty);
+
+	size_t mask = m_slots.size() - 1;
+	for (size_t i = 0; i < old.size(); i++) {
+		if (old[i].id == NO_ID) {
+			continue;
+		}
+		size_t slot = Hash(old[i].key, m_lengths[old[i].id]) & mask;
+		while (m_slots[slot].id != NO_ID) {
+			slot = (slot + 1) & mask;
+		}
+		m_slots[slot] = old[i];
+	}
+}
@@ -5,25 +5,105 @@
 
 
 
-// This class is our symbol table.
+// This class is our symbol table.  Every name the assembler meets, label
+// or operand, is held once in an arena and given an id that does not
+// change.  Names are found through an open addressing hash table keyed by
+// their first KEY_BYTES bytes, which hold all of a label, so that a probe
+// compares two words instead of two strings.
 class SymbolTable {
 
 public:
-	SymbolTable() {}
+	SymbolTable();
 	~SymbolTable() {}
 
-	// Add a new symbol to the symbol table.
-	bool AddSymbol(string &a_symbol, int a_loc);
+	// The location of a multiply defined symbol, as displayed.
+	const static int MULTIPLY_DEFINED = -999;
+
+	// Forgets every name.
+	void Clear();
+
+	// The id of a name, which is given one if it has none.
+	int Intern(const string &a_name);
+
+	// Add a new symbol to the symbol table, by name or by id.
+	bool AddSymbol(const string &a_symbol, int a_loc);
+	bool AddSymbol(int a_id, int a_loc);
 
 	// Display the symbol table.
-	void DisplaySymbolTable();
+	void DisplaySymbolTable(ostream &a_listing);
+
+	// Lookup a symbol in the symbol table, by name or by id.
+	bool LookupSymbol(const string &a_symbol, int &a_loc) const;
+	bool LookupSymbol(int a_id, int &a_loc) const;
+
+	// The number of names, whose ids run from 0.
+	int GetNameCount() const { return (int)m_offsets.size(); }
 
-	// Lookup a symbol in the symbol table.
-	bool LookupSymbol(string &a_symbol, int &a_loc);
+	// The text of a name.
+	string GetName(int a_id) const { return string(m_arena.data() + m_offsets[a_id], m_lengths[a_id]); }
+
+	// Whether a symbol was defined more than once.
+	bool IsMultiplyDefined(int a_id) const { return (m_flags[a_id] & SF_MultiplyDefined) != 0; }
+
+	// The ids of the symbols that were defined, in the order they are displayed.
+	void GetSortedSymbols(vector<int> &a_ids) const;
+
+	// The number of calls to AddSymbol so far, and takes back every call
+	// after the first a_count, latest first.  The names stay.
+	int GetAddedCount() const { return (int)m_added.size(); }
+	void UndoAdded(int a_count);
 
 private:
 
-	// This is the actual symbol table.  The symbol is the key to the map.
-	map<string, int> m_symbolTable;
+	const static int KEY_BYTES = 16;
+	const static int NO_ID = -1;
+
+	// The first KEY_BYTES bytes of a name, padded with zeros.
+	struct Key {
+		unsigned long long words[2];
+	};
+
+	// One entry of the hash table.
+	struct Slot {
+		Key key;
+		int id;         // NO_ID if the slot is empty.
+	};
+
+	enum SymbolFlag {
+		SF_Defined = 1,         // The name is a label.
+		SF_MultiplyDefined = 2  // The label was defined more than once.
+	};
+
+	// The names, one after another, and where each starts and how long it is.
+	vector<char> m_arena;
+	vector<int> m_offsets;
+	vector<int> m_lengths;
+
+	// The location and flags of each name.
+	vector<int> m_locations;
+	vector<unsigned char> m_flags;
+
+	// The hash table; its size is a power of two, at most half full.
+	vector<Slot> m_slots;
+
+	// What each call to AddSymbol changed, for UndoAdded: the name and its
+	// location and flags before the call.
+	struct Added {
+		int id;
+		int location;
+		unsigned char flags;
+	};
+	vector<Added> m_added;
+
+	static Key MakeKey(const char *a_name, size_t a_length);
+	static size_t Hash(const Key &a_key, size_t a_length);
+
+	// Finds the slot of a name, or the empty slot where it would go.
+	size_t FindSlot(const char *a_name, size_t a_length, const Key &a_key) const;
+
+	// The id of a name, NO_ID if it has none.
+	int Find(const string &a_name) const;
 
-};
\ No newline at end of file
+	// Doubles the hash table.
+	void Grow();
+};
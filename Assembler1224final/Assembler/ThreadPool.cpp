@@ -0,0 +1,209 @@
+//
+//  Implementation of the ThreadPool class.
+//
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+/*
+NAME
+
+ThreadPool - Constructor for the ThreadPool class.
+
+SYNOPSIS
+
+ThreadPool::ThreadPool(int a_workers);
+
+a_workers - the number of worker threads, at least one.
+
+DESCRIPTION
+
+Creates an empty task queue for each worker.  No threads are started
+until Run is called.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+ThreadPool::ThreadPool(int a_workers)
+{
+	if (a_workers < 1) {
+		a_workers = 1;
+	}
+	for (int i = 0; i < a_workers; i++) {
+		m_queues.push_back(new WorkQueue);
+	}
+	m_nextQueue = 0;
+}
+
+// Destructor releases the queues.
+ThreadPool::~ThreadPool()
+{
+	for (int i = 0; i < (int)m_queues.size(); i++) {
+		delete m_queues[i];
+	}
+}
+
+
+
+/*
+NAME
+
+Submit - Adds a task to the pool.
+
+SYNOPSIS
+
+void ThreadPool::Submit(const Task &a_task);
+
+a_task - the task to run.
+
+DESCRIPTION
+
+Tasks are dealt to the worker queues in turn, so each worker starts with
+an even share.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ThreadPool::Submit(const Task &a_task)
+{
+	WorkQueue *queue = m_queues[m_nextQueue];
+	m_nextQueue = (m_nextQueue + 1) % (int)m_queues.size();
+
+	lock_guard<mutex> guard(queue->lock);
+	queue->tasks.push_back(a_task);
+}
+
+
+
+/*
+NAME
+
+Run - Runs every submitted task.
+
+SYNOPSIS
+
+void ThreadPool::Run();
+
+DESCRIPTION
+
+Starts one thread for each worker, the first worker being the calling
+thread, and waits until all the queues are empty and every task has
+finished.  Because no tasks are added while running, a worker that finds
+every queue empty is done.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ThreadPool::Run()
+{
+	vector<thread> threads;
+	for (int i = 1; i < (int)m_queues.size(); i++) {
+		threads.push_back(thread(&ThreadPool::WorkerLoop, this, i));
+	}
+	WorkerLoop(0);
+	for (int i = 0; i < (int)threads.size(); i++) {
+		threads[i].join();
+	}
+	m_nextQueue = 0;
+}
+
+
+
+/*
+NAME
+
+WorkerLoop - Runs tasks until there are none left.
+
+SYNOPSIS
+
+void ThreadPool::WorkerLoop(int a_worker);
+
+a_worker - the index of this worker.
+
+DESCRIPTION
+
+Runs the tasks of this worker's queue, then helps the others.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void ThreadPool::WorkerLoop(int a_worker)
+{
+	Task task;
+	while (TakeTask(a_worker, task)) {
+		task(a_worker);
+	}
+}
+
+
+
+/*
+NAME
+
+TakeTask - Takes the next task for a worker.
+
+SYNOPSIS
+
+bool ThreadPool::TakeTask(int a_worker, Task &a_task);
+
+a_worker - the index of the worker.
+
+a_task - passed by reference, set to the task taken.
+
+DESCRIPTION
+
+Takes the newest task from the worker's own queue.  If that is empty the
+oldest task of another queue is stolen, trying the queues after the
+worker's own in turn so the thieves spread out.
+
+RETURNS
+
+True if a task was taken, false if every queue is empty.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool ThreadPool::TakeTask(int a_worker, Task &a_task)
+{
+	WorkQueue *own = m_queues[a_worker];
+	{
+		lock_guard<mutex> guard(own->lock);
+		if (!own->tasks.empty()) {
+			a_task = own->tasks.back();
+			own->tasks.pop_back();
+			return true;
+		}
+	}
+
+	int count = (int)m_queues.size();
+	for (int i = 1; i < count; i++) {
+		WorkQueue *victim = m_queues[(a_worker + i) % count];
+		lock_guard<mutex> guard(victim->lock);
+		if (!victim->tasks.empty()) {
+			a_task = victim->tasks.front();
+			victim->tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
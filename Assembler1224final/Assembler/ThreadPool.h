@@ -0,0 +1,47 @@
+//
+//		ThreadPool class - runs a set of tasks on worker threads.
+//
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <functional>
+
+class ThreadPool {
+
+public:
+
+	// A task is given the index of the worker running it.
+	typedef function<void(int)> Task;
+
+	ThreadPool(int a_workers);
+	~ThreadPool();
+
+	// The number of worker threads.
+	int GetWorkerCount() { return (int)m_queues.size(); }
+
+	// Adds a task.  Tasks are dealt to the workers in turn.
+	void Submit(const Task &a_task);
+
+	// Runs every submitted task and waits for them all to finish.
+	void Run();
+
+private:
+
+	// The tasks of one worker.  The owner takes from the back and the
+	// other workers steal from the front.
+	struct WorkQueue {
+		mutex lock;
+		deque<Task> tasks;
+	};
+
+	vector<WorkQueue *> m_queues;	// One queue for each worker.
+	int m_nextQueue;				// The queue the next task is dealt to.
+
+	// The loop run by each worker thread.
+	void WorkerLoop(int a_worker);
+
+	// Takes the next task for a worker, stealing one if its queue is empty.
+	bool TakeTask(int a_worker, Task &a_task);
+};
+
+#endif
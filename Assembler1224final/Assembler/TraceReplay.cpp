@@ -0,0 +1,673 @@
+//
+//		Implementation of the TraceReplay class.
+//
+#include "stdafx.h"
+#include "TraceReplay.h"
+#include "BatchRunner.h"
+
+/*
+NAME
+
+TraceReplay - Constructor for the TraceReplay class.
+
+SYNOPSIS
+
+TraceReplay::TraceReplay(int argc, char *argv[]);
+
+argc - the number of command line arguments.
+
+argv - the commmand line arguments in an array.
+
+DESCRIPTION
+
+Reads the options of the replay:
+
+	--replay <trace>   the trace written by --trace (required)
+	--step <n>         display the state after n steps, the last by default
+	--first <loc>      display memory from this location
+	--last <loc>       display memory up to this location; without either,
+	                   the words that are not zero are displayed
+	--rerun            run the program again on the values recorded for
+	                   READ instead, displaying its output
+
+Any error in the options terminates the program.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+TraceReplay::TraceReplay(int argc, char *argv[])
+{
+	m_step = -1;
+	m_first = 0;
+	m_last = emulator::MEMSZ - 1;
+	m_nonZeroOnly = true;
+	m_rerun = false;
+	m_ended = false;
+	m_result.status = emulator::RS_Halted;
+	m_result.error = emulator::RE_None;
+	m_result.location = 0;
+	m_result.steps = 0;
+	m_result.loopFirst = -1;
+	m_result.loopLast = -1;
+	m_accumulator = 0;
+	m_stepNow = 0;
+	m_lastLocation = -1;
+	m_frame = 0;
+	m_next = NULL;
+	m_nextLocation = 0;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--replay" && i + 1 < argc) {
+			m_traceName = argv[++i];
+		}
+		else if (arg == "--step") {
+			m_step = BatchRunner::NumberOption(argc, argv, i);
+		}
+		else if (arg == "--first") {
+			m_first = (int)BatchRunner::NumberOption(argc, argv, i);
+			m_nonZeroOnly = false;
+		}
+		else if (arg == "--last") {
+			m_last = (int)BatchRunner::NumberOption(argc, argv, i);
+			m_nonZeroOnly = false;
+		}
+		else if (arg == "--rerun") {
+			m_rerun = true;
+		}
+		else {
+			m_traceName = "";
+			break;
+		}
+	}
+	if (m_traceName.empty() || m_first > m_last || m_last >= emulator::MEMSZ) {
+		cerr << "Usage: Assem --replay <Trace> [--step N] [--first LOC] [--last LOC] [--rerun]" << endl;
+		exit(1);
+	}
+}
+
+
+
+/*
+NAME
+
+Run - Displays the state of the traced run.
+
+SYNOPSIS
+
+int TraceReplay::Run();
+
+DESCRIPTION
+
+Displays how the run ended, then the state after the step asked for.
+The state is rebuilt from the last checkpoint at or before the step by
+applying the records after it, so any step is reached by applying at
+most TraceWriter::CHECKPOINT_INTERVAL records, and two more where a
+fused group ran past a checkpoint.  A trace that was cut
+short, as when the program writing it was killed, is replayed as far
+as it goes.
+
+RETURNS
+
+The exit status for the program: 0 if the state was displayed, 1 if the
+trace could not be read.
+
+AUTHOR
+
+Charles Snyder
+*/
+int TraceReplay::Run()
+{
+	if (!m_file.Open(m_traceName)) {
+		cerr << "Trace file could not be opened: " << m_traceName << endl;
+		return 1;
+	}
+	if (!ReadFrames()) {
+		cerr << "Not a trace file: " << m_traceName << endl;
+		return 1;
+	}
+	if (m_rerun) {
+		return Rerun();
+	}
+
+	if (m_ended) {
+		cout << "Run ended: " << BatchRunner::StatusName(m_result.status) << " at location "
+			<< m_result.location << " after " << m_result.steps << " steps" << endl;
+	}
+	else {
+		cout << "The trace ends before the run did" << endl;
+	}
+	if (m_checkpoints.empty()) {
+		return 0;
+	}
+
+	// The last checkpoint at or before the step.
+	int checkpoint = (int)m_checkpoints.size() - 1;
+	while (m_step != -1 && checkpoint > 0 && m_checkpoints[checkpoint].step > m_step) {
+		checkpoint--;
+	}
+	if (!LoadCheckpoint(m_checkpoints[checkpoint].frame)) {
+		cerr << "The trace is damaged" << endl;
+		return 1;
+	}
+	while (m_step == -1 || m_stepNow < m_step) {
+		if (!NextStep(NULL)) {
+			break;
+		}
+	}
+	if (m_step != -1 && m_stepNow < m_step) {
+		cout << "The trace has only " << m_stepNow << " steps" << endl;
+	}
+	DisplayState(cout);
+	return 0;
+}
+
+
+
+/*
+NAME
+
+ReadFrames - Splits the trace into its frames.
+
+SYNOPSIS
+
+bool TraceReplay::ReadFrames();
+
+DESCRIPTION
+
+Checks the MAGIC at the start and finds each frame by its length, noting
+the checkpoints and reading the end of the run.  A frame that does not
+fit in what is left of the file ends the trace.
+
+RETURNS
+
+False if the file does not start with MAGIC, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool TraceReplay::ReadFrames()
+{
+	const char *next = m_file.GetData();
+	const char *end = next + m_file.GetSize();
+	if (m_file.GetSize() < (size_t)TraceWriter::MAGIC_SIZE
+		|| memcmp(next, TraceWriter::MAGIC, TraceWriter::MAGIC_SIZE) != 0) {
+		return false;
+	}
+	next += TraceWriter::MAGIC_SIZE;
+
+	while (next < end) {
+		Frame frame;
+		frame.tag = *next++;
+		unsigned long long length;
+		if (!ReadVarint(next, end, length) || length > (unsigned long long)(end - next)) {
+			break;
+		}
+		frame.data = next;
+		frame.end = next + length;
+		next = frame.end;
+
+		const char *contents = frame.data;
+		unsigned long long value;
+		if (frame.tag == 'C' && ReadVarint(contents, frame.end, value)) {
+			Checkpoint checkpoint;
+			checkpoint.frame = (int)m_frames.size();
+			checkpoint.step = (long long)value;
+			m_checkpoints.push_back(checkpoint);
+		}
+		else if (frame.tag == 'E') {
+			unsigned long long fields[4];
+			bool valid = true;
+			for (int i = 0; i < 4; i++) {
+				valid = valid && ReadVarint(contents, frame.end, fields[i]);
+			}
+			if (valid) {
+				m_ended = true;
+				m_result.status = (emulator::RunStatus)fields[0];
+				m_result.error = (emulator::RuntimeError)fields[1];
+				m_result.location = (int)TraceWriter::UnZigZag(fields[2]);
+				m_result.steps = (long long)fields[3];
+			}
+		}
+		m_frames.push_back(frame);
+	}
+	return true;
+}
+
+
+
+/*
+NAME
+
+LoadCheckpoint - Makes the state that of a checkpoint.
+
+SYNOPSIS
+
+bool TraceReplay::LoadCheckpoint(int a_frame);
+
+a_frame - the index of the 'C' frame in m_frames.
+
+DESCRIPTION
+
+Sets memory, the texts of its words, the accumulator and the step from
+the checkpoint, and places the next step record just after it.
+
+RETURNS
+
+False if the checkpoint is damaged, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool TraceReplay::LoadCheckpoint(int a_frame)
+{
+	const Frame &frame = m_frames[a_frame];
+	const char *next = frame.data;
+	unsigned long long step;
+	unsigned long long location;
+	unsigned long long accumulator;
+	unsigned long long count;
+	if (!ReadVarint(next, frame.end, step) || !ReadVarint(next, frame.end, location)
+		|| !ReadVarint(next, frame.end, accumulator) || !ReadVarint(next, frame.end, count)) {
+		return false;
+	}
+
+	m_memory.assign(emulator::MEMSZ, 0);
+	long long last = -1;
+	for (unsigned long long i = 0; i < count; i++) {
+		unsigned long long gap;
+		unsigned long long value;
+		if (!ReadVarint(next, frame.end, gap) || !ReadVarint(next, frame.end, value)) {
+			return false;
+		}
+		last += (long long)gap;
+		if (last < 0 || last >= emulator::MEMSZ) {
+			return false;
+		}
+		m_memory[(int)last] = (int)TraceWriter::UnZigZag(value);
+	}
+	m_texts.assign(emulator::MEMSZ, string());
+	if (!ReadVarint(next, frame.end, count)) {
+		return false;
+	}
+	last = -1;
+	for (unsigned long long i = 0; i < count; i++) {
+		unsigned long long gap;
+		unsigned long long length;
+		if (!ReadVarint(next, frame.end, gap) || !ReadVarint(next, frame.end, length)
+			|| length > (unsigned long long)(frame.end - next)) {
+			return false;
+		}
+		last += (long long)gap;
+		if (last < 0 || last >= emulator::MEMSZ) {
+			return false;
+		}
+		m_texts[(int)last].assign(next, (size_t)length);
+		next += length;
+	}
+
+	m_stepNow = (long long)step;
+	m_accumulator = (int)TraceWriter::UnZigZag(accumulator);
+	m_lastLocation = -1;
+	m_frame = a_frame + 1;
+	m_next = m_frame < (int)m_frames.size() ? m_frames[m_frame].data : NULL;
+	m_nextLocation = (int)location;
+	return true;
+}
+
+
+
+/*
+NAME
+
+NextStep - Applies the next step record to the state.
+
+SYNOPSIS
+
+bool TraceReplay::NextStep(string *a_reads);
+
+a_reads - if not NULL, the value of a READ is added to it on a line of
+		  its own, as it was typed, "?" if the input was not valid.
+
+DESCRIPTION
+
+The instruction that was executed is found in the rebuilt memory and
+decoded as the emulator did, from its text if it has one; only STORE
+and READ change memory, STORE with the accumulator before the step and
+READ with the recorded value and text.  A later checkpoint is passed
+over, only taking its location as the one the next record is from.
+
+RETURNS
+
+True if a step was applied, false at the end of the trace.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool TraceReplay::NextStep(string *a_reads)
+{
+	// Move on to a frame with records left, stopping at the end of the run.
+	while (m_frame < (int)m_frames.size()
+		&& (m_frames[m_frame].tag != 'R' || m_next >= m_frames[m_frame].end)) {
+		const Frame &frame = m_frames[m_frame];
+		if (frame.tag == 'E') {
+			return false;
+		}
+		if (frame.tag == 'C') {
+			const char *next = frame.data;
+			unsigned long long value;
+			if (!ReadVarint(next, frame.end, value) || !ReadVarint(next, frame.end, value)) {
+				return false;
+			}
+			m_nextLocation = (int)value;
+		}
+		m_frame++;
+		m_next = m_frame < (int)m_frames.size() ? m_frames[m_frame].data : NULL;
+	}
+	if (m_frame >= (int)m_frames.size()) {
+		return false;
+	}
+
+	const char *end = m_frames[m_frame].end;
+	unsigned long long record;
+	if (!ReadVarint(m_next, end, record)) {
+		return false;
+	}
+	int location = m_nextLocation;
+	if (record & 1) {
+		unsigned long long jump;
+		if (!ReadVarint(m_next, end, jump)) {
+			return false;
+		}
+		location += (int)TraceWriter::UnZigZag(jump);
+	}
+	if (location < 0 || location >= emulator::MEMSZ) {
+		return false;
+	}
+
+	// Executed words are valid instructions, so the address is in memory
+	// unless the trace is damaged.
+	int word = m_memory[location];
+	int opcode = word / 10000;
+	int address = word % 10000;
+	const string &text = m_texts[location];
+	if (!text.empty()) {
+		opcode = atoi(text.substr(0, 2).c_str());
+		address = text.length() > 2 ? atoi(text.c_str() + 2) : 0;
+		if (address < 0 || address >= emulator::MEMSZ) {
+			return false;
+		}
+	}
+	if (opcode == 6) {
+		m_memory[address] = m_accumulator;
+		m_texts[address].clear();
+	}
+	else if (opcode == 7) {
+		unsigned long long value;
+		if (!ReadVarint(m_next, end, value)) {
+			return false;
+		}
+		bool valid = value != 0;
+		if (valid) {
+			value--;
+			m_memory[address] = (int)TraceWriter::UnZigZag(value >> 1);
+			m_texts[address].clear();
+			if (value & 1) {
+				unsigned long long length;
+				if (!ReadVarint(m_next, end, length) || length > (unsigned long long)(end - m_next)) {
+					return false;
+				}
+				m_texts[address].assign(m_next, (size_t)length);
+				m_next += length;
+			}
+		}
+		if (a_reads != NULL) {
+			if (!valid) {
+				*a_reads += "?";
+			}
+			else if (!m_texts[address].empty()) {
+				*a_reads += m_texts[address];
+			}
+			else {
+				*a_reads += to_string((long long)m_memory[address]);
+			}
+			*a_reads += "\n";
+		}
+	}
+	m_accumulator = (int)(m_accumulator + TraceWriter::UnZigZag(record >> 1));
+	m_lastLocation = location;
+	m_nextLocation = location + 1;
+	m_stepNow++;
+	return true;
+}
+
+
+
+/*
+NAME
+
+PeekLocation - Gives the location of the next step.
+
+SYNOPSIS
+
+bool TraceReplay::PeekLocation(int &a_location);
+
+a_location - passed by reference, set to the location.
+
+DESCRIPTION
+
+Takes the next step and then puts the state back as it was.
+
+RETURNS
+
+False if there is no next step, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool TraceReplay::PeekLocation(int &a_location)
+{
+	vector<int> memory = m_memory;
+	vector<string> texts = m_texts;
+	int accumulator = m_accumulator;
+	long long step = m_stepNow;
+	int lastLocation = m_lastLocation;
+	int frame = m_frame;
+	const char *next = m_next;
+	int nextLocation = m_nextLocation;
+
+	bool found = NextStep(NULL);
+	a_location = m_lastLocation;
+
+	m_memory.swap(memory);
+	m_texts.swap(texts);
+	m_accumulator = accumulator;
+	m_stepNow = step;
+	m_lastLocation = lastLocation;
+	m_frame = frame;
+	m_next = next;
+	m_nextLocation = nextLocation;
+	return found;
+}
+
+
+
+/*
+NAME
+
+DisplayState - Displays the rebuilt state.
+
+SYNOPSIS
+
+void TraceReplay::DisplayState(ostream &a_out);
+
+a_out - where the state is displayed.
+
+DESCRIPTION
+
+Displays the step, the instruction last executed and the next one, the
+accumulator and then memory: the range given by --first and --last, or
+every word that is not zero.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void TraceReplay::DisplayState(ostream &a_out)
+{
+	a_out << endl << "State after step " << m_stepNow << ":" << endl << endl;
+	if (m_lastLocation != -1) {
+		a_out << "Last instruction:  location " << m_lastLocation << ", word "
+			<< WordText(m_lastLocation) << endl;
+	}
+	int next;
+	if (PeekLocation(next)) {
+		a_out << "Next instruction:  location " << next << ", word "
+			<< WordText(next) << endl;
+	}
+	a_out << "Accumulator:       " << m_accumulator << endl << endl;
+
+	a_out << "Location   Contents" << endl;
+	for (int i = m_first; i <= m_last; i++) {
+		if (m_nonZeroOnly && m_memory[i] == 0) {
+			continue;
+		}
+		a_out << setw(8) << i << "   " << WordText(i) << endl;
+	}
+}
+
+
+
+/*
+NAME
+
+Rerun - Runs the traced program again.
+
+SYNOPSIS
+
+int TraceReplay::Rerun();
+
+DESCRIPTION
+
+Loads the memory, with the text of each word, and the accumulator of
+the first checkpoint into an emulator and runs it from there with the
+values recorded for READ, as they were typed, as its input, so the run is repeated exactly, output and all, without the
+input it had.  A run that was stopped by a limit is stopped after the
+same number of steps, and a trace that was cut short after the steps
+it has.  Whether the rerun ended as the recorded run did is displayed
+afterwards.
+
+RETURNS
+
+The exit status for the program: 0 if the rerun ended as recorded, 1
+otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+int TraceReplay::Rerun()
+{
+	if (m_checkpoints.empty() || !LoadCheckpoint(m_checkpoints[0].frame)) {
+		cerr << "The trace has no checkpoint to run from" << endl;
+		return 1;
+	}
+	vector<int> memory = m_memory;
+	vector<string> texts = m_texts;
+	int accumulator = m_accumulator;
+	int startLocation = m_nextLocation;
+	string reads;
+	while (NextStep(&reads)) {
+	}
+
+	bool limited = !m_ended || (m_result.status != emulator::RS_Halted
+		&& m_result.status != emulator::RS_RuntimeError);
+	emulator *emul = new emulator;
+	istringstream noInput;
+	emul->LoadWords(&memory[0], 1, accumulator);
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		if (!texts[i].empty()) {
+			emul->insertMemory(i, texts[i]);
+		}
+	}
+	emul->SetIO(noInput, cout, false);
+	emul->SetInputBuffer(reads.data(), reads.data() + reads.size());
+	emul->SetOutputBuffer(1 << 16);
+	if (limited) {
+		emul->SetLimits(m_ended ? m_result.steps : m_stepNow, emulator::NO_LIMIT, emulator::NO_LIMIT);
+	}
+	emulator::RunResult result = emul->GetResult(emul->runProgram(startLocation));
+	delete emul;
+
+	bool same = m_ended && result.steps == m_result.steps;
+	if (limited) {
+		same = same && result.status == emulator::RS_StepLimit;
+	}
+	else {
+		same = same && result.status == m_result.status && result.location == m_result.location;
+	}
+	if (!m_ended) {
+		cout << endl << "The trace ends before the run did; the rerun stopped after its "
+			<< m_stepNow << " steps" << endl;
+	}
+	else {
+		cout << endl << (same ? "The rerun ended as the recorded run did" : "The rerun did not end as the recorded run did")
+			<< endl;
+	}
+	return same ? 0 : 1;
+}
+
+
+
+/*
+NAME
+
+ReadVarint - Reads a varint.
+
+SYNOPSIS
+
+bool TraceReplay::ReadVarint(const char *&a_next, const char *a_end, unsigned long long &a_value);
+
+a_next - passed by reference, the first byte, moved past the varint.
+
+a_end - the end of the data.
+
+a_value - passed by reference, set to the value.
+
+DESCRIPTION
+
+Reads the varint written by TraceWriter::AppendVarint.
+
+RETURNS
+
+False if the data ends before the varint does, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool TraceReplay::ReadVarint(const char *&a_next, const char *a_end, unsigned long long &a_value)
+{
+	a_value = 0;
+	for (int shift = 0; a_next < a_end && shift < 64; shift += 7) {
+		unsigned char byte = (unsigned char)*a_next++;
+		a_value |= (unsigned long long)(byte & 0x7F) << shift;
+		if (byte < 0x80) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,91 @@
+//
+//		TraceReplay class - reconstructs the state of a traced run at any step.
+//
+#ifndef _TRACEREPLAY_H
+#define _TRACEREPLAY_H
+
+#include "TraceWriter.h"
+#include "MappedFile.h"
+
+class TraceReplay {
+
+public:
+
+	// Reads the replay options from the command line.
+	TraceReplay(int argc, char *argv[]);
+
+	// Displays the state asked for, or reruns the program.
+	int Run();
+
+private:
+
+	// A frame of the trace, as described in TraceWriter.h.
+	struct Frame {
+		char tag;
+		const char *data;		// The contents.
+		const char *end;
+	};
+
+	// A checkpoint of the trace.
+	struct Checkpoint {
+		int frame;				// Its index in m_frames.
+		long long step;			// The steps taken before it.
+	};
+
+	string m_traceName;			// The trace file (--replay).
+	long long m_step;			// The step to display (--step), -1 for the last.
+	int m_first;				// The memory to display (--first, --last).
+	int m_last;
+	bool m_nonZeroOnly;			// Neither was given: display the words that are not zero.
+	bool m_rerun;				// Run the program again instead (--rerun).
+
+	MappedFile m_file;
+	vector<Frame> m_frames;
+	vector<Checkpoint> m_checkpoints;
+	bool m_ended;				// The trace has an 'E' frame.
+	emulator::RunResult m_result;	// What it holds.
+
+	// The reconstructed state: memory, the accumulator and the steps taken.
+	// The text of a word is kept where the checkpoint or a READ recorded
+	// one, and is empty where the word is shown as TraceWriter::ShownAs gives.
+	vector<int> m_memory;
+	vector<string> m_texts;
+	int m_accumulator;
+	long long m_stepNow;
+	int m_lastLocation;			// Of the last instruction taken, -1 if none.
+
+	// Where the next step record is: the frame, the byte in it, and the
+	// location the step is at unless it jumps.
+	int m_frame;
+	const char *m_next;
+	int m_nextLocation;
+
+	// Splits the file into frames; false if it is not a trace.
+	bool ReadFrames();
+
+	// Makes the state that of the checkpoint in the given frame.
+	bool LoadCheckpoint(int a_frame);
+
+	// Applies the next step to the state.  If a_reads is not NULL the value
+	// of a READ is added to it as it was typed, "?" for one that was not valid.
+	bool NextStep(string *a_reads);
+
+	// Gives the location of the next step without taking it; false if there is none.
+	bool PeekLocation(int &a_location);
+
+	// Displays the state after m_stepNow steps.
+	void DisplayState(ostream &a_out);
+
+	// The text a word is shown as: as it was loaded or typed, or its number.
+	string WordText(int a_location) const {
+		return m_texts[a_location].empty() ? emulator::FormatWord(m_memory[a_location]) : m_texts[a_location];
+	}
+
+	// Runs the program from the first checkpoint on the values recorded for READ.
+	int Rerun();
+
+	// Reads a varint, false if the data ends first.
+	static bool ReadVarint(const char *&a_next, const char *a_end, unsigned long long &a_value);
+};
+
+#endif
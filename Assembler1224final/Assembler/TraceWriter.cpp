@@ -0,0 +1,475 @@
+//
+//		Implementation of the TraceWriter class.
+//
+#include "stdafx.h"
+#include "TraceWriter.h"
+
+const char TraceWriter::MAGIC[] = "VC3600T2";
+
+// Constructor for a trace that is not open yet.
+TraceWriter::TraceWriter()
+{
+	m_failed = false;
+	m_batch.resize(BATCH_SIZE);
+	m_batchNext = &m_batch[0];
+	m_batchEnd = &m_batch[0] + BATCH_SIZE;
+	m_steps.resize(BLOCK_SIZE + MAX_RECORD);
+	m_stepsNext = &m_steps[0];
+	m_stepsFull = &m_steps[0] + BLOCK_SIZE;
+	m_nextLocation = 0;
+	m_accumulator = 0;
+	m_closing = false;
+}
+
+// Destructor closes the trace and releases the frame buffers.
+TraceWriter::~TraceWriter()
+{
+	Close();
+	for (int i = 0; i < (int)m_free.size(); i++) {
+		delete m_free[i];
+	}
+}
+
+
+
+/*
+NAME
+
+Open - Creates the trace file.
+
+SYNOPSIS
+
+bool TraceWriter::Open(const string &a_fileName);
+
+a_fileName - the name of the trace file.
+
+DESCRIPTION
+
+Creates the file, writes MAGIC and starts the thread that writes the
+frames, so that the run only has to encode its steps into memory.
+
+RETURNS
+
+True if the file was created, false otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool TraceWriter::Open(const string &a_fileName)
+{
+	Close();
+	m_file.open(a_fileName.c_str(), ios::binary | ios::trunc);
+	if (!m_file) {
+		return false;
+	}
+	m_file.write(MAGIC, MAGIC_SIZE);
+	m_failed = false;
+	m_batchNext = &m_batch[0];
+	m_stepsNext = &m_steps[0];
+	m_nextLocation = 0;
+	m_accumulator = 0;
+	m_closing = false;
+	m_writer = thread(&TraceWriter::WriteFrames, this);
+	return true;
+}
+
+
+
+/*
+NAME
+
+Close - Finishes the trace file.
+
+SYNOPSIS
+
+bool TraceWriter::Close();
+
+DESCRIPTION
+
+Encodes and hands over the steps not yet written, waits for the thread to
+write everything and closes the file.  Nothing happens if the trace is
+not open.
+
+RETURNS
+
+False if anything could not be written, true otherwise.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool TraceWriter::Close()
+{
+	if (!m_writer.joinable()) {
+		return !m_failed;
+	}
+	EncodeSteps();
+	SubmitSteps();
+	{
+		lock_guard<mutex> guard(m_lock);
+		m_closing = true;
+	}
+	m_queued.notify_one();
+	m_writer.join();
+
+	m_file.close();
+	if (m_file.fail()) {
+		m_failed = true;
+	}
+	return !m_failed;
+}
+
+
+
+/*
+NAME
+
+RecordCheckpoint - Records the whole state of the machine.
+
+SYNOPSIS
+
+void TraceWriter::RecordCheckpoint(long long a_step, int a_location, int a_accumulator,
+	const emulator &a_emul);
+
+a_step - the steps executed so far.
+
+a_location - the location of the next instruction.
+
+a_accumulator - the accumulator.
+
+a_emul - the emulator, for its memory and the text each word is shown as.
+
+DESCRIPTION
+
+The steps before it are encoded and handed over first, so that the
+frames stay in order.  Only the words shown as other than ShownAs gives
+have their text recorded, which is usually just the words the program
+was loaded with.  The records of the following steps start again from
+a_location and a_accumulator.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void TraceWriter::RecordCheckpoint(long long a_step, int a_location, int a_accumulator, const emulator &a_emul)
+{
+	EncodeSteps();
+	SubmitSteps();
+
+	const int *memory = a_emul.GetMemory();
+	vector<char> checkpoint;
+	AppendVarint(checkpoint, (unsigned long long)a_step);
+	AppendVarint(checkpoint, (unsigned long long)a_location);
+	AppendVarint(checkpoint, ZigZag(a_accumulator));
+	int count = 0;
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		if (memory[i] != 0) {
+			count++;
+		}
+	}
+	AppendVarint(checkpoint, (unsigned long long)count);
+	int last = -1;
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		if (memory[i] != 0) {
+			AppendVarint(checkpoint, (unsigned long long)(i - last));
+			AppendVarint(checkpoint, ZigZag(memory[i]));
+			last = i;
+		}
+	}
+	vector<int> shown;
+	vector<string> texts;
+	for (int i = 0; i < emulator::MEMSZ; i++) {
+		string text = a_emul.FormatLocation(i);
+		if (text != ShownAs(memory[i])) {
+			shown.push_back(i);
+			texts.push_back(text);
+		}
+	}
+	AppendVarint(checkpoint, (unsigned long long)shown.size());
+	last = -1;
+	for (int i = 0; i < (int)shown.size(); i++) {
+		AppendVarint(checkpoint, (unsigned long long)(shown[i] - last));
+		AppendVarint(checkpoint, (unsigned long long)texts[i].size());
+		checkpoint.insert(checkpoint.end(), texts[i].begin(), texts[i].end());
+		last = shown[i];
+	}
+	Submit('C', &checkpoint[0], checkpoint.size());
+	m_nextLocation = a_location;
+	m_accumulator = a_accumulator;
+}
+
+
+
+/*
+NAME
+
+RecordEnd - Records how the run ended.
+
+SYNOPSIS
+
+void TraceWriter::RecordEnd(const emulator::RunResult &a_result);
+
+a_result - the result of the run.
+
+DESCRIPTION
+
+Encodes and hands over the last steps and then the 'E' frame, which
+tells the replay that the trace is complete.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void TraceWriter::RecordEnd(const emulator::RunResult &a_result)
+{
+	EncodeSteps();
+	SubmitSteps();
+
+	vector<char> end;
+	AppendVarint(end, (unsigned long long)a_result.status);
+	AppendVarint(end, (unsigned long long)a_result.error);
+	AppendVarint(end, ZigZag(a_result.location));
+	AppendVarint(end, (unsigned long long)a_result.steps);
+	Submit('E', &end[0], end.size());
+}
+
+
+
+/*
+NAME
+
+AppendVarint - Appends a varint to a buffer.
+
+SYNOPSIS
+
+void TraceWriter::AppendVarint(vector<char> &a_buffer, unsigned long long a_value);
+
+a_buffer - the buffer.
+
+a_value - the value.
+
+DESCRIPTION
+
+Seven bits go in each byte, low bits first, with the high bit set on
+every byte but the last.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void TraceWriter::AppendVarint(vector<char> &a_buffer, unsigned long long a_value)
+{
+	while (a_value >= 0x80) {
+		a_buffer.push_back((char)(a_value | 0x80));
+		a_value >>= 7;
+	}
+	a_buffer.push_back((char)a_value);
+}
+
+
+
+/*
+NAME
+
+EncodeSteps - Encodes the steps of the batch.
+
+SYNOPSIS
+
+void TraceWriter::EncodeSteps();
+
+DESCRIPTION
+
+Turns each step recorded since the last call into its step record, the
+change in the accumulator from the step before and, if it jumped, the
+change in the location, and empties the batch.  Encoding a whole batch in
+one loop keeps the branches and registers of the encoding out of the
+loop running the program.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void TraceWriter::EncodeSteps()
+{
+	char *next = m_stepsNext;
+	int nextLocation = m_nextLocation;
+	int accumulator = m_accumulator;
+	for (const Step *step = &m_batch[0]; step != m_batchNext; step++) {
+		unsigned long long record = ZigZag((long long)step->accumulator - accumulator) << 1;
+		if (step->location == nextLocation) {
+			next = PutVarint(next, record);
+		}
+		else {
+			next = PutVarint(next, record | 1);
+			next = PutVarint(next, ZigZag((long long)step->location - nextLocation));
+		}
+		nextLocation = step->location + 1;
+		accumulator = step->accumulator;
+		if (next >= m_stepsFull) {
+			m_stepsNext = next;
+			SubmitSteps();
+			next = m_stepsNext;
+		}
+	}
+	m_stepsNext = next;
+	m_nextLocation = nextLocation;
+	m_accumulator = accumulator;
+	m_batchNext = &m_batch[0];
+}
+
+
+
+/*
+NAME
+
+SubmitSteps - Hands the step records collected to the thread.
+
+SYNOPSIS
+
+void TraceWriter::SubmitSteps();
+
+DESCRIPTION
+
+Makes an 'R' frame of the records, if there are any, and starts
+collecting again.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void TraceWriter::SubmitSteps()
+{
+	if (m_stepsNext == &m_steps[0]) {
+		return;
+	}
+	Submit('R', &m_steps[0], m_stepsNext - &m_steps[0]);
+	m_stepsNext = &m_steps[0];
+}
+
+
+
+/*
+NAME
+
+Submit - Hands a frame to the thread.
+
+SYNOPSIS
+
+void TraceWriter::Submit(char a_tag, const char *a_data, size_t a_length);
+
+a_tag - the tag of the frame.
+
+a_data - the contents of the frame.
+
+a_length - the length of the contents.
+
+DESCRIPTION
+
+Builds the frame in a buffer the thread is done with, if there is one,
+and queues it.  If the thread has fallen MAX_QUEUED frames behind, this
+waits for it, so a fast run cannot fill memory with its trace.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void TraceWriter::Submit(char a_tag, const char *a_data, size_t a_length)
+{
+	unique_lock<mutex> guard(m_lock);
+	while ((int)m_queue.size() >= MAX_QUEUED) {
+		m_written.wait(guard);
+	}
+	vector<char> *frame;
+	if (m_free.empty()) {
+		frame = new vector<char>;
+	}
+	else {
+		frame = m_free.back();
+		m_free.pop_back();
+	}
+	guard.unlock();
+
+	frame->clear();
+	frame->push_back(a_tag);
+	AppendVarint(*frame, (unsigned long long)a_length);
+	frame->insert(frame->end(), a_data, a_data + a_length);
+
+	guard.lock();
+	m_queue.push_back(frame);
+	guard.unlock();
+	m_queued.notify_one();
+}
+
+
+
+/*
+NAME
+
+WriteFrames - Writes the queued frames to the file.
+
+SYNOPSIS
+
+void TraceWriter::WriteFrames();
+
+DESCRIPTION
+
+Runs on its own thread from Open until Close, writing each frame as it
+is queued and returning its buffer for reuse.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void TraceWriter::WriteFrames()
+{
+	unique_lock<mutex> guard(m_lock);
+	for (;;) {
+		while (m_queue.empty() && !m_closing) {
+			m_queued.wait(guard);
+		}
+		if (m_queue.empty()) {
+			return;
+		}
+		vector<char> *frame = m_queue.front();
+		m_queue.pop_front();
+		guard.unlock();
+
+		m_file.write(&(*frame)[0], frame->size());
+		if (!m_file) {
+			m_failed = true;
+		}
+
+		guard.lock();
+		m_free.push_back(frame);
+		m_written.notify_one();
+	}
+}
@@ -0,0 +1,174 @@
+//
+//		TraceWriter class - records a run of a VC3600 program into a compact binary trace.
+//
+#ifndef _TRACEWRITER_H
+#define _TRACEWRITER_H
+
+#include "Emulator.h"
+
+// A trace file starts with MAGIC and is followed by frames, each a tag
+// byte, the length of its contents as a varint and then the contents:
+//
+//	'C'  A checkpoint: the step, the location and the accumulator, then the
+//	     number of words of memory that are not zero and, for each, the gap
+//	     from the one before and its value.  Then the number of words shown
+//	     as other than ShownAs gives, such as "000001", and for each the gap
+//	     from the one before, the length of its text and the text.
+//	'R'  Records of the steps after the last checkpoint, one after another.
+//	'E'  The end of the run: the status, error, location and steps of its
+//	     emulator::RunResult.
+//
+// Varints hold seven bits a byte, low bits first, and signed values are
+// zigzag encoded so that small negative numbers stay short too.  A step is
+// recorded as the change in the accumulator shifted left one, with the low
+// bit set if the instruction was not the one after the last; then the
+// difference from that location follows.  A READ adds 0 if its input was
+// not valid, otherwise the value read shifted left one, with the low bit
+// set if it is shown as it was typed rather than as its number, plus one;
+// then for such a value the length of the text and the text.
+class TraceWriter {
+
+public:
+
+	// The first bytes of a trace file.
+	static const char MAGIC[];
+	const static int MAGIC_SIZE = 8;
+
+	// Steps between checkpoints.
+	const static long long CHECKPOINT_INTERVAL = 1 << 20;
+
+	TraceWriter();
+
+	// Closes the trace if it is still open.
+	~TraceWriter();
+
+	// Creates the trace file and starts the thread that writes it.
+	bool Open(const string &a_fileName);
+
+	// Writes whatever is left and closes the file; false if any of it failed.
+	bool Close();
+
+	// Recording, done by emulator::runProgramTraced.  A step is only put in
+	// the batch as its location and the accumulator after it; the batch is
+	// encoded all at once when it is full or before anything else is
+	// recorded, so the loop that runs the program does no encoding.
+	void RecordStep(int a_location, int a_accumulator) {
+		m_batchNext->location = a_location;
+		m_batchNext->accumulator = a_accumulator;
+		if (++m_batchNext == m_batchEnd) {
+			EncodeSteps();
+		}
+	}
+	void RecordRead(bool a_valid, int a_value, const char *a_text, int a_length) {
+		EncodeSteps();
+		char *next = m_stepsNext;
+		if (!a_valid) {
+			next = PutVarint(next, 0);
+		}
+		else if (a_text == NULL) {
+			next = PutVarint(next, (ZigZag(a_value) << 1) + 1);
+		}
+		else {
+			next = PutVarint(next, (ZigZag(a_value) << 1 | 1) + 1);
+			next = PutVarint(next, (unsigned long long)a_length);
+			memcpy(next, a_text, a_length);
+			next += a_length;
+		}
+		m_stepsNext = next;
+		if (m_stepsNext >= m_stepsFull) {
+			SubmitSteps();
+		}
+	}
+	void RecordCheckpoint(long long a_step, int a_location, int a_accumulator, const emulator &a_emul);
+	void RecordEnd(const emulator::RunResult &a_result);
+
+	// The text a word of a checkpoint is shown as unless the checkpoint
+	// records another: its number, or nothing for a location holding 0.
+	static string ShownAs(int a_word) { return a_word == 0 ? string() : emulator::FormatWord(a_word); }
+
+	// Signed values as the unsigned values that are written.
+	static unsigned long long ZigZag(long long a_value) {
+		return ((unsigned long long)a_value << 1) ^ (unsigned long long)(a_value >> 63);
+	}
+	static long long UnZigZag(unsigned long long a_value) {
+		return (long long)(a_value >> 1) ^ -(long long)(a_value & 1);
+	}
+
+	// Appends a varint to a buffer.
+	static void AppendVarint(vector<char> &a_buffer, unsigned long long a_value);
+
+private:
+
+	// Bytes of step records collected before they are handed to the thread,
+	// and the most a single step with its READ value and text can add.
+	const static int BLOCK_SIZE = 1 << 16;
+	const static int MAX_RECORD = 32;
+
+	// Steps recorded before they are encoded.
+	const static int BATCH_SIZE = 4096;
+
+	// Frames that may wait for the thread before recording waits for it.
+	const static int MAX_QUEUED = 64;
+
+	ofstream m_file;
+	bool m_failed;				// A write to the file failed.
+
+	// The steps not yet encoded, where the next one goes and the end of
+	// the batch.
+	struct Step {
+		int location;
+		int accumulator;
+	};
+	vector<Step> m_batch;
+	Step *m_batchNext;
+	Step *m_batchEnd;
+
+	// The step records not yet handed over: where the next one goes, and
+	// where the buffer counts as full, leaving room for one more record.
+	// Then the location a step is expected at if it does not jump, and the
+	// accumulator before it.
+	vector<char> m_steps;
+	char *m_stepsNext;
+	char *m_stepsFull;
+	int m_nextLocation;
+	int m_accumulator;
+
+	// Frames waiting to be written, and used buffers to build frames in.
+	deque<vector<char> *> m_queue;
+	vector<vector<char> *> m_free;
+	mutex m_lock;
+	condition_variable m_queued;	// Signals the thread there is work.
+	condition_variable m_written;	// Signals recording there is room.
+	bool m_closing;
+	thread m_writer;
+
+	// Puts a varint at a_next and returns where the next byte goes.  The
+	// caller keeps the pointer in a local, so that the stores of the bytes
+	// cannot make it be reloaded.
+	static char *PutVarint(char *a_next, unsigned long long a_value) {
+		while (a_value >= 0x80) {
+			*a_next++ = (char)(a_value | 0x80);
+			a_value >>= 7;
+		}
+		*a_next++ = (char)a_value;
+		return a_next;
+	}
+
+	// Encodes the steps of the batch as step records.
+	void EncodeSteps();
+
+	// Hands the step records collected so far to the thread as an 'R' frame.
+	void SubmitSteps();
+
+	// Hands a frame to the thread.
+	void Submit(char a_tag, const char *a_data, size_t a_length);
+
+	// The thread: writes frames as they arrive until the trace is closed.
+	void WriteFrames();
+
+	// A trace cannot be copied.
+	TraceWriter(const TraceWriter &);
+	TraceWriter &operator=(const TraceWriter &);
+};
+
+#endif
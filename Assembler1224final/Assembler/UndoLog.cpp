@@ -0,0 +1,140 @@
+//
+//		Implementation of the UndoLog class.
+//
+#include "stdafx.h"
+#include "UndoLog.h"
+
+// Constructor sizes the ring from the memory budget, keeping at least one step.
+UndoLog::UndoLog(size_t a_bytes)
+{
+	size_t capacity = a_bytes / sizeof(Entry);
+	if (capacity < 1) {
+		capacity = 1;
+	}
+	m_capacity = (int)capacity;
+	m_entries.resize(m_capacity);
+	m_lastWrite.resize(emulator::MEMSZ);
+	Clear();
+}
+// Destructor currently does nothing.
+UndoLog::~UndoLog()
+{
+}
+
+
+
+/*
+NAME
+
+Clear - Forgets every step.
+
+SYNOPSIS
+
+void UndoLog::Clear();
+
+DESCRIPTION
+
+Empties the ring and forgets the last writer of every address.  The
+next step recorded is step 0.
+
+RETURNS
+
+Nothing.
+
+AUTHOR
+
+Charles Snyder
+*/
+void UndoLog::Clear()
+{
+	m_next = 0;
+	m_count = 0;
+	m_steps = 0;
+	fill(m_lastWrite.begin(), m_lastWrite.end(), -1LL);
+}
+
+
+
+/*
+NAME
+
+Undo - Takes the last step out of the log.
+
+SYNOPSIS
+
+bool UndoLog::Undo(Entry &a_entry);
+
+a_entry - passed by reference, set to what the step changed.
+
+DESCRIPTION
+
+The caller puts back the state held in a_entry.  The step that wrote the
+address before becomes its last writer again.
+
+RETURNS
+
+True if there was a step to take back, false if the log is empty.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool UndoLog::Undo(Entry &a_entry)
+{
+	if (m_count == 0) {
+		return false;
+	}
+	m_next = (m_next == 0 ? m_capacity : m_next) - 1;
+	m_count--;
+	m_steps--;
+	a_entry = m_entries[m_next];
+	if (a_entry.address != -1) {
+		m_lastWrite[a_entry.address] = a_entry.previousWrite;
+	}
+	return true;
+}
+
+
+
+/*
+NAME
+
+LastWrite - Finds the last step that wrote an address.
+
+SYNOPSIS
+
+bool UndoLog::LastWrite(int a_address, long long &a_step, int &a_location) const;
+
+a_address - the address asked about.
+
+a_step - passed by reference, set to the number of the step.
+
+a_location - passed by reference, set to the location of its instruction.
+
+DESCRIPTION
+
+Looks the step up in m_lastWrite, so this takes the same time however
+many steps the log holds.
+
+RETURNS
+
+True if the step is still in the log, false if no step wrote the address
+or the one that did has been forgotten.
+
+AUTHOR
+
+Charles Snyder
+*/
+bool UndoLog::LastWrite(int a_address, long long &a_step, int &a_location) const
+{
+	if (a_address < 0 || a_address >= emulator::MEMSZ) {
+		return false;
+	}
+	long long step = m_lastWrite[a_address];
+	if (step == -1 || step < m_steps - m_count) {
+		return false;
+	}
+	a_step = step;
+	a_location = m_entries[(int)(step % m_capacity)].location;
+	return true;
+}
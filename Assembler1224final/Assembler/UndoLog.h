@@ -0,0 +1,94 @@
+//
+//		UndoLog class - keeps what each step of a run changed so that it can be taken back.
+//
+#ifndef _UNDOLOG_H
+#define _UNDOLOG_H
+
+#include "Emulator.h"
+
+// A ring of the last steps of a run, one entry a step, holding the state
+// the step changed: the location it ran at, the accumulator before it and,
+// for a STORE or READ, the word it wrote over and how that was shown.  The ring is sized once from
+// a memory budget, and when it is full the oldest step is forgotten, so
+// recording a step costs the same however long the run is.
+//
+// Each entry of a write also holds the step of the write before it to the
+// same address, so that the last writer of every address is known at once
+// and stays right as steps are taken back.
+class UndoLog {
+
+public:
+
+	// What one step changed.
+	struct Entry {
+		int location;           // Where the instruction was.
+		int accumulator;        // The accumulator before it.
+		int word;               // What the address held before,
+		unsigned short shown;   // and how WRITE showed it.
+		short address;          // The address it wrote, -1 if it wrote nothing.
+		long long previousWrite;// The step that wrote the address before, -1 if none.
+	};
+
+	// The memory used by default.
+	const static size_t DEFAULT_BYTES = 64 << 20;
+
+	// Makes a log of as many steps as fit in a_bytes.
+	UndoLog(size_t a_bytes);
+	~UndoLog();
+
+	// Forgets every step, as at the start of a run.
+	void Clear();
+
+	// Records the next step.  a_address is -1 if the step wrote nothing.
+	void Record(int a_location, int a_accumulator, int a_address, int a_word, int a_shown) {
+		Entry &entry = m_entries[m_next];
+		entry.location = a_location;
+		entry.accumulator = a_accumulator;
+		entry.address = (short)a_address;
+		if (a_address != -1) {
+			entry.word = a_word;
+			entry.shown = (unsigned short)a_shown;
+			entry.previousWrite = m_lastWrite[a_address];
+			m_lastWrite[a_address] = m_steps;
+		}
+		m_steps++;
+		if (++m_next == m_capacity) {
+			m_next = 0;
+		}
+		if (m_count < m_capacity) {
+			m_count++;
+		}
+	}
+
+	// Takes the last step out of the log; false if none are left.
+	bool Undo(Entry &a_entry);
+
+	// Finds the last step that wrote an address and where it ran; false if
+	// no step still in the log did.
+	bool LastWrite(int a_address, long long &a_step, int &a_location) const;
+
+	// The steps recorded since Clear, less those taken back.
+	long long GetSteps() const { return m_steps; }
+
+	// The steps that can still be taken back, and the most the log holds.
+	int GetCount() const { return m_count; }
+	int GetCapacity() const { return m_capacity; }
+
+private:
+
+	vector<Entry> m_entries;
+	int m_capacity;
+	int m_next;                 // Where the next step is recorded.
+	int m_count;                // The steps held, the newest just before m_next.
+	long long m_steps;          // The number of the next step.
+
+	// The step that last wrote each address, -1 if none.  It can be older
+	// than the steps held, once they have been forgotten.
+	vector<long long> m_lastWrite;
+
+	// A log cannot be copied.
+	UndoLog(const UndoLog &);
+	UndoLog &operator=(const UndoLog &);
+};
+
+#endif
@@ -18,9 +18,18 @@
 #include <iomanip>
 #include <stdlib.h>
 #include <string>
+#include <string.h>
 #include <windows.h>
 #include <map>
+#include <algorithm>
+#include <vector>
+#include <deque>
 #include <sstream>
-#include <regex>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 using namespace std;
\ No newline at end of file
@@ -0,0 +1,8 @@
+; A label past the end of memory is translated with all of its digits,
+; and an instruction referring to it stops with the address error.
+        org 9998
+start   write one
+        load past
+one     dc 1
+past    dc 2
+        end start
@@ -0,0 +1,9 @@
+; An instruction whose label is not defined is translated with question
+; marks for its address, and running it stops the run.
+        org 100
+start   load one
+        write one
+        add nowhere
+        halt
+one     dc 1
+        end start
@@ -0,0 +1,15 @@
+; Divides by a word that the program has counted down to zero.
+        org 100
+start   load three
+loop    sub one
+        bp loop
+        store count
+        load ten
+        div count
+        write count
+        halt
+three   dc 3
+one     dc 1
+ten     dc 10
+count   ds 1
+        end start
@@ -0,0 +1,21 @@
+; DS reserves words without loading them, so writing one shows 0.  A DS
+; that reaches past the end of memory leaves the next line at an invalid
+; location.  ORG can move back over words already assembled, and the
+; later word is the one loaded.  The last ORG sets where the run starts.
+        org 9998
+last    ds 5
+        org 50
+early   dc 1
+        org 200
+        load early
+        halt
+        org 200
+start   write gap
+        load five
+        store gap
+        write gap
+        write early
+        halt
+gap     ds 1
+five    dc 5
+        end start
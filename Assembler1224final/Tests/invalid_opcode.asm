@@ -0,0 +1,6 @@
+; Runs on from the last instruction into a constant, whose opcode is 00.
+        org 100
+start   load one
+        write one
+one     dc 1
+        end start
@@ -0,0 +1,34 @@
+; Sums 1 to 10 in a loop and writes the sum, twice, going back to the
+; start through a branch that is compiled the first time.  The second
+; time a halt is stored over that branch before it is run again.
+        org 100
+start   load ten
+        store count
+        load zero
+        store sum
+loop    load sum
+        add count
+        store sum
+        load count
+        sub one
+        store count
+        bp loop
+        write sum
+        load again
+        bp last
+        load one
+        store again
+patch   b start
+last    load halt
+        mult hundred
+        store patch
+        b patch
+halt    dc 1300
+hundred dc 100
+again   dc 0
+count   dc 0
+sum     dc 0
+ten     dc 10
+one     dc 1
+zero    dc 0
+        end start
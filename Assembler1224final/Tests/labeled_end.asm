@@ -0,0 +1,7 @@
+; END may not have a label.  The line is then not taken as the end of
+; the program and is translated like an instruction.
+        org 100
+start   load one
+        write one
+one     dc 1
+fin     end start
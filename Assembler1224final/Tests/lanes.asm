@@ -0,0 +1,13 @@
+; Writes the value read, then runs off the end of memory if it is positive
+; and halts otherwise.  lanes.man runs it over both kinds of input at once.
+        org 9998
+far     load x
+        add x
+        org 100
+start   read x
+        write x
+        load x
+        bp far
+        halt
+x       dc 0
+        end start
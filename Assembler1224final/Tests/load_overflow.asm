@@ -0,0 +1,11 @@
+; A constant too large for a word is flagged with question marks, and
+; loading it stops the run.
+        org 100
+start   load small
+        write small
+        load big
+        write big
+        halt
+small   dc 9999
+big     dc 123456
+        end start
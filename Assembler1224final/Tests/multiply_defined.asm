@@ -0,0 +1,9 @@
+; A branch to a label defined twice is translated with -999 as its
+; address, and running it stops with the address error.
+        org 100
+start   write one
+        b twice
+twice   dc 5
+twice   dc 6
+one     dc 1
+        end start
@@ -0,0 +1,4 @@
+; Without an ORG or an END there is no start location.
+        load one
+        halt
+one     dc 1
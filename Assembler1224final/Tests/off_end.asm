@@ -0,0 +1,8 @@
+; Runs off the last location of memory, which is an address error.
+        org 100
+a       dc 5
+        org 9997
+start   load a
+        add a
+        add a
+        end start
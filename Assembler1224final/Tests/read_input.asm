@@ -0,0 +1,11 @@
+; Reads until a zero, writing back each value read.  Input that is not a
+; number is asked for again, and only the first six characters are kept.
+        org 100
+start   read x
+        write x
+        load x
+        bp start
+        bm start
+        halt
+x       ds 1
+        end start
@@ -0,0 +1,147 @@
+#!/bin/sh
+#
+#		Regression tests for the VC3600 assembler and emulator.
+#
+# Usage: run_tests.sh <Assem>
+#
+# Each program NAME.asm here is assembled and run with NAME.in as its
+# input, or no input if there is none, and everything it displays, the
+# listing, the errors and the results of the run, must be exactly what
+# NAME.expected holds.  It must display exactly the same when it is run
+# with --jit and when it is assembled with --single-pass.  It is also
+# written to an object file and run from that with --run, which must give
+# the same results, apart from naming the line an error came from.  It
+# must display the same when it is traced, and a rerun of the trace,
+# when the run started, must end as the traced run did.
+#
+# A program too long for one chunk of the passes is generated and must be
+# assembled and run the same on several threads as on one, and with
+# --single-pass.
+#
+# Each manifest NAME.man is run with --batch and again with --batch
+# --lanes, and both must give the results in NAME.results, leaving out
+# the milliseconds each job took.
+#
+# Each program is also run with --debug, which must start at the number
+# of steps --batch gives for it.
+#
+# Exits with the number of tests that failed.
+#
+if [ $# -ne 1 ] || [ ! -x "$1" ]; then
+	echo "Usage: run_tests.sh <Assem>" >&2
+	exit 1
+fi
+assem=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+cd "$(dirname "$0")" || exit 1
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+failed=0
+
+# Reports a failure and the first lines that differ.
+fail()
+{
+	echo "FAIL $1"
+	diff "$2" "$3" | head -20
+	failed=$((failed + 1))
+}
+
+# The results of a run, from what Assem displayed.
+results()
+{
+	sed -n '/^Results from emulating program:/,$p' "$1" | grep -v '^The instruction at location'
+}
+
+for source in *.asm; do
+	name=${source%.asm}
+	input=/dev/null
+	if [ -f "$name.in" ]; then
+		input=$name.in
+	fi
+
+	"$assem" "$source" < "$input" > "$work/out" 2>&1
+	cmp -s "$name.expected" "$work/out" || fail "$name" "$name.expected" "$work/out"
+
+	"$assem" --jit "$source" < "$input" > "$work/jit" 2>&1
+	cmp -s "$name.expected" "$work/jit" || fail "$name --jit" "$name.expected" "$work/jit"
+
+	"$assem" --single-pass "$source" < "$input" > "$work/single" 2>&1
+	cmp -s "$name.expected" "$work/single" || fail "$name --single-pass" "$name.expected" "$work/single"
+
+	"$assem" --no-listing --object="$work/object" "$source" < "$input" > /dev/null 2>&1
+	"$assem" --run "$work/object" < "$input" > "$work/run" 2>&1
+	results "$name.expected" > "$work/expected"
+	results "$work/run" > "$work/object.out"
+	cmp -s "$work/expected" "$work/object.out" || fail "$name --run" "$work/expected" "$work/object.out"
+
+	"$assem" --trace="$work/trace" "$source" < "$input" > "$work/traced" 2>&1
+	cmp -s "$name.expected" "$work/traced" || fail "$name --trace" "$name.expected" "$work/traced"
+	"$assem" --replay "$work/trace" --rerun > "$work/rerun" 2>&1
+	if grep -q '^The rerun did not end' "$work/rerun"; then
+		fail "$name --replay --rerun" /dev/null "$work/rerun"
+	fi
+done
+
+# Blocks of a comment and an addition, the constants they add, and errors
+# that are not run, enough lines for several chunks.
+awk 'BEGIN {
+	print "        org 10"
+	print "start   load zero"
+	for (i = 0; i < 4000; i++) {
+		printf "; Block %d\n", i
+		printf "s%d      add v%d\n", i, i
+	}
+	print "        store sum"
+	print "        write sum"
+	print "        halt"
+	print "        b nowhere"
+	for (i = 0; i < 4000; i++) {
+		printf "v%d      dc %d\n", i, i % 7
+		if (i == 2000) {
+			print "s3      dc 3"
+		}
+	}
+	print "sum     ds 1"
+	print "zero    dc 0"
+	print "        end start"
+}' > "$work/long.asm"
+"$assem" --threads=1 "$work/long.asm" < /dev/null > "$work/serial" 2>&1
+for option in --threads=2 --threads=4 --single-pass; do
+	"$assem" $option "$work/long.asm" < /dev/null > "$work/long" 2>&1
+	cmp -s "$work/serial" "$work/long" || fail "long $option" "$work/serial" "$work/long"
+done
+
+# The results of a batch, without the column of milliseconds.
+batch()
+{
+	"$assem" --batch "$@" 2>&1 | awk -F '\t' 'BEGIN { OFS = "\t" } { $6 = ""; print }'
+}
+
+for manifest in *.man; do
+	name=${manifest%.man}
+
+	batch "$manifest" > "$work/batch"
+	cmp -s "$name.results" "$work/batch" || fail "$name --batch" "$name.results" "$work/batch"
+
+	batch "$manifest" --lanes > "$work/lanes"
+	cmp -s "$name.results" "$work/lanes" || fail "$name --batch --lanes" "$name.results" "$work/lanes"
+done
+
+# Every engine counts the steps of a run the same way, the instruction
+# that stops it included, so --debug starts at the step --batch gives.
+for source in *.asm; do
+	name=${source%.asm}
+	input=
+	if [ -f "$name.in" ]; then
+		input=$name.in
+	fi
+	echo "$source $input" > "$work/one.man"
+	batch "$work/one.man" | sed -n '2s/^[^\t]*\t[^\t]*\t[^\t]*\t[^\t]*\t\([^\t]*\).*/Step \1/p' > "$work/steps"
+	"$assem" --debug --input="${input:-/dev/null}" "$source" < /dev/null 2>&1 | grep -m 1 -o '^Step [0-9]*' > "$work/debug"
+	cmp -s "$work/steps" "$work/debug" || fail "$name --debug steps" "$work/steps" "$work/debug"
+done
+
+if [ $failed -eq 0 ]; then
+	echo "All tests passed"
+fi
+exit $failed
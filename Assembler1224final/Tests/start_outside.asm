@@ -0,0 +1,6 @@
+; A numeric ORG sets the start location, which here is outside memory, so
+; the run stops with the address error before executing anything.
+        org 100
+        halt
+        org 12345
+        end
@@ -0,0 +1,10 @@
+; Squares a number until the product no longer fits in a word, which
+; stops the run at the store.
+        org 100
+start   load n
+        mult n
+        store n
+        write n
+        b start
+n       dc 7
+        end start